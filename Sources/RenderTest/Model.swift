@@ -30,15 +30,14 @@ struct Model {
             var triangles: [Triangle] = []
             var positions: [Vector3] = []
 
-            _ = mesh.enumerateVertexBufferContent(semantic: .position,
-                                                  context: deviceContext) {
-                data, format, index in
+            _ = mesh.withVertexBufferContent(semantic: .position,
+                                             context: deviceContext) {
+                data, format, stride, count in
                 if format == .float3 {
-                    let v = data.assumingMemoryBound(to: Float3.self).pointee
-                    positions.append(Vector3(v).applying(transform, w: 1.0))
-                    return true
+                    let source = StridedVectors(readOnly: data, stride: stride,
+                                                count: count, format: .float3)
+                    positions = BatchTransform(transform).transformedPoints(source)
                 }
-                return false
             }
             var indices: [Int] = []
             if mesh.indexBuffer != nil {
@@ -102,15 +101,14 @@ struct Model {
             var faces: [TriangleFace] = []
 
             var positions: [Vector3] = []
-            _ = mesh.enumerateVertexBufferContent(semantic: .position,
-                                                  context: deviceContext) {
-                data, format, index in
+            _ = mesh.withVertexBufferContent(semantic: .position,
+                                             context: deviceContext) {
+                data, format, stride, count in
                 if format == .float3 {
-                    let v = data.assumingMemoryBound(to: Float3.self).pointee
-                    positions.append(Vector3(v).applying(transform, w: 1.0))
-                    return true
+                    let source = StridedVectors(readOnly: data, stride: stride,
+                                                count: count, format: .float3)
+                    positions = BatchTransform(transform).transformedPoints(source)
                 }
-                return false
             }
             var uvs: [Vector2] = []
             _ = mesh.enumerateVertexBufferContent(semantic: .textureCoordinates,
@@ -287,7 +285,9 @@ extension SceneNode {
     }
 }
 
-func loadModel(from path: String, shader: MaterialShaderMap? = nil, queue: CommandQueue) -> Model? {
+// resources of the model are ready to use on the queue when it returns.
+func loadModel(from path: String, shader: MaterialShaderMap? = nil, queue: CommandQueue,
+               uploadManager: UploadManager? = nil) async -> Model? {
     var loader = tinygltf.TinyGLTF()
     var model = tinygltf.Model()
     var err = std.string()
@@ -306,8 +306,15 @@ func loadModel(from path: String, shader: MaterialShaderMap? = nil, queue: Comma
     }
 
     if result {
+        // buffers and images are uploaded in batches through the staging ring.
+        guard let uploadManager = uploadManager ?? UploadManager(queue: queue) else {
+            Log.error("UploadManager init failed")
+            return nil
+        }
+        let loadStart = Date()
+
         let defaultImage = Image(width: 1, height: 1, pixelFormat: .rgba8, content: Color(1, 0, 1, 1).rgba8)
-        let defaultTexture = defaultImage.makeTexture(commandQueue: queue, usage: [.sampled, .storage])
+        let defaultTexture = defaultImage.makeTexture(uploadManager: uploadManager, usage: [.sampled, .storage])
         guard let defaultTexture else {
             Log.error("Image.makeTexture failed")
             return nil
@@ -323,6 +330,7 @@ func loadModel(from path: String, shader: MaterialShaderMap? = nil, queue: Comma
         let shaderMap = shader ?? MaterialShaderMap(functions: [], resourceSemantics: [:], inputAttributeSemantics: [:])
         let context = LoaderContext(model: model,
                                     queue: queue,
+                                    uploadManager: uploadManager,
                                     shader: shaderMap,
                                     defaultTexture: defaultTexture,
                                     defaultSampler: defaultSampler)
@@ -331,6 +339,11 @@ func loadModel(from path: String, shader: MaterialShaderMap? = nil, queue: Comma
         loadSamplerDescriptors(context)
         loadMaterials(context)
         loadMeshes(context)
+        await uploadManager.flush()?.completed()
+
+        let elapsed = Date().timeIntervalSince(loadStart)
+        let stats = uploadManager.statistics
+        Log.info("glTF resources: \(stats.uploads) uploads (\(stats.bytes) bytes), \(stats.submissions) submissions in \(String(format: "%.3f", elapsed)) seconds (\(String(format: "%.1f", Double(stats.submissions) / max(elapsed, .ulpOfOne))) submissions/s)")
 
         var scenes: [Model.Scene] = []
         context.model.scenes.forEach {
@@ -345,6 +358,7 @@ func loadModel(from path: String, shader: MaterialShaderMap? = nil, queue: Comma
 fileprivate class LoaderContext {
     let model: tinygltf.Model
     let queue: CommandQueue
+    let uploadManager: UploadManager
     let shader: MaterialShaderMap
 
     var defaultTexture: Texture
@@ -356,9 +370,10 @@ fileprivate class LoaderContext {
     var meshes: [SceneNode] = []
     var samplerDescriptors: [SamplerDescriptor] = []
 
-    init(model: tinygltf.Model, queue: CommandQueue, shader: MaterialShaderMap, defaultTexture: Texture, defaultSampler: SamplerState) {
+    init(model: tinygltf.Model, queue: CommandQueue, uploadManager: UploadManager, shader: MaterialShaderMap, defaultTexture: Texture, defaultSampler: SamplerState) {
         self.model = model
         self.queue = queue
+        self.uploadManager = uploadManager
         self.shader = shader
         self.defaultTexture = defaultTexture
         self.defaultSampler = defaultSampler
@@ -371,25 +386,25 @@ fileprivate extension Collection where Self.Index == Int {
     }
 }
 
-fileprivate func makeBuffer<T>(_ cbuffer: CommandBuffer,
+fileprivate func makeBuffer<T>(_ uploadManager: UploadManager,
                                length: Int,
                                data: UnsafePointer<T>?,
                                storageMode: StorageMode = .private,
                                cpuCacheMode: CPUCacheMode = .defaultCache) -> GPUBuffer? {
     let ptr = UnsafeRawBufferPointer(start: data, count: length)
     if let data = ptr.baseAddress, ptr.count > 0 {
-        return makeBuffer(cbuffer, length: ptr.count, data: data, storageMode: storageMode, cpuCacheMode: cpuCacheMode)
+        return makeBuffer(uploadManager, length: ptr.count, data: data, storageMode: storageMode, cpuCacheMode: cpuCacheMode)
     }
     return nil
 }
 
-fileprivate func makeBuffer(_ cbuffer: CommandBuffer,
+fileprivate func makeBuffer(_ uploadManager: UploadManager,
                             length: Int,
                             data: UnsafeRawPointer,
                             storageMode: StorageMode = .private,
                             cpuCacheMode: CPUCacheMode = .defaultCache) -> GPUBuffer? {
     assert(length > 0)
-    let device = cbuffer.device
+    let device = uploadManager.queue.device
 
     if storageMode == .shared {
         guard let buffer = device.makeBuffer(length: length,
@@ -407,50 +422,27 @@ fileprivate func makeBuffer(_ cbuffer: CommandBuffer,
         buffer.flush()
         return buffer
     } else {
-        guard let stgBuffer = device.makeBuffer(length: length,
-                                                storageMode: .shared,
-                                                cpuCacheMode: .writeCombined)
-        else {
-            Log.error("makeBuffer(length: \(length), storageMode: .shared, cpuCacheMode: writeCombined)) failed.")
-            return nil
-        }
-        if let ptr = stgBuffer.contents() {
-            ptr.copyMemory(from: data, byteCount: length)
-            stgBuffer.flush()
-        } else {
-            Log.error("GPUBuffer map failed")
-            return nil
-        }
-
         guard let buffer = device.makeBuffer(length: length,
                                              storageMode: storageMode,
                                              cpuCacheMode: cpuCacheMode) else {
             Log.error("makeBuffer(length: \(length), storageMode: \(storageMode), cpuCacheMode: \(cpuCacheMode)) failed.")
             return nil
         }
-        guard let encoder = cbuffer.makeCopyCommandEncoder() else {
-            Log.error("makeCopyCommandEncoder failed.")
+        if uploadManager.upload(UnsafeRawBufferPointer(start: data, count: length), to: buffer) == nil {
+            Log.error("UploadManager.upload failed.")
             return nil
         }
-        encoder.copy(from: stgBuffer, sourceOffset: 0, to: buffer, destinationOffset: 0, size: length)
-        encoder.endEncoding()
-
         return buffer
     }
 }
 
 fileprivate func loadBuffers(_ context: LoaderContext) {
-    guard let cbuffer = context.queue.makeCommandBuffer() else {
-        fatalError("CommandQueue.makeCommandBuffer failed.")
-    }
-
     context.buffers = context.model.buffers.map {
-        guard let buffer = makeBuffer(cbuffer, length: $0.data.count, data: $0.data.__dataUnsafe())
+        guard let buffer = makeBuffer(context.uploadManager, length: $0.data.count, data: $0.data.__dataUnsafe())
         else { fatalError("makeBuffer failed") }
         return buffer
     }
     assert(context.buffers.count == context.model.buffers.count)
-    cbuffer.commit()
 }
 
 fileprivate func loadImages(_ context: LoaderContext) {
@@ -485,7 +477,7 @@ fileprivate func loadImages(_ context: LoaderContext) {
         }
         let data = UnsafeBufferPointer(start: $0.image.__dataUnsafe(), count: $0.image.count)
         let image = Image(width: width, height: height, pixelFormat: imageFormat, data: UnsafeRawBufferPointer(data))
-        if let texture = image.makeTexture(commandQueue: context.queue) {
+        if let texture = image.makeTexture(uploadManager: context.uploadManager) {
             return texture
         }
         Log.error("Failed to load image: \($0.name)")
@@ -607,10 +599,6 @@ fileprivate func loadMaterials(_ context: LoaderContext) {
 }
 
 fileprivate func loadMeshes(_ context: LoaderContext) {
-    guard let cbuffer = context.queue.makeCommandBuffer() else {
-        fatalError("makeCommandBuffer failed")
-    }
-
     context.meshes = context.model.meshes.map { mesh in
         let meshName = String(mesh.name)
         var node = SceneNode(name: meshName)
@@ -619,6 +607,8 @@ fileprivate func loadMeshes(_ context: LoaderContext) {
             let mesh = Mesh()
 
             var positions: [Vector3] = []
+            var vertexNormals: [Vector3] = []
+            var vertexUVs: [Vector2] = []
             var indices: [Int] = []
             var hasVertexNormal = false
             var hasVertexColor = false
@@ -744,10 +734,26 @@ fileprivate func loadMeshes(_ context: LoaderContext) {
                 case "NORMAL":
                     attribute.semantic = .normal
                     hasVertexNormal = true
+                    if attribute.format == .float3 {
+                        // for the attribute error of the mesh simplifier
+                        var ptr = UnsafeRawPointer(buffer.data.__dataUnsafe()!)
+                        ptr += bufferOffset + attribOffset
+                        vertexNormals = (0..<accessor.count).map { i in
+                            Vector3((ptr + i * Int(vertexStride)).load(as: Float3.self))
+                        }
+                    }
                 case "TANGENT":
                     attribute.semantic = .tangent
                 case "TEXCOORD_0":
                     attribute.semantic = .textureCoordinates
+                    if attribute.format == .float2 {
+                        var ptr = UnsafeRawPointer(buffer.data.__dataUnsafe()!)
+                        ptr += bufferOffset + attribOffset
+                        vertexUVs = (0..<accessor.count).map { i in
+                            let uv = (ptr + i * Int(vertexStride)).load(as: Float2.self)
+                            return Vector2(Scalar(uv.0), Scalar(uv.1))
+                        }
+                    }
                 case "COLOR_0":
                     attribute.semantic = .color
                     hasVertexColor = true
@@ -805,7 +811,7 @@ fileprivate func loadMeshes(_ context: LoaderContext) {
                         indices.append(Int(index))
                     }
 
-                    guard let buffer = makeBuffer(cbuffer, length: indexData.count * 2, data: &indexData)
+                    guard let buffer = makeBuffer(context.uploadManager, length: indexData.count * 2, data: &indexData)
                     else { fatalError("makeBuffer failed") }
 
                     mesh.indexBuffer = buffer
@@ -833,6 +839,51 @@ fileprivate func loadMeshes(_ context: LoaderContext) {
                 positions.indices.forEach { indices.append($0) }
             }
 
+            // reorder triangles for the vertex cache and overdraw.
+            // vertices are shared glTF buffers and keep their order.
+            if mesh.primitiveType == .triangle && primitive.indices >= 0 &&
+                positions.isEmpty == false && indices.count >= 3 {
+                let source = indices.map { UInt32($0) }
+                let optimized = MeshOptimizer.optimizeOverdraw(indices: source, positions: positions)
+                let before = MeshOptimizer.analyzeVertexCache(indices: source, vertexCount: positions.count)
+                let after = MeshOptimizer.analyzeVertexCache(indices: optimized, vertexCount: positions.count)
+                Log.debug("Mesh: \(meshName), ACMR: \(before.acmr) -> \(after.acmr)")
+
+                var buffer: GPUBuffer? = nil
+                if mesh.indexType == .uint16 {
+                    let indexData = optimized.map { UInt16($0) }
+                    buffer = makeBuffer(context.uploadManager, length: indexData.count * 2, data: indexData)
+                } else {
+                    buffer = makeBuffer(context.uploadManager, length: optimized.count * 4, data: optimized)
+                }
+                guard let buffer else { fatalError("makeBuffer failed") }
+                mesh.indexBuffer = buffer
+                mesh.indexBufferByteOffset = 0
+                mesh.indexCount = optimized.count
+                indices = optimized.map { Int($0) }
+
+                // levels of detail, sharing the vertex buffers of the mesh.
+                let levels = MeshSimplifier.generateLODChain(
+                    indices: optimized,
+                    positions: positions,
+                    normals: vertexNormals.count == positions.count ? vertexNormals : nil,
+                    uvs: vertexUVs.count == positions.count ? vertexUVs : nil)
+                mesh.lods = levels.map { level in
+                    let lodIndices = MeshOptimizer.optimizeVertexCache(indices: level.indices,
+                                                                       vertexCount: positions.count)
+                    var buffer: GPUBuffer? = nil
+                    if mesh.indexType == .uint16 {
+                        let indexData = lodIndices.map { UInt16($0) }
+                        buffer = makeBuffer(context.uploadManager, length: indexData.count * 2, data: indexData)
+                    } else {
+                        buffer = makeBuffer(context.uploadManager, length: lodIndices.count * 4, data: lodIndices)
+                    }
+                    guard let buffer else { fatalError("makeBuffer failed") }
+                    return Mesh.LOD(indexBuffer: buffer, indexCount: lodIndices.count, error: level.error)
+                }
+                Log.debug("Mesh: \(meshName), LOD triangles: \([optimized.count / 3] + levels.map { $0.indices.count / 3 }), errors: \(levels.map { $0.error })")
+            }
+
             if hasVertexNormal == false {
                 var normals = [Vector3](repeating: Vector3.zero, count: positions.count)
 
@@ -871,7 +922,7 @@ fileprivate func loadMeshes(_ context: LoaderContext) {
                 }
 
                 let normalData = normals.map { $0.float3 }
-                let buffer = makeBuffer(cbuffer,
+                let buffer = makeBuffer(context.uploadManager,
                                         length: normals.count * MemoryLayout<Float3>.size,
                                         data: normalData)
                 guard let buffer else {
@@ -891,7 +942,7 @@ fileprivate func loadMeshes(_ context: LoaderContext) {
 
             if hasVertexColor == false {
                 let colors = [Float4](repeating: Vector4(1, 1, 1, 1).float4, count: positions.count)
-                let buffer = makeBuffer(cbuffer, length: colors.count * MemoryLayout<Float4>.size, data: colors)
+                let buffer = makeBuffer(context.uploadManager, length: colors.count * MemoryLayout<Float4>.size, data: colors)
                 guard let buffer else {
                     fatalError("makeBuffer failed")
                 }
@@ -928,7 +979,6 @@ fileprivate func loadMeshes(_ context: LoaderContext) {
         }
         return node
     }
-    cbuffer.commit()
 }
 
 fileprivate func loadNode(_ context: LoaderContext, node: tinygltf.Node, transform baseTM: Matrix4) -> SceneNode {
@@ -98,7 +98,9 @@ class RenderTestApp: ApplicationDelegate, WindowDelegate, @unchecked Sendable {
 
         // load gltf
         let modelPath = appResourcesRoot + "/glTF/Duck/glTF-Binary/Duck.glb"
-        let model = loadModel(from: modelPath, shader: shader, queue: queue)
+        // uploaded on the transfer queue and handed off to the render queue.
+        let uploadManager = self.graphicsContext?.asyncUploadManager
+        let model = await loadModel(from: modelPath, shader: shader, queue: queue, uploadManager: uploadManager)
         guard let model else {
             fatalError("Failed to load glTF at path: '\(modelPath)\'.")
         }
@@ -226,11 +228,15 @@ class RenderTestApp: ApplicationDelegate, WindowDelegate, @unchecked Sendable {
                                                  fov: fov,
                                                  near: 1.0,
                                                  far: 1000.0)
+            let lodSelector = LODSelector(view: sceneState.view,
+                                          projection: sceneState.projection,
+                                          viewportHeight: Scalar(height))
 
             model.scenes[model.defaultSceneIndex].forEachNode { node, transform in
                 if let mesh = node.mesh {
                     mesh.updateShadingProperties(sceneState: sceneState)
-                    mesh.encodeRenderCommand(encoder: encoder)
+                    mesh.encodeRenderCommand(encoder: encoder,
+                                             lod: lodSelector.lod(for: mesh, transform: sceneState.model))
                 }
             }
             encoder.endEncoding()
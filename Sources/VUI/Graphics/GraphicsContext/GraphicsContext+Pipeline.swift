@@ -136,7 +136,7 @@ class GraphicsPipelineStates {
         let blendState: BlendState
         let sampleCount: Int
     }
-    private var renderStates: [RenderStateDescriptor: RenderPipelineState] = [:]
+    private let renderStates = AsyncPipelineCompiler<RenderStateDescriptor, RenderPipelineState>()
     private var depthStencilStates: [_Stencil: DepthStencilState] = [:]
 
     func renderState(shader: _Shader,
@@ -151,16 +151,26 @@ class GraphicsPipelineStates {
                                           sampleCount: sampleCount))
     }
 
+    // blocks until the state is ready.
     func renderState(_ rs: RenderStateDescriptor) -> RenderPipelineState? {
-
         assert(rs.sampleCount.isPowerOfTwo,
                "sampleCount must be a power of two and greater than zero.")
+        return renderStates.waitForState(for: rs) { makeRenderState(rs) }
+    }
 
-        Self.lock.lock()
-        defer { Self.lock.unlock() }
-
-        if let state = renderStates[rs] { return state }
+    // returns .pending while the state is compiled on a worker thread,
+    // whenDone is called on the worker thread when it is finished.
+    func renderStateIfReady(_ rs: RenderStateDescriptor,
+                            whenDone: (() -> Void)? = nil) -> AsyncPipelineCompiler<RenderStateDescriptor, RenderPipelineState>.Status {
+        assert(rs.sampleCount.isPowerOfTwo,
+               "sampleCount must be a power of two and greater than zero.")
+        // the states may be released while the job is queued.
+        return renderStates.state(for: rs,
+                                  compile: { [weak self] in self?.makeRenderState(rs) },
+                                  whenDone: whenDone)
+    }
 
+    private func makeRenderState(_ rs: RenderStateDescriptor) -> RenderPipelineState? {
         guard let shader = shaderFunctions[rs.shader] else { return nil }
 
         var pipelineDescriptor = RenderPipelineDescriptor()
@@ -195,8 +205,7 @@ class GraphicsPipelineStates {
         if let state = device.makeRenderPipelineState(descriptor: pipelineDescriptor,
                                                       reflection: &reflection) {
             Log.debug("RenderPipelineState (_Shader.\(rs.shader)) Reflection: \(reflection)")
-            renderStates[rs] = state
-            return renderStates[rs]
+            return state
         }
         return nil
     }
@@ -269,7 +278,6 @@ class GraphicsPipelineStates {
         self.bindingLayout2 = bindingLayout2
         self.defaultSampler = defaultSampler
         self.defaultMaskTexture = defaultMaskTexture
-        self.renderStates = [:]
         self.depthStencilStates = [:]
     }
 
@@ -470,6 +478,8 @@ extension GraphicsContext {
         if let queue = deviceContext.renderQueue() {
             if let state = GraphicsPipelineStates.sharedInstance(commandQueue: queue) {
                 deviceContext.cachedDeviceResources["VUI.GraphicsPipelineStates"] = state
+                deviceContext.cachedDeviceResources["VUI.RenderTargetPool"] =
+                    RenderTargetPool.sharedInstance(device: deviceContext.device)
                 return true
             }
         }
@@ -581,10 +591,15 @@ extension GraphicsContext {
             return nil
         }
         let viewport = viewport.standardized
-        let x = Int(viewport.origin.x)
-        let y = Int(viewport.origin.y)
-        let width = Int(viewport.width)
-        let height = Int(viewport.height)
+        var scissor = viewport
+        if let redrawRect {
+            scissor = scissor.intersection(redrawRect)
+            if scissor.isNull { scissor = CGRect(origin: viewport.origin, size: .zero) }
+        }
+        let x = Int(scissor.origin.x)
+        let y = Int(scissor.origin.y)
+        let width = Int(scissor.width)
+        let height = Int(scissor.height)
 
         encoder.setViewport(Viewport(x: viewport.origin.x,
                                      y: viewport.origin.y,
@@ -617,12 +632,21 @@ extension GraphicsContext {
 
         if vertices.isEmpty { return }
 
-        guard let renderState = pipeline.renderState(
-            shader: shader,
-            colorFormat: renderPass.colorFormat,
-            depthFormat: renderPass.depthFormat,
-            blendState: blendState,
-            sampleCount: renderPass.sampleCount) else {
+        // first use of a state, the draw is skipped instead of stalling
+        // the frame and the window is redrawn when the state is ready.
+        let scheduler = self.sharedContext.redrawScheduler
+        let renderState: RenderPipelineState
+        switch pipeline.renderStateIfReady(.init(shader: shader,
+                                                 colorFormat: renderPass.colorFormat,
+                                                 depthFormat: renderPass.depthFormat,
+                                                 blendState: blendState,
+                                                 sampleCount: renderPass.sampleCount),
+                                           whenDone: { scheduler.invalidate() }) {
+        case .ready(let state):
+            renderState = state
+        case .pending:
+            return
+        case .failed:
             Log.err("GraphicsContext error: pipeline.renderState failed.")
             return
         }
@@ -73,6 +73,7 @@ public struct GraphicsContext {
         self.commandBuffer = commandBuffer
         self.contentScaleFactor = contentScaleFactor
         self.renderTargets = renderTargets
+        renderTargets.usage.use(commandBuffer)
 
         let queue = commandBuffer.commandQueue
         guard let pipeline = GraphicsPipelineStates.sharedInstance(
@@ -123,6 +124,10 @@ public struct GraphicsContext {
 
     public internal(set) var clipBoundingRect: CGRect = .zero
 
+    // region of the viewport to be redrawn in pixels, render passes of
+    // this context are scissored to it. layer contexts draw entirely.
+    var redrawRect: CGRect? = nil
+
     var filters: [(Filter, FilterOptions)] = []
 
     var backdrop: Texture { renderTargets.backdrop }
@@ -149,7 +154,11 @@ extension GraphicsContext {
 
         let renderTargetMSAA: Texture
         let stencilBufferMSAA: Texture
-        let msaaSampleCount = 4
+        static let msaaSampleCount = 4
+        var msaaSampleCount: Int { Self.msaaSampleCount }
+
+        let pool: RenderTargetPool
+        let usage: Usage
 
         var width: Int { backdrop.width }
         var height: Int { backdrop.height }
@@ -158,50 +167,107 @@ extension GraphicsContext {
         var colorFormat: PixelFormat { backdrop.pixelFormat }
         var depthFormat: PixelFormat { stencilBuffer.pixelFormat }
 
-        init?(device: GraphicsDevice, width: Int, height: Int) {
-            let makeRenderTarget = {
-                (format: PixelFormat, usage: TextureUsage) -> Texture? in
-                device.makeTexture(
-                    descriptor: TextureDescriptor(textureType: .type2D,
-                                                  pixelFormat: format,
-                                                  width: width,
-                                                  height: height,
-                                                  usage: usage))
+        // Tracks the command buffers using the targets. The textures are
+        // returned to the pool when the targets are released and these
+        // command buffers are completed. If only one is in flight, they
+        // are reusable by that command buffer at once.
+        final class Usage: @unchecked Sendable {
+            let pool: RenderTargetPool
+            private var inFlight: [ObjectIdentifier] = []
+            private var released: [Texture] = []
+            private var recycledFor: ObjectIdentifier? = nil
+            private let lock = NSLock()
+
+            init(pool: RenderTargetPool) {
+                self.pool = pool
+            }
+
+            func use(_ commandBuffer: CommandBuffer) {
+                let id = ObjectIdentifier(commandBuffer as AnyObject)
+                let added = self.lock.withLock {
+                    if self.inFlight.contains(id) { return false }
+                    self.inFlight.append(id)
+                    return true
+                }
+                if added {
+                    commandBuffer.addCompletedHandler { _ in
+                        self.completed(id)
+                    }
+                }
+            }
+
+            func release(_ textures: [Texture]) {
+                self.lock.withLock {
+                    switch self.inFlight.count {
+                    case 0:
+                        textures.forEach { self.pool.recycle($0) }
+                    case 1:
+                        let commandBuffer = self.inFlight[0]
+                        textures.forEach { self.pool.recycle($0, commandBuffer: commandBuffer) }
+                        self.recycledFor = commandBuffer
+                    default:
+                        self.released = textures
+                    }
+                }
+            }
+
+            private func completed(_ id: ObjectIdentifier) {
+                self.lock.withLock {
+                    self.inFlight.removeAll { $0 == id }
+                    if self.recycledFor == id {
+                        self.pool.commandBufferCompleted(id)
+                        self.recycledFor = nil
+                    }
+                    if self.inFlight.isEmpty && self.released.isEmpty == false {
+                        self.released.forEach { self.pool.recycle($0) }
+                        self.released = []
+                    }
+                }
             }
-            let usage: TextureUsage = [.renderTarget, .sampled]
-            if let renderTarget = makeRenderTarget(.rgba8Unorm, usage) {
-                self.source = renderTarget
-            } else { return nil }
-            if let renderTarget = makeRenderTarget(.rgba8Unorm, usage) {
-                self.backdrop = renderTarget
-            } else { return nil }
-            if let renderTarget = makeRenderTarget(.rgba8Unorm, usage) {
-                self.composited = renderTarget
-            } else { return nil }
-            if let renderTarget = makeRenderTarget(.rgba8Unorm, usage) {
-                self.temporary = renderTarget
-            } else { return nil }
-            if let renderTarget = device.makeTransientRenderTarget(
-                type: .type2D,
+        }
+
+        init?(pool: RenderTargetPool, width: Int, height: Int, commandBuffer: CommandBuffer? = nil) {
+            let usage = Usage(pool: pool)
+            if let commandBuffer { usage.use(commandBuffer) }
+
+            let colorTargets = (0..<4).compactMap { _ in
+                pool.makeRenderTarget(pixelFormat: .rgba8Unorm, width: width, height: height,
+                                      commandBuffer: commandBuffer)
+            }
+            let stencilBuffer = pool.makeTransientRenderTarget(
                 pixelFormat: .stencil8,
-                width: width, height: height, depth: 1, sampleCount: 1) {
-                self.stencilBuffer = renderTarget
-            } else { return nil }
+                width: width, height: height, sampleCount: 1,
+                commandBuffer: commandBuffer)
             // msaa temporary buffers
-            if let renderTarget = device.makeTransientRenderTarget(
-                type: .type2D,
+            let renderTargetMSAA = pool.makeTransientRenderTarget(
                 pixelFormat: .rgba8Unorm,
-                width: width, height: height, depth: 1,
-                sampleCount: self.msaaSampleCount) {
-                self.renderTargetMSAA = renderTarget
-            } else { return nil }
-            if let renderTarget = device.makeTransientRenderTarget(
-                type: .type2D,
+                width: width, height: height, sampleCount: Self.msaaSampleCount,
+                commandBuffer: commandBuffer)
+            let stencilBufferMSAA = pool.makeTransientRenderTarget(
                 pixelFormat: .stencil8,
-                width: width, height: height, depth: 1,
-                sampleCount: self.msaaSampleCount) {
-                self.stencilBufferMSAA = renderTarget
-            } else { return nil }
+                width: width, height: height, sampleCount: Self.msaaSampleCount,
+                commandBuffer: commandBuffer)
+
+            guard colorTargets.count == 4,
+                  let stencilBuffer, let renderTargetMSAA, let stencilBufferMSAA else {
+                usage.release(colorTargets + [stencilBuffer, renderTargetMSAA, stencilBufferMSAA]
+                    .compactMap { $0 })
+                return nil
+            }
+            self.source = colorTargets[0]
+            self.backdrop = colorTargets[1]
+            self.composited = colorTargets[2]
+            self.temporary = colorTargets[3]
+            self.stencilBuffer = stencilBuffer
+            self.renderTargetMSAA = renderTargetMSAA
+            self.stencilBufferMSAA = stencilBufferMSAA
+            self.pool = pool
+            self.usage = usage
+        }
+
+        deinit {
+            usage.release([source, backdrop, composited, temporary,
+                           stencilBuffer, renderTargetMSAA, stencilBufferMSAA])
         }
 
         func switchSourceToComposited() {
@@ -257,9 +323,10 @@ extension GraphicsContext {
             Log.error("Invalid resolution")
             return nil
         }
-        guard let renderTargets = RenderTargets(device: device,
-                                             width: width,
-                                             height: height) else {
+        guard let renderTargets = RenderTargets(pool: .sharedInstance(device: device),
+                                                width: width,
+                                                height: height,
+                                                commandBuffer: commandBuffer) else {
             Log.error("Failed to make renderTargets")
             return nil
         }
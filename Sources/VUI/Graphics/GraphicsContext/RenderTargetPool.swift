@@ -0,0 +1,198 @@
+//
+//  File: RenderTargetPool.swift
+//  Author: Hongtae Kim (tiff2766@gmail.com)
+//
+//  Copyright (c) 2022-2025 Hongtae Kim. All rights reserved.
+//
+
+import Foundation
+import VVD
+
+// Render targets of GraphicsContext shared by all windows and layers.
+// Textures are returned to the pool when the RenderTargets is released
+// and the command buffers using it are completed, then reused by the next
+// context of the same format, size and usage. Textures released while a
+// single command buffer uses them are reused at once by that command
+// buffer only, its passes are ordered by the layout tracking of the
+// command encoders. Textures not used for a while are released by purge().
+final class RenderTargetPool: @unchecked Sendable {
+    // sizes are not rounded up, filters and blending sample the
+    // entire texture with normalized coordinates.
+    struct Key: Hashable {
+        let pixelFormat: PixelFormat
+        let width: Int
+        let height: Int
+        let sampleCount: Int
+        let transient: Bool
+    }
+
+    struct Statistics {
+        var allocations: Int = 0    // textures created
+        var reuses: Int = 0         // requests served from the pool
+        var releases: Int = 0       // textures released by purge
+        var texturesInUse: Int = 0
+        var bytesInUse: Int = 0
+        var texturesPooled: Int = 0
+        var bytesPooled: Int = 0
+        var peakBytes: Int = 0
+    }
+
+    private struct Entry {
+        let texture: Texture
+        let lastUsed: UInt64
+    }
+
+    let device: GraphicsDevice
+    let maxIdleTime: Double = 2.0
+
+    private var freeTextures: [Key: [Entry]] = [:]
+    // reusable in the command buffer only, until it is completed.
+    private var commandBufferTextures: [ObjectIdentifier: [Key: [Entry]]] = [:]
+    private var texturesInUse: [ObjectIdentifier: Key] = [:]
+    private var _statistics = Statistics()
+    private let lock = NSLock()
+
+    var statistics: Statistics { self.lock.withLock { _statistics } }
+
+    init(device: GraphicsDevice) {
+        self.device = device
+    }
+
+    private static let lock = NSLock()
+    nonisolated(unsafe) private static weak var sharedInstance: RenderTargetPool? = nil
+
+    static func sharedInstance(device: GraphicsDevice) -> RenderTargetPool {
+        lock.withLock {
+            if let instance = sharedInstance, instance.device as AnyObject === device as AnyObject {
+                return instance
+            }
+            let instance = RenderTargetPool(device: device)
+            sharedInstance = instance
+            Log.info("\(Self.self).\(#function): instance created.")
+            return instance
+        }
+    }
+
+    func makeRenderTarget(pixelFormat: PixelFormat, width: Int, height: Int,
+                          commandBuffer: CommandBuffer? = nil) -> Texture? {
+        let key = Key(pixelFormat: pixelFormat, width: width, height: height,
+                      sampleCount: 1, transient: false)
+        return self.texture(for: key, commandBuffer: commandBuffer) {
+            self.device.makeTexture(
+                descriptor: TextureDescriptor(textureType: .type2D,
+                                              pixelFormat: pixelFormat,
+                                              width: width,
+                                              height: height,
+                                              usage: [.renderTarget, .sampled]))
+        }
+    }
+
+    func makeTransientRenderTarget(pixelFormat: PixelFormat, width: Int, height: Int, sampleCount: Int,
+                                   commandBuffer: CommandBuffer? = nil) -> Texture? {
+        let key = Key(pixelFormat: pixelFormat, width: width, height: height,
+                      sampleCount: sampleCount, transient: true)
+        return self.texture(for: key, commandBuffer: commandBuffer) {
+            self.device.makeTransientRenderTarget(type: .type2D,
+                                                  pixelFormat: pixelFormat,
+                                                  width: width, height: height, depth: 1,
+                                                  sampleCount: sampleCount)
+        }
+    }
+
+    // the texture must not be in use by the GPU, or by the command buffer
+    // only if it is given. (see GraphicsContext.RenderTargets)
+    func recycle(_ texture: Texture, commandBuffer: ObjectIdentifier? = nil) {
+        self.lock.withLock {
+            guard let key = self.texturesInUse.removeValue(forKey: ObjectIdentifier(texture)) else {
+                Log.error("\(Self.self).\(#function): the texture is not from the pool.")
+                return
+            }
+            let entry = Entry(texture: texture, lastUsed: DispatchTime.now().uptimeNanoseconds)
+            if let commandBuffer {
+                self.commandBufferTextures[commandBuffer, default: [:]][key, default: []].append(entry)
+            } else {
+                self.freeTextures[key, default: []].append(entry)
+            }
+
+            let bytes = Self.bytes(key)
+            self._statistics.texturesInUse -= 1
+            self._statistics.bytesInUse -= bytes
+            self._statistics.texturesPooled += 1
+            self._statistics.bytesPooled += bytes
+        }
+    }
+
+    // textures recycled for the command buffer become reusable by all.
+    func commandBufferCompleted(_ commandBuffer: ObjectIdentifier) {
+        self.lock.withLock {
+            guard let textures = self.commandBufferTextures.removeValue(forKey: commandBuffer) else {
+                return
+            }
+            // entries of freeTextures are kept in the order of recycling.
+            let now = DispatchTime.now().uptimeNanoseconds
+            for (key, entries) in textures {
+                self.freeTextures[key, default: []].append(contentsOf: entries.map {
+                    Entry(texture: $0.texture, lastUsed: now)
+                })
+            }
+        }
+    }
+
+    // releases textures that have not been used for maxIdleTime.
+    func purge() {
+        let now = DispatchTime.now().uptimeNanoseconds
+        let maxIdle = UInt64(self.maxIdleTime * 1_000_000_000)
+        self.lock.withLock {
+            for key in self.freeTextures.keys {
+                let entries = self.freeTextures[key]!
+                // entries are in the order of recycling.
+                let count = entries.prefix { now - $0.lastUsed > maxIdle }.count
+                if count == 0 { continue }
+                if count == entries.count {
+                    self.freeTextures[key] = nil
+                } else {
+                    self.freeTextures[key]!.removeFirst(count)
+                }
+                let bytes = Self.bytes(key)
+                self._statistics.releases += count
+                self._statistics.texturesPooled -= count
+                self._statistics.bytesPooled -= bytes * count
+            }
+        }
+    }
+
+    private func texture(for key: Key, commandBuffer: CommandBuffer?, make: () -> Texture?) -> Texture? {
+        let bytes = Self.bytes(key)
+        let pooled: Texture? = self.lock.withLock {
+            var entry: Entry? = nil
+            if let commandBuffer {
+                let id = ObjectIdentifier(commandBuffer as AnyObject)
+                entry = self.commandBufferTextures[id]?[key]?.popLast()
+            }
+            guard let entry = entry ?? self.freeTextures[key]?.popLast() else { return nil }
+            self._statistics.reuses += 1
+            self._statistics.texturesPooled -= 1
+            self._statistics.bytesPooled -= bytes
+            self.texturesInUse[ObjectIdentifier(entry.texture)] = key
+            self._statistics.texturesInUse += 1
+            self._statistics.bytesInUse += bytes
+            return entry.texture
+        }
+        if let pooled { return pooled }
+
+        guard let texture = make() else { return nil }
+        self.lock.withLock {
+            self.texturesInUse[ObjectIdentifier(texture)] = key
+            self._statistics.allocations += 1
+            self._statistics.texturesInUse += 1
+            self._statistics.bytesInUse += bytes
+            self._statistics.peakBytes = max(self._statistics.peakBytes,
+                                             self._statistics.bytesInUse + self._statistics.bytesPooled)
+        }
+        return texture
+    }
+
+    private static func bytes(_ key: Key) -> Int {
+        key.width * key.height * key.pixelFormat.bytesPerPixel * key.sampleCount
+    }
+}
@@ -22,7 +22,7 @@ public struct LayoutSubview: Equatable {
     }
 
     public func sizeThatFits(_ proposal: ProposedViewSize) -> CGSize {
-        view.sizeThatFits(proposal)
+        view.measure(proposal)
     }
 
     public func dimensions(in proposal: ProposedViewSize) -> ViewDimensions {
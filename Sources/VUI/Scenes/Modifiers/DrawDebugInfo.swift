@@ -21,6 +21,8 @@ public struct _DrawDebug: _SceneModifier {
         public static let queue        = Info(rawValue: 1 << 2)
         public static let appState     = Info(rawValue: 1 << 4)
         public static let windowState  = Info(rawValue: 1 << 5)
+        public static let hitches      = Info(rawValue: 1 << 6)
+        public static let renderTargets = Info(rawValue: 1 << 7)
 
         public static let all          = Info(rawValue: .max)
     }
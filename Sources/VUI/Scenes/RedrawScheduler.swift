@@ -0,0 +1,108 @@
+//
+//  File: RedrawScheduler.swift
+//  Author: Hongtae Kim (tiff2766@gmail.com)
+//
+//  Copyright (c) 2022-2025 Hongtae Kim. All rights reserved.
+//
+
+import Foundation
+import Synchronization
+
+// Invalidation state of a window.
+// Views report the regions to be redrawn in the root view coordinates,
+// the update task of the window sleeps in wait() until something is
+// invalidated or an event arrives, and redraws only the damaged region.
+final class RedrawScheduler: Sendable {
+    struct Damage {
+        var rect: CGRect = .null
+        var fullRedraw: Bool = false
+
+        var isEmpty: Bool { fullRedraw == false && rect.isNull }
+    }
+
+    struct Statistics {
+        var wakeups: UInt64 = 0
+        var framesRendered: UInt64 = 0  // including partial frames
+        var partialFrames: UInt64 = 0
+        var framesSkipped: UInt64 = 0   // updates without damage
+    }
+
+    private struct State {
+        var damage = Damage(fullRedraw: true)
+        var signaled = false
+        var continuation: CheckedContinuation<Void, Never>? = nil
+        var statistics = Statistics()
+    }
+    private let state = Mutex<State>(State())
+
+    var statistics: Statistics { state.withLock { $0.statistics } }
+
+    func invalidate(_ rect: CGRect) {
+        if rect.isNull || rect.isEmpty { return }
+        self.signal { $0.damage.rect = $0.damage.rect.union(rect) }
+    }
+
+    func invalidate() {
+        self.signal { $0.damage.fullRedraw = true }
+    }
+
+    // wakes the update task without damage, e.g. input events or
+    // pending content updates that report their damage when applied.
+    func wake() {
+        self.signal { _ in }
+    }
+
+    // returns the accumulated damage and resets it.
+    func takeDamage() -> Damage {
+        state.withLock {
+            let damage = $0.damage
+            $0.damage = Damage()
+            return damage
+        }
+    }
+
+    func recordFrame(rendered: Bool, partial: Bool) {
+        state.withLock {
+            if rendered {
+                $0.statistics.framesRendered += 1
+                if partial { $0.statistics.partialFrames += 1 }
+            } else {
+                $0.statistics.framesSkipped += 1
+            }
+        }
+    }
+
+    // suspends until invalidated or woken up, returns immediately
+    // if signaled since the last call.
+    func wait() async {
+        await withTaskCancellationHandler {
+            await withCheckedContinuation { (continuation: CheckedContinuation<Void, Never>) in
+                let resume = state.withLock {
+                    if $0.signaled {
+                        $0.signaled = false
+                        return true
+                    }
+                    $0.continuation = continuation
+                    return false
+                }
+                if resume { continuation.resume() }
+            }
+        } onCancel: {
+            self.wake()
+        }
+    }
+
+    private func signal(_ update: (inout State) -> Void) {
+        let continuation = state.withLock {
+            update(&$0)
+            guard let continuation = $0.continuation else {
+                $0.signaled = true
+                return Optional<CheckedContinuation<Void, Never>>.none
+            }
+            $0.continuation = nil
+            $0.statistics.wakeups += 1
+            return continuation
+        }
+        continuation?.resume()
+    }
+}
@@ -140,8 +140,10 @@ class GenericWindowContext<Content>: WindowContext,
     func updateContent() {
         if let content = scene.value(atPath: self.content) {
             self.sharedContext.root = TypedViewRoot(root: content, graph: self.content, scene: self.scene)
+            self.sharedContext.setNeedsDisplay()
             if let view {
                 view.updateContent()
+                view.setNeedsLayout()
                 if view.validate() == false {
                     Log.err("View(type:\(Content.self) validation failed.")
                 }
@@ -290,6 +292,7 @@ class GenericWindowContext<Content>: WindowContext,
             }
 
             while sharedContext.needsLayout {
+                let layoutStart = DispatchTime.now().uptimeNanoseconds
                 let bounds = self.layoutBounds(sharedContext.contentBounds)
                 assert(bounds.width > 0 && bounds.height > 0)
                 let isInitialLayout = view.frame == .zero
@@ -297,8 +300,10 @@ class GenericWindowContext<Content>: WindowContext,
                 view.place(at: CGPoint(x: bounds.midX, y: bounds.midY),
                            anchor: .center,
                            proposal: ProposedViewSize(bounds.size))
-                view.update(transform: .identity)
+                view.updateTransformIfNeeded(.identity)
                 assert(view.frame != .zero)
+                sharedContext.layoutStatistics.passes += 1
+                sharedContext.layoutStatistics.time += Double(DispatchTime.now().uptimeNanoseconds - layoutStart) * 0.000_000_001
                 if sharedContext.needsLayout == false {
                     self.onViewLayoutUpdated()
                 }
@@ -389,11 +394,39 @@ class GenericWindowContext<Content>: WindowContext,
             var contentBounds: CGRect = .null
             var contentScaleFactor: CGFloat = 1
             var renderTargets: GraphicsContext.RenderTargets? = nil
+            // the last presented frame, partial redraws are composited onto it.
+            var frameTexture: Texture? = nil
 
             var additionalDeltaTimes: Double = 0.0
             let debugDrawEnabled = self?.style.contains(.auxiliaryWindow) == false
+            var frameTimes = FrameTimeStatistics()
+
+            // the scheduler and the interval to wait for before the next update.
+            // the window context is not retained while waiting.
+            var nextUpdate: (scheduler: RedrawScheduler, frameInterval: Double, idle: Bool)? = nil
+            var hadOverlayWindows = false
+
+            var reportTimestamp = DispatchTime.now()
+            var reportClock = clock()
+            var reportStatistics = RedrawScheduler.Statistics()
+            var reportLayoutStatistics = SharedContext.LayoutStatistics()
 
             mainLoop: while true {
+                if let nextUpdate {
+                    if nextUpdate.idle {
+                        // sleep until invalidated or an event arrives.
+                        await nextUpdate.scheduler.wait()
+                    }
+                    if Task.isCancelled { break }
+                    let remaining = nextUpdate.frameInterval - elapsed()
+                    if remaining > 0 {
+                        do {
+                            try await Task.sleep(nanoseconds: UInt64(remaining * 1_000_000_000))
+                        } catch {
+                            break mainLoop
+                        }
+                    }
+                }
                 guard let self = self else { break }
                 if Task.isCancelled { break }
 
@@ -401,9 +434,11 @@ class GenericWindowContext<Content>: WindowContext,
                 let (state, config) = self.stateConfig.withLock {
                     ($0.state, $0.config)
                 }
+                let scheduler = self.sharedContext.redrawScheduler
 
                 let clearColor = config.backgroundColor
 
+                let paced = nextUpdate?.idle == false
                 let delta = resetTimestamp() + additionalDeltaTimes
                 let tick = timestamp.uptimeNanoseconds
                 let date = Date(timeIntervalSinceNow: 0)
@@ -424,11 +459,7 @@ class GenericWindowContext<Content>: WindowContext,
                         }
                     }
                     additionalDeltaTimes = delta
-                    let frameInterval = config.inactiveFrameInterval
-                    repeat {
-                        if Task.isCancelled { break mainLoop }
-                        await Task.yield()
-                    } while elapsed() < frameInterval
+                    nextUpdate = (scheduler, config.inactiveFrameInterval, false)
                     continue
                 }
 
@@ -449,38 +480,95 @@ class GenericWindowContext<Content>: WindowContext,
                     sharedContext.needsLayout = true
                 }
 
+                if state.activated && paced {
+                    if frameTimes.record(delta, targetInterval: config.activeFrameInterval) {
+                        Log.debug(String(format: "WindowContext<\(Content.self)> hitch: %.2f ms (median: %.2f ms)",
+                                         delta * 1000.0, frameTimes.median * 1000.0))
+                    }
+                }
+
                 self.updateView(tick: tick, delta: delta, date: date)
 
-                if state.visible, let swapChain {
+                // auxiliary and modal windows are updated and drawn over the
+                // content every frame, the debug info changes every frame.
+                let hasOverlayWindows = self.auxiliaryWindows.withLock { $0.contains { $0.client != nil } } ||
+                                        self.modalWindows.withLock { $0.contains { $0.client != nil } }
+                let continuous = hasOverlayWindows ||
+                                 (debugDrawEnabled && config.drawDebugInfo.isEmpty == false)
+
+                var damage = scheduler.takeDamage()
+                if continuous || hadOverlayWindows {
+                    damage.fullRedraw = true
+                }
+                hadOverlayWindows = hasOverlayWindows
+
+                var rendered = false
+                var partial = false
+                if state.visible, let swapChain, damage.isEmpty == false {
                     var renderPass = swapChain.currentRenderPassDescriptor()
                     let device = swapChain.commandQueue.device
                     let backBuffer = renderPass.colorAttachments[0].renderTarget!
 
                     let dim = { (tex: Texture) in (tex.width, tex.height, tex.depth) }
 
+                    let renderTargetPool = RenderTargetPool.sharedInstance(device: device)
                     if let renderTargets, dim(renderTargets.backdrop) == dim(backBuffer) {
                     } else {
+                        // release the previous targets to the pool first.
+                        renderTargets = nil
                         renderTargets = GraphicsContext.RenderTargets(
-                            device: device,
+                            pool: renderTargetPool,
                             width: backBuffer.width,
                             height: backBuffer.height)
                     }
+                    if let frameTexture, dim(frameTexture) == dim(backBuffer) {
+                    } else {
+                        frameTexture = device.makeTexture(
+                            descriptor: TextureDescriptor(textureType: .type2D,
+                                                          pixelFormat: .rgba8Unorm,
+                                                          width: backBuffer.width,
+                                                          height: backBuffer.height,
+                                                          usage: [.renderTarget, .sampled]))
+                        damage.fullRedraw = true
+                    }
+
+                    // region to redraw in pixels.
+                    let viewport = CGRect(x: 0, y: 0,
+                                          width: backBuffer.width,
+                                          height: backBuffer.height)
+                    var redrawRect = viewport
+                    if damage.fullRedraw == false {
+                        let scale = state.contentScaleFactor
+                        let padding: CGFloat = 2 // antialiased edges
+                        let rect = damage.rect.offsetBy(dx: state.bounds.minX, dy: state.bounds.minY)
+                        redrawRect = CGRect(x: rect.minX * scale,
+                                            y: rect.minY * scale,
+                                            width: rect.width * scale,
+                                            height: rect.height * scale)
+                            .insetBy(dx: -padding, dy: -padding)
+                            .integral
+                            .intersection(viewport)
+                        partial = redrawRect != viewport
+                    }
 
                     renderPass.colorAttachments[0].clearColor = clearColor
-                    if let renderTargets,
+                    if redrawRect.isNull || redrawRect.isEmpty {
+                        // the damaged views are outside of the window.
+                    } else if let renderTargets, let frameTexture,
                        let commandBuffer = swapChain.commandQueue.makeCommandBuffer() {
 
-                        if let context = GraphicsContext(
+                        if var context = GraphicsContext(
                             sharedContext: self.sharedContext,
                             environment: self.environment,
-                            viewport: CGRect(x: 0, y: 0,
-                                             width: backBuffer.width,
-                                             height: backBuffer.height),
+                            viewport: viewport,
                             contentOffset: .zero,
                             contentScaleFactor: state.contentScaleFactor,
                             renderTargets: renderTargets,
                             commandBuffer: commandBuffer) {
 
+                            if partial {
+                                context.redrawRect = redrawRect
+                            }
                             context.clear(with: clearColor)
                             self.drawFrame(context, offset: state.bounds.origin)
                             
@@ -508,15 +596,52 @@ class GenericWindowContext<Content>: WindowContext,
                                 if config.drawDebugInfo.contains(.windowState) {
                                     drawText(Text("foreground: \(state.activated)"))
                                 }
+                                if config.drawDebugInfo.contains(.renderTargets) {
+                                    let stats = renderTargetPool.statistics
+                                    let mb = { (bytes: Int) in Double(bytes) / (1024.0 * 1024.0) }
+                                    drawText(Text(String(format: "render targets: %d in use (%.1f MB), %d pooled (%.1f MB), peak: %.1f MB, allocations: %d, reuses: %d",
+                                                         stats.texturesInUse, mb(stats.bytesInUse),
+                                                         stats.texturesPooled, mb(stats.bytesPooled),
+                                                         mb(stats.peakBytes),
+                                                         stats.allocations, stats.reuses)))
+                                }
+                                if config.drawDebugInfo.contains(.hitches) {
+                                    drawText(Text(String(format: "hitches: %d/%d, last: %.1f ms, max: %.1f ms, p99: %.1f ms",
+                                                         frameTimes.numHitches,
+                                                         frameTimes.numFrames,
+                                                         frameTimes.lastHitch * 1000.0,
+                                                         frameTimes.maxFrameTime * 1000.0,
+                                                         frameTimes.percentile(0.99) * 1000.0)))
+                                }
                             }
 
-                            if let rp = context.beginRenderPass(descriptor: renderPass,
-                                                                viewport: context.viewport) {
+                            // composite the redrawn region onto the last frame.
+                            if let rp = context.beginRenderPass(viewport: viewport,
+                                                                renderTarget: frameTexture,
+                                                                loadAction: partial ? .load : .dontCare,
+                                                                clearColor: clearColor,
+                                                                useStencil: false,
+                                                                useMSAA: false) {
                                 context.encodeDrawTextureCommand(
                                     renderPass: rp,
                                     texture: context.backdrop,
                                     frame: state.bounds,
-                                    textureFrame: context.viewport,
+                                    textureFrame: viewport,
+                                    blendState: .opaque,
+                                    color: .white)
+                                rp.end()
+                            } else {
+                                Log.error("beginRenderPass failed.")
+                            }
+
+                            context.redrawRect = nil
+                            if let rp = context.beginRenderPass(descriptor: renderPass,
+                                                                viewport: viewport) {
+                                context.encodeDrawTextureCommand(
+                                    renderPass: rp,
+                                    texture: frameTexture,
+                                    frame: state.bounds,
+                                    textureFrame: viewport,
                                     blendState: .opaque,
                                     color: .white)
                                 rp.end()
@@ -531,22 +656,33 @@ class GenericWindowContext<Content>: WindowContext,
 
                         commandBuffer.commit()
                         _=swapChain.present()
+                        rendered = true
                     }
+                    renderTargetPool.purge()
+                }
+                scheduler.recordFrame(rendered: rendered, partial: partial)
+
+                let reportInterval = Double(DispatchTime.now().uptimeNanoseconds - reportTimestamp.uptimeNanoseconds) * 0.000_000_001
+                if reportInterval >= 60.0 {
+                    let stats = scheduler.statistics
+                    let cpuTime = Double(clock() - reportClock) / Double(CLOCKS_PER_SEC)
+                    Log.debug(String(format: "WindowContext<\(Content.self)> %.1f s: \(stats.framesRendered - reportStatistics.framesRendered) frames rendered (\(stats.partialFrames - reportStatistics.partialFrames) partial), \(stats.framesSkipped - reportStatistics.framesSkipped) skipped, process CPU time: %.1f ms",
+                                     reportInterval, cpuTime * 1000.0))
+                    let layoutStats = self.sharedContext.layoutStatistics
+                    let passes = layoutStats.passes - reportLayoutStatistics.passes
+                    if passes > 0 {
+                        let layoutTime = layoutStats.time - reportLayoutStatistics.time
+                        Log.debug(String(format: "WindowContext<\(Content.self)> \(passes) layout passes, %.3f ms per pass, \(layoutStats.measurements - reportLayoutStatistics.measurements) views measured (\(layoutStats.cacheHits - reportLayoutStatistics.cacheHits) cached), \(layoutStats.layouts - reportLayoutStatistics.layouts) views laid out",
+                                         layoutTime * 1000.0 / Double(passes)))
+                    }
+                    reportTimestamp = DispatchTime.now()
+                    reportClock = clock()
+                    reportStatistics = stats
+                    reportLayoutStatistics = layoutStats
                 }
 
                 let frameInterval = state.activated ? config.activeFrameInterval : config.inactiveFrameInterval
-                let timeForBusyWait = state.activated ? 0.001 : 0.0
-
-                repeat {
-                    if Task.isCancelled { break mainLoop }
-                    await Task.yield()
-                } while elapsed() < frameInterval - timeForBusyWait
-
-                // busy waiting, remaining time is too short to yield.
-                while elapsed() < frameInterval {
-                    if Task.isCancelled { break mainLoop }
-                    Platform.threadYield()
-                }
+                nextUpdate = (scheduler, frameInterval, continuous == false)
             }
             Log.info("WindowContext<\(Content.self)> update task is finished.")
         }
@@ -556,6 +692,7 @@ class GenericWindowContext<Content>: WindowContext,
     func onWindowEvent(event: WindowEvent) {
         if event.window !== self.window { return }
         Log.debug("WindowContext.onWindowEvent: \(event)")
+        self.sharedContext.setNeedsDisplay()
 
         let releaseEventHandlers = {
             self.sharedContext.focusedViews.forEach {
@@ -642,6 +779,7 @@ class GenericWindowContext<Content>: WindowContext,
 
     @MainActor
     func onKeyboardEvent(event: KeyboardEvent) {
+        self.sharedContext.redrawScheduler.wake()
         let modalClient = self.modalWindows.withLock { $0.first?.client }
         if let modalClient {
             modalClient.modalWindowInputEventHandler()?
@@ -653,6 +791,7 @@ class GenericWindowContext<Content>: WindowContext,
 
     @MainActor
     func onMouseEvent(event: MouseEvent) {
+        self.sharedContext.redrawScheduler.wake()
         let modalWindow = self.modalWindows.withLock { $0.first }
         if let modalClient = modalWindow?.client,
            let modalFrame = modalWindow?.frame {
@@ -962,6 +1101,7 @@ class GenericWindowContext<Content>: WindowContext,
             auxiliaryWindows = auxiliaryWindows.filter { $0.client != nil }
             auxiliaryWindows.append(aux)
         }
+        self.sharedContext.setNeedsDisplay()
         return true
     }
 
@@ -971,6 +1111,7 @@ class GenericWindowContext<Content>: WindowContext,
                 auxiliaryWindows.remove(at: index)
             }
         }
+        self.sharedContext.setNeedsDisplay()
     }
 
     func dismissAllAuxiliaryWindows() {
@@ -978,6 +1119,7 @@ class GenericWindowContext<Content>: WindowContext,
             defer { aux.removeAll() }
             return aux.compactMap(\.client)
         }
+        self.sharedContext.setNeedsDisplay()
         clients.forEach { $0.onHostWindowClosed() }
     }
 
@@ -1029,6 +1171,7 @@ class GenericWindowContext<Content>: WindowContext,
             self.resetGestureHandlers()
             self.handleMouseHover(at: .zero, deviceID: 0, isTopMost: false)
         }
+        self.sharedContext.setNeedsDisplay()
         return true
     }
 
@@ -1036,6 +1179,7 @@ class GenericWindowContext<Content>: WindowContext,
         self.modalWindows.withLock { modalWindows in
             modalWindows.removeAll { $0.client === client }
         }
+        self.sharedContext.setNeedsDisplay()
     }
 
     func removeModalWindow(_ client: ModalWindowClient) {
@@ -1048,6 +1192,7 @@ class GenericWindowContext<Content>: WindowContext,
                 modalWindows.remove(at: index)
             }
         }
+        self.sharedContext.setNeedsDisplay()
         guard let initiated else {
             return  // client was not found
         }
@@ -1067,6 +1212,7 @@ class GenericWindowContext<Content>: WindowContext,
                 return (client, modal.initiated)
             }
         }
+        self.sharedContext.setNeedsDisplay()
         for (client, initiated) in clients {
             if initiated {
                 client.onModalSessionDismissedByParent()
@@ -91,6 +91,6 @@ private class TypeErasedViewContext: DynamicViewContext<AnyView> {
         } else {
             self.invalidate()
         }
-        self.sharedContext.needsLayout = true
+        self.setNeedsLayout()
     }
 }
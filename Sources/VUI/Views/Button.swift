@@ -203,6 +203,8 @@ private class ResolvedButtonStyleViewContext: GenericViewContext<ResolvedButtonS
     func onButtonPressing(_ isPressed: Bool) {
         self.view?._isPressing = isPressed
         self.body.updateContent()
+        self.body.setNeedsLayout()
+        self.setNeedsDisplay()
     }
 
     func onDispatchButtonAction(_ action: @escaping ButtonAction) {
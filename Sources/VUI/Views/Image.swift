@@ -259,7 +259,7 @@ private class ImageViewContext: PrimitiveViewContext<Image> {
         super.loadResources(context)
         if let image = self.view {
             self.resolvedImage = context.resolve(image)
-            self.sharedContext.needsLayout = true
+            self.setNeedsLayout()
         }
     }
 
@@ -281,7 +281,7 @@ private class ImageViewContext: PrimitiveViewContext<Image> {
             if self.resolvedImage == nil {
                 if let image = self.view {
                     self.resolvedImage = context.resolve(image)
-                    self.sharedContext.needsLayout = true
+                    self.setNeedsLayout()
                 }
             }
             if let resolvedImage {
@@ -290,6 +290,8 @@ private class MenuDropdownViewContext<MenuContent>: ViewModifierContext<MenuDrop
             handler.pressingCallback = { [weak self] isPressing in
                 self?.modifier?.onPressingChanged?(isPressing)
                 self?.body.updateContent()
+                self?.body.setNeedsLayout()
+                self?.setNeedsDisplay()
             }
             let local = GestureHandlerOutputs(gestures: [handler],
                                               simultaneousGestures: [],
@@ -333,6 +335,8 @@ private class MenuDropdownViewContext<MenuContent>: ViewModifierContext<MenuDrop
                 }
                 self.modifier?.onHoverChanged?(self.isMouseHovered)
                 self.body.updateContent()
+                self.body.setNeedsLayout()
+                self.setNeedsDisplay()
             }
         }
         return isMouseHovered
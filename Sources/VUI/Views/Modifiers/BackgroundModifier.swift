@@ -234,7 +234,7 @@ private class BackgroundViewContext<Modifier>: ViewModifierContext<Modifier> whe
 
     override func update(transform t: AffineTransform) {
         super.update(transform: t)
-        background.update(transform: self.transformToRoot)
+        background.updateTransformIfNeeded(self.transformToRoot)
     }
 
     override func layoutSubviews() {
@@ -393,6 +393,6 @@ private class PrimitiveButtonStyleConfigurationLabelViewContext: DynamicViewCont
             self.invalidate()
             fatalError("Unable to recover view for \(graph)")
         }
-        self.sharedContext.needsLayout = true
+        self.setNeedsLayout()
     }
 }
@@ -43,7 +43,7 @@ extension _FixedSizeLayout: _ViewLayoutModifier {
                 height: modifier.vertical ? nil : proposal.height
             )
             
-            return self.body.sizeThatFits(childProposal)
+            return self.body.measure(childProposal)
         }
         
         override func layoutSubviews() {
@@ -53,7 +53,7 @@ extension _FixedSizeLayout: _ViewLayoutModifier {
             
             // For fixed dimensions, get child's ideal size
             // For non-fixed dimensions, use parent's allocated size
-            let childIdealSize = self.body.sizeThatFits(
+            let childIdealSize = self.body.measure(
                 ProposedViewSize(
                     width: modifier.horizontal ? nil : frame.width,
                     height: modifier.vertical ? nil : frame.height
@@ -101,10 +101,19 @@ extension View {
 
 extension _FrameLayout: _ViewLayoutModifier {
     private class LayoutViewContext: ViewModifierContext<_FrameLayout> {
+        // the frame with fixed width and height isolates the layout of the content.
+        override var isLayoutBoundary: Bool {
+            guard let modifier else { return false }
+            return modifier.width != nil && modifier.height != nil
+        }
+
         override func sizeThatFits(_ proposal: ProposedViewSize) -> CGSize {
             guard let modifier else { fatalError("Invalid view modifier") }
 
-            var size = self.body.sizeThatFits(proposal)
+            if let w = modifier.width, let h = modifier.height {
+                return CGSize(width: w, height: h)
+            }
+            var size = self.body.measure(proposal)
             if let w = modifier.width { size.width = w }
             if let h = modifier.height { size.height = h }
             return size
@@ -164,7 +173,7 @@ extension _FlexFrameLayout: _ViewLayoutModifier {
                 return max(minH, min(maxH, h))
             }()
 
-            let childSize = self.body.sizeThatFits(
+            let childSize = self.body.measure(
                 ProposedViewSize(width: childProposedWidth, height: childProposedHeight))
 
             // Reported size: clamp child result to [min, max].
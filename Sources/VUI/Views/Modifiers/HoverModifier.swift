@@ -145,6 +145,8 @@ private class HoverViewContextBase<Modifier: ViewModifier>: ViewModifierContext<
             }
             if hovered != self.isMouseHovered {
                 self.body.updateContent()
+                self.body.setNeedsLayout()
+                self.setNeedsDisplay()
             }
         }
         return super.handleMouseHover(at: location, deviceID: deviceID, isTopMost: isTopMost)
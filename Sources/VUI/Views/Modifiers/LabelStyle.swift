@@ -193,7 +193,7 @@ private class LabelStyleConfigurationTitleViewContext: DynamicViewContext<LabelS
             self.invalidate()
             fatalError("Unable to recover view for \(graph)")
         }
-        self.sharedContext.needsLayout = true
+        self.setNeedsLayout()
     }
 }
 
@@ -217,6 +217,6 @@ private class LabelStyleConfigurationIconViewContext: DynamicViewContext<LabelSt
             self.invalidate()
             fatalError("Unable to recover view for \(graph)")
         }
-        self.sharedContext.needsLayout = true
+        self.setNeedsLayout()
     }
 }
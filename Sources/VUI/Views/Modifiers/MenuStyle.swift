@@ -313,7 +313,7 @@ private class MenuStyleConfigurationProxyViewContext<T>: DynamicViewContext<T> w
             self.invalidate()
             fatalError("Unable to recover view for \(graph)")
         }
-        self.sharedContext.needsLayout = true
+        self.setNeedsLayout()
     }
 }
 
@@ -186,7 +186,7 @@ private class OverlayViewContext<Modifier>: ViewModifierContext<Modifier> where
 
     override func update(transform t: AffineTransform) {
         super.update(transform: t)
-        overlay.update(transform: self.transformToRoot)
+        overlay.updateTransformIfNeeded(self.transformToRoot)
     }
 
     override func layoutSubviews() {
@@ -79,7 +79,7 @@ extension _PaddingLayout: _ViewLayoutModifier {
                     proposal.height = max(h - paddingV, 0)
                 }
             }
-            let size = self.body.sizeThatFits(proposal)
+            let size = self.body.measure(proposal)
             return CGSize(width: max(size.width + paddingH, 0),
                           height: max(size.height + paddingV, 0))
         }
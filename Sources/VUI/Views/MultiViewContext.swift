@@ -26,8 +26,9 @@ class MultiViewContext: ViewGroupContext {
     }
 
     override func updateFrame() {
-        if let superview {
+        if let superview, self.frame != superview.bounds {
             self.frame = superview.bounds
+            self.setNeedsTransformUpdate()
         }
         self.activeSubviews.forEach {
             $0.updateFrame()
@@ -46,8 +46,22 @@ final class SharedContext: @unchecked Sendable {
 
     var contentBounds: CGRect
     var contentScaleFactor: CGFloat
-    var needsLayout: Bool
-    var viewsNeedToReloadResources: [WeakObject<ViewContext>] = []
+    var needsLayout: Bool {
+        didSet { if needsLayout { redrawScheduler.invalidate() } }
+    }
+    var viewsNeedToReloadResources: [WeakObject<ViewContext>] = [] {
+        didSet { if viewsNeedToReloadResources.isEmpty == false { redrawScheduler.invalidate() } }
+    }
+    let redrawScheduler = RedrawScheduler()
+
+    struct LayoutStatistics {
+        var passes: UInt64 = 0
+        var measurements: UInt64 = 0    // sizeThatFits evaluated
+        var cacheHits: UInt64 = 0       // sizes from the cache
+        var layouts: UInt64 = 0         // layoutSubviews invoked
+        var time: Double = 0            // seconds
+    }
+    var layoutStatistics = LayoutStatistics()
 
     var resourceData: [String: Data] = [:]
     var resourceObjects: [String: AnyObject] = [:]
@@ -70,6 +84,15 @@ final class SharedContext: @unchecked Sendable {
         self.needsLayout = true
     }
 
+    // rect in the root view coordinates.
+    func setNeedsDisplay(_ rect: CGRect) {
+        redrawScheduler.invalidate(rect)
+    }
+
+    func setNeedsDisplay() {
+        redrawScheduler.invalidate()
+    }
+
     func updateReferencedResourceObjects() {
         let weakMap = resourceObjects.mapValues {
             WeakObject<AnyObject>($0)
@@ -314,7 +314,7 @@ private class TextViewContext: PrimitiveViewContext<Text> {
         super.loadResources(context)
         if let text = self.view {
             self.resolvedText = context.resolve(text)
-            self.sharedContext.needsLayout = true
+            self.setNeedsLayout()
         }
     }
 
@@ -344,7 +344,7 @@ private class TextViewContext: PrimitiveViewContext<Text> {
     }
 
     override func dimensions(in proposal: ProposedViewSize) -> ViewDimensions {
-        let size = sizeThatFits(proposal)
+        let size = measure(proposal)
         var d = ViewDimensions(width: size.width, height: size.height)
         
         // Only set baseline if text is resolved
@@ -367,7 +367,7 @@ private class TextViewContext: PrimitiveViewContext<Text> {
             if self.resolvedText == nil {
                 if let text = self.view {
                     self.resolvedText = context.resolve(text)
-                    self.sharedContext.needsLayout = true
+                    self.setNeedsLayout()
                 }
             }
             if let resolvedText {
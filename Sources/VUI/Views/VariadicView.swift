@@ -358,7 +358,7 @@ private class ChildrenElementViewContext: DynamicViewContext<_VariadicView_Child
             self.invalidate()
             fatalError("Failed to resolve view for \(self.graph)")
         }
-        self.sharedContext.needsLayout = true
+        self.setNeedsLayout()
     }
 }
 
@@ -37,7 +37,25 @@ class ViewContext: _GraphValueResolver {
     var transform: AffineTransform = .identity          // local transform
     var transformToRoot: AffineTransform = .identity    // local to root
     var spacing: ViewSpacing { styleContext?.viewSpacing ?? ViewSpacing() }
-    var requiresContentUpdates: Bool = false
+    var requiresContentUpdates: Bool = false {
+        // the damage is reported when the content is updated.
+        didSet { if requiresContentUpdates { sharedContext.redrawScheduler.wake() } }
+    }
+
+    // Incremental layout
+    // needsLayout: the subviews must be laid out again.
+    // subtreeNeedsLayout: the layout of the view is valid, but some of
+    //   the descendants must be laid out.
+    // sizeCache: results of sizeThatFits, valid until the inputs of
+    //   the view or the sizes of the subviews are changed.
+    var needsLayout: Bool = true
+    var subtreeNeedsLayout: Bool = false
+    var needsTransformUpdate: Bool = true
+    private var sizeCache: [ProposedViewSize: CGSize] = [:]
+    private static let sizeCacheLimit = 8
+
+    // the size of the view does not depend on its subviews.
+    var isLayoutBoundary: Bool { false }
 
     var bounds: CGRect {
         CGRect(x: 0, y: 0, width: frame.width, height: frame.height)
@@ -122,6 +140,7 @@ class ViewContext: _GraphValueResolver {
         do {
             self.environment = self.inputs.environment
             self.properties = self.inputs.properties
+            self.invalidateLayout()
 
             self.inputs.modifiers.updateEach { modifier in
                 if modifier.isResolved == false {
@@ -157,16 +176,88 @@ class ViewContext: _GraphValueResolver {
         self.transformToRoot = self.transformToContainer.concatenating(t)
     }
 
+    // skips the subtree if neither the frame of the view nor the transform
+    // of the container has been changed since the last update.
+    final func updateTransformIfNeeded(_ t: AffineTransform) {
+        if self.needsTransformUpdate == false &&
+            self.transformToContainer.concatenating(t) == self.transformToRoot {
+            return
+        }
+        self.needsTransformUpdate = false
+        self.update(transform: t)
+    }
+
+    // marks the view and its ancestors to be visited by the next transform update.
+    func setNeedsTransformUpdate() {
+        self.needsTransformUpdate = true
+        var subview = self
+        var view = self.superview
+        while let v = view {
+            v.subviewNeedsTransformUpdate(subview)
+            if v.needsTransformUpdate { break }
+            v.needsTransformUpdate = true
+            subview = v
+            view = v.superview
+        }
+    }
+
+    // called on the superview when the subview or its descendants are marked
+    // by setNeedsLayout() or setNeedsTransformUpdate(). views with many
+    // subviews keep the marked ones to visit only those.
+    func subviewNeedsLayout(_ subview: ViewContext) {
+    }
+
+    func subviewNeedsTransformUpdate(_ subview: ViewContext) {
+    }
+
     func update(tick: UInt64, delta: Double, date: Date) {
         assert(self.isValid)
         if self.requiresContentUpdates {
             self.requiresContentUpdates = false
+            self.setNeedsDisplay()
             self.resetGraphInputModifiers(recursively: true)
             self.updateContent()
+            self.setNeedsLayout()
+            self.setNeedsDisplay()
+        }
+    }
+
+    // discards the cached sizes, the subviews will be laid out again.
+    func invalidateLayout() {
+        self.sizeCache.removeAll(keepingCapacity: true)
+        self.needsLayout = true
+    }
+
+    // invalidates the layout of the view and the cached sizes of the
+    // superviews up to the layout boundary. the ancestors beyond the
+    // boundary only pass the layout down to the subtree.
+    func setNeedsLayout() {
+        self.invalidateLayout()
+        var sizeMayChange = true    // the view itself may have been resized.
+        var subview = self
+        var view = self.superview
+        while let v = view {
+            v.subviewNeedsLayout(subview)
+            if sizeMayChange {
+                v.invalidateLayout()
+                sizeMayChange = v.isLayoutBoundary == false
+            } else {
+                v.subtreeNeedsLayout = true
+            }
+            subview = v
+            view = v.superview
         }
+        self.sharedContext.needsLayout = true
+    }
+
+    // invalidates the bounds of the view in the root coordinates.
+    func setNeedsDisplay() {
+        let rect = self.bounds.applying(self.transformToRoot)
+        self.sharedContext.setNeedsDisplay(rect)
     }
 
     func updateEnvironment(_ environmentValues: EnvironmentValues) {
+        self.invalidateLayout()
         inputs.environment.values.merge(environmentValues.values) { $1 }
         self.inputs.modifiers.forEach { modifier in
             if modifier.isResolved {
@@ -207,13 +298,58 @@ class ViewContext: _GraphValueResolver {
         ViewDimensions(width: self.frame.width, height: self.frame.height)
     }
 
+    // sizeThatFits with the cached result.
+    final func measure(_ proposal: ProposedViewSize) -> CGSize {
+        if let size = self.sizeCache[proposal] {
+            self.sharedContext.layoutStatistics.cacheHits += 1
+            return size
+        }
+        let size = self.sizeThatFits(proposal)
+        if self.sizeCache.count >= Self.sizeCacheLimit {
+            self.sizeCache.removeAll(keepingCapacity: true)
+        }
+        self.sizeCache[proposal] = size
+        self.sharedContext.layoutStatistics.measurements += 1
+        return size
+    }
+
     func place(at position: CGPoint, anchor: UnitPoint, proposal: ProposedViewSize) {
         //let size = proposal.replacingUnspecifiedDimensions()
-        let size = sizeThatFits(proposal)
+        let size = measure(proposal)
         let offset = CGPoint(x: position.x - size.width * anchor.x,
                              y: position.y - size.height * anchor.y)
 
-        self.frame = CGRect(origin: offset, size: size).standardized
+        let frame = CGRect(origin: offset, size: size).standardized
+        if self.frame != frame {
+            if self.frame.size != frame.size {
+                self.needsLayout = true
+            }
+            self.frame = frame
+            self.needsTransformUpdate = true
+        }
+        if self.needsTransformUpdate {
+            // also for the views not updated yet.
+            self.setNeedsTransformUpdate()
+        }
+        self.layoutIfNeeded()
+    }
+
+    final func layoutIfNeeded() {
+        if self.needsLayout {
+            self.needsLayout = false
+            self.subtreeNeedsLayout = false
+            self.sharedContext.layoutStatistics.layouts += 1
+            self.layoutSubviews()
+        } else if self.subtreeNeedsLayout {
+            self.subtreeNeedsLayout = false
+            self.layoutSubtree()
+        }
+    }
+
+    // lays out the descendants marked by setNeedsLayout, the frames of the
+    // subviews are not changed. subclasses with many subviews override
+    // this to visit only the marked ones.
+    func layoutSubtree() {
         self.layoutSubviews()
     }
 
@@ -454,7 +590,7 @@ class GenericViewContext<Content>: ViewContext {
 
     override func update(transform t: AffineTransform) {
         super.update(transform: t)
-        body.update(transform: self.transformToRoot)
+        body.updateTransformIfNeeded(self.transformToRoot)
     }
 
     override func update(tick: UInt64, delta: Double, date: Date) {
@@ -468,7 +604,7 @@ class GenericViewContext<Content>: ViewContext {
     }
 
     override func sizeThatFits(_ proposal: ProposedViewSize) -> CGSize {
-        body.sizeThatFits(proposal)
+        body.measure(proposal)
     }
 
     override func setLayoutProperties(_ properties: LayoutProperties) {
@@ -653,7 +789,7 @@ class DynamicViewContext<Content>: ViewContext {
 
     override func update(transform t: AffineTransform) {
         self.transformToRoot = self.transformToContainer.concatenating(t)
-        body?.update(transform: self.transformToRoot)
+        body?.updateTransformIfNeeded(self.transformToRoot)
     }
 
     override func update(tick: UInt64, delta: Double, date: Date) {
@@ -667,7 +803,7 @@ class DynamicViewContext<Content>: ViewContext {
     }
 
     override func sizeThatFits(_ proposal: ProposedViewSize) -> CGSize {
-        body?.sizeThatFits(proposal) ?? .zero
+        body?.measure(proposal) ?? .zero
     }
 
     override func setLayoutProperties(_ properties: LayoutProperties) {
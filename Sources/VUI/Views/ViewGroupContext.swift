@@ -18,7 +18,45 @@ class ViewGroupContext: ViewContext {
     var layoutCache: AnyLayout.Cache?
     var layoutProperties: LayoutProperties
     var subviews: [ViewContext]
-    var activeSubviews: [ViewContext] = []
+    var activeSubviews: [ViewContext] = [] {
+        didSet {
+            self.layoutSubviewList = nil
+            self.layoutMarkedSubviews.markAll()
+            self.transformMarkedSubviews.markAll()
+        }
+    }
+    // flattened subviews with the layout cache updated,
+    // rebuilt when the subviews or their sizes are changed.
+    private var layoutSubviewList: AnyLayout.Subviews? = nil
+
+    // subviews marked by setNeedsLayout() and setNeedsTransformUpdate(),
+    // visited instead of all subviews while the layout and the transform
+    // of the group are unchanged. all are visited after the list changes.
+    fileprivate struct MarkedSubviews {
+        private(set) var views: [ViewContext] = []
+        private var identifiers: Set<ObjectIdentifier> = []
+        private(set) var all = true
+
+        mutating func insert(_ view: ViewContext) {
+            if all { return }
+            if identifiers.insert(ObjectIdentifier(view)).inserted {
+                views.append(view)
+            }
+        }
+
+        mutating func markAll() {
+            self.removeAll()
+            self.all = true
+        }
+
+        mutating func removeAll() {
+            views.removeAll(keepingCapacity: true)
+            identifiers.removeAll(keepingCapacity: true)
+            all = false
+        }
+    }
+    fileprivate var layoutMarkedSubviews = MarkedSubviews()
+    fileprivate var transformMarkedSubviews = MarkedSubviews()
 
     init(subviews: [ViewContext], layout: any Layout, inputs: _GraphInputs) {
         func layoutProperties<L: Layout>(_ layout: L) -> LayoutProperties {
@@ -84,24 +122,44 @@ class ViewGroupContext: ViewContext {
         }
     }
 
-    override func sizeThatFits(_ proposal: ProposedViewSize) -> CGSize {
-        var size: CGSize = .zero
+    override func invalidateLayout() {
+        super.invalidateLayout()
+        self.layoutSubviewList = nil
+    }
+
+    override func subviewNeedsLayout(_ subview: ViewContext) {
+        self.layoutMarkedSubviews.insert(subview)
+    }
+
+    override func subviewNeedsTransformUpdate(_ subview: ViewContext) {
+        self.transformMarkedSubviews.insert(subview)
+    }
+
+    func subviewsForLayout() -> AnyLayout.Subviews? {
+        if let layoutSubviews = self.layoutSubviewList {
+            return layoutSubviews
+        }
         let viewList = self.activeSubviews.flatMap {
             $0.multiViewForLayout()
         }
-        let subviews: [LayoutSubview] = viewList.map {
-            LayoutSubview(view: $0)
+        if viewList.isEmpty {
+            return nil
+        }
+        let layoutSubviews = AnyLayout.Subviews(subviews: viewList.map { LayoutSubview(view: $0) },
+                                                layoutDirection: .leftToRight)
+        if var cache = self.layoutCache {
+            self.layout.updateCache(&cache, subviews: layoutSubviews)
+            self.layoutCache = cache
+        } else {
+            self.layoutCache = self.layout.makeCache(subviews: layoutSubviews)
         }
-        if subviews.isEmpty == false {
-            let layoutSubviews = AnyLayout.Subviews(subviews: subviews,
-                                                    layoutDirection: .leftToRight)
+        self.layoutSubviewList = layoutSubviews
+        return layoutSubviews
+    }
 
-            if var cache = self.layoutCache {
-                self.layout.updateCache(&cache, subviews: layoutSubviews)
-                self.layoutCache = cache
-            } else {
-                self.layoutCache = self.layout.makeCache(subviews: layoutSubviews)
-            }
+    override func sizeThatFits(_ proposal: ProposedViewSize) -> CGSize {
+        var size: CGSize = .zero
+        if let layoutSubviews = self.subviewsForLayout() {
             if var cache = self.layoutCache {
                 size = self.layout.sizeThatFits(proposal: proposal,
                                                    subviews: layoutSubviews,
@@ -122,27 +180,10 @@ class ViewGroupContext: ViewContext {
     }
 
     override func dimensions(in proposal: ProposedViewSize) -> ViewDimensions {
-        let size = sizeThatFits(proposal)
+        let size = measure(proposal)
         var dimensions = ViewDimensions(width: size.width, height: size.height)
         
-        let viewList = self.activeSubviews.flatMap {
-            $0.multiViewForLayout()
-        }
-        let subviews: [LayoutSubview] = viewList.map {
-            LayoutSubview(view: $0)
-        }
-        
-        if subviews.isEmpty == false {
-            let layoutSubviews = AnyLayout.Subviews(subviews: subviews,
-                                                    layoutDirection: .leftToRight)
-            
-            if var cache = self.layoutCache {
-                self.layout.updateCache(&cache, subviews: layoutSubviews)
-                self.layoutCache = cache
-            } else {
-                self.layoutCache = self.layout.makeCache(subviews: layoutSubviews)
-            }
-            
+        if let layoutSubviews = self.subviewsForLayout() {
             if var cache = self.layoutCache {
                 let bounds = CGRect(origin: .zero, size: size)
                 
@@ -175,22 +216,7 @@ class ViewGroupContext: ViewContext {
         let frame = self.bounds
         guard frame.width > 0 && frame.height > 0 else { return }
 
-        let viewList = self.activeSubviews.flatMap {
-            $0.multiViewForLayout()
-        }
-        let subviews: [LayoutSubview] = viewList.map {
-            LayoutSubview(view: $0)
-        }
-        if subviews.isEmpty == false {
-            let layoutSubviews = AnyLayout.Subviews(subviews: subviews,
-                                                    layoutDirection: .leftToRight)
-
-            if var cache = self.layoutCache {
-                self.layout.updateCache(&cache, subviews: layoutSubviews)
-                self.layoutCache = cache
-            } else {
-                self.layoutCache = self.layout.makeCache(subviews: layoutSubviews)
-            }
+        if let layoutSubviews = self.subviewsForLayout() {
             if var cache = self.layoutCache {
                 let proposal = ProposedViewSize(frame.size)
                 _/*let size*/ = self.layout.sizeThatFits(proposal: proposal,
@@ -203,6 +229,7 @@ class ViewGroupContext: ViewContext {
                                           subviews: layoutSubviews,
                                           cache: &cache)
                 self.layoutCache = cache
+                self.layoutMarkedSubviews.removeAll()
                 self.updateFrame()
             } else {
                 Log.error("Invalid layout cache")
@@ -210,6 +237,37 @@ class ViewGroupContext: ViewContext {
         }
     }
 
+    // the sizes of the subviews are not changed, only the marked
+    // subviews are visited instead of running the layout again.
+    override func layoutSubtree() {
+        let frame = self.bounds
+        guard frame.width > 0 && frame.height > 0 else { return }
+        self.layoutMarkedSubtrees()
+    }
+
+    // multi-views are flattened into the layout of the superview,
+    // their marked subviews are visited directly.
+    fileprivate func layoutMarkedSubtrees() {
+        if self.layoutMarkedSubviews.all {
+            self.layoutMarkedSubviews.removeAll()
+            self.activeSubviews.flatMap { $0.multiViewForLayout() }.forEach {
+                $0.layoutIfNeeded()
+            }
+            return
+        }
+        let marked = self.layoutMarkedSubviews.views
+        self.layoutMarkedSubviews.removeAll()
+        for view in marked where view.superview === self && view.isValid {
+            if let multiView = view as? MultiViewContext {
+                multiView.needsLayout = false
+                multiView.subtreeNeedsLayout = false
+                multiView.layoutMarkedSubtrees()
+            } else {
+                view.layoutIfNeeded()
+            }
+        }
+    }
+
     override func updateFrame() {
         self.activeSubviews.forEach {
             $0.updateFrame()
@@ -224,9 +282,19 @@ class ViewGroupContext: ViewContext {
     }
 
     override func update(transform t: AffineTransform) {
+        let transformToRoot = self.transformToRoot
         super.update(transform: t)
-        self.activeSubviews.forEach {
-            $0.update(transform: self.transformToRoot)
+        if self.transformToRoot == transformToRoot && self.transformMarkedSubviews.all == false {
+            let marked = self.transformMarkedSubviews.views
+            self.transformMarkedSubviews.removeAll()
+            for view in marked where view.superview === self && view.isValid {
+                view.updateTransformIfNeeded(self.transformToRoot)
+            }
+        } else {
+            self.transformMarkedSubviews.removeAll()
+            self.activeSubviews.forEach {
+                $0.updateTransformIfNeeded(self.transformToRoot)
+            }
         }
     }
 
@@ -58,6 +58,54 @@ public typealias ALCdevice = OpaquePointer
 public typealias ALCcontext = OpaquePointer
 
 
+public enum AudioRenderSampleType {
+    case int16
+    case float32
+
+    public var bits: Int {
+        switch self {
+        case .int16:    return 16
+        case .float32:  return 32
+        }
+    }
+}
+
+public struct AudioRenderFormat {
+    public var sampleRate: Int
+    public var channels: Int     // 1, 2, 4, 6(5.1), 8(7.1)
+    public var sampleType: AudioRenderSampleType
+
+    public var bytesPerFrame: Int { channels * sampleType.bits >> 3 }
+
+    public init(sampleRate: Int = 44100, channels: Int = 2, sampleType: AudioRenderSampleType = .int16) {
+        self.sampleRate = sampleRate
+        self.channels = channels
+        self.sampleType = sampleType
+    }
+}
+
+// ALC_SOFT_loopback functions, alext.h prototypes are not exposed.
+private typealias ALCLoopbackOpenDeviceSOFT = @convention(c) (UnsafePointer<CChar>?) -> OpaquePointer?
+private typealias ALCIsRenderFormatSupportedSOFT = @convention(c) (OpaquePointer?, Int32, Int32, Int32) -> CChar
+private typealias ALCRenderSamplesSOFT = @convention(c) (OpaquePointer?, UnsafeMutableRawPointer?, Int32) -> Void
+// ALC_EXT_thread_local_context
+private typealias ALCSetThreadContext = @convention(c) (OpaquePointer?) -> CChar
+private typealias ALCGetThreadContext = @convention(c) () -> OpaquePointer?
+
+private struct ThreadContextProcs: @unchecked Sendable {
+    let setThreadContext: ALCSetThreadContext
+    let getThreadContext: ALCGetThreadContext
+}
+private let threadContextProcs: ThreadContextProcs? = {
+    guard alcIsExtensionPresent(nil, "ALC_EXT_thread_local_context") != 0,
+          let setAddr = alcGetProcAddress(nil, "alcSetThreadContext"),
+          let getAddr = alcGetProcAddress(nil, "alcGetThreadContext") else {
+        return nil
+    }
+    return ThreadContextProcs(setThreadContext: unsafeBitCast(setAddr, to: ALCSetThreadContext.self),
+                              getThreadContext: unsafeBitCast(getAddr, to: ALCGetThreadContext.self))
+}()
+
 public final class AudioDevice: @unchecked Sendable {
     public let device: ALCdevice
     public let context: ALCcontext
@@ -66,60 +114,178 @@ public final class AudioDevice: @unchecked Sendable {
     public let majorVersion: Int
     public let minorVersion: Int
 
+    // non-nil for loopback device, which does not output to hardware.
+    public let renderFormat: AudioRenderFormat?
+    public var isLoopback: Bool { renderFormat != nil }
+    private let renderSamplesProc: ALCRenderSamplesSOFT?
+
     struct BitsChannels: Hashable {
         let bits: Int
         let channels: Int
     }
     var formatTable: [BitsChannels: Int32] = [:]
 
-    public init?(deviceName: String) {
-        guard let device = alcOpenDevice(deviceName) else { return nil }
-
-        if let context = alcCreateContext(device, nil) {
+    private init(device: ALCdevice, context: ALCcontext,
+                 renderFormat: AudioRenderFormat?,
+                 renderSamplesProc: ALCRenderSamplesSOFT?) {
+        // a loopback context is only current inside withCurrentContext(_:),
+        // the context of a hardware device stays current.
+        if renderFormat == nil {
             alcMakeContextCurrent(context)
+        }
+
+        self.device = device
+        self.context = context
+        self.renderFormat = renderFormat
+        self.renderSamplesProc = renderSamplesProc
+
+        self.deviceName = String(utf8String: alcGetString(device, ALC_DEVICE_SPECIFIER)) ?? ""
+        var majorVersion : Int32 = 0
+        var minorVersion : Int32 = 0
+        alcGetIntegerv(device, ALC_MAJOR_VERSION, Int32(MemoryLayout<Int32>.size), &majorVersion)
+        alcGetIntegerv(device, ALC_MINOR_VERSION, Int32(MemoryLayout<Int32>.size), &minorVersion)
+
+        self.majorVersion = Int(majorVersion)
+        self.minorVersion = Int(minorVersion)
+
+        Log.info("OpenAL device: \(self.deviceName) Version: \(majorVersion).\(minorVersion).")
+
+        self.withCurrentContext { self.updateFormatTable() }
+    }
+
+    private func updateFormatTable() {
+        // update format table
+        formatTable[BitsChannels(bits: 4, channels: 1)] = alGetEnumValue("AL_FORMAT_MONO_IMA4")
+        formatTable[BitsChannels(bits: 4, channels: 2)] = alGetEnumValue("AL_FORMAT_STEREO_IMA4")
+
+        formatTable[BitsChannels(bits: 8, channels: 1)] = AL_FORMAT_MONO8
+        formatTable[BitsChannels(bits: 8, channels: 2)] = AL_FORMAT_STEREO8
+        formatTable[BitsChannels(bits: 8, channels: 4)] = alGetEnumValue("AL_FORMAT_QUAD8")
+        formatTable[BitsChannels(bits: 8, channels: 6)] = alGetEnumValue("AL_FORMAT_51CHN8")
+        formatTable[BitsChannels(bits: 8, channels: 8)] = alGetEnumValue("AL_FORMAT_71CHN8")
 
-            self.device = device
-            self.context = context
+        formatTable[BitsChannels(bits:16, channels: 1)] = AL_FORMAT_MONO16
+        formatTable[BitsChannels(bits:16, channels: 2)] = AL_FORMAT_STEREO16
+        formatTable[BitsChannels(bits:16, channels: 4)] = alGetEnumValue("AL_FORMAT_QUAD16")
+        formatTable[BitsChannels(bits:16, channels: 6)] = alGetEnumValue("AL_FORMAT_51CHN16")
+        formatTable[BitsChannels(bits:16, channels: 8)] = alGetEnumValue("AL_FORMAT_71CHN16")
 
-            self.deviceName = String(utf8String: alcGetString(device, ALC_DEVICE_SPECIFIER)) ?? ""
-            var majorVersion : Int32 = 0
-            var minorVersion : Int32 = 0
-            alcGetIntegerv(device, ALC_MAJOR_VERSION, Int32(MemoryLayout<Int32>.size), &majorVersion)
-            alcGetIntegerv(device, ALC_MINOR_VERSION, Int32(MemoryLayout<Int32>.size), &minorVersion)
+        formatTable[BitsChannels(bits:32, channels: 1)] = alGetEnumValue("AL_FORMAT_MONO_FLOAT32")
+        formatTable[BitsChannels(bits:32, channels: 2)] = alGetEnumValue("AL_FORMAT_STEREO_FLOAT32")
+        formatTable[BitsChannels(bits:32, channels: 4)] = alGetEnumValue("AL_FORMAT_QUAD32")
+        formatTable[BitsChannels(bits:32, channels: 6)] = alGetEnumValue("AL_FORMAT_51CHN32")
+        formatTable[BitsChannels(bits:32, channels: 8)] = alGetEnumValue("AL_FORMAT_71CHN32")
+    }
 
-            self.majorVersion = Int(majorVersion)
-            self.minorVersion = Int(minorVersion)
+    public convenience init?(deviceName: String) {
+        guard let device = alcOpenDevice(deviceName) else { return nil }
 
-            Log.info("OpenAL device: \(deviceName) Version: \(majorVersion).\(minorVersion).")
+        if let context = alcCreateContext(device, nil) {
+            self.init(device: device, context: context,
+                      renderFormat: nil, renderSamplesProc: nil)
+        } else {
+            Log.err("alcCreateContext failed.")
+            alcCloseDevice(device)
+            return nil
+        }
+    }
 
-            // update format table
-            formatTable[BitsChannels(bits: 4, channels: 1)] = alGetEnumValue("AL_FORMAT_MONO_IMA4")
-            formatTable[BitsChannels(bits: 4, channels: 2)] = alGetEnumValue("AL_FORMAT_STEREO_IMA4")
+    // Loopback device (ALC_SOFT_loopback), mixed output is pulled
+    // by renderSamples(_:frames:) instead of hardware.
+    public convenience init?(loopback format: AudioRenderFormat) {
+        guard alcIsExtensionPresent(nil, "ALC_SOFT_loopback") != 0 else {
+            Log.err("ALC_SOFT_loopback is not supported.")
+            return nil
+        }
+        guard let openDeviceAddr = alcGetProcAddress(nil, "alcLoopbackOpenDeviceSOFT"),
+              let isFormatSupportedAddr = alcGetProcAddress(nil, "alcIsRenderFormatSupportedSOFT"),
+              let renderSamplesAddr = alcGetProcAddress(nil, "alcRenderSamplesSOFT") else {
+            Log.err("Failed to load ALC_SOFT_loopback functions.")
+            return nil
+        }
+        let openDevice = unsafeBitCast(openDeviceAddr, to: ALCLoopbackOpenDeviceSOFT.self)
+        let isFormatSupported = unsafeBitCast(isFormatSupportedAddr, to: ALCIsRenderFormatSupportedSOFT.self)
+        let renderSamples = unsafeBitCast(renderSamplesAddr, to: ALCRenderSamplesSOFT.self)
 
-            formatTable[BitsChannels(bits: 8, channels: 1)] = AL_FORMAT_MONO8
-            formatTable[BitsChannels(bits: 8, channels: 2)] = AL_FORMAT_STEREO8
-            formatTable[BitsChannels(bits: 8, channels: 4)] = alGetEnumValue("AL_FORMAT_QUAD8")
-            formatTable[BitsChannels(bits: 8, channels: 6)] = alGetEnumValue("AL_FORMAT_51CHN8")
-            formatTable[BitsChannels(bits: 8, channels: 8)] = alGetEnumValue("AL_FORMAT_71CHN8")
+        guard let device = openDevice(nil) else {
+            Log.err("alcLoopbackOpenDeviceSOFT failed.")
+            return nil
+        }
 
-            formatTable[BitsChannels(bits:16, channels: 1)] = AL_FORMAT_MONO16
-            formatTable[BitsChannels(bits:16, channels: 2)] = AL_FORMAT_STEREO16
-            formatTable[BitsChannels(bits:16, channels: 4)] = alGetEnumValue("AL_FORMAT_QUAD16")
-            formatTable[BitsChannels(bits:16, channels: 6)] = alGetEnumValue("AL_FORMAT_51CHN16")
-            formatTable[BitsChannels(bits:16, channels: 8)] = alGetEnumValue("AL_FORMAT_71CHN16")
+        let channelsName: String
+        switch format.channels {
+        case 1: channelsName = "ALC_MONO_SOFT"
+        case 2: channelsName = "ALC_STEREO_SOFT"
+        case 4: channelsName = "ALC_QUAD_SOFT"
+        case 6: channelsName = "ALC_5POINT1_SOFT"
+        case 8: channelsName = "ALC_7POINT1_SOFT"
+        default:
+            Log.err("Unsupported loopback channels: \(format.channels)")
+            alcCloseDevice(device)
+            return nil
+        }
+        let typeName: String
+        switch format.sampleType {
+        case .int16:    typeName = "ALC_SHORT_SOFT"
+        case .float32:  typeName = "ALC_FLOAT_SOFT"
+        }
+        let channels = alcGetEnumValue(device, channelsName)
+        let type = alcGetEnumValue(device, typeName)
+        let sampleRate = Int32(format.sampleRate)
 
-            formatTable[BitsChannels(bits:32, channels: 1)] = alGetEnumValue("AL_FORMAT_MONO_FLOAT32")
-            formatTable[BitsChannels(bits:32, channels: 2)] = alGetEnumValue("AL_FORMAT_STEREO_FLOAT32")
-            formatTable[BitsChannels(bits:32, channels: 4)] = alGetEnumValue("AL_FORMAT_QUAD32")
-            formatTable[BitsChannels(bits:32, channels: 6)] = alGetEnumValue("AL_FORMAT_51CHN32")
-            formatTable[BitsChannels(bits:32, channels: 8)] = alGetEnumValue("AL_FORMAT_71CHN32")
+        if isFormatSupported(device, sampleRate, channels, type) == 0 {
+            Log.err("Unsupported loopback format: \(format)")
+            alcCloseDevice(device)
+            return nil
+        }
 
+        let attrs: [ALCint] = [
+            alcGetEnumValue(device, "ALC_FORMAT_CHANNELS_SOFT"), channels,
+            alcGetEnumValue(device, "ALC_FORMAT_TYPE_SOFT"), type,
+            ALC_FREQUENCY, sampleRate,
+            0
+        ]
+        if let context = alcCreateContext(device, attrs) {
+            self.init(device: device, context: context,
+                      renderFormat: format, renderSamplesProc: renderSamples)
         } else {
             Log.err("alcCreateContext failed.")
+            alcCloseDevice(device)
             return nil
         }
     }
 
+    // Renders mixed samples of all playing sources, loopback device only.
+    public func renderSamples(_ buffer: UnsafeMutableRawPointer, frames: Int) {
+        guard let renderSamplesProc else {
+            Log.err("AudioDevice.renderSamples: not a loopback device.")
+            return
+        }
+        withCurrentContext {
+            renderSamplesProc(device, buffer, Int32(frames))
+        }
+    }
+
+    // Runs body with the context of this device current. A loopback context
+    // is made current for the calling thread (ALC_EXT_thread_local_context),
+    // or process-wide while body runs, and the previous context is restored.
+    // The process-wide context of a hardware device is left as it is.
+    public func withCurrentContext<R>(_ body: () throws -> R) rethrows -> R {
+        guard isLoopback else { return try body() }
+        if let procs = threadContextProcs {
+            let previous = procs.getThreadContext()
+            if previous == context { return try body() }
+            _ = procs.setThreadContext(context)
+            defer { _ = procs.setThreadContext(previous) }
+            return try body()
+        }
+        let previous = alcGetCurrentContext()
+        if previous == context { return try body() }
+        alcMakeContextCurrent(context)
+        defer { alcMakeContextCurrent(previous) }
+        return try body()
+    }
+
     deinit {
         if alcGetCurrentContext() == context {
             alcMakeContextCurrent(nil)
@@ -130,10 +296,12 @@ public final class AudioDevice: @unchecked Sendable {
 
     public func makeSource() -> AudioSource? {
         var sourceID: ALuint = 0
-        alGenSources(1, &sourceID)
-        alSourcei(sourceID, AL_LOOPING, 0)
-        alSourcei(sourceID, AL_BUFFER, 0)
-        alSourceStop(sourceID)
+        withCurrentContext {
+            alGenSources(1, &sourceID)
+            alSourcei(sourceID, AL_LOOPING, 0)
+            alSourcei(sourceID, AL_BUFFER, 0)
+            alSourceStop(sourceID)
+        }
 
         return AudioSource(device: self, sourceID: sourceID)
     }
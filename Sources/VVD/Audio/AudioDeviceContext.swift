@@ -9,10 +9,6 @@ import Foundation
 import Synchronization
 import OpenAL
 
-private let maxBufferCount = 3
-private let minBufferTime = 0.4
-private let maxBufferTime = 10.0
-
 public final class AudioDeviceContext: @unchecked Sendable {
     public let device: AudioDevice
     public let listener: AudioListener
@@ -22,12 +18,26 @@ public final class AudioDeviceContext: @unchecked Sendable {
     }
     private let players = Mutex<[Player]>([])
 
+    // State owned by the updater, reused every pass.
+    private final class UpdateState {
+        var retainedPlayers: [AudioPlayer] = []
+    }
+
     private var task: Task<Void, Never>?
+    private let offlineState: Mutex<UpdateState>?
 
     public init(device: AudioDevice) {
         self.device = device
         self.listener = AudioListener(device: self.device)
 
+        if device.isLoopback {
+            // No playback task for the loopback device,
+            // streams are updated by update() from the renderer.
+            self.offlineState = Mutex(UpdateState())
+            return
+        }
+        self.offlineState = nil
+
         self.task = .detached(priority: .background) { [weak self] in
             let taskID = UUID()
             detachedServiceTasks.withLock { $0[taskID] = "AudioDeviceContext playback task" }
@@ -37,119 +47,132 @@ public final class AudioDeviceContext: @unchecked Sendable {
 
             Log.info("AudioDeviceContext playback task is started.")
 
-            var buffer: UnsafeMutableRawBufferPointer = .allocate(byteCount: 1024, alignment: 1)
-
-            var retainedPlayers: [AudioPlayer] = []
+            let state = UpdateState()
 
             mainLoop: while true {
                 guard let self = self else { break }
                 if Task.isCancelled { break }
 
-                let players: [AudioPlayer] = self.players.withLock {
-                    let r = $0.compactMap(\.player)
-                    $0 = r.map { Player(player: $0) }
-                    return r
+                self.updatePlayers(state)
+
+                //await Task.yield()
+                do {
+                    try await Task.sleep(nanoseconds: 200_000_000) // 200ms
+                } catch {
+                    break mainLoop
                 }
+            }
+            state.retainedPlayers.removeAll()
 
-                retainedPlayers.removeAll(keepingCapacity: true)
+            Log.info("AudioDeviceContext playback task is finished.")
+        }
+    }
 
-                // update all active audio streams!
-                for player in players {
-                    if player.playing {
-                        let source = player.source
-                        source.dequeueBuffers()
+    // Updates streams of all players synchronously, for the loopback device.
+    // Returns number of players still playing.
+    @discardableResult
+    public func update() -> Int {
+        guard let offlineState else {
+            Log.err("AudioDeviceContext.update() is valid for loopback device only.")
+            return 0
+        }
+        return offlineState.withLock { updatePlayers($0) }
+    }
 
-                        if player.buffering && source.numberOfBuffersInQueue() < maxBufferCount {
-                            // buffering!                            
-                            let stream = player.stream
-                            let bufferingTime = clamp(player.maxBufferingTime, min: minBufferTime, max: maxBufferTime)
-                            let sampleAlignment = stream.channels * stream.bits >> 3
-                            let bufferSize = Int(bufferingTime * Double(stream.sampleRate)) * sampleAlignment
+    @discardableResult
+    private func updatePlayers(_ state: UpdateState) -> Int {
+        let players: [AudioPlayer] = self.players.withLock {
+            let r = $0.compactMap(\.player)
+            $0 = r.map { Player(player: $0) }
+            return r
+        }
 
-                            if bufferSize > buffer.count {  // resize buffer
-                                buffer.deallocate()
-                                buffer = .allocate(byteCount: bufferSize, alignment: 1)
-                            }
+        state.retainedPlayers.removeAll(keepingCapacity: true)
+        var activePlayers = 0
+
+        // update all active audio streams!
+        for player in players {
+            if player.playing {
+                let source = player.source
+                source.dequeueBuffers()
+
+                if player.buffering {
+                    let ringBuffer = player.ringBuffer
+                    if player.decodesOnUpdate {
+                        // fill the ring buffer before taking blocks,
+                        // the loopback device renders faster than real time.
+                        while player.decodeAhead() {}
+                    }
+                    // take blocks decoded ahead by the player, without locking.
+                    let generation = player.decodeGeneration
+                    while source.numberOfBuffersInQueue() < AudioPlayer.maxBufferCount, let block = ringBuffer.peek() {
+                        defer { ringBuffer.release() }
+                        if block.generation != generation { continue }  // stale
+
+                        let stream = player.stream
+                        if block.byteCount > 0 {
+                            player.processStream(data: block.data, byteCount: block.byteCount, timeStamp: block.timeStamp)
+                            if source.enqueueBuffer(sampleRate: stream.sampleRate,
+                                                    bits: stream.bits,
+                                                    channels: stream.channels,
+                                                    data: block.data,
+                                                    byteCount: block.byteCount,
+                                                    timeStamp: block.timeStamp) {
+                                let bytesSecond = stream.sampleRate * stream.channels * (stream.bits >> 3)
+                                player.playing = true
+                                player.bufferedPosition = block.timeStamp + Double(block.byteCount) / Double(bytesSecond)
+
+                                player.bufferingStateChanged(true, timeStamp: block.timeStamp)
+                            } else {    // error
+                                Log.err("AudioSource.enqueueBuffer failed")
 
-                            let bufferPos = stream.timePosition
-                            let bytesRead = stream.read(buffer.baseAddress!, count: bufferSize)
-                            if bytesRead > 0 {
-                                player.processStream(data: buffer.baseAddress!, byteCount: bytesRead, timeStamp: bufferPos)
-                                if source.enqueueBuffer(sampleRate: stream.sampleRate,
-                                                        bits: stream.bits,
-                                                        channels: stream.channels,
-                                                        data: buffer.baseAddress!,
-                                                        byteCount: bufferSize,
-                                                        timeStamp: bufferPos) {
-                                    player.playing = true
-                                    player.bufferedPosition = stream.timePosition
-
-                                    player.bufferingStateChanged(true, timeStamp: bufferPos)
-                                } else {    // error
-                                    Log.err("AudioSource.enqueueBuffer failed")
-
-                                    player.buffering = false
-                                    player.playing = false
-                                }
-                            } else if bytesRead == 0 {  // EOF
-                                if player.playLoopCount > 1 {
-                                    player.playLoopCount -= 1
-                                    _=stream.seek(pcm: 0) // rewind
-                                } else {
-                                    player.buffering = false
-                                }
-                            } else {    // error!
-                                Log.err("AudioStream.read failed.")
-                                player.playing = false
                                 player.buffering = false
-                                source.stop()
-                                source.dequeueBuffers()
-                            }
-
-                            if player.buffering == false {
-                                player.bufferingStateChanged(false, timeStamp: bufferPos)
+                                player.playing = false
                             }
                         }
-
-                        // update state
-                        if player.playing {
-                            if source.state == .stopped {
-                                if source.numberOfBuffersInQueue() > 0 {
-                                    source.play()
-                                } else {
-                                    // done.
-                                    player.playing = false
-                                }
-                            }
+                        if block.error {
+                            player.playing = false
+                            player.buffering = false
+                            source.stop()
+                            source.dequeueBuffers()
+                        } else if block.endOfStream {
+                            player.buffering = false
+                        }
+                        if player.buffering == false {
+                            player.bufferingStateChanged(false, timeStamp: block.timeStamp)
+                            break
                         }
+                    }
+                }
 
-                        if player.playing {
-                            let pos = source.timePosition
-                            if player.playbackPosition != pos {
-                                player.playbackPosition = pos
-                                player.playbackStateChanged(true, position: player.playbackPosition)
-                            }
-                            if player.retainedWhilePlaying {
-                                retainedPlayers.append(player)
-                            }
+                // update state
+                if player.playing {
+                    if source.state == .stopped {
+                        if source.numberOfBuffersInQueue() > 0 {
+                            source.play()
                         } else {
-                            player.playbackStateChanged(false, position: player.playbackPosition)
+                            // done.
+                            player.playing = false
                         }
                     }
                 }
 
-                //await Task.yield()
-                do {
-                    try await Task.sleep(nanoseconds: 200_000_000) // 200ms
-                } catch {
-                    break mainLoop
+                if player.playing {
+                    activePlayers += 1
+                    let pos = source.timePosition
+                    if player.playbackPosition != pos {
+                        player.playbackPosition = pos
+                        player.playbackStateChanged(true, position: player.playbackPosition)
+                    }
+                    if player.retainedWhilePlaying {
+                        state.retainedPlayers.append(player)
+                    }
+                } else {
+                    player.playbackStateChanged(false, position: player.playbackPosition)
                 }
             }
-            buffer.deallocate()
-            retainedPlayers.removeAll()
-
-            Log.info("AudioDeviceContext playback task is finished.")
         }
+        return activePlayers
     }
 
     deinit {
@@ -158,8 +181,8 @@ public final class AudioDeviceContext: @unchecked Sendable {
     }
 
     public func makePlayer(stream: AudioStream) -> AudioPlayer? {
-        if let source = device.makeSource() {
-            let player = AudioPlayer(source: source, stream: stream)
+        if let source = device.makeSource(),
+           let player = AudioPlayer(source: source, stream: stream) {
             self.players.withLock {
                 $0.append(Player(player: player))
             }
@@ -178,3 +201,10 @@ public func makeAudioDeviceContext() -> AudioDeviceContext? {
     }
     return nil
 }
+
+public func makeOfflineAudioDeviceContext(format: AudioRenderFormat = AudioRenderFormat()) -> AudioDeviceContext? {
+    if let device = AudioDevice(loopback: format) {
+        return AudioDeviceContext(device: device)
+    }
+    return nil
+}
@@ -0,0 +1,135 @@
+//
+//  File: AudioOfflineRenderer.swift
+//  Author: Hongtae Kim (tiff2766@gmail.com)
+//
+//  Copyright (c) 2022-2024 Hongtae Kim. All rights reserved.
+//
+
+import Foundation
+
+// Renders the mix of a loopback AudioDeviceContext as fast as possible,
+// stepping the stream scheduler synchronously between chunks.
+public final class AudioOfflineRenderer {
+    public let context: AudioDeviceContext
+    public let format: AudioRenderFormat
+    public let framesPerUpdate: Int
+
+    public struct Statistics {
+        public var framesRendered: Int = 0
+        public var elapsedTime: Double = 0      // wall clock, seconds
+        public var renderedTime: Double = 0     // rendered audio, seconds
+        public var voiceSeconds: Double = 0     // sum of (active voices * rendered time)
+
+        // mixed voice-seconds per wall clock second
+        public var voiceThroughput: Double {
+            elapsedTime > 0 ? voiceSeconds / elapsedTime : 0
+        }
+        public var realtimeFactor: Double {
+            elapsedTime > 0 ? renderedTime / elapsedTime : 0
+        }
+    }
+    public private(set) var statistics = Statistics()
+
+    public init?(context: AudioDeviceContext, updateInterval: Double = 0.1) {
+        guard let format = context.device.renderFormat else {
+            Log.err("AudioOfflineRenderer requires a loopback device context.")
+            return nil
+        }
+        self.context = context
+        self.format = format
+        self.framesPerUpdate = max(Int(Double(format.sampleRate) * updateInterval), 1)
+    }
+
+    // Renders frames into buffer, buffer must hold frames * format.bytesPerFrame bytes.
+    // Returns number of voices playing after the last update.
+    @discardableResult
+    public func render(_ buffer: UnsafeMutableRawPointer, frames: Int) -> Int {
+        let device = context.device
+        let bytesPerFrame = format.bytesPerFrame
+        let start = DispatchTime.now().uptimeNanoseconds
+
+        // the loopback context is made current once for the whole pass.
+        let activeVoices = device.withCurrentContext {
+            var activeVoices = 0
+            var offset = 0
+            while offset < frames {
+                activeVoices = context.update()
+                let count = min(framesPerUpdate, frames - offset)
+                device.renderSamples(buffer + offset * bytesPerFrame, frames: count)
+
+                let time = Double(count) / Double(format.sampleRate)
+                statistics.voiceSeconds += Double(activeVoices) * time
+                statistics.renderedTime += time
+                offset += count
+            }
+            return activeVoices
+        }
+        statistics.framesRendered += frames
+        statistics.elapsedTime += Double(DispatchTime.now().uptimeNanoseconds - start) * 0.000_000_001
+        return activeVoices
+    }
+
+    public func render(duration: Double) -> Data {
+        let frames = Int(duration * Double(format.sampleRate))
+        var data = Data(count: frames * format.bytesPerFrame)
+        data.withUnsafeMutableBytes {
+            if let ptr = $0.baseAddress {
+                render(ptr, frames: frames)
+            }
+        }
+        return data
+    }
+
+    // Renders until all players are finished or maxDuration reached.
+    public func renderUntilIdle(maxDuration: Double) -> Data {
+        let maxFrames = Int(maxDuration * Double(format.sampleRate))
+        let chunkSize = framesPerUpdate * format.bytesPerFrame
+        var data = Data()
+        var chunk = Data(count: chunkSize)
+        var frames = 0
+        while frames < maxFrames {
+            let count = min(framesPerUpdate, maxFrames - frames)
+            let active = chunk.withUnsafeMutableBytes {
+                render($0.baseAddress!, frames: count)
+            }
+            data.append(chunk.prefix(count * format.bytesPerFrame))
+            frames += count
+            if active == 0 { break }
+        }
+        return data
+    }
+
+    public func wavData(_ pcm: Data) -> Data {
+        var data = Data(capacity: 44 + pcm.count)
+        func append<T: FixedWidthInteger>(_ value: T) {
+            withUnsafeBytes(of: value.littleEndian) { data.append(contentsOf: $0) }
+        }
+        let bits = format.sampleType.bits
+        let blockAlign = format.bytesPerFrame
+        data.append(contentsOf: Array("RIFF".utf8))
+        append(UInt32(36 + pcm.count))
+        data.append(contentsOf: Array("WAVE".utf8))
+        data.append(contentsOf: Array("fmt ".utf8))
+        append(UInt32(16))
+        append(UInt16(format.sampleType == .float32 ? 3 : 1)) // IEEE float, PCM
+        append(UInt16(format.channels))
+        append(UInt32(format.sampleRate))
+        append(UInt32(format.sampleRate * blockAlign))
+        append(UInt16(blockAlign))
+        append(UInt16(bits))
+        data.append(contentsOf: Array("data".utf8))
+        append(UInt32(pcm.count))
+        data.append(pcm)
+        return data
+    }
+
+    public func writeWAV(_ pcm: Data, to url: URL) -> Bool {
+        do {
+            try wavData(pcm).write(to: url)
+            return true
+        } catch {
+            Log.err("AudioOfflineRenderer: failed to write \(url): \(error)")
+            return false
+        }
+    }
+}
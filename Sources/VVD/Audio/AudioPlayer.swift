@@ -5,6 +5,9 @@
 //  Copyright (c) 2022-2024 Hongtae Kim. All rights reserved.
 //
 
+import Foundation
+import Synchronization
+
 public class AudioPlayer {
 
     public nonisolated var sampleRate: Int  { stream.sampleRate }
@@ -21,26 +24,204 @@ public class AudioPlayer {
     var buffering = false
     var bufferedPosition: Double = 0.0
     var playbackPosition: Double = 0.0
-    var playLoopCount = 0
-    var maxBufferingTime = 1.0
+
+    static let maxBufferingTime = 1.0
+    static let maxBufferCount = 3
+    private static let minBufferTime = 0.4
+    private static let maxBufferTime = 10.0
 
     public var retainedWhilePlaying = false
 
-    public nonisolated init(source: AudioSource, stream: AudioStream) {
+    // blocks decoded ahead by the decoder, the consumer (AudioDeviceContext)
+    // takes them without locking.
+    let ringBuffer: AudioRingBuffer
+    var decodeGeneration: UInt32 { decoder.generation.load(ordering: .relaxed) }
+    private let decoder: Decoder
+    private var decodeTask: Task<Void, Never>?
+    // Loopback devices are rendered faster than real time, the consumer
+    // decodes synchronously with decodeAhead() instead of the decode task.
+    let decodesOnUpdate: Bool
+
+    // Decode-ahead producer, the only state shared with the decode task.
+    // The stream is only accessed with the state lock held.
+    private final class Decoder: @unchecked Sendable {
+        struct State {
+            var active = false
+            var loopCount = 0
+        }
+        let stream: AudioStream
+        let ringBuffer: AudioRingBuffer
+        let state = Mutex<State>(State())
+        // blocks of other generation are discarded by the consumer.
+        let generation = Atomic<UInt32>(0)
+        let request = DecodeRequest()
+
+        init(stream: AudioStream, ringBuffer: AudioRingBuffer) {
+            self.stream = stream
+            self.ringBuffer = ringBuffer
+        }
+
+        var isActive: Bool { state.withLock { $0.active } }
+
+        // Decodes one block into the ring buffer, returns false if nothing to do.
+        func decode() -> Bool {
+            state.withLock { state in
+                guard state.active, let buffer = ringBuffer.acquire() else { return false }
+
+                let generation = self.generation.load(ordering: .relaxed)
+                let timeStamp = stream.timePosition
+                let bytesRead = stream.read(buffer, count: ringBuffer.slotSize)
+                if bytesRead > 0 {
+                    ringBuffer.commit(byteCount: bytesRead, timeStamp: timeStamp, generation: generation)
+                } else if bytesRead == 0 {  // EOF
+                    if state.loopCount > 1 {
+                        state.loopCount -= 1
+                        _=stream.seek(pcm: 0) // rewind
+                    } else {
+                        ringBuffer.commit(byteCount: 0, timeStamp: timeStamp, generation: generation,
+                                          endOfStream: true)
+                        state.active = false
+                    }
+                } else {    // error!
+                    Log.err("AudioStream.read failed.")
+                    ringBuffer.commit(byteCount: 0, timeStamp: timeStamp, generation: generation,
+                                      endOfStream: true, error: true)
+                    state.active = false
+                }
+                return true
+            }
+        }
+
+        // starts decoding, from the given time if not nil.
+        // returns the stream position to decode from.
+        func start(time: Double?, loopCount: Int) -> Double {
+            defer { request.signal() }
+            return state.withLock {
+                if let time {
+                    generation.add(1, ordering: .relaxed)
+                    _=stream.seek(time: time)
+                }
+                $0.active = true
+                $0.loopCount = loopCount
+                return stream.timePosition
+            }
+        }
+
+        func stop() {
+            state.withLock {
+                generation.add(1, ordering: .relaxed)
+                $0.active = false
+                _=stream.seek(pcm: 0)
+            }
+            request.signal()
+        }
+    }
+
+    // Wakes the parked decode task, without retaining the player.
+    private final class DecodeRequest: Sendable {
+        private struct State {
+            var signaled = false
+            var continuation: CheckedContinuation<Void, Never>? = nil
+        }
+        private let state = Mutex<State>(State())
+
+        func signal() {
+            let continuation = state.withLock {
+                guard let continuation = $0.continuation else {
+                    $0.signaled = true
+                    return Optional<CheckedContinuation<Void, Never>>.none
+                }
+                $0.continuation = nil
+                return continuation
+            }
+            continuation?.resume()
+        }
+
+        // suspends until signaled, returns immediately if signaled since the last call.
+        func wait() async {
+            await withTaskCancellationHandler {
+                await withCheckedContinuation { (continuation: CheckedContinuation<Void, Never>) in
+                    let resume = state.withLock {
+                        if $0.signaled {
+                            $0.signaled = false
+                            return true
+                        }
+                        $0.continuation = continuation
+                        return false
+                    }
+                    if resume { continuation.resume() }
+                }
+            } onCancel: {
+                self.signal()
+            }
+        }
+    }
+
+    // Fails if the ring buffer cannot be allocated.
+    public nonisolated init?(source: AudioSource, stream: AudioStream) {
+        let bufferingTime = clamp(Self.maxBufferingTime, min: Self.minBufferTime, max: Self.maxBufferTime)
+        let sampleAlignment = stream.channels * stream.bits >> 3
+        let blockSize = Int(bufferingTime * Double(stream.sampleRate)) * sampleAlignment
+        guard let ringBuffer = AudioRingBuffer(slotCount: Self.maxBufferCount + 1, slotSize: blockSize) else {
+            Log.err("AudioPlayer: failed to create ring buffer. (\(blockSize) bytes)")
+            return nil
+        }
+
         self.source = source
         self.stream = stream
+        self.ringBuffer = ringBuffer
+        self.decoder = Decoder(stream: stream, ringBuffer: ringBuffer)
+        self.decodesOnUpdate = source.device.isLoopback
+        if self.decodesOnUpdate { return }
+
+        let fullInterval = UInt64(bufferingTime * 0.25 * 1_000_000_000)
+        let decoder = self.decoder
+        let request = decoder.request
+
+        // captures the decoder only, the player is not Sendable.
+        self.decodeTask = .detached(priority: .medium) { [weak decoder] in
+            let taskID = UUID()
+            detachedServiceTasks.withLock { $0[taskID] = "AudioPlayer decode task" }
+            defer {
+                detachedServiceTasks.withLock { $0[taskID] = nil }
+            }
+
+            while Task.isCancelled == false {
+                let decoded: Bool? = decoder?.decode()
+                guard let decoded else { break }
+                if decoded { continue }
+                let active = decoder?.isActive ?? false
+                if active {
+                    // ring buffer is full, wait for the consumer.
+                    do {
+                        try await Task.sleep(nanoseconds: fullInterval)
+                    } catch {
+                        break
+                    }
+                } else {
+                    // parked until play(), stop() or the player is released.
+                    await request.wait()
+                }
+            }
+        }
     }
 
     deinit {
+        decodeTask?.cancel()
         source.stop()
         source.dequeueBuffers()
     }
 
+    // Decodes one block into the ring buffer, returns false if nothing to do.
+    func decodeAhead() -> Bool {
+        decoder.decode()
+    }
+
     public func play() {
         if self.playing == false {
+            _=self.decoder.start(time: nil, loopCount: 1)
             self.playing = true
             self.buffering = true
-            self.playLoopCount = 1
         }
     }
 
@@ -49,16 +230,14 @@ public class AudioPlayer {
             self.source.stop()
             self.source.dequeueBuffers()
 
+            self.playbackPosition = self.decoder.start(time: start, loopCount: loopCount)
             self.playing = true
             self.buffering = true
-            self.playLoopCount = loopCount
-            _=self.stream.seek(time: start)
-            self.playbackPosition = self.stream.timePosition
         }
     }
 
     public func stop() {
-        _=self.stream.seek(pcm: 0)
+        self.decoder.stop()
         self.source.stop()
         self.source.dequeueBuffers()
         
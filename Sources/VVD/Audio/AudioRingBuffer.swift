@@ -0,0 +1,80 @@
+//
+//  File: AudioRingBuffer.swift
+//  Author: Hongtae Kim (tiff2766@gmail.com)
+//
+//  Copyright (c) 2022-2024 Hongtae Kim. All rights reserved.
+//
+
+import Foundation
+import VVDHelper
+
+// Lock-free single-producer / single-consumer ring of PCM blocks.
+// acquire/commit must be called from one producer thread,
+// peek/release from one consumer thread.
+public final class AudioRingBuffer: @unchecked Sendable {
+    public struct Block {
+        public let data: UnsafeRawPointer
+        public let byteCount: Int
+        public let timeStamp: Double
+        public let generation: UInt32
+        public let endOfStream: Bool
+        public let error: Bool
+    }
+
+    private let ringBuffer: OpaquePointer
+
+    public var slotCount: Int   { VVDAudioRingBufferSlotCount(ringBuffer) }
+    public var slotSize: Int    { VVDAudioRingBufferSlotSize(ringBuffer) }
+    public var count: Int       { VVDAudioRingBufferNumBlocks(ringBuffer) }
+    public var isEmpty: Bool    { count == 0 }
+
+    public init?(slotCount: Int, slotSize: Int) {
+        guard slotCount > 0, slotSize > 0,
+              let rb = VVDAudioRingBufferCreate(slotCount, slotSize) else {
+            return nil
+        }
+        self.ringBuffer = rb
+    }
+
+    deinit {
+        VVDAudioRingBufferDestroy(ringBuffer)
+    }
+
+    // producer: writable slot memory of slotSize bytes, nil if full.
+    public func acquire() -> UnsafeMutableRawPointer? {
+        VVDAudioRingBufferAcquire(ringBuffer)
+    }
+
+    // producer: publishes the slot returned by acquire().
+    public func commit(byteCount: Int, timeStamp: Double, generation: UInt32 = 0,
+                       endOfStream: Bool = false, error: Bool = false) {
+        var flags: UInt32 = 0
+        if endOfStream { flags |= UInt32(VVDAudioRingBufferFlag_EndOfStream) }
+        if error { flags |= UInt32(VVDAudioRingBufferFlag_Error) }
+        VVDAudioRingBufferCommit(ringBuffer, byteCount, timeStamp, flags, generation)
+    }
+
+    // consumer: oldest block, valid until release().
+    public func peek() -> Block? {
+        var block = VVDAudioRingBufferBlock()
+        if VVDAudioRingBufferPeek(ringBuffer, &block) {
+            return Block(data: UnsafeRawPointer(block.data!),
+                         byteCount: block.byteCount,
+                         timeStamp: block.timeStamp,
+                         generation: block.generation,
+                         endOfStream: block.flags & UInt32(VVDAudioRingBufferFlag_EndOfStream) != 0,
+                         error: block.flags & UInt32(VVDAudioRingBufferFlag_Error) != 0)
+        }
+        return nil
+    }
+
+    // consumer: removes oldest block.
+    public func release() {
+        VVDAudioRingBufferRelease(ringBuffer)
+    }
+
+    // both producer and consumer must be idle.
+    public func reset() {
+        VVDAudioRingBufferReset(ringBuffer)
+    }
+}
@@ -78,103 +78,115 @@ public final class AudioSource: Sendable {
 
     public var state: State {
         get {
-            var st: ALint = 0
-            alGetSourcei(sourceID, AL_SOURCE_STATE, &st)
-            switch st {
-            case AL_PLAYING:    return .playing
-            case AL_PAUSED:     return .paused
-            default:            return .stopped
+            return self.device.withCurrentContext {
+                var st: ALint = 0
+                alGetSourcei(sourceID, AL_SOURCE_STATE, &st)
+                switch st {
+                case AL_PLAYING:    return .playing
+                case AL_PAUSED:     return .paused
+                default:            return .stopped
+                }
             }
         }
     }
 
     public func play() {
-        self.buffers.withLock { _ in
-            alSourcePlay(sourceID)
+        self.device.withCurrentContext {
+            self.buffers.withLock { _ in
+                alSourcePlay(sourceID)
+            }
         }
     }
 
     public func pause() {
-        self.buffers.withLock { _ in
-            alSourcePause(sourceID)
+        self.device.withCurrentContext {
+            self.buffers.withLock { _ in
+                alSourcePause(sourceID)
+            }
         }
     }
 
     public func stop() {
-        self.buffers.withLock { buffers in
-            alSourceStop(sourceID)
-            var buffersQueued: ALint = 0
-            var buffersProcessed: ALint = 0
-            alGetSourcei(sourceID, AL_BUFFERS_QUEUED, &buffersQueued)       // entire buffer
-            alGetSourcei(sourceID, AL_BUFFERS_PROCESSED, &buffersProcessed) // finished buffer
-
-            for _ in 0..<buffersProcessed {
-                var bufferID: ALuint = 0
-                alSourceUnqueueBuffers(sourceID, 1, &bufferID)
-            }
+        self.device.withCurrentContext {
+            self.buffers.withLock { buffers in
+                alSourceStop(sourceID)
+                var buffersQueued: ALint = 0
+                var buffersProcessed: ALint = 0
+                alGetSourcei(sourceID, AL_BUFFERS_QUEUED, &buffersQueued)       // entire buffer
+                alGetSourcei(sourceID, AL_BUFFERS_PROCESSED, &buffersProcessed) // finished buffer
 
-            if buffersProcessed != buffers.count {
-                Log.warn("Buffer mismatch! (\(buffers.count) allocated, \(buffersProcessed) released)")
-            }
+                for _ in 0..<buffersProcessed {
+                    var bufferID: ALuint = 0
+                    alSourceUnqueueBuffers(sourceID, 1, &bufferID)
+                }
 
-            alSourcei(sourceID, AL_LOOPING, 0)
-            alSourcei(sourceID, AL_BUFFER, 0)
-            alSourceRewind(sourceID)
+                if buffersProcessed != buffers.count {
+                    Log.warn("Buffer mismatch! (\(buffers.count) allocated, \(buffersProcessed) released)")
+                }
 
-            buffers.forEach {
-                var bufferID = $0.bufferID
-                alDeleteBuffers(1, &bufferID)
-            }
-            buffers.removeAll()
+                alSourcei(sourceID, AL_LOOPING, 0)
+                alSourcei(sourceID, AL_BUFFER, 0)
+                alSourceRewind(sourceID)
 
-            // check error.
-            let err = alGetError()
-            if err != AL_NO_ERROR {
-                Log.err("AudioSource Error: \(String(format: "0x%x (%s)", err, alGetString(err)))")
+                buffers.forEach {
+                    var bufferID = $0.bufferID
+                    alDeleteBuffers(1, &bufferID)
+                }
+                buffers.removeAll()
+
+                // check error.
+                let err = alGetError()
+                if err != AL_NO_ERROR {
+                    Log.err("AudioSource Error: \(String(format: "0x%x (%s)", err, alGetString(err)))")
+                }
             }
         }
     }
 
     public func numberOfBuffersInQueue() -> Int {
-        self.dequeueBuffers()
-        return self.buffers.withLock { buffers in
-            // get number of total buffers.
-            var queuedBuffers: ALint = 0
-            alGetSourcei(sourceID, AL_BUFFERS_QUEUED, &queuedBuffers)
-            if queuedBuffers != buffers.count {
-                Log.err("AudioSource buffer count mismatch! (\(buffers.count) != \(queuedBuffers))")
+        return self.device.withCurrentContext {
+            self.dequeueBuffers()
+            return self.buffers.withLock { buffers in
+                // get number of total buffers.
+                var queuedBuffers: ALint = 0
+                alGetSourcei(sourceID, AL_BUFFERS_QUEUED, &queuedBuffers)
+                if queuedBuffers != buffers.count {
+                    Log.err("AudioSource buffer count mismatch! (\(buffers.count) != \(queuedBuffers))")
+                }
+                return buffers.count
             }
-            return buffers.count
         }
     }
 
     public func dequeueBuffers() {
-        self.buffers.withLock { buffers in
-            var bufferProcessed: ALint = 0
-            alGetSourcei(sourceID, AL_BUFFERS_PROCESSED, &bufferProcessed)
-            for _ in 0..<bufferProcessed {
-                var bufferID: ALuint = 0
-                alSourceUnqueueBuffers(sourceID, 1, &bufferID)
-                if bufferID != 0 {
-                    if let index = buffers.firstIndex(where: {
-                        $0.bufferID == bufferID
-                    }) {
-                        buffers.remove(at: index)
+        self.device.withCurrentContext {
+            self.buffers.withLock { buffers in
+                var bufferProcessed: ALint = 0
+                alGetSourcei(sourceID, AL_BUFFERS_PROCESSED, &bufferProcessed)
+                for _ in 0..<bufferProcessed {
+                    var bufferID: ALuint = 0
+                    alSourceUnqueueBuffers(sourceID, 1, &bufferID)
+                    if bufferID != 0 {
+                        if let index = buffers.firstIndex(where: {
+                            $0.bufferID == bufferID
+                        }) {
+                            buffers.remove(at: index)
+                        }
+                        alDeleteBuffers(1, &bufferID)
+                    } else {
+                        Log.err("AudioSource Failed to dequeue buffer! (source: \(sourceID))")
                     }
-                    alDeleteBuffers(1, &bufferID)
-                } else {
-                    Log.err("AudioSource Failed to dequeue buffer! (source: \(sourceID))")
-                }
 
-                // check error.
-                let err = alGetError()
-                if err != AL_NO_ERROR {
-                    Log.err("AudioSource Error: \(String(format: "0x%x (%s)", err, alGetString(err)))")
+                    // check error.
+                    let err = alGetError()
+                    if err != AL_NO_ERROR {
+                        Log.err("AudioSource Error: \(String(format: "0x%x (%s)", err, alGetString(err)))")
+                    }
                 }
-            }
 
-            if bufferProcessed > 0 {
-                // Log.debug("AudioSource buffer dequeued. remains: \(buffers.count)")
+                if bufferProcessed > 0 {
+                    // Log.debug("AudioSource buffer dequeued. remains: \(buffers.count)")
+                }
             }
         }
     }
@@ -185,111 +197,117 @@ public final class AudioSource: Sendable {
                               data: UnsafeRawPointer,
                               byteCount: Int,
                               timeStamp: Double) -> Bool {
-        if byteCount > 0 && sampleRate > 0 {
-            let format = self.device.format(bits: bits, channels: channels)
-            if format != 0 {
-                return self.buffers.withLock { buffers in
-                    var finishedBuffers: [ALuint] = []
-                    var numBuffersProcessed: ALint = 0
-                    alGetSourcei(sourceID, AL_BUFFERS_PROCESSED, &numBuffersProcessed)
-                    finishedBuffers.reserveCapacity(Int(numBuffersProcessed))
+        return self.device.withCurrentContext {
+            if byteCount > 0 && sampleRate > 0 {
+                let format = self.device.format(bits: bits, channels: channels)
+                if format != 0 {
+                    return self.buffers.withLock { buffers in
+                        var finishedBuffers: [ALuint] = []
+                        var numBuffersProcessed: ALint = 0
+                        alGetSourcei(sourceID, AL_BUFFERS_PROCESSED, &numBuffersProcessed)
+                        finishedBuffers.reserveCapacity(Int(numBuffersProcessed))
+
+                        while numBuffersProcessed > 0 {
+                            var bufferID: ALuint = 0
+                            alSourceUnqueueBuffers(sourceID, 1, &bufferID) // collect buffer to recycle
+                            if bufferID != 0 {
+                                finishedBuffers.append(bufferID)
+                            }
+                            numBuffersProcessed -= 1
+                        }
 
-                    while numBuffersProcessed > 0 {
                         var bufferID: ALuint = 0
-                        alSourceUnqueueBuffers(sourceID, 1, &bufferID) // collect buffer to recycle
-                        if bufferID != 0 {
-                            finishedBuffers.append(bufferID)
-                        }
-                        numBuffersProcessed -= 1
-                    }
+                        if finishedBuffers.isEmpty == false {
+                            finishedBuffers.forEach { buffID in
+                                if let index = buffers.firstIndex(where: {
+                                    $0.bufferID == buffID
+                                }) {
+                                    buffers.remove(at: index);
+                                }
+                            }
 
-                    var bufferID: ALuint = 0
-                    if finishedBuffers.isEmpty == false {
-                        finishedBuffers.forEach { buffID in
-                            if let index = buffers.firstIndex(where: {
-                                $0.bufferID == buffID
-                            }) {
-                                buffers.remove(at: index);
+                            bufferID = finishedBuffers[0]
+                            let numBuffers = finishedBuffers.count
+                            if numBuffers > 1 {
+                                finishedBuffers[1...].withUnsafeBufferPointer { ptr in
+                                    alDeleteBuffers(ALsizei(numBuffers - 1), ptr.baseAddress)
+                                }
                             }
                         }
 
-                        bufferID = finishedBuffers[0]
-                        let numBuffers = finishedBuffers.count
-                        if numBuffers > 1 {
-                            finishedBuffers[1...].withUnsafeBufferPointer { ptr in
-                                alDeleteBuffers(ALsizei(numBuffers - 1), ptr.baseAddress)
-                            }
+                        if bufferID == 0 {
+                            alGenBuffers(1, &bufferID)
                         }
-                    }
+                        // enqueue buffer.
+                        let bytes = ALsizei(byteCount)
+                        alBufferData(bufferID, format, data, bytes, ALsizei(sampleRate))
+                        alSourceQueueBuffers(sourceID, 1, &bufferID)
 
-                    if bufferID == 0 {
-                        alGenBuffers(1, &bufferID)
-                    }
-                    // enqueue buffer.
-                    let bytes = ALsizei(byteCount)
-                    alBufferData(bufferID, format, data, bytes, ALsizei(sampleRate))
-                    alSourceQueueBuffers(sourceID, 1, &bufferID)
+                        let bytesSecond = UInt(sampleRate * channels * (bits >> 3))
+                        let bufferInfo = Buffer(timeStamp: timeStamp, bytes: UInt(bytes), bytesSecond: bytesSecond, bufferID: bufferID)
+                        buffers.append(bufferInfo)
 
-                    let bytesSecond = UInt(sampleRate * channels * (bits >> 3))
-                    let bufferInfo = Buffer(timeStamp: timeStamp, bytes: UInt(bytes), bytesSecond: bytesSecond, bufferID: bufferID)
-                    buffers.append(bufferInfo)
+                        // check error.
+                        let err = alGetError()
+                        if err != AL_NO_ERROR {
+                            Log.err("AudioSource Error: \(String(format: "0x%x (%s)", err, alGetString(err)))")
+                        }
 
-                    // check error.
-                    let err = alGetError()
-                    if err != AL_NO_ERROR {
-                        Log.err("AudioSource Error: \(String(format: "0x%x (%s)", err, alGetString(err)))")
+                        return true
                     }
-
-                    return true
                 }
+                else {
+                    Log.err("Unsupported audio format! (\(bits) bits, \(channels) channels)")
+                }          
             }
-            else {
-                Log.err("Unsupported audio format! (\(bits) bits, \(channels) channels)")
-            }          
+            self.dequeueBuffers()
+            return false
         }
-        self.dequeueBuffers()
-        return false
     }
 
     public var timePosition: Double {
         get {
-            self.dequeueBuffers()
-            return self.buffers.withLock { buffers in
-                if let buffer = buffers.first {
-                    assert(buffer.bufferID != 0)
-                    assert(buffer.bytes != 0)
-                    assert(buffer.bytesSecond != 0)
-
-                    var bytesOffset: ALint = 0
-                    alGetSourcei(sourceID, AL_BYTE_OFFSET, &bytesOffset)
-                    // If last buffer is too small, playing over next buffer before unqueue.
-                    // This can be time accuracy problem.
-                    bytesOffset = clamp(bytesOffset, min: 0, max: ALint(buffer.bytes))
-
-                    let position = buffer.timeStamp + Double(bytesOffset) / Double(buffer.bytesSecond)
-                    return position
+            return self.device.withCurrentContext {
+                self.dequeueBuffers()
+                return self.buffers.withLock { buffers in
+                    if let buffer = buffers.first {
+                        assert(buffer.bufferID != 0)
+                        assert(buffer.bytes != 0)
+                        assert(buffer.bytesSecond != 0)
+
+                        var bytesOffset: ALint = 0
+                        alGetSourcei(sourceID, AL_BYTE_OFFSET, &bytesOffset)
+                        // If last buffer is too small, playing over next buffer before unqueue.
+                        // This can be time accuracy problem.
+                        bytesOffset = clamp(bytesOffset, min: 0, max: ALint(buffer.bytes))
+
+                        let position = buffer.timeStamp + Double(bytesOffset) / Double(buffer.bytesSecond)
+                        return position
+                    }
+                    return 0.0
                 }
-                return 0.0
             }
         }
         set {
-            self.dequeueBuffers()
-            self.buffers.withLock { buffers in
-                if let buffer = buffers.first {
-                    assert(buffer.bufferID != 0)
-                    assert(buffer.bytes != 0)
-                    assert(buffer.bytesSecond != 0)
-
-                    if newValue > buffer.timeStamp {
-                        let t = newValue - buffer.timeStamp
-
-                        let bytesOffset: ALint = clamp(ALint(Double(buffer.bytesSecond) * t), min: 0, max: ALint(buffer.bytes))
-                        alSourcei(sourceID, AL_BYTE_OFFSET, bytesOffset)
-
-                        // check error.
-                        let err = alGetError()
-                        if err != AL_NO_ERROR {
-                            Log.err("AudioSource Error: \(String(format: "0x%x (%s)", err, alGetString(err)))")
+            self.device.withCurrentContext {
+                self.dequeueBuffers()
+                self.buffers.withLock { buffers in
+                    if let buffer = buffers.first {
+                        assert(buffer.bufferID != 0)
+                        assert(buffer.bytes != 0)
+                        assert(buffer.bytesSecond != 0)
+
+                        if newValue > buffer.timeStamp {
+                            let t = newValue - buffer.timeStamp
+
+                            let bytesOffset: ALint = clamp(ALint(Double(buffer.bytesSecond) * t), min: 0, max: ALint(buffer.bytes))
+                            alSourcei(sourceID, AL_BYTE_OFFSET, bytesOffset)
+
+                            // check error.
+                            let err = alGetError()
+                            if err != AL_NO_ERROR {
+                                Log.err("AudioSource Error: \(String(format: "0x%x (%s)", err, alGetString(err)))")
+                            }
                         }
                     }
                 }
@@ -299,41 +317,45 @@ public final class AudioSource: Sendable {
 
     public var timeOffset: Double {
         get {
-            self.dequeueBuffers()
-            return self.buffers.withLock { buffers in
-                if let buffer = buffers.first {
-                    assert(buffer.bufferID != 0)
-                    assert(buffer.bytes != 0)
-                    assert(buffer.bytesSecond != 0)
-
-                    var bytesOffset: ALint = 0
-                    alGetSourcei(sourceID, AL_BYTE_OFFSET, &bytesOffset)
-                    // If last buffer is too small, playing over next buffer before unqueue.
-                    // This can be time accuracy problem.
-                    bytesOffset = clamp(bytesOffset, min: 0, max: ALint(buffer.bytes))
-
-                    return Double(bytesOffset) / Double(buffer.bytesSecond)
+            return self.device.withCurrentContext {
+                self.dequeueBuffers()
+                return self.buffers.withLock { buffers in
+                    if let buffer = buffers.first {
+                        assert(buffer.bufferID != 0)
+                        assert(buffer.bytes != 0)
+                        assert(buffer.bytesSecond != 0)
+
+                        var bytesOffset: ALint = 0
+                        alGetSourcei(sourceID, AL_BYTE_OFFSET, &bytesOffset)
+                        // If last buffer is too small, playing over next buffer before unqueue.
+                        // This can be time accuracy problem.
+                        bytesOffset = clamp(bytesOffset, min: 0, max: ALint(buffer.bytes))
+
+                        return Double(bytesOffset) / Double(buffer.bytesSecond)
+                    }
+                    return 0.0
                 }
-                return 0.0
             }
         }
         set {
-            self.dequeueBuffers()
-            self.buffers.withLock { buffers in
-                if let buffer = buffers.first {
-                    assert(buffer.bufferID != 0)
-                    assert(buffer.bytes != 0)
-                    assert(buffer.bytesSecond != 0)
-
-                    if newValue > buffer.timeStamp {
-                        let t = newValue
-                        let bytesOffset: ALint = clamp(ALint(Double(buffer.bytesSecond) * t), min: 0, max: ALint(buffer.bytes))
-                        alSourcei(sourceID, AL_BYTE_OFFSET, bytesOffset)
-
-                        // check error.
-                        let err = alGetError()
-                        if err != AL_NO_ERROR {
-                            Log.err("AudioSource Error: \(String(format: "0x%x (%s)", err, alGetString(err)))")
+            self.device.withCurrentContext {
+                self.dequeueBuffers()
+                self.buffers.withLock { buffers in
+                    if let buffer = buffers.first {
+                        assert(buffer.bufferID != 0)
+                        assert(buffer.bytes != 0)
+                        assert(buffer.bytesSecond != 0)
+
+                        if newValue > buffer.timeStamp {
+                            let t = newValue
+                            let bytesOffset: ALint = clamp(ALint(Double(buffer.bytesSecond) * t), min: 0, max: ALint(buffer.bytes))
+                            alSourcei(sourceID, AL_BYTE_OFFSET, bytesOffset)
+
+                            // check error.
+                            let err = alGetError()
+                            if err != AL_NO_ERROR {
+                                Log.err("AudioSource Error: \(String(format: "0x%x (%s)", err, alGetString(err)))")
+                            }
                         }
                     }
                 }
@@ -361,40 +383,50 @@ public final class AudioSource: Sendable {
     }
 
     deinit {
-        assert(alIsSource(sourceID) != 0)
+        self.device.withCurrentContext {
+            assert(alIsSource(sourceID) != 0)
 
-        self.stop()
-        let buffers = self.buffers.withLock { $0 }
-        assert(buffers.isEmpty)
+            self.stop()
+            let buffers = self.buffers.withLock { $0 }
+            assert(buffers.isEmpty)
 
-        var sourceID = self.sourceID
-        alDeleteSources(1, &sourceID)
+            var sourceID = self.sourceID
+            alDeleteSources(1, &sourceID)
 
-        // check error.
-        let err = alGetError()
-        if err != AL_NO_ERROR {
-            Log.err("AudioSource.\(#function) Error: \(String(format: "0x%x (%s)", err, alGetString(err)))")
-        }      
+            // check error.
+            let err = alGetError()
+            if err != AL_NO_ERROR {
+                Log.err("AudioSource.\(#function) Error: \(String(format: "0x%x (%s)", err, alGetString(err)))")
+            }      
+        }
     }
 
     private func getSource(_ param: ALenum, _ value: Scalar) -> Scalar {
-        var value = ALfloat(value)
-        alGetSourcef(sourceID, param, &value)
-        return Scalar(value)
+        return self.device.withCurrentContext {
+            var value = ALfloat(value)
+            alGetSourcef(sourceID, param, &value)
+            return Scalar(value)
+        }
     }
 
     private func getSource(_ param: ALenum, _ vector: Vector3) -> Vector3 {
-        var v = vector.float3
-        alGetSource3f(sourceID, param, &v.0, &v.1, &v.2)
-        return Vector3(v)
+        return self.device.withCurrentContext {
+            var v = vector.float3
+            alGetSource3f(sourceID, param, &v.0, &v.1, &v.2)
+            return Vector3(v)
+        }
     }
 
     private func setSource(_ param: ALenum, _ value: Scalar) {
-        alSourcef(sourceID, param, ALfloat(value))
+        self.device.withCurrentContext {
+            alSourcef(sourceID, param, ALfloat(value))
+        }
     }
 
     private func setSource(_ param: ALenum, _ vector: Vector3) {
-        let v = vector.float3
-        alSource3f(sourceID, param, v.0, v.1, v.2)
+        self.device.withCurrentContext {
+            let v = vector.float3
+            alSource3f(sourceID, param, v.0, v.1, v.2)
+        }
     }  
 }
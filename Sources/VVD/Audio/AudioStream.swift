@@ -102,17 +102,68 @@ public class AudioStream {
     }
 
     public func seek(raw: UInt64) -> UInt64 {
+        if raw > 0 { buildDeferredSeekTable() }
         return stream.pointee.seekRaw(stream, raw)
     }
 
     public func seek(pcm: UInt64) -> UInt64 {
+        if pcm > 0 { buildDeferredSeekTable() }
         return stream.pointee.seekPcm(stream, pcm)
     }
 
     public func seek(time: Double) -> Double {
+        if time > 0 { buildDeferredSeekTable() }
         return stream.pointee.seekTime(stream, time)
     }
 
+    // interval of the seek table built on the first seek, see init(data:seekTable:)
+    private var deferredSeekTableInterval: Double?
+
+    private func buildDeferredSeekTable() {
+        if let interval = deferredSeekTableInterval {
+            deferredSeekTableInterval = nil
+            if hasSeekTable == false {
+                buildSeekTable(interval: interval)
+            }
+        }
+    }
+
+    public var hasSeekTable: Bool { stream.pointee.seekTable != nil }
+
+    // Scans the entire stream to build a seek table, which
+    // makes seeking O(1). Wave streams do not need it, and
+    // Ogg Vorbis streams use bisection of vorbisfile instead.
+    @discardableResult
+    public func buildSeekTable(interval: Double = 0.1) -> Bool {
+        deferredSeekTableInterval = nil
+        let intervalMs = UInt32(clamp(interval, min: 0.001, max: 60.0) * 1000.0)
+        return VVDAudioStreamBuildSeekTable(stream, intervalMs)
+    }
+
+    // Serialized seek table, to be stored alongside the asset.
+    public func seekTableData() -> Data? {
+        let size = VVDAudioStreamSerializeSeekTable(stream, nil, 0)
+        if size > 0 {
+            var data = Data(count: size)
+            let written = data.withUnsafeMutableBytes {
+                VVDAudioStreamSerializeSeekTable(stream, $0.baseAddress, $0.count)
+            }
+            if written == size {
+                return data
+            }
+        }
+        return nil
+    }
+
+    @discardableResult
+    public func loadSeekTable(_ data: Data) -> Bool {
+        let loaded = data.withUnsafeBytes {
+            VVDAudioStreamDeserializeSeekTable(stream, $0.baseAddress, $0.count)
+        }
+        if loaded { deferredSeekTableInterval = nil }
+        return loaded
+    }
+
     public init?(data: Data) {
         let source = DataStream(data: data)
         if let stream = VVDAudioStreamCreate(&source.stream) {
@@ -141,6 +192,19 @@ public class AudioStream {
         } else { return nil }
     }
 
+    // Restores the seek table cached from the same asset. If it is missing
+    // or does not match, a new one is built on the first seek instead of
+    // scanning the stream here, streams played from the start never scan.
+    public convenience init?(data: Data, seekTable: Data?) {
+        self.init(data: data)
+        if let seekTable, self.loadSeekTable(seekTable) {
+            return
+        }
+        if self.seekable && self.stream.pointee.buildSeekTable != nil {
+            self.deferredSeekTableInterval = 0.1
+        }
+    }
+
     deinit {
         VVDAudioStreamDestroy(stream)
     }
@@ -2,25 +2,154 @@
 //  File: BVH.swift
 //  Author: Hongtae Kim (tiff2766@gmail.com)
 //
-//  Copyright (c) 2022 Hongtae Kim. All rights reserved.
+//  Copyright (c) 2022-2024 Hongtae Kim. All rights reserved.
 //
 
 import Foundation
 
+// Bounding volume hierarchy of AABBs, one object per leaf.
+// Nodes are stored in depth-first order with quantized (16-bit) bounds.
+// treeStride of an internal node is the number of nodes in its subtree,
+// (the next sibling is at index + treeStride), a leaf node stores the
+// object index as -(index + 1).
 public class BVH {
     var aabbOffset: Vector3
     var aabbScale: Vector3
 
     struct AABBNode {
-        var min: UInt16
-        var max: UInt16
+        var min: (UInt16, UInt16, UInt16)
+        var max: (UInt16, UInt16, UInt16)
         var treeStride: Int32
+
+        var isLeaf: Bool { treeStride < 0 }
+        var objectIndex: Int { Int(-treeStride) - 1 }
+        var escapeIndex: Int { treeStride < 0 ? 1 : Int(treeStride) }
     }
 
     var nodes: [AABBNode] = []
+    public private(set) var numObjects: Int = 0
+
+    public var numNodes: Int { nodes.count }
+    public var aabb: AABB { nodes.isEmpty ? .null : nodeAABB(0) }
 
     public init() {
         self.aabbOffset = .zero
         self.aabbScale = .init(1, 1, 1)
     }
+
+    public convenience init(objects: [AABB]) {
+        self.init()
+        self.build(objects: objects)
+    }
+
+    public func build(objects: [AABB]) {
+        nodes.removeAll(keepingCapacity: true)
+        numObjects = objects.count
+
+        var bounds = AABB.null
+        var indices: [Int] = []
+        indices.reserveCapacity(objects.count)
+        for (i, aabb) in objects.enumerated() where aabb.isNull == false {
+            bounds.combine(aabb)
+            indices.append(i)
+        }
+        if indices.isEmpty { return }
+
+        let extents = Vector3.maximum(bounds.extents, Vector3(1, 1, 1) * .ulpOfOne)
+        aabbOffset = bounds.min
+        aabbScale = Vector3(Scalar(UInt16.max) / extents.x,
+                            Scalar(UInt16.max) / extents.y,
+                            Scalar(UInt16.max) / extents.z)
+
+        let centers = objects.map { $0.center }
+        nodes.reserveCapacity(indices.count * 2 - 1)
+        indices.withUnsafeMutableBufferPointer { indices in
+            buildSubtree(objects, centers, indices, 0..<indices.count)
+        }
+    }
+
+    @discardableResult
+    private func buildSubtree(_ objects: [AABB],
+                              _ centers: [Vector3],
+                              _ indices: UnsafeMutableBufferPointer<Int>,
+                              _ range: Range<Int>) -> AABB {
+        let nodeIndex = nodes.count
+        if range.count == 1 {
+            let object = indices[range.lowerBound]
+            let aabb = objects[object]
+            nodes.append(quantized(aabb, treeStride: -Int32(object + 1)))
+            return aabb
+        }
+        nodes.append(quantized(.null, treeStride: 0))
+
+        // split at the midpoint of the longest axis of centers,
+        // fall back to the median index if all centers are on one side.
+        var centerBounds = AABB.null
+        for i in range {
+            let c = centers[indices[i]]
+            centerBounds.combine(AABB(min: c, max: c))
+        }
+        let extents = centerBounds.extents
+        let axis = extents.x > extents.y ? (extents.x > extents.z ? 0 : 2)
+                                         : (extents.y > extents.z ? 1 : 2)
+        let mid = centerBounds.center[axis]
+        var slice = UnsafeMutableBufferPointer(rebasing: indices[range])
+        var split = slice.partition { centers[$0][axis] >= mid } + range.lowerBound
+        if split == range.lowerBound || split == range.upperBound {
+            split = (range.lowerBound + range.upperBound) / 2
+        }
+
+        var aabb = buildSubtree(objects, centers, indices, range.lowerBound..<split)
+        aabb.combine(buildSubtree(objects, centers, indices, split..<range.upperBound))
+        nodes[nodeIndex] = quantized(aabb, treeStride: Int32(nodes.count - nodeIndex))
+        return aabb
+    }
+
+    // conservative quantization, rounds min down and max up.
+    private func quantized(_ aabb: AABB, treeStride: Int32) -> AABBNode {
+        if aabb.isNull {
+            return AABBNode(min: (0, 0, 0), max: (0, 0, 0), treeStride: treeStride)
+        }
+        func q(_ v: Scalar, _ offset: Scalar, _ scale: Scalar, _ round: (Scalar) -> Scalar) -> UInt16 {
+            UInt16(Swift.min(Swift.max(round((v - offset) * scale), 0), Scalar(UInt16.max)))
+        }
+        let o = aabbOffset, s = aabbScale
+        return AABBNode(min: (q(aabb.min.x, o.x, s.x, floor),
+                              q(aabb.min.y, o.y, s.y, floor),
+                              q(aabb.min.z, o.z, s.z, floor)),
+                        max: (q(aabb.max.x, o.x, s.x, ceil),
+                              q(aabb.max.y, o.y, s.y, ceil),
+                              q(aabb.max.z, o.z, s.z, ceil)),
+                        treeStride: treeStride)
+    }
+
+    func nodeAABB(_ index: Int) -> AABB {
+        let node = nodes[index]
+        let o = aabbOffset, s = aabbScale
+        return AABB(min: Vector3(Scalar(node.min.0) / s.x + o.x,
+                                 Scalar(node.min.1) / s.y + o.y,
+                                 Scalar(node.min.2) / s.z + o.z),
+                    max: Vector3(Scalar(node.max.0) / s.x + o.x,
+                                 Scalar(node.max.1) / s.y + o.y,
+                                 Scalar(node.max.2) / s.z + o.z))
+    }
+
+    // Visits nodes depth-first, the visitor decides whether to descend
+    // into children of an internal node. Leaves are passed with the object index.
+    public func traverse(_ visitor: (_ aabb: AABB, _ objectIndex: Int?) -> Bool) {
+        var index = 0
+        while index < nodes.count {
+            let node = nodes[index]
+            let descend = visitor(nodeAABB(index), node.isLeaf ? node.objectIndex : nil)
+            index += (descend && node.isLeaf == false) ? 1 : node.escapeIndex
+        }
+    }
+
+    // calls body with object indices of the subtree of node at index.
+    func forEachObject(inSubtree index: Int, _ body: (Int) -> Void) {
+        let end = index + nodes[index].escapeIndex
+        for i in index..<end where nodes[i].isLeaf {
+            body(nodes[i].objectIndex)
+        }
+    }
 }
@@ -0,0 +1,192 @@
+//
+//  File: DiskCache.swift
+//  Author: Hongtae Kim (tiff2766@gmail.com)
+//
+//  Copyright (c) 2022-2024 Hongtae Kim. All rights reserved.
+//
+
+import Foundation
+
+// File based key-value cache.
+// Each entry has a header (format version, identity, payload size, CRC32)
+// and entries written by a different identity (e.g. another device or driver)
+// or corrupted entries are discarded on read.
+// Files are written atomically, least recently used entries are removed
+// when the total size exceeds the size limit.
+public final class DiskCache: @unchecked Sendable {
+    public static let formatVersion: UInt32 = 1
+    private static let magic: UInt32 = 0x4356_5644 // "DVVC"
+    private static let fileExtension = "cache"
+
+    public let directory: URL
+    public let identity: Data
+    public var sizeLimit: Int {
+        didSet { lock.withLock { trim() } }
+    }
+
+    private var currentSize: Int = 0
+    private let lock = NSLock()
+
+    public static var defaultDirectory: URL {
+        let caches = FileManager.default.urls(for: .cachesDirectory, in: .userDomainMask).first
+            ?? FileManager.default.temporaryDirectory
+        return caches.appendingPathComponent("VVD", isDirectory: true)
+    }
+
+    public init?(name: String,
+                 identity: Data = Data(),
+                 sizeLimit: Int = 64 << 20,
+                 directory: URL? = nil) {
+        let directory = (directory ?? Self.defaultDirectory)
+            .appendingPathComponent(name, isDirectory: true)
+        do {
+            try FileManager.default.createDirectory(at: directory,
+                                                    withIntermediateDirectories: true)
+        } catch {
+            Log.err("DiskCache: Unable to create directory \(directory.path): \(error)")
+            return nil
+        }
+        self.directory = directory
+        self.identity = identity
+        self.sizeLimit = sizeLimit
+        self.currentSize = entries().reduce(0) { $0 + $1.size }
+    }
+
+    public var totalSize: Int {
+        lock.withLock { currentSize }
+    }
+
+    public func data(forKey key: String) -> Data? {
+        lock.withLock {
+            let url = fileURL(forKey: key)
+            guard let contents = try? Data(contentsOf: url) else { return nil }
+            if let payload = decode(contents) {
+                // keeps recently used entries from being evicted.
+                try? FileManager.default.setAttributes([.modificationDate: Date()],
+                                                       ofItemAtPath: url.path)
+                return payload
+            }
+            Log.warn("DiskCache: Invalid entry \(url.lastPathComponent) removed.")
+            remove(url, size: contents.count)
+            return nil
+        }
+    }
+
+    @discardableResult
+    public func setData(_ data: Data, forKey key: String) -> Bool {
+        let contents = encode(data)
+        if contents.count > sizeLimit { return false }
+        return lock.withLock {
+            let url = fileURL(forKey: key)
+            let oldSize = fileSize(url) ?? 0
+            do {
+                try contents.write(to: url, options: .atomic)
+            } catch {
+                Log.err("DiskCache: Unable to write \(url.path): \(error)")
+                return false
+            }
+            currentSize += contents.count - oldSize
+            trim()
+            return true
+        }
+    }
+
+    public func removeData(forKey key: String) {
+        lock.withLock {
+            let url = fileURL(forKey: key)
+            if let size = fileSize(url) {
+                remove(url, size: size)
+            }
+        }
+    }
+
+    public func removeAll() {
+        lock.withLock {
+            for entry in entries() {
+                remove(entry.url, size: entry.size)
+            }
+            currentSize = 0
+        }
+    }
+
+    private func fileURL(forKey key: String) -> URL {
+        directory.appendingPathComponent(SHA256.hash(key).string)
+            .appendingPathExtension(Self.fileExtension)
+    }
+
+    private func fileSize(_ url: URL) -> Int? {
+        (try? FileManager.default.attributesOfItem(atPath: url.path)[.size] as? NSNumber)?.intValue
+    }
+
+    private func remove(_ url: URL, size: Int) {
+        if (try? FileManager.default.removeItem(at: url)) != nil {
+            currentSize -= size
+        }
+    }
+
+    private func entries() -> [(url: URL, size: Int, date: Date)] {
+        let keys: [URLResourceKey] = [.fileSizeKey, .contentModificationDateKey]
+        let urls = (try? FileManager.default.contentsOfDirectory(at: directory,
+                                                                 includingPropertiesForKeys: keys)) ?? []
+        return urls.filter { $0.pathExtension == Self.fileExtension }.map { url in
+            let values = try? url.resourceValues(forKeys: Set(keys))
+            return (url, values?.fileSize ?? 0, values?.contentModificationDate ?? .distantPast)
+        }
+    }
+
+    private func trim() {
+        if currentSize <= sizeLimit { return }
+        let entries = entries().sorted { $0.date < $1.date }
+        currentSize = entries.reduce(0) { $0 + $1.size }
+        for entry in entries {
+            if currentSize <= sizeLimit { break }
+            remove(entry.url, size: entry.size)
+        }
+    }
+
+    // header: magic, version, identity length, identity, payload size, payload crc32
+    private func encode(_ payload: Data) -> Data {
+        var data = Data()
+        data.reserveCapacity(24 + identity.count + payload.count)
+        func append<T: FixedWidthInteger>(_ value: T) {
+            withUnsafeBytes(of: value.littleEndian) { data.append(contentsOf: $0) }
+        }
+        append(Self.magic)
+        append(Self.formatVersion)
+        append(UInt32(identity.count))
+        data.append(identity)
+        append(UInt64(payload.count))
+        append(CRC32.hash(data: payload).hash)
+        data.append(payload)
+        return data
+    }
+
+    private func decode(_ data: Data) -> Data? {
+        var offset = data.startIndex
+        func read<T: FixedWidthInteger>(_: T.Type) -> T? {
+            let size = MemoryLayout<T>.size
+            if data.endIndex - offset < size { return nil }
+            var value: T = 0
+            withUnsafeMutableBytes(of: &value) {
+                $0.copyBytes(from: data[offset..<offset + size])
+            }
+            offset += size
+            return T(littleEndian: value)
+        }
+        guard read(UInt32.self) == Self.magic,
+              read(UInt32.self) == Self.formatVersion,
+              let identityLength = read(UInt32.self),
+              data.endIndex - offset >= Int(identityLength),
+              data[offset..<offset + Int(identityLength)] == identity
+        else { return nil }
+        offset += Int(identityLength)
+
+        guard let length = read(UInt64.self),
+              let crc = read(UInt32.self),
+              data.endIndex - offset == Int(length)
+        else { return nil }
+        let payload = data[offset...]
+        if CRC32.hash(data: payload).hash != crc { return nil }
+        return Data(payload)
+    }
+}
@@ -0,0 +1,147 @@
+//
+//  File: AsyncPipelineCompiler.swift
+//  Author: Hongtae Kim (tiff2766@gmail.com)
+//
+//  Copyright (c) 2022-2024 Hongtae Kim. All rights reserved.
+//
+
+import Foundation
+
+// Creates pipeline states on worker threads.
+// A state is compiled once per key, requests for a key that is already
+// being compiled do not schedule another compilation.
+// The render thread asks for a state with state(for:compile:whenDone:) and
+// skips the draw (or uses a fallback) until the state is ready, whenDone is
+// called on the worker thread once the compilation is finished.
+public final class AsyncPipelineCompiler<Key: Hashable, State>: @unchecked Sendable {
+    public enum Status {
+        case ready(State)
+        case pending
+        case failed
+    }
+
+    public let maxConcurrentTasks: Int
+
+    private var states: [Key: State] = [:]
+    private var failedKeys: Set<Key> = []
+    private var inFlight: Set<Key> = []
+    private var queue: [(key: Key, compile: () -> State?)] = []
+    private var handlers: [Key: [() -> Void]] = [:]
+    private var numWorkers = 0
+    private let condition = NSCondition()
+
+    public init(maxConcurrentTasks: Int = max(ProcessInfo.processInfo.activeProcessorCount / 2, 1)) {
+        self.maxConcurrentTasks = max(maxConcurrentTasks, 1)
+    }
+
+    // number of states that are queued or being compiled.
+    public var numPendingStates: Int {
+        condition.withLock { inFlight.count }
+    }
+
+    public var numCompiledStates: Int {
+        condition.withLock { states.count }
+    }
+
+    // returns immediately, schedules the compilation if the key is new.
+    // whenDone is called if .pending is returned, when the state is
+    // compiled or has failed.
+    public func state(for key: Key,
+                      compile: @escaping () -> State?,
+                      whenDone: (() -> Void)? = nil) -> Status {
+        condition.withLock {
+            if let state = states[key] { return .ready(state) }
+            if failedKeys.contains(key) { return .failed }
+            if inFlight.contains(key) == false {
+                inFlight.insert(key)
+                queue.append((key, compile))
+                spawnWorkerIfNeeded()
+            }
+            if let whenDone {
+                handlers[key, default: []].append(whenDone)
+            }
+            return .pending
+        }
+    }
+
+    // blocks until the state is ready, compiles on the calling thread
+    // unless the key is already in flight.
+    public func waitForState(for key: Key, compile: () -> State?) -> State? {
+        condition.lock()
+        defer { condition.unlock() }
+
+        while true {
+            if let state = states[key] { return state }
+            if failedKeys.contains(key) { return nil }
+            if let index = queue.firstIndex(where: { $0.key == key }) {
+                // not started yet, compile it here.
+                queue.remove(at: index)
+                break
+            }
+            if inFlight.contains(key) == false {
+                inFlight.insert(key)
+                break
+            }
+            condition.wait()
+        }
+
+        condition.unlock()
+        let state = compile()
+        condition.lock()
+        let handlers = finish(key, state)
+        condition.unlock()
+        handlers.forEach { $0() }
+        condition.lock()
+        return state
+    }
+
+    // blocks until all scheduled states are compiled.
+    public func waitUntilIdle() {
+        condition.withLock {
+            while inFlight.isEmpty == false {
+                condition.wait()
+            }
+        }
+    }
+
+    private func spawnWorkerIfNeeded() {
+        if numWorkers >= maxConcurrentTasks || queue.isEmpty { return }
+        numWorkers += 1
+        DispatchQueue.global(qos: .userInitiated).async { [self] in
+            condition.lock()
+            while queue.isEmpty == false {
+                let job = queue.removeFirst()
+                condition.unlock()
+
+                let start = DispatchTime.now().uptimeNanoseconds
+                let state = job.compile()
+                let elapsed = Double(DispatchTime.now().uptimeNanoseconds - start) * 0.000_001
+                Log.debug("AsyncPipelineCompiler: \(job.key) compiled. (\(String(format: "%.2f", elapsed)) ms)")
+
+                condition.lock()
+                let handlers = finish(job.key, state)
+                if handlers.isEmpty == false {
+                    condition.unlock()
+                    handlers.forEach { $0() }
+                    condition.lock()
+                }
+            }
+            numWorkers -= 1
+            condition.unlock()
+        }
+    }
+
+    // called with the lock held, returns the handlers to be called
+    // after the lock is released.
+    private func finish(_ key: Key, _ state: State?) -> [() -> Void] {
+        if let state {
+            states[key] = state
+        } else {
+            Log.err("AsyncPipelineCompiler: Failed to compile \(key)")
+            failedKeys.insert(key)
+        }
+        inFlight.remove(key)
+        condition.broadcast()
+        return handlers.removeValue(forKey: key) ?? []
+    }
+}
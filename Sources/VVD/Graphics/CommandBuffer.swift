@@ -9,6 +9,7 @@ public typealias CommandBufferHandler = (CommandBuffer) -> Void
 
 public protocol CommandBuffer {
     func makeRenderCommandEncoder(descriptor: RenderPassDescriptor) -> RenderCommandEncoder?
+    func makeParallelRenderCommandEncoder(descriptor: RenderPassDescriptor) -> ParallelRenderCommandEncoder?
     func makeComputeCommandEncoder() -> ComputeCommandEncoder?
     func makeCopyCommandEncoder() -> CopyCommandEncoder?
 
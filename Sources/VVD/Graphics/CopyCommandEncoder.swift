@@ -53,4 +53,13 @@ public protocol CopyCommandEncoder: CommandEncoder {
     func copy(from: Texture, sourceOffset: TextureOrigin, to: Texture, destinationOffset: TextureOrigin, size: TextureSize)
 
     func fill(buffer: GPUBuffer, offset: Int, length: Int, value: UInt8)
+
+    // Queue ownership transfer of a resource written on this queue and used on
+    // another queue. Release after the last write, acquire on the other queue
+    // before the first use, and synchronize both with a semaphore.
+    // It is a no-op if the device does not require it for the queues.
+    func releaseOwnership(of buffer: GPUBuffer, to queue: CommandQueue)
+    func releaseOwnership(of texture: Texture, to queue: CommandQueue)
+    func acquireOwnership(of buffer: GPUBuffer, from queue: CommandQueue)
+    func acquireOwnership(of texture: Texture, from queue: CommandQueue)
 }
@@ -0,0 +1,69 @@
+//
+//  File: FrameTimeStatistics.swift
+//  Author: Hongtae Kim (tiff2766@gmail.com)
+//
+//  Copyright (c) 2022-2024 Hongtae Kim. All rights reserved.
+//
+
+import Foundation
+
+// Frame times of the recent frames, used to find hitches.
+// A frame is a hitch when it takes longer than twice the median of the
+// recent frames and longer than the target frame interval.
+public struct FrameTimeStatistics {
+    public let capacity: Int
+    public var hitchFactor: Double = 2.0
+
+    public private(set) var numFrames: Int = 0
+    public private(set) var numHitches: Int = 0
+    public private(set) var maxFrameTime: Double = 0
+    public private(set) var lastHitch: Double = 0
+
+    private var frameTimes: [Double] = []
+    private var cursor = 0
+
+    public init(capacity: Int = 120) {
+        self.capacity = max(capacity, 1)
+        self.frameTimes.reserveCapacity(self.capacity)
+    }
+
+    public var median: Double { percentile(0.5) }
+
+    // frame time of the given percentile (0...1) in the recent frames.
+    public func percentile(_ p: Double) -> Double {
+        if frameTimes.isEmpty { return 0 }
+        let sorted = frameTimes.sorted()
+        let index = Int((Double(sorted.count - 1) * min(max(p, 0), 1)).rounded())
+        return sorted[index]
+    }
+
+    // returns true if the frame is a hitch.
+    @discardableResult
+    public mutating func record(_ frameTime: Double, targetInterval: Double = 0) -> Bool {
+        let isHitch = frameTimes.count >= min(capacity, 10) &&
+            frameTime > median * hitchFactor &&
+            frameTime > targetInterval * 1.5
+        if frameTimes.count < capacity {
+            frameTimes.append(frameTime)
+        } else {
+            frameTimes[cursor] = frameTime
+            cursor = (cursor + 1) % capacity
+        }
+        numFrames += 1
+        maxFrameTime = max(maxFrameTime, frameTime)
+        if isHitch {
+            numHitches += 1
+            lastHitch = frameTime
+        }
+        return isHitch
+    }
+
+    public mutating func reset() {
+        frameTimes.removeAll(keepingCapacity: true)
+        cursor = 0
+        numFrames = 0
+        numHitches = 0
+        maxFrameTime = 0
+        lastHitch = 0
+    }
+}
@@ -0,0 +1,368 @@
+//
+//  File: FrustumCulling.swift
+//  Author: Hongtae Kim (tiff2766@gmail.com)
+//
+//  Copyright (c) 2022-2024 Hongtae Kim. All rights reserved.
+//
+
+import Foundation
+
+// Bounding boxes in structure of arrays layout, Float32.
+public struct AABBArray {
+    public private(set) var minX: [Float32] = []
+    public private(set) var minY: [Float32] = []
+    public private(set) var minZ: [Float32] = []
+    public private(set) var maxX: [Float32] = []
+    public private(set) var maxY: [Float32] = []
+    public private(set) var maxZ: [Float32] = []
+
+    public var count: Int { minX.count }
+
+    public init() {
+    }
+
+    public init(_ aabbs: [AABB]) {
+        reserveCapacity(aabbs.count)
+        aabbs.forEach { append($0) }
+    }
+
+    public mutating func reserveCapacity(_ n: Int) {
+        minX.reserveCapacity(n); minY.reserveCapacity(n); minZ.reserveCapacity(n)
+        maxX.reserveCapacity(n); maxY.reserveCapacity(n); maxZ.reserveCapacity(n)
+    }
+
+    public mutating func append(_ aabb: AABB) {
+        minX.append(Float32(aabb.min.x)); minY.append(Float32(aabb.min.y)); minZ.append(Float32(aabb.min.z))
+        maxX.append(Float32(aabb.max.x)); maxY.append(Float32(aabb.max.y)); maxZ.append(Float32(aabb.max.z))
+    }
+
+    public subscript(index: Int) -> AABB {
+        get {
+            AABB(min: Vector3(minX[index], minY[index], minZ[index]),
+                 max: Vector3(maxX[index], maxY[index], maxZ[index]))
+        }
+        set {
+            minX[index] = Float32(newValue.min.x)
+            minY[index] = Float32(newValue.min.y)
+            minZ[index] = Float32(newValue.min.z)
+            maxX[index] = Float32(newValue.max.x)
+            maxY[index] = Float32(newValue.max.y)
+            maxZ[index] = Float32(newValue.max.z)
+        }
+    }
+
+    public mutating func removeAll(keepingCapacity: Bool = true) {
+        minX.removeAll(keepingCapacity: keepingCapacity)
+        minY.removeAll(keepingCapacity: keepingCapacity)
+        minZ.removeAll(keepingCapacity: keepingCapacity)
+        maxX.removeAll(keepingCapacity: keepingCapacity)
+        maxY.removeAll(keepingCapacity: keepingCapacity)
+        maxZ.removeAll(keepingCapacity: keepingCapacity)
+    }
+}
+
+// Bounding spheres in structure of arrays layout, Float32.
+public struct SphereArray {
+    public private(set) var centerX: [Float32] = []
+    public private(set) var centerY: [Float32] = []
+    public private(set) var centerZ: [Float32] = []
+    public private(set) var radius: [Float32] = []
+
+    public var count: Int { radius.count }
+
+    public init() {
+    }
+
+    public init(_ spheres: [Sphere]) {
+        reserveCapacity(spheres.count)
+        spheres.forEach { append($0) }
+    }
+
+    public mutating func reserveCapacity(_ n: Int) {
+        centerX.reserveCapacity(n); centerY.reserveCapacity(n); centerZ.reserveCapacity(n)
+        radius.reserveCapacity(n)
+    }
+
+    public mutating func append(_ sphere: Sphere) {
+        centerX.append(Float32(sphere.center.x))
+        centerY.append(Float32(sphere.center.y))
+        centerZ.append(Float32(sphere.center.z))
+        radius.append(Float32(sphere.radius))
+    }
+
+    public subscript(index: Int) -> Sphere {
+        Sphere(center: Vector3(centerX[index], centerY[index], centerZ[index]),
+               radius: Scalar(radius[index]))
+    }
+
+    public mutating func removeAll(keepingCapacity: Bool = true) {
+        centerX.removeAll(keepingCapacity: keepingCapacity)
+        centerY.removeAll(keepingCapacity: keepingCapacity)
+        centerZ.removeAll(keepingCapacity: keepingCapacity)
+        radius.removeAll(keepingCapacity: keepingCapacity)
+    }
+}
+
+// One bit per object, bit (i % 64) of words[i / 64].
+public struct VisibilityMask {
+    public internal(set) var words: [UInt64]
+    public private(set) var count: Int
+
+    public init(count: Int = 0) {
+        self.count = count
+        self.words = .init(repeating: 0, count: (count + 63) / 64)
+    }
+
+    public mutating func reset(count: Int) {
+        self.count = count
+        let n = (count + 63) / 64
+        if words.count != n {
+            words = .init(repeating: 0, count: n)
+        } else {
+            words.withUnsafeMutableBufferPointer { $0.update(repeating: 0) }
+        }
+    }
+
+    public subscript(index: Int) -> Bool {
+        get { words[index >> 6] & (1 << UInt64(index & 63)) != 0 }
+        set {
+            if newValue {
+                words[index >> 6] |= (1 << UInt64(index & 63))
+            } else {
+                words[index >> 6] &= ~(1 << UInt64(index & 63))
+            }
+        }
+    }
+
+    public var visibleCount: Int {
+        words.reduce(0) { $0 + $1.nonzeroBitCount }
+    }
+
+    public func forEachVisible(_ body: (Int) throws -> Void) rethrows {
+        for (w, word) in words.enumerated() {
+            var bits = word
+            while bits != 0 {
+                let bit = bits.trailingZeroBitCount
+                try body(w << 6 | bit)
+                bits &= bits - 1
+            }
+        }
+    }
+}
+
+extension ViewFrustum {
+    // frustum planes, Float32.
+    struct CullingPlanes {
+        var a: SIMD8<Float32> = .zero   // 6 planes, lanes 6, 7 unused
+        var b: SIMD8<Float32> = .zero
+        var c: SIMD8<Float32> = .zero
+        var d: SIMD8<Float32> = .zero
+
+        init(_ frustum: ViewFrustum) {
+            let planes = [frustum.near, frustum.far, frustum.left,
+                          frustum.right, frustum.top, frustum.bottom]
+            for (i, p) in planes.enumerated() {
+                a[i] = Float32(p.a); b[i] = Float32(p.b)
+                c[i] = Float32(p.c); d[i] = Float32(p.d)
+            }
+        }
+    }
+
+    // objects per parallel work item, multiple of 64 (one mask word).
+    static let cullingChunkSize = 16384
+    static let laneBits = SIMD8<UInt32>(1, 2, 4, 8, 16, 32, 64, 128)
+
+    // Tests all boxes against the frustum and writes visibility to mask.
+    // Equivalent to intersects(aabb) for each box, using Float32.
+    public func cull(_ aabbs: AABBArray, into mask: inout VisibilityMask, parallel: Bool = false) {
+        let count = aabbs.count
+        mask.reset(count: count)
+        if count == 0 { return }
+
+        let planes = CullingPlanes(self)
+        aabbs.minX.withUnsafeBufferPointer { minX in
+        aabbs.minY.withUnsafeBufferPointer { minY in
+        aabbs.minZ.withUnsafeBufferPointer { minZ in
+        aabbs.maxX.withUnsafeBufferPointer { maxX in
+        aabbs.maxY.withUnsafeBufferPointer { maxY in
+        aabbs.maxZ.withUnsafeBufferPointer { maxZ in
+            mask.words.withUnsafeMutableBytes { bytes in
+                let output = bytes.bindMemory(to: UInt8.self)
+                let kernel = { (range: Range<Int>) in
+                    Self.cullAABBs(planes,
+                                   min: (minX.baseAddress!, minY.baseAddress!, minZ.baseAddress!),
+                                   max: (maxX.baseAddress!, maxY.baseAddress!, maxZ.baseAddress!),
+                                   range: range, output: output.baseAddress!)
+                }
+                Self.dispatch(count: count, parallel: parallel, kernel)
+            }
+        }}}}}}
+    }
+
+    // Tests all spheres against the frustum and writes visibility to mask.
+    // Equivalent to intersects(sphere) for each sphere, using Float32.
+    public func cull(_ spheres: SphereArray, into mask: inout VisibilityMask, parallel: Bool = false) {
+        let count = spheres.count
+        mask.reset(count: count)
+        if count == 0 { return }
+
+        let planes = CullingPlanes(self)
+        spheres.centerX.withUnsafeBufferPointer { x in
+        spheres.centerY.withUnsafeBufferPointer { y in
+        spheres.centerZ.withUnsafeBufferPointer { z in
+        spheres.radius.withUnsafeBufferPointer { r in
+            mask.words.withUnsafeMutableBytes { bytes in
+                let output = bytes.bindMemory(to: UInt8.self)
+                let kernel = { (range: Range<Int>) in
+                    Self.cullSpheres(planes,
+                                     center: (x.baseAddress!, y.baseAddress!, z.baseAddress!),
+                                     radius: r.baseAddress!,
+                                     range: range, output: output.baseAddress!)
+                }
+                Self.dispatch(count: count, parallel: parallel, kernel)
+            }
+        }}}}
+    }
+
+    // Hierarchical culling, subtrees outside the frustum are skipped and
+    // subtrees fully inside are accepted without testing their objects.
+    // BVH bounds are quantized (conservative), an object can be reported
+    // visible while being slightly outside of the frustum.
+    public func cull(_ bvh: BVH, into mask: inout VisibilityMask) {
+        mask.reset(count: bvh.numObjects)
+        let planes = [self.near, self.far, self.left, self.right, self.top, self.bottom]
+        var index = 0
+        let numNodes = bvh.nodes.count
+        while index < numNodes {
+            let node = bvh.nodes[index]
+            let aabb = bvh.nodeAABB(index)
+            var isOutside = false
+            var isInside = true
+            for plane in planes {
+                let p = Vector3(plane.a > 0 ? aabb.max.x : aabb.min.x,
+                                plane.b > 0 ? aabb.max.y : aabb.min.y,
+                                plane.c > 0 ? aabb.max.z : aabb.min.z)
+                if plane.dot(p) < 0 {
+                    isOutside = true
+                    break
+                }
+                if isInside {
+                    let n = Vector3(plane.a > 0 ? aabb.min.x : aabb.max.x,
+                                    plane.b > 0 ? aabb.min.y : aabb.max.y,
+                                    plane.c > 0 ? aabb.min.z : aabb.max.z)
+                    isInside = plane.dot(n) > 0
+                }
+            }
+            if isOutside {
+                index += node.escapeIndex
+            } else if isInside || node.isLeaf {
+                bvh.forEachObject(inSubtree: index) { mask[$0] = true }
+                index += node.escapeIndex
+            } else {
+                index += 1
+            }
+        }
+    }
+
+    private static func dispatch(count: Int, parallel: Bool, _ kernel: (Range<Int>) -> Void) {
+        let numChunks = (count + cullingChunkSize - 1) / cullingChunkSize
+        if parallel && numChunks > 1 {
+            DispatchQueue.concurrentPerform(iterations: numChunks) { chunk in
+                let start = chunk * cullingChunkSize
+                kernel(start..<Swift.min(start + cullingChunkSize, count))
+            }
+        } else {
+            kernel(0..<count)
+        }
+    }
+
+    // range.lowerBound must be a multiple of 8.
+    private static func cullAABBs(_ planes: CullingPlanes,
+                                  min: (UnsafePointer<Float32>, UnsafePointer<Float32>, UnsafePointer<Float32>),
+                                  max: (UnsafePointer<Float32>, UnsafePointer<Float32>, UnsafePointer<Float32>),
+                                  range: Range<Int>,
+                                  output: UnsafeMutablePointer<UInt8>) {
+        // for each plane, the box corner furthest along the plane normal
+        // (positive vertex) is selected by the sign of the normal.
+        var px: [UnsafePointer<Float32>] = [], py: [UnsafePointer<Float32>] = [], pz: [UnsafePointer<Float32>] = []
+        for i in 0..<6 {
+            px.append(planes.a[i] > 0 ? max.0 : min.0)
+            py.append(planes.b[i] > 0 ? max.1 : min.1)
+            pz.append(planes.c[i] > 0 ? max.2 : min.2)
+        }
+        func load(_ p: UnsafePointer<Float32>, _ i: Int) -> SIMD8<Float32> {
+            UnsafeRawPointer(p + i).loadUnaligned(as: SIMD8<Float32>.self)
+        }
+
+        let end8 = range.lowerBound + (range.count & ~7)
+        var i = range.lowerBound
+        while i < end8 {
+            // null boxes are not visible.
+            var visible = (load(max.0, i) .>= load(min.0, i))
+                .& (load(max.1, i) .>= load(min.1, i))
+                .& (load(max.2, i) .>= load(min.2, i))
+            for p in 0..<6 {
+                let d = planes.a[p] * load(px[p], i)
+                    + planes.b[p] * load(py[p], i)
+                    + planes.c[p] * load(pz[p], i)
+                    + planes.d[p]
+                visible .&= d .>= 0
+            }
+            output[i >> 3] = UInt8(SIMD8<UInt32>().replacing(with: laneBits, where: visible).wrappedSum())
+            i += 8
+        }
+        // remaining objects, the last byte is not shared with other chunks.
+        var bits: UInt8 = 0
+        while i < range.upperBound {
+            var visible = max.0[i] >= min.0[i] && max.1[i] >= min.1[i] && max.2[i] >= min.2[i]
+            for p in 0..<6 where visible {
+                let d = planes.a[p] * px[p][i] + planes.b[p] * py[p][i] + planes.c[p] * pz[p][i] + planes.d[p]
+                visible = d >= 0
+            }
+            if visible { bits |= 1 << UInt8(i & 7) }
+            i += 1
+        }
+        if range.count & 7 != 0 {
+            output[end8 >> 3] = bits
+        }
+    }
+
+    // range.lowerBound must be a multiple of 8.
+    private static func cullSpheres(_ planes: CullingPlanes,
+                                    center: (UnsafePointer<Float32>, UnsafePointer<Float32>, UnsafePointer<Float32>),
+                                    radius: UnsafePointer<Float32>,
+                                    range: Range<Int>,
+                                    output: UnsafeMutablePointer<UInt8>) {
+        func load(_ p: UnsafePointer<Float32>, _ i: Int) -> SIMD8<Float32> {
+            UnsafeRawPointer(p + i).loadUnaligned(as: SIMD8<Float32>.self)
+        }
+
+        let end8 = range.lowerBound + (range.count & ~7)
+        var i = range.lowerBound
+        while i < end8 {
+            let x = load(center.0, i), y = load(center.1, i), z = load(center.2, i)
+            let r = load(radius, i)
+            var visible = r .>= 0
+            for p in 0..<6 {
+                let d = planes.a[p] * x + planes.b[p] * y + planes.c[p] * z + planes.d[p]
+                visible .&= d .>= -r
+            }
+            output[i >> 3] = UInt8(SIMD8<UInt32>().replacing(with: laneBits, where: visible).wrappedSum())
+            i += 8
+        }
+        var bits: UInt8 = 0
+        while i < range.upperBound {
+            let r = radius[i]
+            var visible = r >= 0
+            for p in 0..<6 where visible {
+                let d = planes.a[p] * center.0[i] + planes.b[p] * center.1[i] + planes.c[p] * center.2[i] + planes.d[p]
+                visible = d >= -r
+            }
+            if visible { bits |= 1 << UInt8(i & 7) }
+            i += 1
+        }
+        if range.count & 7 != 0 {
+            output[end8 >> 3] = bits
+        }
+    }
+}
@@ -27,6 +27,8 @@ public protocol GraphicsDevice {
 
     func makeEvent() -> GPUEvent?
     func makeSemaphore() -> GPUSemaphore?
+
+    func defragmentMemory(queue: CommandQueue, maxBytesPerPass: Int) -> Int
 }
 
 public extension GraphicsDevice {
@@ -41,4 +43,13 @@ public extension GraphicsDevice {
     func makeTransientRenderTarget(type: TextureType, pixelFormat: PixelFormat, width: Int, height: Int, depth: Int) -> Texture? {
         return self.makeTransientRenderTarget(type: type, pixelFormat: pixelFormat, width: width, height: height, depth: depth, sampleCount: 1)
     }
+
+    // Moves buffers out of sparse device memory chunks, copying at most
+    // maxBytesPerPass bytes. Intended to be called once per frame, returns
+    // the size of device memory released once the copies are complete.
+    // Only device local buffers that are not written by shaders are moved,
+    // textures are never moved.
+    func defragmentMemory(queue: CommandQueue, maxBytesPerPass: Int) -> Int {
+        return 0
+    }
 }
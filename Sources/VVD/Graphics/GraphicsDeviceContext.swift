@@ -47,6 +47,22 @@ public class GraphicsDeviceContext {
         commandQueue(flags: .copy)
     }
 
+    // uploads of resource data, batched on the copy queue.
+    public lazy var uploadManager: UploadManager? = {
+        copyQueue().flatMap { UploadManager(queue: $0) }
+    }()
+
+    // uploads on a transfer queue of its own, a dedicated transfer queue
+    // family if the device has one. resources are handed off to the render
+    // queue and can be streamed while frames are rendered.
+    public lazy var asyncUploadManager: UploadManager? = {
+        guard let renderQueue = renderQueue(),
+              let transferQueue = device.makeCommandQueue(flags: .copy) else {
+            return nil
+        }
+        return UploadManager(queue: transferQueue, destinationQueue: renderQueue)
+    }()
+
     let deviceWaitTimeout = 2.0
 
     public func makeCPUAccessible(buffer: GPUBuffer) -> GPUBuffer? {
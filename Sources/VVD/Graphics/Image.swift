@@ -651,7 +651,9 @@ public struct Image {
 }
 
 extension Image {
-    public func makeTexture(commandQueue: CommandQueue, usage: TextureUsage = .sampled) -> Texture? {
+    // pixel format of the texture and the image format to upload,
+    // images of three channels are uploaded as four channels.
+    private func textureFormat() -> (PixelFormat, ImagePixelFormat) {
         var textureFormat: PixelFormat = .invalid
         var imageFormat: ImagePixelFormat = self.pixelFormat
 
@@ -675,6 +677,11 @@ extension Image {
         default:
             textureFormat = .invalid
         }
+        return (textureFormat, imageFormat)
+    }
+
+    public func makeTexture(commandQueue: CommandQueue, usage: TextureUsage = .sampled) -> Texture? {
+        let (textureFormat, imageFormat) = self.textureFormat()
         if textureFormat == .invalid {
             Log.error("Invalid pixel format")
             return nil
@@ -727,6 +734,38 @@ extension Image {
         return texture
     }
 
+    // the copy is recorded with the pending uploads of the upload manager,
+    // the texture is ready to use after the batch has been submitted.
+    public func makeTexture(uploadManager: UploadManager, usage: TextureUsage = .sampled) -> Texture? {
+        self.uploadTexture(uploadManager: uploadManager, usage: usage)?.texture
+    }
+
+    func uploadTexture(uploadManager: UploadManager, usage: TextureUsage) -> (texture: Texture, future: UploadManager.Future)? {
+        let (textureFormat, imageFormat) = self.textureFormat()
+        if textureFormat == .invalid {
+            Log.error("Invalid pixel format")
+            return nil
+        }
+        if imageFormat != self.pixelFormat {
+            return self.resample(format: imageFormat)?.uploadTexture(uploadManager: uploadManager, usage: usage)
+        }
+
+        guard let texture = uploadManager.queue.device.makeTexture(
+            descriptor: TextureDescriptor(textureType: .type2D,
+                                          pixelFormat: textureFormat,
+                                          width: width,
+                                          height: height,
+                                          usage: usage.union([.copySource, .copyDestination])))
+        else { return nil }
+
+        let future = self.data.withUnsafeBytes {
+            uploadManager.upload($0, to: texture,
+                                 size: TextureSize(width: width, height: height, depth: 1))
+        }
+        guard let future else { return nil }
+        return (texture, future)
+    }
+
     public static func fromTexture(buffer: GPUBuffer,
                                    width: Int, height: Int,
                                    pixelFormat: PixelFormat) -> Image? {
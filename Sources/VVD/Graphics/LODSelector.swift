@@ -0,0 +1,65 @@
+//
+//  File: LODSelector.swift
+//  Author: Hongtae Kim (tiff2766@gmail.com)
+//
+//  Copyright (c) 2022-2024 Hongtae Kim. All rights reserved.
+//
+
+import Foundation
+
+// Selects the level of detail of a mesh by its screen-space error:
+// the coarsest level whose error, scaled by the model transform and
+// projected at the distance from the viewer, is within maxPixelError.
+public struct LODSelector {
+    public var viewPosition: Vector3
+    public var pixelScale: Scalar       // pixels per unit at distance 1
+    public var isPerspective: Bool
+    public var maxPixelError: Scalar
+    public var bias: Int = 0            // added to the selected level
+
+    public init(view: ViewTransform, projection: ProjectionTransform,
+                viewportHeight: Scalar, maxPixelError: Scalar = 1.0) {
+        self.viewPosition = view.position
+        // m22 is 1/tan(fov/2) for perspective, 2/(top-bottom) for orthographic.
+        self.pixelScale = viewportHeight * 0.5 * abs(projection.matrix.m22)
+        self.isPerspective = projection.isPerspective
+        self.maxPixelError = maxPixelError
+    }
+
+    public init(viewPosition: Vector3, fov: Scalar,
+                viewportHeight: Scalar, maxPixelError: Scalar = 1.0) {
+        self.viewPosition = viewPosition
+        self.pixelScale = viewportHeight * 0.5 / tan(fov * 0.5)
+        self.isPerspective = true
+        self.maxPixelError = maxPixelError
+    }
+
+    public func projectedError(_ error: Scalar, distance: Scalar) -> Scalar {
+        if isPerspective {
+            return error * pixelScale / max(distance, .ulpOfOne)
+        }
+        return error * pixelScale
+    }
+
+    // distance is measured from the view position to the bounding sphere
+    // of the mesh, level 0 is selected if the viewer is inside of it.
+    public func lod(for mesh: Mesh, transform: Matrix4) -> Int {
+        if mesh.lods.isEmpty || mesh.aabb.isNull { return 0 }
+        let scale = max(Vector3(transform.m11, transform.m12, transform.m13).length,
+                        Vector3(transform.m21, transform.m22, transform.m23).length,
+                        Vector3(transform.m31, transform.m32, transform.m33).length)
+        let center = mesh.aabb.center.applying(transform, w: 1.0)
+        let radius = mesh.aabb.extents.length * 0.5 * scale
+        let distance = max((center - viewPosition).length - radius, 0)
+        return lod(for: mesh, scale: scale, distance: distance)
+    }
+
+    public func lod(for mesh: Mesh, scale: Scalar = 1.0, distance: Scalar) -> Int {
+        var level = 0
+        for (i, lod) in mesh.lods.enumerated() {
+            if projectedError(lod.error * scale, distance: distance) > maxPixelError { break }
+            level = i + 1
+        }
+        return min(max(level + bias, 0), mesh.lods.count)
+    }
+}
@@ -284,9 +284,20 @@ public class Material {
     public var cullMode: CullMode = .none
     public var frontFace: Winding = .clockwise
 
-    public var properties: [Semantic: Property]
-    public var userDefinedProperties: [BindingLocation: Property]
-    public var shader: ShaderMap
+    public var properties: [Semantic: Property] {
+        didSet { version &+= 1 }
+    }
+    public var userDefinedProperties: [BindingLocation: Property] {
+        didSet { version &+= 1 }
+    }
+    public var shader: ShaderMap {
+        didSet { shaderVersion &+= 1 }
+    }
+
+    // incremented whenever properties are modified.
+    public private(set) var version: UInt64 = 0
+    // incremented whenever the shader map is modified.
+    public private(set) var shaderVersion: UInt64 = 0
 
     public var defaultTexture: Texture?
     public var defaultSampler: SamplerState?
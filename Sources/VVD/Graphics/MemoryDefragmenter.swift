@@ -0,0 +1,125 @@
+//
+//  File: MemoryDefragmenter.swift
+//  Author: Hongtae Kim (tiff2766@gmail.com)
+//
+//  Copyright (c) 2022-2024 Hongtae Kim. All rights reserved.
+//
+
+import Foundation
+
+// Plans an incremental compaction of sub-allocated memory chunks.
+// The sparsest chunks are evacuated into the densest chunks with free space,
+// so that they can be released once the moves are complete.
+// Destinations are reserved in the heaps by the plan, the caller copies
+// the contents and frees the source allocations (VulkanMemoryAllocator.defragment).
+struct MemoryDefragmenter {
+    struct Move {
+        let source: Int                 // heap index
+        let sourceAllocation: TLSFAllocator.Allocation
+        let destination: Int           // heap index
+        let destinationAllocation: TLSFAllocator.Allocation
+    }
+
+    struct Pass {
+        var moves: [Move] = []
+        var bytesMoved: UInt64 = 0
+        var releasedHeaps: [Int] = []   // empty once the moves are complete
+        var reclaimedBytes: UInt64 = 0
+    }
+
+    // returns the alignment of the allocation, nil if it cannot be moved.
+    typealias Requirements = (_ heap: Int, _ allocation: TLSFAllocator.Allocation) -> UInt64?
+
+    // chunks with less than this fraction in use are evacuated.
+    var sparseThreshold: Double = 0.5
+    // bytes copied in a pass, keeps the copies of a pass within a frame.
+    var maxBytesPerPass: UInt64
+
+    init(maxBytesPerPass: UInt64, sparseThreshold: Double = 0.5) {
+        self.maxBytesPerPass = maxBytesPerPass
+        self.sparseThreshold = sparseThreshold
+    }
+
+    func plan(_ heaps: inout [TLSFAllocator], requirements: Requirements) -> Pass {
+        var pass = Pass()
+
+        // densest first, the densest chunk is never evacuated.
+        var destinations = heaps.indices.filter { heaps[$0].isEmpty == false }
+            .sorted { heaps[$0].allocatedSize > heaps[$1].allocatedSize }
+        if destinations.count < 2 { return pass }
+        let sources = destinations.dropFirst().reversed().filter {
+            Double(heaps[$0].allocatedSize) < Double(heaps[$0].size) * sparseThreshold
+        }
+
+        var budget = maxBytesPerPass
+        var received: Set<Int> = []
+        for source in sources {
+            if budget == 0 { break }
+            // reserved blocks have no contents until the pass is complete.
+            if received.contains(source) { continue }
+
+            // a chunk with pinned allocations cannot be released.
+            var allocations: [(allocation: TLSFAllocator.Allocation,
+                               kind: TLSFAllocator.ResourceKind,
+                               alignment: UInt64)] = []
+            var movable = true
+            heaps[source].forEachAllocation { allocation, kind in
+                if let alignment = requirements(source, allocation) {
+                    allocations.append((allocation, kind, alignment))
+                } else {
+                    movable = false
+                }
+            }
+            if movable == false { continue }
+
+            destinations.removeAll { $0 == source }
+
+            let firstMove = pass.moves.count
+            var complete = true
+            var outOfSpace = false
+            for (allocation, kind, alignment) in allocations {
+                if allocation.size > budget {
+                    complete = false
+                    break
+                }
+                var placed = false
+                for destination in destinations {
+                    if let reserved = heaps[destination].alloc(size: allocation.size,
+                                                               alignment: alignment,
+                                                               kind: kind) {
+                        pass.moves.append(Move(source: source,
+                                               sourceAllocation: allocation,
+                                               destination: destination,
+                                               destinationAllocation: reserved))
+                        received.insert(destination)
+                        placed = true
+                        break
+                    }
+                }
+                if placed == false {
+                    complete = false
+                    outOfSpace = true
+                    break
+                }
+                budget -= allocation.size
+            }
+
+            if outOfSpace {
+                // the chunk would stay in use, undo its moves.
+                for move in pass.moves[firstMove...] {
+                    heaps[move.destination].free(move.destinationAllocation)
+                    budget += move.sourceAllocation.size
+                }
+                pass.moves.removeSubrange(firstMove...)
+                destinations.append(source)
+                continue
+            }
+            if complete {
+                pass.releasedHeaps.append(source)
+                pass.reclaimedBytes += heaps[source].size
+            }
+        }
+        pass.bytesMoved = maxBytesPerPass - budget
+        return pass
+    }
+}
@@ -44,6 +44,23 @@ public class Mesh {
     public var indexType: IndexType
     public var primitiveType: PrimitiveType
 
+    // Simplified index buffers sharing the vertex buffers and the index type
+    // of the mesh, from finer to coarser. Level 0 is the mesh itself,
+    // level n is lods[n-1]. (see MeshSimplifier, LODSelector)
+    public struct LOD {
+        public var indexBuffer: GPUBuffer
+        public var indexBufferByteOffset: Int
+        public var indexCount: Int
+        public var error: Scalar        // geometric error in object space
+        public init(indexBuffer: GPUBuffer, indexBufferByteOffset: Int = 0, indexCount: Int, error: Scalar) {
+            self.indexBuffer = indexBuffer
+            self.indexBufferByteOffset = indexBufferByteOffset
+            self.indexCount = indexCount
+            self.error = error
+        }
+    }
+    public var lods: [LOD] = []
+
     public enum BufferUsagePolicy {
         case useExternalBufferManually
         case singleBuffer
@@ -64,9 +81,14 @@ public class Mesh {
         let layout: ShaderPushConstantLayout
         var data: [UInt8]
     }
-    var pipelineState: RenderPipelineState?
+    // the binding plan is compiled from the pipeline resources.
+    var pipelineState: RenderPipelineState? {
+        didSet { shadingBindingPlan = nil }
+    }
     var pipelineReflection: PipelineReflection?
-    var resourceBindings: [ResourceBindingSet]
+    var resourceBindings: [ResourceBindingSet] {
+        didSet { shadingBindingPlan = nil }
+    }
     var pushConstants: [PushConstantData]
 
     struct BufferResource {
@@ -75,6 +97,36 @@ public class Mesh {
     }
     var bufferResources: [ShaderBindingLocation: BufferResource]
 
+    var shadingBindingPlan: ShadingBindingPlan?
+
+    // Per-instance model matrices (float4x4) for instanced draws,
+    // bound to the buffer resource with the transformMatrixArray semantic.
+    // If nil, the resource is filled with the model matrix of the scene state.
+    var instanceTransforms: BufferBindingInfo?
+
+    // Per-draw storage for the uniform buffers, for meshes drawn several
+    // times in one command buffer. If set, the uniform buffers are copied
+    // to the returned region before they are updated and the region is
+    // bound instead, so earlier draws keep their values.
+    var uniformBufferAllocator: ((_ length: Int) -> BufferBindingInfo?)?
+
+    // bytes of uniform buffers updated per draw, each aligned to alignment.
+    func uniformBufferLength(alignment: Int) -> Int {
+        self.bufferResources.values.reduce(0) { length, resource in
+            resource.buffers.reduce(length) {
+                $0 + $1.length.alignedUp(toMultipleOf: alignment)
+            }
+        }
+    }
+
+    // true if the material binds a transformMatrixArray buffer.
+    public var supportsInstancing: Bool {
+        guard let material else { return false }
+        return material.shader.resourceSemantics.values.contains {
+            if case .uniform(.transformMatrixArray) = $0 { return true }
+            return false
+        }
+    }
 
     public init() {
         self.indexCount = 0
@@ -482,197 +534,38 @@ public class Mesh {
         return true
     }
 
+    // Shader semantics of the material are compiled into the binding plan,
+    // it is rebuilt when the material, its shader map or the pipeline changes.
+    public func invalidateShadingBindingPlan() {
+        self.shadingBindingPlan = nil
+    }
+
     public func updateShadingProperties(sceneState: SceneState?) {
         guard let material else { return }
 
-        struct StructMemberBind {
-            let sceneState: SceneState?
-            let mesh: Mesh
-            let member: ShaderResourceStructMember
-            let parentPath: String
-            let arrayIndex: Int
-            let set: Int
-            let binding: Int
-            let offset: Int // struct offset
-
-            func bind(buffer: UnsafeMutableRawBufferPointer) -> Int {
-                let bindingOffset = member.offset + self.offset
-
-                assert(member.size <= buffer.count)
-
-                let path = if self.parentPath.count > 0 {
-                    "\(self.parentPath).\(member.name)"
-                } else {
-                    member.name
-                }
-
-                var copied = 0
-                if member.dataType == .struct {
-                    for m in member.members {
-                        if m.offset >= buffer.count { continue }
-                        if m.offset + m.size > buffer.count { continue }
-
-                        let s = StructMemberBind(sceneState: sceneState,
-                                                 mesh: mesh,
-                                                 member: m,
-                                                 parentPath: path,
-                                                 arrayIndex: arrayIndex,
-                                                 set: set, binding: binding,
-                                                 offset: bindingOffset)
-                            .bind(buffer: .init(rebasing: buffer[m.offset...]))
-                        if s == 0 {
-                            Log.warning("Unable to bind shader uniform struct element: \(set) name: \(path)")
-                        }
-                        copied = member.offset + s
-                    }
-                } else {
-                    // find semantic
-                    let material = mesh.material!
-                    let location = ShaderBindingLocation(set: set,
-                                                         binding: binding,
-                                                         offset: bindingOffset)
-                    let semantic = material.shader.resourceSemantics[location] ?? .material(.userDefined)
-
-                    if case let .uniform(ss) = semantic {
-                        if let sceneState {
-                            copied = mesh.bindShaderUniformBuffer(
-                                semantic: ss,
-                                dataType: member.dataType,
-                                name: path,
-                                sceneState: sceneState,
-                                buffer: buffer)
-                        }
-                    }
-                    if copied == 0 {
-                        let ms: MaterialSemantic
-                        if case let .material(ss) = semantic {
-                            ms = ss
-                        } else {
-                            ms = .userDefined
-                        }
-
-                        let offset = member.count * member.stride * arrayIndex
-                        copied = mesh.bindMaterialProperty(semantic: ms,
-                                                           location: location,
-                                                           dataType: member.dataType,
-                                                           name: path,
-                                                           offset: offset,
-                                                           buffer: buffer)
-                    }
-                    if copied == 0 {
-                        //Log.warning("Unable to bind shader uniform struct (\(location)), arrayIndex: \(arrayIndex), name:\"\(path)\"")
-                    }
-                }
-                return copied
-            }
+        if self.shadingBindingPlan?.matches(material: material) != true {
+            self.shadingBindingPlan = ShadingBindingPlan(
+                material: material,
+                resourceBindings: self.resourceBindings,
+                pushConstants: self.pushConstants.map(\.layout))
         }
-
-        let copyStructProperty = {
-            (type: ShaderDataType,
-             set: Int,
-             binding: Int,
-             offset: Int,
-             size: Int,
-             stride: Int,
-             arrayIndex: Int,
-             members: [ShaderResourceStructMember],
-             name: String,
-             buffer: UnsafeMutableRawBufferPointer) -> Int in
-
-            let location = ShaderBindingLocation(set: set,
-                                                 binding: binding,
-                                                 offset: offset)
-
-            let semantic = material.shader.resourceSemantics[location] ?? .material(.userDefined)
-
-            var copied = 0
-            if type == .struct {
-                if case let .material(ms) = semantic {
-                    copied = self.bindMaterialProperty(semantic: ms,
-                                                       location: location,
-                                                       dataType: type,
-                                                       name: name,
-                                                       offset: offset,
-                                                       buffer: buffer)
-                }
-                if copied != size {
-                    // The entire buffer wasn't copied,
-                    // so we split it into members of a struct and try to copy it.
-                    copied = 0
-                    for member in members {
-                        if member.offset < offset { continue }
-                        if member.offset >= (offset + size) { break }
-                        if member.offset + member.size > offset + size { break }
-
-                        let path = if name.isEmpty == false && member.name.isEmpty == false {
-                            "\(name).\(member.name)"
-                        } else {
-                            member.name
-                        }
-
-                        if member.offset + member.size - offset > buffer.count {
-                            Log.error("Insufficient buffer for shader uniform struct at location:\(location), size:\(size), name:\"\(path)\"")
-                            break
-                        }
-
-                        let d = member.offset - offset
-                        let s = StructMemberBind(sceneState: sceneState,
-                                                 mesh: self,
-                                                 member: member,
-                                                 parentPath: name,
-                                                 arrayIndex: arrayIndex,
-                                                 set: set,
-                                                 binding: binding,
-                                                 offset: 0)
-                            .bind(buffer: .init(rebasing: buffer[d...]))
-
-                        if s > 0 {
-                            copied += s
-                        } else {
-                            if copied < d + member.size { // Failed to copy data.
-                                let loc = ShaderBindingLocation(set: set, binding: binding, offset: member.offset)
-                                Log.warning("Unable to bind shader uniform struct at location:\(loc), size:\(size), name:\"\(path)\"")
-                            }
-                        }
-                    }
-                }
-            } else {
-                if case let .uniform(ss) = semantic {
-                    if let sceneState {
-                        copied = self.bindShaderUniformBuffer(semantic: ss,
-                                                              dataType: type,
-                                                              name: name,
-                                                              sceneState: sceneState,
-                                                              buffer: buffer)
-                    }
-                }
-                if copied == 0 {
-                    let ms: MaterialSemantic
-                    if case let .material(ss) = semantic {
-                        ms = ss
-                    } else {
-                        ms = .userDefined
-                    }
-                    let offset = arrayIndex * stride
-                    copied = self.bindMaterialProperty(semantic: ms,
-                                                       location: location,
-                                                       dataType: type,
-                                                       name: name,
-                                                       offset: offset,
-                                                       buffer: buffer)
-                }
-                if copied == 0 {
-                    Log.warning("Unable to bind shader uniform struct (\(location)), arrayIndex: \(arrayIndex), name:\"\(name)\"")
-                }
-            }
-            return copied
+        if self.shadingBindingPlan!.materialVersion != material.version {
+            self.shadingBindingPlan!.resolve(material: material)
         }
+        let plan = self.shadingBindingPlan!
 
-        for rbs in self.resourceBindings {
-            for rb in rbs.resources {
+        for (rbsIndex, rbs) in self.resourceBindings.enumerated() {
+            for (rbIndex, rb) in rbs.resources.enumerated() {
                 let res = rb.resource
-                if res.type == .buffer {
-                    let typeInfo = res.bufferTypeInfo!
+                switch plan.resources[rbsIndex][rbIndex] {
+                case let .buffer(bufferPlan):
+                    if bufferPlan.instanceTransforms, let instanceTransforms {
+                        rbs.bindingSet.setBuffer(instanceTransforms.buffer,
+                                                 offset: instanceTransforms.offset,
+                                                 length: instanceTransforms.length,
+                                                 binding: res.binding)
+                        continue
+                    }
                     let loc = ShaderBindingLocation(set: res.set, binding: res.binding, offset: 0)
                     if let buffers = self.bufferResources[loc]?.buffers {
                         var updatedBuffers: [BufferBindingInfo] = []
@@ -680,24 +573,26 @@ public class Mesh {
                         updatedBuffers.reserveCapacity(validBufferCount)
 
                         for index in 0..<validBufferCount {
-                            let bufferInfo = buffers[index]
+                            var bufferInfo = buffers[index]
+                            if let uniformBufferAllocator = self.uniformBufferAllocator,
+                               bufferInfo.offset + bufferInfo.length <= bufferInfo.buffer.length,
+                               let region = uniformBufferAllocator(bufferInfo.length),
+                               let src = bufferInfo.buffer.contents(),
+                               let dst = region.buffer.contents() {
+                                (dst + region.offset).copyMemory(from: src + bufferInfo.offset,
+                                                                 byteCount: bufferInfo.length)
+                                bufferInfo = region
+                            }
                             if bufferInfo.offset + bufferInfo.length <= bufferInfo.buffer.length {
                                 if let ptr = bufferInfo.buffer.contents() {
                                     let buffer = UnsafeMutableRawBufferPointer(
                                         start: ptr + bufferInfo.offset,
                                         count: bufferInfo.length)
 
-                                    let copied = copyStructProperty(
-                                        typeInfo.dataType,
-                                        res.set,
-                                        res.binding,
-                                        0,
-                                        typeInfo.size,
-                                        res.stride,
-                                        index,
-                                        res.members,
-                                        res.name,
-                                        buffer)
+                                    let copied = plan.execute(bufferPlan,
+                                                              arrayIndex: index,
+                                                              sceneState: sceneState,
+                                                              buffer: buffer)
                                     if copied > 0 {
                                         bufferInfo.buffer.flush()
                                     }
@@ -717,14 +612,9 @@ public class Mesh {
                             Log.error("Failed to bind buffer resource set:\(res.set), binding:\(res.binding), name:\"\(res.name)\"")
                         }
                     }
-                } else {
-                    let location = ShaderBindingLocation(set: res.set,
-                                                         binding: res.binding,
-                                                         offset: 0)
-                    let semantic = material.shader.resourceSemantics[location] ?? .material(.userDefined)
-
+                case let .object(objectPlan):
                     var bounds = 0
-                    if case let .uniform(ss) = semantic {
+                    if let ss = objectPlan.uniform {
                         if let sceneState {
                             switch res.type {
                             case .texture:
@@ -741,12 +631,7 @@ public class Mesh {
                         }
                     }
                     if bounds == 0 {
-                        let ms: MaterialSemantic
-                        if case let .material(ss) = semantic {
-                            ms = ss
-                        } else {
-                            ms = .userDefined
-                        }
+                        let ms = objectPlan.material
                         switch res.type {
                         case .texture:
                             bounds = self.bindMaterialTextures(semantic: ms, resource: res, bindingSet: rbs.bindingSet)
@@ -775,17 +660,10 @@ public class Mesh {
                 pc.data = .init(repeating: 0, count: pc.layout.size)
             }
             pc.data.withUnsafeMutableBytes { buffer in
-                let location = ShaderBindingLocation.pushConstant(offset: pc.layout.offset)
-                _=copyStructProperty(.struct,
-                                     location.set,
-                                     location.binding,
-                                     location.offset,
-                                     pc.layout.size,
-                                     pc.layout.size,  // stride
-                                     0,               // arrayIndex
-                                     pc.layout.members,
-                                     pc.layout.name,
-                                     buffer)
+                _=plan.execute(plan.pushConstants[i],
+                               arrayIndex: 0,
+                               sceneState: sceneState,
+                               buffer: buffer)
             }
             self.pushConstants[i] = pc
         }
@@ -855,54 +733,6 @@ public class Mesh {
         return 0
     }
 
-    func bindMaterialProperty(semantic: MaterialSemantic,
-                              location: ShaderBindingLocation,
-                              dataType: ShaderDataType,
-                              name: String,
-                              offset: Int,
-                              buffer: UnsafeMutableRawBufferPointer) -> Int {
-        guard let material else { return 0 }
-
-        var data: [UInt8] = []
-
-        func bindNumerics<T: Numeric>(as: T.Type, array: [any Numeric]) {
-            let numerics = array.map { $0 as! T }
-            numerics.withUnsafeBytes {
-                data.append(contentsOf: $0)
-            }
-        }
-
-        let bind = { (prop: MaterialProperty) in
-            if case let .buffer(buffer) = prop {
-                data = buffer
-            } else {
-                if let components = dataType.components() {
-                    let numerics = prop.castNumericArray(as: components.type)
-                    bindNumerics(as: components.type, array: numerics)
-                }
-            }
-        }
-
-        if semantic != .userDefined {
-            if let prop = material.properties[semantic] {
-                bind(prop)
-            }
-        }
-        if data.isEmpty {
-            if let prop = material.userDefinedProperties[location] {
-                bind(prop)
-            }
-        }
-        if data.isEmpty == false {
-            if data.count > offset {
-                let s = min(data.count - offset, buffer.count)
-                buffer.copyBytes(from: data[0..<s])
-                return s
-            }
-        }
-        return 0
-    }
-
     func bindShaderUniformTextures(semantic: ShaderUniformSemantic,
                                    name: String,
                                    sceneState: SceneState,
@@ -919,68 +749,8 @@ public class Mesh {
         return 0
     }
 
-    func bindShaderUniformBuffer(semantic: ShaderUniformSemantic,
-                                 dataType: ShaderDataType,
-                                 name: String,
-                                 sceneState: SceneState,
-                                 buffer: UnsafeMutableRawBufferPointer) -> Int {
-        let bindMatrix4 = { (matrix: Matrix4) in
-            if dataType == .float4x4 {
-                return withUnsafeBytes(of: matrix.float4x4) {
-                    buffer.copyBytes(from: $0)
-                    return $0.count
-                }
-            }
-            if dataType == .float3x3 {
-                let mat = Matrix3(matrix.m11, matrix.m12, matrix.m13,
-                                  matrix.m21, matrix.m22, matrix.m23,
-                                  matrix.m31, matrix.m32, matrix.m33)
-                return withUnsafeBytes(of: mat.float3x3) {
-                    buffer.copyBytes(from: $0)
-                    return $0.count
-                }
-            }
-            return 0
-        }
-
-        switch semantic {
-        case .modelMatrix:
-            return bindMatrix4(sceneState.model)
-        case .viewMatrix:
-            return bindMatrix4(sceneState.view.matrix4)
-        case .projectionMatrix:
-            return bindMatrix4(sceneState.projection.matrix)
-        case .viewProjectionMatrix:
-            return bindMatrix4(sceneState.view.matrix4
-                .concatenating(sceneState.projection.matrix))
-        case .modelViewProjectionMatrix:
-            return bindMatrix4(sceneState.model
-                .concatenating(sceneState.view.matrix4)
-                .concatenating(sceneState.projection.matrix))
-        case .inverseModelMatrix:
-            return bindMatrix4(sceneState.model.inverted() ?? .identity)
-        case .inverseViewMatrix:
-            return bindMatrix4(sceneState.view.matrix4.inverted() ?? .identity)
-        case .inverseProjectionMatrix:
-            return bindMatrix4(sceneState.projection.matrix
-                .inverted() ?? .identity)
-        case .inverseViewProjectionMatrix:
-            return bindMatrix4(sceneState.view.matrix4
-                .concatenating(sceneState.projection.matrix)
-                .inverted() ?? .identity)
-        case .inverseModelViewProjectionMatrix:
-            return bindMatrix4(sceneState.model
-                .concatenating(sceneState.view.matrix4)
-                .concatenating(sceneState.projection.matrix)
-                .inverted() ?? .identity)
-        default:
-            Log.error("Not supported or not yet implemented.")
-        }
-        return 0
-    }
-
     @discardableResult
-    public func encodeRenderCommand(encoder: RenderCommandEncoder, numInstances: Int = 1, baseInstance: Int = 0) -> Bool {
+    public func encodeRenderCommand(encoder: RenderCommandEncoder, numInstances: Int = 1, baseInstance: Int = 0, lod: Int = 0) -> Bool {
         if let pipelineState, let material, vertexBuffers.isEmpty == false {
             let vertexBuffers = self.availableVertexBuffers(for: material)
             if vertexBuffers.isEmpty { return false }
@@ -1030,7 +800,16 @@ public class Mesh {
                 min(count, vb.vertexCount)
             }
             if vertexCount > 0 {
-                if let indexBuffer {
+                if lod > 0, lods.isEmpty == false, self.indexBuffer != nil {
+                    let level = lods[min(lod, lods.count) - 1]
+                    encoder.drawIndexed(indexCount: level.indexCount,
+                                        indexType: self.indexType,
+                                        indexBuffer: level.indexBuffer,
+                                        indexBufferOffset: level.indexBufferByteOffset,
+                                        instanceCount: numInstances,
+                                        baseVertex: self.indexBufferBaseVertexIndex,
+                                        baseInstance: baseInstance)
+                } else if let indexBuffer {
                     encoder.drawIndexed(indexCount: self.indexCount,
                                         indexType: self.indexType,
                                         indexBuffer: indexBuffer,
@@ -1085,6 +864,26 @@ public class Mesh {
         return false
     }
 
+    // calls handler once with the mapped content of the attribute,
+    // for batch processing (see BatchTransform).
+    public func withVertexBufferContent<R>(semantic: VertexAttributeSemantic,
+                                           context: GraphicsDeviceContext,
+                                           _ handler: (_ data: UnsafeRawPointer, _ format: VertexFormat,
+                                                       _ stride: Int, _ count: Int) throws -> R) rethrows -> R? {
+        for vb in self.vertexBuffers {
+            guard let attrib = vb.attributes.first(where: { $0.semantic == semantic })
+            else { continue }
+
+            if let buffer = context.makeCPUAccessible(buffer: vb.buffer),
+               let mapped = buffer.contents() {
+                return try handler(mapped + vb.byteOffset + attrib.offset,
+                                   attrib.format, vb.byteStride, vb.vertexCount)
+            }
+            return nil
+        }
+        return nil
+    }
+
     public func enumerateIndexBufferContent(context: GraphicsDeviceContext,
                                             _ handler: ((_:Int)-> Bool)? = nil) -> Bool {
         if let indexBuffer {
@@ -0,0 +1,422 @@
+//
+//  File: MeshBindingPlan.swift
+//  Author: Hongtae Kim (tiff2766@gmail.com)
+//
+//  Copyright (c) 2022-2024 Hongtae Kim. All rights reserved.
+//
+
+// Shader resource reflection flattened into a list of copy operations.
+// Built once per material, shader map and pipeline state (rebuilt when
+// the pipeline, the material or material.shader changes), so that
+// Mesh.updateShadingProperties does not walk struct members,
+// build member paths or look up semantics every frame.
+// Material values are converted to the shader data types when the
+// material is modified, executing the plan only copies bytes.
+struct ShadingBindingPlan {
+    // scene state matrix, converted to the shader data type.
+    struct Uniform {
+        enum Layout {
+            case float4x4
+            case float3x3
+        }
+        let semantic: ShaderUniformSemantic
+        let layout: Layout
+    }
+
+    // material property looked up by semantic, then by location.
+    struct MaterialSource: Hashable {
+        let semantic: MaterialSemantic
+        let location: ShaderBindingLocation
+        let dataType: ShaderDataType
+    }
+
+    // copies one value from the scene state or the material into the buffer.
+    struct Op {
+        let uniform: Uniform?
+        let source: Int         // index of materialData
+        let offset: Int         // destination offset
+        let arrayStride: Int    // material property offset per array index
+    }
+
+    // top-level struct member, for diagnostics only.
+    struct Member {
+        let name: String
+        let location: ShaderBindingLocation
+        let offset: Int         // destination offset
+        let size: Int
+        let ops: Range<Int>
+    }
+
+    struct BufferBinding {
+        let name: String
+        let location: ShaderBindingLocation
+        let size: Int
+        let isStruct: Bool
+        // material struct property copied as a whole if its size matches.
+        let structSource: Int?
+        let ops: [Op]
+        let members: [Member]
+        // bound to Mesh.instanceTransforms for instanced draws.
+        let instanceTransforms: Bool
+    }
+
+    struct ObjectBinding {
+        let uniform: ShaderUniformSemantic?
+        let material: MaterialSemantic
+    }
+
+    enum Binding {
+        case buffer(BufferBinding)
+        case object(ObjectBinding)  // textures, samplers
+    }
+
+    // not retained, compared by identity with the material of the mesh.
+    private weak var material: Material?
+    private let shaderVersion: UInt64
+    let resources: [[Binding]]  // same layout as Mesh.resourceBindings
+    let pushConstants: [BufferBinding]
+    let materialSources: [MaterialSource]
+
+    // converted material values, see resolve(material:)
+    private(set) var materialData: [[UInt8]]
+    private(set) var materialVersion: UInt64?
+
+    init(material: Material,
+         resourceBindings: [Mesh.ResourceBindingSet],
+         pushConstants: [ShaderPushConstantLayout]) {
+        let semantics = material.shader.resourceSemantics
+
+        var sources = Sources()
+        self.material = material
+        self.shaderVersion = material.shaderVersion
+        self.resources = resourceBindings.map { rbs in
+            rbs.resources.map { rb in
+                let res = rb.resource
+                if res.type == .buffer {
+                    let typeInfo = res.bufferTypeInfo!
+                    return .buffer(Self.compile(semantics: semantics,
+                                                sources: &sources,
+                                                type: typeInfo.dataType,
+                                                set: res.set,
+                                                binding: res.binding,
+                                                offset: 0,
+                                                size: typeInfo.size,
+                                                stride: res.stride,
+                                                members: res.members,
+                                                name: res.name))
+                }
+                let location = ShaderBindingLocation(set: res.set,
+                                                     binding: res.binding,
+                                                     offset: 0)
+                let (uniform, material) = Self.semantic(semantics[location])
+                return .object(ObjectBinding(uniform: uniform, material: material))
+            }
+        }
+        self.pushConstants = pushConstants.map { layout in
+            let location = ShaderBindingLocation.pushConstant(offset: layout.offset)
+            return Self.compile(semantics: semantics,
+                                sources: &sources,
+                                type: .struct,
+                                set: location.set,
+                                binding: location.binding,
+                                offset: location.offset,
+                                size: layout.size,
+                                stride: layout.size,
+                                members: layout.members,
+                                name: layout.name)
+        }
+        self.materialSources = sources.sources
+        self.materialData = []
+        self.materialVersion = nil
+    }
+
+    func matches(material: Material) -> Bool {
+        self.material === material && self.shaderVersion == material.shaderVersion
+    }
+
+    // converts material properties into the shader data types,
+    // must be called again if the material has been modified.
+    mutating func resolve(material: Material) {
+        self.materialData = self.materialSources.map { source in
+            var data: [UInt8] = []
+            let bind = { (prop: MaterialProperty) in
+                if case let .buffer(buffer) = prop {
+                    data = buffer
+                } else if let components = source.dataType.components() {
+                    data = Self.bytes(of: prop, as: components.type)
+                }
+            }
+            if source.semantic != .userDefined {
+                if let prop = material.properties[source.semantic] {
+                    bind(prop)
+                }
+            }
+            if data.isEmpty {
+                if let prop = material.userDefinedProperties[source.location] {
+                    bind(prop)
+                }
+            }
+            return data
+        }
+        self.materialVersion = material.version
+    }
+
+    private static func bytes<T: Numeric>(of prop: MaterialProperty, as: T.Type) -> [UInt8] {
+        prop.castNumericArray(as: T.self).withUnsafeBytes { Array($0) }
+    }
+
+    private struct Sources {
+        var sources: [MaterialSource] = []
+        var indices: [MaterialSource: Int] = [:]
+
+        mutating func index(of source: MaterialSource) -> Int {
+            if let index = indices[source] { return index }
+            let index = sources.count
+            sources.append(source)
+            indices[source] = index
+            return index
+        }
+    }
+
+    private static func isInstanceTransforms(_ semantic: ShaderUniformSemantic?,
+                                             _ location: ShaderBindingLocation) -> Bool {
+        if case .some(.transformMatrixArray) = semantic {
+            return location.offset == 0
+        }
+        return false
+    }
+
+    private static func uniform(_ semantic: ShaderUniformSemantic?,
+                                dataType: ShaderDataType) -> Uniform? {
+        guard let semantic else { return nil }
+        switch dataType {
+        case .float4x4: return Uniform(semantic: semantic, layout: .float4x4)
+        case .float3x3: return Uniform(semantic: semantic, layout: .float3x3)
+        default:        return nil
+        }
+    }
+
+    private static func semantic(_ semantic: MaterialShaderMap.Semantic?)
+    -> (ShaderUniformSemantic?, MaterialSemantic) {
+        switch semantic {
+        case let .uniform(ss):   return (ss, .userDefined)
+        case let .material(ms):  return (nil, ms)
+        case nil:                return (nil, .userDefined)
+        }
+    }
+
+    private static func compile(semantics: [ShaderBindingLocation: MaterialShaderMap.Semantic],
+                                sources: inout Sources,
+                                type: ShaderDataType,
+                                set: Int,
+                                binding: Int,
+                                offset: Int,
+                                size: Int,
+                                stride: Int,
+                                members: [ShaderResourceStructMember],
+                                name: String) -> BufferBinding {
+        let location = ShaderBindingLocation(set: set, binding: binding, offset: offset)
+        let semantic = semantics[location]
+
+        if type != .struct {
+            let (uniform, material) = Self.semantic(semantic)
+            let source = MaterialSource(semantic: material, location: location, dataType: type)
+            let op = Op(uniform: Self.uniform(uniform, dataType: type),
+                        source: sources.index(of: source),
+                        offset: 0,
+                        arrayStride: stride)
+            return BufferBinding(name: name, location: location, size: size,
+                                 isStruct: false, structSource: nil,
+                                 ops: [op], members: [],
+                                 instanceTransforms: Self.isInstanceTransforms(uniform, location))
+        }
+
+        var ops: [Op] = []
+        var firstUniform: ShaderUniformSemantic? = nil
+        func append(member: ShaderResourceStructMember,
+                    parentOffset: Int,
+                    destination: Int,
+                    available: Int) {
+            let bindingOffset = member.offset + parentOffset
+            if member.dataType == .struct {
+                for m in member.members {
+                    if m.offset >= available { continue }
+                    if m.offset + m.size > available { continue }
+                    append(member: m,
+                           parentOffset: bindingOffset,
+                           destination: destination + m.offset,
+                           available: available - m.offset)
+                }
+            } else {
+                let location = ShaderBindingLocation(set: set,
+                                                     binding: binding,
+                                                     offset: bindingOffset)
+                let (uniform, material) = Self.semantic(semantics[location])
+                if ops.isEmpty {
+                    firstUniform = uniform
+                }
+                let source = MaterialSource(semantic: material, location: location,
+                                            dataType: member.dataType)
+                ops.append(Op(uniform: Self.uniform(uniform, dataType: member.dataType),
+                              source: sources.index(of: source),
+                              offset: destination,
+                              arrayStride: member.count * member.stride))
+            }
+        }
+
+        var planMembers: [Member] = []
+        for member in members {
+            if member.offset < offset { continue }
+            if member.offset >= (offset + size) { break }
+            if member.offset + member.size > offset + size { break }
+
+            let path = if name.isEmpty == false && member.name.isEmpty == false {
+                "\(name).\(member.name)"
+            } else {
+                member.name
+            }
+            let d = member.offset - offset
+            let first = ops.count
+            append(member: member, parentOffset: 0, destination: d, available: size - d)
+            planMembers.append(Member(name: path,
+                                      location: ShaderBindingLocation(set: set, binding: binding, offset: member.offset),
+                                      offset: d,
+                                      size: member.size,
+                                      ops: first..<ops.count))
+        }
+
+        var structSource: Int? = nil
+        if case let .material(ms) = semantic ?? .material(.userDefined) {
+            structSource = sources.index(of: MaterialSource(semantic: ms, location: location,
+                                                            dataType: .struct))
+        }
+        return BufferBinding(name: name, location: location, size: size,
+                             isStruct: true, structSource: structSource,
+                             ops: ops, members: planMembers,
+                             instanceTransforms: ops.count == 1 && Self.isInstanceTransforms(firstUniform, location))
+    }
+
+    // same as the material property binding, returns number of bytes copied.
+    private func copyMaterialData(_ source: Int,
+                                  offset: Int,
+                                  buffer: UnsafeMutableRawBufferPointer) -> Int {
+        let data = self.materialData[source]
+        if data.count > offset {
+            let s = min(data.count - offset, buffer.count)
+            if s > 0 {
+                data.withUnsafeBytes {
+                    buffer.baseAddress!.copyMemory(from: $0.baseAddress!, byteCount: s)
+                }
+            }
+            return s
+        }
+        return 0
+    }
+
+    private static func copyUniform(_ uniform: Uniform,
+                                    sceneState: SceneState,
+                                    buffer: UnsafeMutableRawBufferPointer) -> Int {
+        let matrix: Matrix4
+        switch uniform.semantic {
+        case .modelMatrix, .transformMatrixArray:
+            // transformMatrixArray: single instance, not drawn through SceneRenderQueue.
+            matrix = sceneState.model
+        case .viewMatrix:
+            matrix = sceneState.view.matrix4
+        case .projectionMatrix:
+            matrix = sceneState.projection.matrix
+        case .viewProjectionMatrix:
+            matrix = sceneState.view.matrix4
+                .concatenating(sceneState.projection.matrix)
+        case .modelViewProjectionMatrix:
+            matrix = sceneState.model
+                .concatenating(sceneState.view.matrix4)
+                .concatenating(sceneState.projection.matrix)
+        case .inverseModelMatrix:
+            matrix = sceneState.model.inverted() ?? .identity
+        case .inverseViewMatrix:
+            matrix = sceneState.view.matrix4.inverted() ?? .identity
+        case .inverseProjectionMatrix:
+            matrix = sceneState.projection.matrix.inverted() ?? .identity
+        case .inverseViewProjectionMatrix:
+            matrix = sceneState.view.matrix4
+                .concatenating(sceneState.projection.matrix)
+                .inverted() ?? .identity
+        case .inverseModelViewProjectionMatrix:
+            matrix = sceneState.model
+                .concatenating(sceneState.view.matrix4)
+                .concatenating(sceneState.projection.matrix)
+                .inverted() ?? .identity
+        default:
+            return 0
+        }
+
+        let copy = { (bytes: UnsafeRawBufferPointer) -> Int in
+            if bytes.count > buffer.count { return 0 }
+            buffer.copyMemory(from: bytes)
+            return bytes.count
+        }
+        switch uniform.layout {
+        case .float4x4:
+            return withUnsafeBytes(of: matrix.float4x4, copy)
+        case .float3x3:
+            let mat = Matrix3(matrix.m11, matrix.m12, matrix.m13,
+                              matrix.m21, matrix.m22, matrix.m23,
+                              matrix.m31, matrix.m32, matrix.m33)
+            return withUnsafeBytes(of: mat.float3x3, copy)
+        }
+    }
+
+    func execute(_ binding: BufferBinding,
+                 arrayIndex: Int,
+                 sceneState: SceneState?,
+                 buffer: UnsafeMutableRawBufferPointer) -> Int {
+        let execute = { (op: Op) -> Int in
+            if op.offset >= buffer.count { return 0 }
+            let dst = UnsafeMutableRawBufferPointer(rebasing: buffer[op.offset...])
+            var copied = 0
+            if let uniform = op.uniform, let sceneState {
+                copied = Self.copyUniform(uniform, sceneState: sceneState, buffer: dst)
+            }
+            if copied == 0 {
+                copied = self.copyMaterialData(op.source,
+                                               offset: op.arrayStride * arrayIndex,
+                                               buffer: dst)
+            }
+            return copied
+        }
+
+        if binding.isStruct == false {
+            let copied = execute(binding.ops[0])
+            if copied == 0 {
+                Log.warning("Unable to bind shader uniform struct (\(binding.location)), arrayIndex: \(arrayIndex), name:\"\(binding.name)\"")
+            }
+            return copied
+        }
+
+        if let source = binding.structSource {
+            let copied = self.copyMaterialData(source,
+                                               offset: binding.location.offset,
+                                               buffer: buffer)
+            if copied == binding.size { return copied }
+        }
+        // The entire buffer wasn't copied, copy members of a struct.
+        var copied = 0
+        for member in binding.members {
+            if member.offset + member.size > buffer.count {
+                Log.error("Insufficient buffer for shader uniform struct at location:\(binding.location), size:\(binding.size), name:\"\(member.name)\"")
+                break
+            }
+            var s = 0
+            for index in member.ops {
+                s += execute(binding.ops[index])
+            }
+            if s > 0 {
+                copied += s
+            } else {
+                Log.warning("Unable to bind shader uniform struct at location:\(member.location), size:\(member.size), name:\"\(member.name)\"")
+            }
+        }
+        return copied
+    }
+}
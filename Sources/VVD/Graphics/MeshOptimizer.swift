@@ -0,0 +1,325 @@
+//
+//  File: MeshOptimizer.swift
+//  Author: Hongtae Kim (tiff2766@gmail.com)
+//
+//  Copyright (c) 2022-2024 Hongtae Kim. All rights reserved.
+//
+
+import Foundation
+
+// CPU-side mesh post-processing for triangle lists.
+//  - vertex welding: merges binary identical vertices.
+//  - vertex cache: reorders triangles for the post-transform cache (Tipsify).
+//  - overdraw: reorders clusters of triangles front-to-back from outside.
+//  - vertex fetch: reorders vertices in first-use order.
+// Statistics are simulated on CPU, to compare results without a GPU.
+public enum MeshOptimizer {
+    public struct VertexCacheStatistics {
+        public var vertexTransforms = 0     // post-transform cache misses
+        public var acmr: Double = 0         // transformed vertices per triangle (0.5...3)
+        public var atvr: Double = 0         // transformed vertices per vertex (1.0 is optimal)
+    }
+
+    public struct VertexFetchStatistics {
+        public var bytesFetched = 0
+        public var overfetch: Double = 0    // fetched bytes / vertex buffer size (1.0 is optimal)
+    }
+
+    // Simulates a FIFO post-transform cache.
+    public static func analyzeVertexCache(indices: [UInt32], vertexCount: Int, cacheSize: Int = 16) -> VertexCacheStatistics {
+        var stats = VertexCacheStatistics()
+        let numTriangles = indices.count / 3
+        if numTriangles == 0 || vertexCount == 0 { return stats }
+
+        // vertex is in the cache if it was inserted within the last cacheSize misses.
+        var insertedAt = [Int](repeating: Int.min / 2, count: vertexCount)
+        var misses = 0
+        for index in indices.prefix(numTriangles * 3) {
+            let v = Int(index)
+            if misses - insertedAt[v] >= cacheSize {
+                insertedAt[v] = misses
+                misses += 1
+            }
+        }
+        stats.vertexTransforms = misses
+        stats.acmr = Double(misses) / Double(numTriangles)
+        stats.atvr = Double(misses) / Double(vertexCount)
+        return stats
+    }
+
+    // Simulates fetching vertices in cache lines through a small FIFO line cache.
+    public static func analyzeVertexFetch(indices: [UInt32], vertexCount: Int, vertexStride: Int,
+                                          cacheLineSize: Int = 64, cacheLines: Int = 64) -> VertexFetchStatistics {
+        var stats = VertexFetchStatistics()
+        if indices.isEmpty || vertexCount == 0 { return stats }
+
+        var cache = [Int](repeating: -1, count: cacheLines)
+        var next = 0
+        for index in indices {
+            let start = Int(index) * vertexStride
+            let end = start + vertexStride
+            var line = start / cacheLineSize
+            while line * cacheLineSize < end {
+                if cache.contains(line) == false {
+                    cache[next] = line
+                    next = (next + 1) % cacheLines
+                    stats.bytesFetched += cacheLineSize
+                }
+                line += 1
+            }
+        }
+        stats.overfetch = Double(stats.bytesFetched) / Double(vertexCount * vertexStride)
+        return stats
+    }
+
+    // Finds binary identical vertices, returns remap table (old index to new index)
+    // and the number of unique vertices. Unique vertices keep their first-seen order.
+    public static func generateVertexRemap(vertices: UnsafeRawBufferPointer,
+                                           vertexStride: Int) -> (remap: [UInt32], vertexCount: Int) {
+        let vertexCount = vertices.count / vertexStride
+        var remap = [UInt32](repeating: 0, count: vertexCount)
+        if vertexCount == 0 { return (remap, 0) }
+
+        var capacity = 1
+        while capacity < vertexCount * 2 { capacity <<= 1 }
+        var table = [Int](repeating: -1, count: capacity)    // original vertex index
+        let base = vertices.baseAddress!
+
+        func hash(_ p: UnsafeRawPointer) -> Int {
+            var h: UInt64 = 0xcbf29ce484222325     // FNV-1a
+            for i in 0..<vertexStride {
+                h = (h ^ UInt64(p.load(fromByteOffset: i, as: UInt8.self))) &* 0x100000001b3
+            }
+            return Int(truncatingIfNeeded: h)
+        }
+
+        var unique = 0
+        for v in 0..<vertexCount {
+            let p = base + v * vertexStride
+            var slot = hash(p) & (capacity - 1)
+            while true {
+                let other = table[slot]
+                if other < 0 {
+                    table[slot] = v
+                    remap[v] = UInt32(unique)
+                    unique += 1
+                    break
+                }
+                if memcmp(p, base + other * vertexStride, vertexStride) == 0 {
+                    remap[v] = remap[other]
+                    break
+                }
+                slot = (slot + 1) & (capacity - 1)
+            }
+        }
+        return (remap, unique)
+    }
+
+    public static func remapIndices(_ indices: [UInt32], remap: [UInt32]) -> [UInt32] {
+        indices.map { remap[Int($0)] }
+    }
+
+    // Builds new vertex data with vertexCount vertices, from a remap table.
+    public static func remapVertices(_ vertices: UnsafeRawBufferPointer, vertexStride: Int,
+                                     remap: [UInt32], vertexCount: Int) -> [UInt8] {
+        var output = [UInt8](repeating: 0, count: vertexCount * vertexStride)
+        output.withUnsafeMutableBytes { dst in
+            for (v, r) in remap.enumerated() where r != UInt32.max {
+                (dst.baseAddress! + Int(r) * vertexStride)
+                    .copyMemory(from: vertices.baseAddress! + v * vertexStride, byteCount: vertexStride)
+            }
+        }
+        return output
+    }
+
+    // Welds identical vertices, returns new indices and vertex data.
+    public static func weldVertices(indices: [UInt32], vertices: UnsafeRawBufferPointer,
+                                    vertexStride: Int) -> (indices: [UInt32], vertices: [UInt8], vertexCount: Int) {
+        let (remap, vertexCount) = generateVertexRemap(vertices: vertices, vertexStride: vertexStride)
+        return (remapIndices(indices, remap: remap),
+                remapVertices(vertices, vertexStride: vertexStride, remap: remap, vertexCount: vertexCount),
+                vertexCount)
+    }
+
+    // vertex to triangle adjacency, compressed rows.
+    struct Adjacency {
+        var offsets: [Int]
+        var triangles: [Int]
+        var counts: [Int]
+
+        init(indices: [UInt32], vertexCount: Int) {
+            counts = [Int](repeating: 0, count: vertexCount)
+            for index in indices { counts[Int(index)] += 1 }
+            offsets = [Int](repeating: 0, count: vertexCount + 1)
+            for v in 0..<vertexCount { offsets[v + 1] = offsets[v] + counts[v] }
+            triangles = [Int](repeating: 0, count: offsets[vertexCount])
+            var fill = offsets
+            for (i, index) in indices.enumerated() {
+                let v = Int(index)
+                triangles[fill[v]] = i / 3
+                fill[v] += 1
+            }
+        }
+    }
+
+    // Reorders triangles for the post-transform vertex cache, using Tipsify
+    // (Sander, Nehab, Barczak: Fast Triangle Reordering for Vertex Locality and Reduced Overdraw).
+    public static func optimizeVertexCache(indices: [UInt32], vertexCount: Int, cacheSize: Int = 16) -> [UInt32] {
+        optimizeVertexCacheClusters(indices: indices, vertexCount: vertexCount, cacheSize: cacheSize).indices
+    }
+
+    // Tipsify, also returns the first triangle of each cluster. A cluster
+    // starts where the fanning vertex was not taken from the cache.
+    static func optimizeVertexCacheClusters(indices: [UInt32], vertexCount: Int,
+                                            cacheSize: Int) -> (indices: [UInt32], clusters: [Int]) {
+        let numTriangles = indices.count / 3
+        if numTriangles == 0 { return ([], []) }
+
+        let adjacency = Adjacency(indices: Array(indices.prefix(numTriangles * 3)), vertexCount: vertexCount)
+        var live = adjacency.counts
+        var cacheTime = [Int](repeating: 0, count: vertexCount)
+        var emitted = [Bool](repeating: false, count: numTriangles)
+        var deadEnd: [Int] = []
+        var candidates: [Int] = []
+        var output: [UInt32] = []
+        output.reserveCapacity(numTriangles * 3)
+        var clusters: [Int] = [0]
+
+        var time = cacheSize + 1
+        var cursor = 0
+        var fanning = Int(indices[0])
+
+        while fanning >= 0 {
+            candidates.removeAll(keepingCapacity: true)
+            for a in adjacency.offsets[fanning]..<adjacency.offsets[fanning + 1] {
+                let t = adjacency.triangles[a]
+                if emitted[t] { continue }
+                emitted[t] = true
+                for k in 0..<3 {
+                    let v = Int(indices[t * 3 + k])
+                    output.append(UInt32(v))
+                    deadEnd.append(v)
+                    candidates.append(v)
+                    live[v] -= 1
+                    if time - cacheTime[v] > cacheSize {
+                        cacheTime[v] = time
+                        time += 1
+                    }
+                }
+            }
+
+            // next fanning vertex: the one in cache with the most use,
+            // which will still be in the cache after its fan is emitted.
+            var next = -1
+            var bestPriority = -1
+            for v in candidates where live[v] > 0 {
+                var priority = 0
+                if time - cacheTime[v] + 2 * live[v] <= cacheSize {
+                    priority = time - cacheTime[v]
+                }
+                if priority > bestPriority {
+                    bestPriority = priority
+                    next = v
+                }
+            }
+            if next < 0 {
+                // dead-end, take a recently used vertex or the next in input order.
+                while let v = deadEnd.popLast() {
+                    if live[v] > 0 {
+                        next = v
+                        break
+                    }
+                }
+                while next < 0 && cursor < vertexCount {
+                    if live[cursor] > 0 {
+                        next = cursor
+                    }
+                    cursor += 1
+                }
+                if next >= 0 && output.count / 3 < numTriangles {
+                    clusters.append(output.count / 3)
+                }
+            }
+            fanning = next
+        }
+        return (output, clusters)
+    }
+
+    // Reorders triangles for the vertex cache, then sorts clusters of triangles
+    // so that clusters facing away from the mesh center are drawn first,
+    // which reduces overdraw from most view directions.
+    // Clusters smaller than minClusterSize triangles are merged with neighbours.
+    public static func optimizeOverdraw(indices: [UInt32], positions: [Vector3],
+                                        cacheSize: Int = 16, minClusterSize: Int = 32) -> [UInt32] {
+        let (ordered, starts) = optimizeVertexCacheClusters(indices: indices,
+                                                            vertexCount: positions.count,
+                                                            cacheSize: cacheSize)
+        let numTriangles = ordered.count / 3
+        if numTriangles == 0 { return ordered }
+
+        var clusters: [Range<Int>] = []
+        var begin = 0
+        for start in starts.dropFirst() + [numTriangles] where start - begin >= minClusterSize || start == numTriangles {
+            clusters.append(begin..<start)
+            begin = start
+        }
+        if clusters.count < 2 { return ordered }
+
+        // mesh centroid, area weighted
+        var meshCenter = Vector3.zero
+        var meshArea: Scalar = 0
+        var clusterData: [(center: Vector3, normal: Vector3)] = []
+        for cluster in clusters {
+            var center = Vector3.zero
+            var normal = Vector3.zero
+            var area: Scalar = 0
+            for t in cluster {
+                let p0 = positions[Int(ordered[t * 3])]
+                let p1 = positions[Int(ordered[t * 3 + 1])]
+                let p2 = positions[Int(ordered[t * 3 + 2])]
+                let n = Vector3.cross(p1 - p0, p2 - p0)
+                let a = n.length
+                center += (p0 + p1 + p2) * (a / 3)
+                normal += n
+                area += a
+            }
+            meshCenter += center
+            meshArea += area
+            clusterData.append((area > 0 ? center / area : positions[Int(ordered[cluster.lowerBound * 3])],
+                                normal.normalized()))
+        }
+        if meshArea > 0 { meshCenter = meshCenter / meshArea }
+
+        let sortKeys = clusterData.map { Vector3.dot($0.center - meshCenter, $0.normal) }
+        let order = clusters.indices.sorted { sortKeys[$0] > sortKeys[$1] }
+
+        var output: [UInt32] = []
+        output.reserveCapacity(ordered.count)
+        for c in order {
+            output.append(contentsOf: ordered[(clusters[c].lowerBound * 3)..<(clusters[c].upperBound * 3)])
+        }
+        return output
+    }
+
+    // Vertex order of first use in indices, returns remap table
+    // (old index to new index, UInt32.max for unused) and the number of used vertices.
+    public static func generateVertexFetchRemap(indices: [UInt32], vertexCount: Int) -> (remap: [UInt32], vertexCount: Int) {
+        var remap = [UInt32](repeating: UInt32.max, count: vertexCount)
+        var next: UInt32 = 0
+        for index in indices where remap[Int(index)] == UInt32.max {
+            remap[Int(index)] = next
+            next += 1
+        }
+        return (remap, Int(next))
+    }
+
+    // Reorders vertices in first-use order, returns new indices and vertex data.
+    public static func optimizeVertexFetch(indices: [UInt32], vertices: UnsafeRawBufferPointer,
+                                           vertexStride: Int) -> (indices: [UInt32], vertices: [UInt8], vertexCount: Int) {
+        let (remap, vertexCount) = generateVertexFetchRemap(indices: indices,
+                                                            vertexCount: vertices.count / vertexStride)
+        return (remapIndices(indices, remap: remap),
+                remapVertices(vertices, vertexStride: vertexStride, remap: remap, vertexCount: vertexCount),
+                vertexCount)
+    }
+}
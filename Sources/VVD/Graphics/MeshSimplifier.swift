@@ -0,0 +1,427 @@
+//
+//  File: MeshSimplifier.swift
+//  Author: Hongtae Kim (tiff2766@gmail.com)
+//
+//  Copyright (c) 2022-2024 Hongtae Kim. All rights reserved.
+//
+
+import Foundation
+
+// Triangle list simplification with quadric error metrics
+// (Garland, Heckbert: Surface Simplification Using Quadric Error Metrics).
+// Edges are collapsed onto existing vertices, so that every level of detail
+// is an index buffer sharing the vertex buffers of the source mesh.
+//  - vertices sharing a position (wedges) are collapsed together, so
+//    attribute seams (split normals, uv charts) stay closed.
+//  - border vertices move along the border only, seam vertices along the seam.
+//  - vertices which are none of manifold, border or simple seam are locked.
+//  - normal and uv differences of the collapsed wedges add to the error.
+public enum MeshSimplifier {
+    public struct LODLevel {
+        public var indices: [UInt32]
+        public var error: Scalar        // estimated deviation from the source mesh, in mesh units
+    }
+
+    public struct AttributeWeights {
+        public var normal: Scalar
+        public var uv: Scalar
+        public init(normal: Scalar = 1.0, uv: Scalar = 1.0) {
+            self.normal = normal
+            self.uv = uv
+        }
+    }
+
+    static let boundaryWeight: Scalar = 10.0
+
+    struct Quadric {
+        var a2: Scalar = 0, b2: Scalar = 0, c2: Scalar = 0, d2: Scalar = 0
+        var ab: Scalar = 0, ac: Scalar = 0, ad: Scalar = 0
+        var bc: Scalar = 0, bd: Scalar = 0, cd: Scalar = 0
+        var weight: Scalar = 0
+
+        init() {}
+
+        // plane: dot(n, p) + d = 0, n is unit length.
+        init(normal n: Vector3, d: Scalar, weight w: Scalar) {
+            a2 = n.x * n.x * w; b2 = n.y * n.y * w; c2 = n.z * n.z * w; d2 = d * d * w
+            ab = n.x * n.y * w; ac = n.x * n.z * w; ad = n.x * d * w
+            bc = n.y * n.z * w; bd = n.y * d * w; cd = n.z * d * w
+            weight = w
+        }
+
+        static func + (lhs: Quadric, rhs: Quadric) -> Quadric {
+            var q = lhs
+            q += rhs
+            return q
+        }
+
+        static func += (lhs: inout Quadric, rhs: Quadric) {
+            lhs.a2 += rhs.a2; lhs.b2 += rhs.b2; lhs.c2 += rhs.c2; lhs.d2 += rhs.d2
+            lhs.ab += rhs.ab; lhs.ac += rhs.ac; lhs.ad += rhs.ad
+            lhs.bc += rhs.bc; lhs.bd += rhs.bd; lhs.cd += rhs.cd
+            lhs.weight += rhs.weight
+        }
+
+        // weighted mean of squared distances from p to the planes.
+        func error(_ p: Vector3) -> Scalar {
+            if weight <= 0 { return 0 }
+            let x = p.x, y = p.y, z = p.z
+            let e = a2 * x * x + b2 * y * y + c2 * z * z + d2
+                + 2.0 * (ab * x * y + ac * x * z + bc * y * z)
+                + 2.0 * (ad * x + bd * y + cd * z)
+            return abs(e) / weight
+        }
+    }
+
+    enum VertexKind {
+        case manifold, border, seam, locked
+    }
+
+    struct Topology {
+        var kinds: [VertexKind]         // indexed by position (see generatePositionRemap)
+        var borderEdges: Set<UInt64>    // undirected, in position space
+        var seamEdges: Set<UInt64>
+
+        func isBorder(_ a: UInt32, _ b: UInt32) -> Bool { borderEdges.contains(MeshSimplifier.undirectedKey(a, b)) }
+        func isSeam(_ a: UInt32, _ b: UInt32) -> Bool { seamEdges.contains(MeshSimplifier.undirectedKey(a, b)) }
+
+        func canCollapse(_ u: UInt32, _ v: UInt32) -> Bool {
+            switch kinds[Int(u)] {
+            case .manifold: return true
+            case .border:   return isBorder(u, v)
+            case .seam:     return isSeam(u, v)
+            case .locked:   return false
+            }
+        }
+    }
+
+    static func edgeKey(_ a: UInt32, _ b: UInt32) -> UInt64 {
+        UInt64(a) << 32 | UInt64(b)
+    }
+
+    static func undirectedKey(_ a: UInt32, _ b: UInt32) -> UInt64 {
+        a < b ? edgeKey(a, b) : edgeKey(b, a)
+    }
+
+    // Maps each vertex to the first vertex with the same position.
+    static func generatePositionRemap(positions: [Vector3]) -> [UInt32] {
+        struct Key: Hashable {
+            let x: UInt64, y: UInt64, z: UInt64
+            init(_ p: Vector3) {
+                // adding zero turns -0.0 into 0.0
+                x = (p.x + 0).bitPattern; y = (p.y + 0).bitPattern; z = (p.z + 0).bitPattern
+            }
+        }
+        var table: [Key: UInt32] = [:]
+        table.reserveCapacity(positions.count)
+        return positions.enumerated().map { i, p in
+            let key = Key(p)
+            if let first = table[key] { return first }
+            table[key] = UInt32(i)
+            return UInt32(i)
+        }
+    }
+
+    // An edge that has no opposite edge in position space is a border edge.
+    // An edge that has an opposite edge in position space but not in vertex
+    // space is a seam edge: the adjacent triangles use different wedges.
+    static func classify(indices: [UInt32], positionRemap remap: [UInt32]) -> Topology {
+        let vertexCount = remap.count
+        var edges = Set<UInt64>(minimumCapacity: indices.count)
+        var positionEdges = Set<UInt64>(minimumCapacity: indices.count)
+        var referenced = [Bool](repeating: false, count: vertexCount)
+        var wedges = [Int](repeating: 0, count: vertexCount)
+        for t in stride(from: 0, to: indices.count, by: 3) {
+            for k in 0..<3 {
+                let a = indices[t + k], b = indices[t + (k + 1) % 3]
+                edges.insert(edgeKey(a, b))
+                positionEdges.insert(edgeKey(remap[Int(a)], remap[Int(b)]))
+                if referenced[Int(a)] == false {
+                    referenced[Int(a)] = true
+                    wedges[Int(remap[Int(a)])] += 1
+                }
+            }
+        }
+
+        var borderCount = [Int](repeating: 0, count: vertexCount)
+        var seamCount = [Int](repeating: 0, count: vertexCount)
+        var topology = Topology(kinds: [], borderEdges: [], seamEdges: [])
+        for t in stride(from: 0, to: indices.count, by: 3) {
+            for k in 0..<3 {
+                let a = indices[t + k], b = indices[t + (k + 1) % 3]
+                let pa = remap[Int(a)], pb = remap[Int(b)]
+                if positionEdges.contains(edgeKey(pb, pa)) == false {
+                    borderCount[Int(pa)] += 1
+                    borderCount[Int(pb)] += 1
+                    topology.borderEdges.insert(undirectedKey(pa, pb))
+                } else if edges.contains(edgeKey(b, a)) == false {
+                    seamCount[Int(pa)] += 1
+                    seamCount[Int(pb)] += 1
+                    topology.seamEdges.insert(undirectedKey(pa, pb))
+                }
+            }
+        }
+
+        // a border vertex has one incoming and one outgoing border edge,
+        // a seam vertex has two wedges with one incoming and one outgoing seam edge each.
+        topology.kinds = (0..<vertexCount).map { v in
+            switch (wedges[v], borderCount[v], seamCount[v]) {
+            case (1, 0, 0): return .manifold
+            case (1, 2, 0): return .border
+            case (2, 0, 4): return .seam
+            default:        return .locked
+            }
+        }
+        return topology
+    }
+
+    // Simplifies the triangle list until it has no more than targetIndexCount
+    // indices, or the next collapse would exceed targetError (in mesh units).
+    // Returns the indices of the simplified mesh, which reference the same
+    // vertices, and the resulting error.
+    public static func simplify(indices source: [UInt32],
+                                positions: [Vector3],
+                                normals: [Vector3]? = nil,
+                                uvs: [Vector2]? = nil,
+                                weights: AttributeWeights = .init(),
+                                targetIndexCount: Int,
+                                targetError: Scalar = .greatestFiniteMagnitude) -> (indices: [UInt32], error: Scalar) {
+        var indices = Array(source.prefix(source.count / 3 * 3))
+        let targetIndexCount = max(targetIndexCount, 0)
+        let vertexCount = positions.count
+        if indices.count <= targetIndexCount || vertexCount == 0 { return (indices, 0) }
+
+        assert(normals == nil || normals!.count == vertexCount)
+        assert(uvs == nil || uvs!.count == vertexCount)
+
+        // collapse in a unit sized space, so that attribute weights
+        // do not depend on the scale of the mesh.
+        var bounds = AABB.null
+        positions.forEach { bounds.expand($0) }
+        let size = bounds.max - bounds.min
+        let extent = max(size.x, size.y, size.z, .ulpOfOne)
+        let scale = 1.0 / extent
+        let points = positions.map { ($0 - bounds.min) * scale }
+        let maxError = targetError < .greatestFiniteMagnitude
+            ? pow(max(targetError, 0) * scale, 2) : .greatestFiniteMagnitude
+
+        let remap = generatePositionRemap(positions: positions)
+        var topology = classify(indices: indices, positionRemap: remap)
+
+        var quadrics = [Quadric](repeating: Quadric(), count: vertexCount)
+        for t in stride(from: 0, to: indices.count, by: 3) {
+            let v = (0..<3).map { remap[Int(indices[t + $0])] }
+            let p = v.map { points[Int($0)] }
+            let n = Vector3.cross(p[1] - p[0], p[2] - p[0])
+            let area = n.length
+            if area <= 0 { continue }
+            let normal = n / area
+            let q = Quadric(normal: normal, d: -Vector3.dot(normal, p[0]), weight: area * 0.5)
+            v.forEach { quadrics[Int($0)] += q }
+
+            // planes perpendicular to the face through open edges, keeping
+            // border and seam vertices from moving away from the edge.
+            for k in 0..<3 {
+                let a = v[k], b = v[(k + 1) % 3]
+                if topology.isBorder(a, b) || topology.isSeam(a, b) {
+                    let edge = p[(k + 1) % 3] - p[k]
+                    let length = edge.length
+                    if length <= 0 { continue }
+                    let planeNormal = Vector3.cross(edge, normal).normalized()
+                    let q = Quadric(normal: planeNormal, d: -Vector3.dot(planeNormal, p[k]),
+                                    weight: length * length * boundaryWeight)
+                    quadrics[Int(a)] += q
+                    quadrics[Int(b)] += q
+                }
+            }
+        }
+
+        // attribute deviation of the wedges, weighted by the squared edge
+        // length to be comparable with the squared distance of quadrics.
+        func attributeError(_ a: UInt32, _ b: UInt32) -> Scalar {
+            var e: Scalar = 0
+            if let normals { e += (normals[Int(a)] - normals[Int(b)]).lengthSquared * weights.normal }
+            if let uvs { e += (uvs[Int(a)] - uvs[Int(b)]).lengthSquared * weights.uv }
+            return e
+        }
+
+        struct Collapse {
+            let u: UInt32
+            let v: UInt32
+            let cost: Scalar
+        }
+
+        var positionIndices = [UInt32](repeating: 0, count: indices.count)
+        var collapseTarget = (0..<UInt32(vertexCount)).map { $0 }
+        var locked = [Bool](repeating: false, count: vertexCount)
+        var wedgePairs: [(UInt32, UInt32)] = []
+        var resultError: Scalar = 0
+        var unboundedPass = false
+
+        while indices.count > targetIndexCount {
+            for i in 0..<indices.count { positionIndices[i] = remap[Int(indices[i])] }
+            let adjacency = MeshOptimizer.Adjacency(indices: Array(positionIndices.prefix(indices.count)),
+                                                    vertexCount: vertexCount)
+
+            // pairs wedges of u with wedges of v through the triangles around u,
+            // fails if a wedge of u is not adjacent to v or has ambiguous pairs.
+            func pairWedges(_ u: UInt32, _ v: UInt32) -> Bool {
+                wedgePairs.removeAll(keepingCapacity: true)
+                for n in adjacency.offsets[Int(u)]..<adjacency.offsets[Int(u) + 1] {
+                    let t = adjacency.triangles[n] * 3
+                    guard let cu = (0..<3).first(where: { positionIndices[t + $0] == u }),
+                          let cv = (0..<3).first(where: { positionIndices[t + $0] == v })
+                    else { continue }
+                    let wu = indices[t + cu], wv = indices[t + cv]
+                    if let pair = wedgePairs.first(where: { $0.0 == wu }) {
+                        if pair.1 != wv { return false }
+                    } else {
+                        wedgePairs.append((wu, wv))
+                    }
+                }
+                for n in adjacency.offsets[Int(u)]..<adjacency.offsets[Int(u) + 1] {
+                    let t = adjacency.triangles[n] * 3
+                    for k in 0..<3 where positionIndices[t + k] == u {
+                        if wedgePairs.contains(where: { $0.0 == indices[t + k] }) == false { return false }
+                    }
+                }
+                return wedgePairs.isEmpty == false
+            }
+
+            func cost(_ u: UInt32, _ v: UInt32) -> Scalar? {
+                guard topology.canCollapse(u, v), pairWedges(u, v) else { return nil }
+                let pu = points[Int(u)], pv = points[Int(v)]
+                let attribute = wedgePairs.reduce(0) { max($0, attributeError($1.0, $1.1)) }
+                return (quadrics[Int(u)] + quadrics[Int(v)]).error(pv)
+                    + attribute * (pu - pv).lengthSquared
+            }
+
+            var collapses: [Collapse] = []
+            for t in stride(from: 0, to: indices.count, by: 3) {
+                for k in 0..<3 {
+                    let a = positionIndices[t + k], b = positionIndices[t + (k + 1) % 3]
+                    // interior edges are visited from both sides.
+                    if a > b && topology.isBorder(a, b) == false { continue }
+                    let ab = cost(a, b), ba = cost(b, a)
+                    if let ab, ab <= (ba ?? ab) {
+                        collapses.append(Collapse(u: a, v: b, cost: ab))
+                    } else if let ba {
+                        collapses.append(Collapse(u: b, v: a, cost: ba))
+                    }
+                }
+            }
+            collapses.sort { $0.cost < $1.cost }
+
+            // collapse the cheapest edges, locking the ring of each collapsed
+            // vertex, so that triangles are checked against their final positions.
+            // collapses that are much more expensive than the goal of the pass
+            // are left to the next pass, where cheaper ones may be unlocked.
+            for i in 0..<vertexCount { locked[i] = false }
+            var triangleCount = indices.count / 3
+            let targetTriangleCount = targetIndexCount / 3
+            let goal = (triangleCount - targetTriangleCount) / 2
+            let passError = collapses.isEmpty || unboundedPass
+                ? .greatestFiniteMagnitude : collapses[min(goal, collapses.count - 1)].cost * 1.5
+            var numCollapses = 0
+            for collapse in collapses {
+                if triangleCount <= targetTriangleCount || collapse.cost > maxError { break }
+                if collapse.cost > passError { break }
+                let u = collapse.u, v = collapse.v
+                if locked[Int(u)] || locked[Int(v)] { continue }
+
+                // reject collapses that flip a triangle.
+                var removed = 0
+                var flipped = false
+                for n in adjacency.offsets[Int(u)]..<adjacency.offsets[Int(u) + 1] {
+                    let t = adjacency.triangles[n] * 3
+                    let tri = (0..<3).map { positionIndices[t + $0] }
+                    if tri.contains(v) {
+                        removed += 1
+                        continue
+                    }
+                    let p0 = tri.map { points[Int($0)] }
+                    let p1 = tri.map { points[Int($0 == u ? v : $0)] }
+                    let n0 = Vector3.cross(p0[1] - p0[0], p0[2] - p0[0])
+                    let n1 = Vector3.cross(p1[1] - p1[0], p1[2] - p1[0])
+                    if Vector3.dot(n0, n1) <= 0 {
+                        flipped = true
+                        break
+                    }
+                }
+                if flipped || pairWedges(u, v) == false { continue }
+
+                for (wu, wv) in wedgePairs { collapseTarget[Int(wu)] = wv }
+                quadrics[Int(v)] += quadrics[Int(u)]
+                for n in adjacency.offsets[Int(u)]..<adjacency.offsets[Int(u) + 1] {
+                    let t = adjacency.triangles[n] * 3
+                    for k in 0..<3 { locked[Int(positionIndices[t + k])] = true }
+                }
+                locked[Int(v)] = true
+
+                triangleCount -= removed
+                resultError = max(resultError, collapse.cost)
+                numCollapses += 1
+            }
+            if numCollapses == 0 {
+                // all collapses within the pass error were rejected.
+                if unboundedPass { break }
+                unboundedPass = true
+                continue
+            }
+            unboundedPass = false
+
+            // apply collapses, remove triangles that became degenerate.
+            var count = 0
+            for t in stride(from: 0, to: indices.count, by: 3) {
+                let i0 = collapseTarget[Int(indices[t])]
+                let i1 = collapseTarget[Int(indices[t + 1])]
+                let i2 = collapseTarget[Int(indices[t + 2])]
+                let p0 = remap[Int(i0)], p1 = remap[Int(i1)], p2 = remap[Int(i2)]
+                if p0 == p1 || p1 == p2 || p2 == p0 { continue }
+                indices[count] = i0
+                indices[count + 1] = i1
+                indices[count + 2] = i2
+                count += 3
+            }
+            indices.removeLast(indices.count - count)
+            for i in 0..<vertexCount { collapseTarget[i] = UInt32(i) }
+
+            topology = classify(indices: indices, positionRemap: remap)
+        }
+        return (indices, resultError.squareRoot() * extent)
+    }
+
+    // Generates up to maxLevels levels of detail, each level with about
+    // reduction times the triangles of the previous one. Each level is
+    // simplified from the previous level; the error of a level is the sum
+    // of the errors of the steps, which bounds its deviation from the source.
+    // Generation stops when the mesh cannot be simplified any further.
+    public static func generateLODChain(indices: [UInt32],
+                                        positions: [Vector3],
+                                        normals: [Vector3]? = nil,
+                                        uvs: [Vector2]? = nil,
+                                        weights: AttributeWeights = .init(),
+                                        maxLevels: Int = 4,
+                                        reduction: Scalar = 0.5,
+                                        maxError: Scalar = .greatestFiniteMagnitude) -> [LODLevel] {
+        var levels: [LODLevel] = []
+        var source = indices
+        var error: Scalar = 0
+        for _ in 0..<maxLevels where error < maxError {
+            let target = Int(Scalar(source.count / 3) * reduction) * 3
+            let result = simplify(indices: source,
+                                  positions: positions,
+                                  normals: normals,
+                                  uvs: uvs,
+                                  weights: weights,
+                                  targetIndexCount: target,
+                                  targetError: maxError - error)
+            // stalled, fewer than 10% of triangles removed.
+            if result.indices.isEmpty || result.indices.count * 10 > source.count * 9 { break }
+            error += result.error
+            levels.append(LODLevel(indices: result.indices, error: error))
+            source = result.indices
+        }
+        return levels
+    }
+}
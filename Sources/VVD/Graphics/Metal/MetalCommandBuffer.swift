@@ -44,8 +44,28 @@ final class MetalCommandBuffer: CommandBuffer, @unchecked Sendable {
         self.lock.lock()
         defer { self.lock.unlock() }
 
+        if let desc = self.makeRenderPassDescriptor(descriptor, caller: "makeRenderCommandEncoder") {
+            self._status = .encoding
+            return MetalRenderCommandEncoder(buffer: self, descriptor: desc)
+        }
+        return nil
+    }
+
+    func makeParallelRenderCommandEncoder(descriptor: RenderPassDescriptor) -> ParallelRenderCommandEncoder? {
+        self.lock.lock()
+        defer { self.lock.unlock() }
+
+        if let desc = self.makeRenderPassDescriptor(descriptor, caller: "makeParallelRenderCommandEncoder") {
+            self._status = .encoding
+            return MetalParallelRenderCommandEncoder(buffer: self, descriptor: desc)
+        }
+        return nil
+    }
+
+    // called with the lock held.
+    private func makeRenderPassDescriptor(_ descriptor: RenderPassDescriptor, caller: String) -> MTLRenderPassDescriptor? {
         if self._status != .ready {
-            Log.err("CommandBuffer.makeRenderCommandEncoder failed: CommandBuffer is not in ready state.")
+            Log.err("CommandBuffer.\(caller) failed: CommandBuffer is not in ready state.")
             return nil
         }
 
@@ -204,9 +224,7 @@ final class MetalCommandBuffer: CommandBuffer, @unchecked Sendable {
                 desc.stencilAttachment = attachment
             }
         }
-
-        self._status = .encoding
-        return MetalRenderCommandEncoder(buffer: self, descriptor: desc)
+        return desc
     }
 
     func makeComputeCommandEncoder() -> ComputeCommandEncoder? {
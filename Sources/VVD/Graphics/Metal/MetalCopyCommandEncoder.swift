@@ -212,6 +212,12 @@ final class MetalCopyCommandEncoder: CopyCommandEncoder {
         }
     }
 
+    // resources are shared between queues on Metal.
+    func releaseOwnership(of buffer: GPUBuffer, to queue: CommandQueue) {}
+    func releaseOwnership(of texture: Texture, to queue: CommandQueue) {}
+    func acquireOwnership(of buffer: GPUBuffer, from queue: CommandQueue) {}
+    func acquireOwnership(of texture: Texture, from queue: CommandQueue) {}
+
     func endEncoding() {
         assert(self.encoder != nil)
         if let commandBuffer = self.commandBuffer as? MetalCommandBuffer,
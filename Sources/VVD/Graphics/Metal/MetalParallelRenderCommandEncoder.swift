@@ -0,0 +1,122 @@
+//
+//  File: MetalParallelRenderCommandEncoder.swift
+//  Author: Hongtae Kim (tiff2766@gmail.com)
+//
+//  Copyright (c) 2022-2025 Hongtae Kim. All rights reserved.
+//
+
+#if ENABLE_METAL
+import Foundation
+import Metal
+
+// Child encoders record closures on their own threads, at commit each child
+// is replayed into a child of MTLParallelRenderCommandEncoder in creation order.
+final class MetalParallelRenderCommandEncoder: ParallelRenderCommandEncoder {
+
+    final class Encoder: MetalCommandEncoder {
+        let renderPassDescriptor: MTLRenderPassDescriptor
+        // events and semaphores of the parallel encoder, it has no commands.
+        let header: MetalRenderCommandEncoder.Encoder
+        // in creation order, nil until the child encoder has ended.
+        var children: [MetalRenderCommandEncoder.Encoder?] = []
+
+        init(descriptor: MTLRenderPassDescriptor) {
+            self.renderPassDescriptor = descriptor
+            self.header = MetalRenderCommandEncoder.Encoder(descriptor: descriptor)
+            super.init()
+        }
+
+        override func encode(_ buffer: MTLCommandBuffer) -> Bool {
+            let encoders = [self.header] + self.children.compactMap { $0 }
+
+            encoders.forEach { $0.encodeWaits(buffer) }
+            guard let parallelEncoder = buffer.makeParallelRenderCommandEncoder(descriptor: self.renderPassDescriptor) else {
+                return false
+            }
+            for child in encoders.dropFirst() where child.commands.isEmpty == false {
+                if let encoder = parallelEncoder.makeRenderCommandEncoder() {
+                    child.encodeCommands(encoder)
+                    encoder.endEncoding()
+                }
+            }
+            parallelEncoder.endEncoding()
+            encoders.forEach { $0.encodeSignals(buffer) }
+            return true
+        }
+    }
+
+    private var encoder: Encoder?
+    private let header: MetalRenderCommandEncoder
+    private var numActiveEncoders = 0
+    private let lock = NSLock()
+    let commandBuffer: CommandBuffer
+
+    init(buffer: MetalCommandBuffer, descriptor: MTLRenderPassDescriptor) {
+        let encoder = Encoder(descriptor: descriptor)
+        self.commandBuffer = buffer
+        self.encoder = encoder
+        self.header = MetalRenderCommandEncoder(buffer: buffer, encoder: encoder.header)
+    }
+
+    func makeRenderCommandEncoder() -> RenderCommandEncoder? {
+        self.lock.withLock {
+            guard let encoder = self.encoder else {
+                Log.err("ParallelRenderCommandEncoder.makeRenderCommandEncoder failed: encoding has ended.")
+                return nil
+            }
+            let index = encoder.children.count
+            encoder.children.append(nil)
+            self.numActiveEncoders += 1
+            return MetalRenderCommandEncoder(
+                buffer: self.commandBuffer as! MetalCommandBuffer,
+                encoder: MetalRenderCommandEncoder.Encoder(descriptor: encoder.renderPassDescriptor),
+                parallelEncoder: self,
+                parallelIndex: index)
+        }
+    }
+
+    // called by the child encoder, from its recording thread.
+    func endEncoder(_ child: MetalRenderCommandEncoder.Encoder, index: Int) {
+        self.lock.withLock {
+            guard let encoder = self.encoder else {
+                Log.err("ParallelRenderCommandEncoder: child encoder ended after endEncoding(), commands discarded.")
+                return
+            }
+            encoder.children[index] = child
+            self.numActiveEncoders -= 1
+        }
+    }
+
+    func endEncoding() {
+        let encoder = self.lock.withLock {
+            if self.numActiveEncoders > 0 {
+                Log.err("ParallelRenderCommandEncoder.endEncoding: \(self.numActiveEncoders) child encoder(s) still encoding, commands discarded.")
+            }
+            assert(self.numActiveEncoders == 0)
+            defer { self.encoder = nil }
+            return self.encoder!
+        }
+        if let commandBuffer = self.commandBuffer as? MetalCommandBuffer {
+            commandBuffer.endEncoder(encoder)
+        }
+    }
+
+    var isCompleted: Bool { self.lock.withLock { self.encoder == nil } }
+
+    func waitEvent(_ event: GPUEvent) {
+        self.lock.withLock { self.header.waitEvent(event) }
+    }
+
+    func signalEvent(_ event: GPUEvent) {
+        self.lock.withLock { self.header.signalEvent(event) }
+    }
+
+    func waitSemaphoreValue(_ semaphore: GPUSemaphore, value: UInt64) {
+        self.lock.withLock { self.header.waitSemaphoreValue(semaphore, value: value) }
+    }
+
+    func signalSemaphoreValue(_ semaphore: GPUSemaphore, value: UInt64) {
+        self.lock.withLock { self.header.signalSemaphoreValue(semaphore, value: value) }
+    }
+}
+#endif //if ENABLE_METAL
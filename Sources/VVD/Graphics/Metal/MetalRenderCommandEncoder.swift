@@ -28,6 +28,7 @@ final class MetalRenderCommandEncoder: RenderCommandEncoder {
         var signalSemaphores: [MetalHashable<MetalSemaphore>: UInt64] = [:]
 
         var pushConstants: [UInt8] = []
+        var shadowState = RenderCommandEncoderShadowState(vertexBuffersDependOnPipeline: true)
 
         let renderPassDescriptor: MTLRenderPassDescriptor
 
@@ -39,42 +40,62 @@ final class MetalRenderCommandEncoder: RenderCommandEncoder {
 
         override func encode(_ buffer: MTLCommandBuffer) -> Bool {
             if let encoder = buffer.makeRenderCommandEncoder(descriptor: self.renderPassDescriptor) {
-                self.waitEvents.forEach {
-                    let event: MetalEvent = $0.object
-                    buffer.encodeWaitForEvent(event.event,
-                                              value: event.nextWaitValue())
-                }
-                self.waitSemaphores.forEach { (key, value) in
-                    let event: MetalSemaphore = key.object
-                    buffer.encodeWaitForEvent(event.event, value: value)
-                }
-
-                var state = EncodingState(encoder: self)
-                self.commands.forEach { $0(encoder, &state) }
+                self.encodeWaits(buffer)
+                self.encodeCommands(encoder)
                 encoder.endEncoding()
-
-                self.signalEvents.forEach {
-                    let event: MetalEvent = $0.object
-                    buffer.encodeSignalEvent(event.event,
-                                             value: event.nextSignalValue())
-                }
-                self.signalSemaphores.forEach { (key, value) in
-                    let event: MetalSemaphore = key.object
-                    buffer.encodeSignalEvent(event.event, value: value)
-                }
-
+                self.encodeSignals(buffer)
                 return true
             }
             return false
         }
+
+        func encodeWaits(_ buffer: MTLCommandBuffer) {
+            self.waitEvents.forEach {
+                let event: MetalEvent = $0.object
+                buffer.encodeWaitForEvent(event.event,
+                                          value: event.nextWaitValue())
+            }
+            self.waitSemaphores.forEach { (key, value) in
+                let event: MetalSemaphore = key.object
+                buffer.encodeWaitForEvent(event.event, value: value)
+            }
+        }
+
+        func encodeCommands(_ encoder: MTLRenderCommandEncoder) {
+            var state = EncodingState(encoder: self)
+            self.commands.forEach { $0(encoder, &state) }
+        }
+
+        func encodeSignals(_ buffer: MTLCommandBuffer) {
+            self.signalEvents.forEach {
+                let event: MetalEvent = $0.object
+                buffer.encodeSignalEvent(event.event,
+                                         value: event.nextSignalValue())
+            }
+            self.signalSemaphores.forEach { (key, value) in
+                let event: MetalSemaphore = key.object
+                buffer.encodeSignalEvent(event.event, value: value)
+            }
+        }
     }
 
     private var encoder: Encoder?
     let commandBuffer: CommandBuffer
 
-    init(buffer: MetalCommandBuffer, descriptor: MTLRenderPassDescriptor) {
+    // set for the child encoders of a parallel render pass.
+    private let parallelEncoder: MetalParallelRenderCommandEncoder?
+    private let parallelIndex: Int
+
+    convenience init(buffer: MetalCommandBuffer, descriptor: MTLRenderPassDescriptor) {
+        self.init(buffer: buffer, encoder: Encoder(descriptor: descriptor))
+    }
+
+    init(buffer: MetalCommandBuffer, encoder: Encoder,
+         parallelEncoder: MetalParallelRenderCommandEncoder? = nil, parallelIndex: Int = 0) {
         self.commandBuffer = buffer
-        self.encoder = Encoder(descriptor: descriptor)
+        self.encoder = encoder
+        self.parallelEncoder = parallelEncoder
+        self.parallelIndex = parallelIndex
     }
 
     func setResource(_ bindingSet: ShaderBindingSet, index: Int) {
@@ -83,6 +104,9 @@ final class MetalRenderCommandEncoder: RenderCommandEncoder {
 
         if let bindingSet = bindingSet as? MetalShaderBindingSet,
            let encoder = self.encoder {
+            if encoder.shadowState.setResource(bindingSet, version: bindingSet.version, index: index) == false {
+                return
+            }
             // copy resources
             let buffers = bindingSet.buffers
             let textures = bindingSet.textures
@@ -203,6 +227,9 @@ final class MetalRenderCommandEncoder: RenderCommandEncoder {
 
         if let pipelineState = pipelineState as? MetalRenderPipelineState,
            let encoder = self.encoder {
+            if encoder.shadowState.setRenderPipelineState(pipelineState) == false {
+                return
+            }
 
             if pipelineState.vertexBindings.pushConstantBufferSize > 0 {
                 encoder.pushConstants.reserveCapacity(pipelineState.vertexBindings.pushConstantBufferSize)
@@ -226,6 +253,9 @@ final class MetalRenderCommandEncoder: RenderCommandEncoder {
         assert(buffer is MetalBuffer)
 
         if let buffer = buffer as? MetalBuffer, let encoder = self.encoder {
+            if encoder.shadowState.setVertexBuffer(buffer, offset: offset, index: index) == false {
+                return
+            }
             encoder.commands.append {
                 (encoder: MTLRenderCommandEncoder, state: inout EncodingState) in
 
@@ -244,6 +274,9 @@ final class MetalRenderCommandEncoder: RenderCommandEncoder {
         assert(self.encoder != nil)
         let count = min(buffers.count, offsets.count)
         if count > 0, let encoder = self.encoder {
+            if encoder.shadowState.setVertexBuffers(buffers, offsets: offsets, index: index) == false {
+                return
+            }
             let buffers: [MTLBuffer?] = buffers[0..<count].map { ($0 as? MetalBuffer)?.buffer }
             let offsets: [Int] = .init(offsets[0..<count])
 
@@ -265,6 +298,9 @@ final class MetalRenderCommandEncoder: RenderCommandEncoder {
             assert(state is MetalDepthStencilState)
             depthStencilState = (state as! MetalDepthStencilState).depthStencilState
         }
+        if self.encoder?.shadowState.setDepthStencilState(state as? MetalDepthStencilState) == false {
+            return
+        }
 
         self.encoder?.commands.append {
             (encoder: MTLRenderCommandEncoder, state: inout EncodingState) in
@@ -294,6 +330,9 @@ final class MetalRenderCommandEncoder: RenderCommandEncoder {
         case .front:    .front
         case .back:     .back
         }
+        if self.encoder?.shadowState.setCullMode(mode) == false {
+            return
+        }
 
         self.encoder?.commands.append {
             (encoder: MTLRenderCommandEncoder, state: inout EncodingState) in
@@ -308,6 +347,9 @@ final class MetalRenderCommandEncoder: RenderCommandEncoder {
         case .clockwise:        .clockwise
         case .counterClockwise: .counterClockwise
         }
+        if self.encoder?.shadowState.setFrontFacing(front) == false {
+            return
+        }
         self.encoder?.commands.append {
             (encoder: MTLRenderCommandEncoder, state: inout EncodingState) in
             encoder.setFrontFacing(frontFacingWinding)
@@ -472,7 +514,9 @@ final class MetalRenderCommandEncoder: RenderCommandEncoder {
 
     func endEncoding() {
         assert(self.encoder != nil)
-        if let commandBuffer = self.commandBuffer as? MetalCommandBuffer,
+        if let parallelEncoder, let encoder = self.encoder {
+            parallelEncoder.endEncoder(encoder, index: self.parallelIndex)
+        } else if let commandBuffer = self.commandBuffer as? MetalCommandBuffer,
            let encoder = self.encoder {
             commandBuffer.endEncoder(encoder)
         }
@@ -14,9 +14,17 @@ final class MetalShaderBindingSet: ShaderBindingSet {
     let device: GraphicsDevice
     let layout: [ShaderBinding]
 
-    var buffers: [Int: Array<(buffer: MetalBuffer, offset: Int)>] = [:]
-    var textures: [Int: Array<MetalTexture>] = [:]
-    var samplers: [Int: Array<MetalSamplerState>] = [:]
+    var buffers: [Int: Array<(buffer: MetalBuffer, offset: Int)>] = [:] {
+        didSet { version &+= 1 }
+    }
+    var textures: [Int: Array<MetalTexture>] = [:] {
+        didSet { version &+= 1 }
+    }
+    var samplers: [Int: Array<MetalSamplerState>] = [:] {
+        didSet { version &+= 1 }
+    }
+    // incremented on every binding update, used to filter redundant binds.
+    private(set) var version: UInt64 = 0
 
     init(device: MetalGraphicsDevice, layout: [ShaderBinding]) {
         self.device = device
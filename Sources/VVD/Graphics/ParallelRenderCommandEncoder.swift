@@ -0,0 +1,17 @@
+//
+//  File: ParallelRenderCommandEncoder.swift
+//  Author: Hongtae Kim (tiff2766@gmail.com)
+//
+//  Copyright (c) 2022-2024 Hongtae Kim. All rights reserved.
+//
+
+// Splits the encoding of a single render pass across threads.
+// Each child encoder can be recorded on its own thread, the child encoders
+// are executed in the order they were created, not the order they ended.
+// A child encoder starts with the default render states, nothing is
+// inherited from the previous child encoder.
+// All child encoders must end their encoding before endEncoding().
+public protocol ParallelRenderCommandEncoder: CommandEncoder {
+    // thread-safe
+    func makeRenderCommandEncoder() -> RenderCommandEncoder?
+}
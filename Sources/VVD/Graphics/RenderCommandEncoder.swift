@@ -109,3 +109,115 @@ public extension RenderCommandEncoder {
                                         height: Int(rect.height)))
     }
 }
+
+// Last state set on a render command encoder.
+// Backends use this to drop binds that would not change anything.
+// Resource bindings are compared by binding-set identity and version,
+// and are invalidated whenever the pipeline state changes. Bound sets are
+// retained, so a freed set cannot be mistaken for a new one at its address.
+// Vertex buffers are invalidated as well if the backend maps vertex
+// buffer indices through the pipeline state (Metal).
+struct RenderCommandEncoderShadowState {
+    struct Statistics {
+        var requested = 0
+        var issued = 0
+        var skipped: Int { requested - issued }
+    }
+    private(set) var statistics = Statistics()
+
+    private var pipelineState: ObjectIdentifier?
+    private var depthStencilState: ObjectIdentifier?
+    private var depthStencilStateSet = false
+    private var cullMode: CullMode?
+    private var frontFace: Winding?
+    private var resources: [(set: AnyObject, version: UInt64)?] = []
+    private var vertexBuffers: [(buffer: ObjectIdentifier, offset: Int)?] = []
+    let vertexBuffersDependOnPipeline: Bool
+
+    init(vertexBuffersDependOnPipeline: Bool = false) {
+        self.vertexBuffersDependOnPipeline = vertexBuffersDependOnPipeline
+    }
+
+    private mutating func update(_ changed: Bool) -> Bool {
+        statistics.requested += 1
+        if changed { statistics.issued += 1 }
+        return changed
+    }
+
+    mutating func setRenderPipelineState(_ pipelineState: AnyObject) -> Bool {
+        let id = ObjectIdentifier(pipelineState)
+        if update(self.pipelineState != id) {
+            self.pipelineState = id
+            self.resources.removeAll(keepingCapacity: true)
+            if vertexBuffersDependOnPipeline {
+                self.vertexBuffers.removeAll(keepingCapacity: true)
+            }
+            return true
+        }
+        return false
+    }
+
+    mutating func setResource(_ bindingSet: AnyObject, version: UInt64, index: Int) -> Bool {
+        if index < resources.count, let current = resources[index],
+           current.set === bindingSet, current.version == version {
+            return update(false)
+        }
+        if index >= resources.count {
+            resources.append(contentsOf: repeatElement(nil, count: index - resources.count + 1))
+        }
+        resources[index] = (bindingSet, version)
+        return update(true)
+    }
+
+    private mutating func updateVertexBuffer(_ buffer: GPUBuffer, offset: Int, index: Int) -> Bool {
+        if index >= vertexBuffers.count {
+            vertexBuffers.append(contentsOf: repeatElement(nil, count: index - vertexBuffers.count + 1))
+        }
+        let id = ObjectIdentifier(buffer)
+        if let current = vertexBuffers[index], current.buffer == id, current.offset == offset {
+            return false
+        }
+        vertexBuffers[index] = (id, offset)
+        return true
+    }
+
+    mutating func setVertexBuffer(_ buffer: GPUBuffer, offset: Int, index: Int) -> Bool {
+        update(updateVertexBuffer(buffer, offset: offset, index: index))
+    }
+
+    mutating func setVertexBuffers(_ buffers: [GPUBuffer], offsets: [Int], index: Int) -> Bool {
+        var changed = false
+        for i in 0..<min(buffers.count, offsets.count) {
+            if updateVertexBuffer(buffers[i], offset: offsets[i], index: index + i) {
+                changed = true
+            }
+        }
+        return update(changed)
+    }
+
+    mutating func setDepthStencilState(_ state: AnyObject?) -> Bool {
+        let id = state.map { ObjectIdentifier($0) }
+        if update(depthStencilStateSet == false || depthStencilState != id) {
+            depthStencilState = id
+            depthStencilStateSet = true
+            return true
+        }
+        return false
+    }
+
+    mutating func setCullMode(_ mode: CullMode) -> Bool {
+        if update(cullMode != mode) {
+            cullMode = mode
+            return true
+        }
+        return false
+    }
+
+    mutating func setFrontFacing(_ winding: Winding) -> Bool {
+        if update(frontFace != winding) {
+            frontFace = winding
+            return true
+        }
+        return false
+    }
+}
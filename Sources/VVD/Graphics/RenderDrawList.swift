@@ -0,0 +1,108 @@
+//
+//  File: RenderDrawList.swift
+//  Author: Hongtae Kim (tiff2766@gmail.com)
+//
+//  Copyright (c) 2022-2024 Hongtae Kim. All rights reserved.
+//
+
+import Foundation
+
+// Collects mesh draws and encodes them ordered by pipeline state,
+// material and vertex/index buffers, so that consecutive draws share
+// as much state as possible and redundant binds can be dropped by the
+// encoder. Submission order is kept for draws with equal keys.
+// Sorting changes draw order, do not use it for blended geometry that
+// must be drawn back-to-front.
+public struct RenderDrawList {
+    public struct Item {
+        public let mesh: Mesh
+        public var numInstances: Int
+        public var baseInstance: Int
+        public var lod: Int
+
+        let key: SortKey
+    }
+
+    struct SortKey: Comparable {
+        var pipeline: ObjectIdentifier?
+        var material: ObjectIdentifier?
+        var vertexBuffer: ObjectIdentifier?
+        var indexBuffer: ObjectIdentifier?
+        var order: Int
+
+        init(mesh: Mesh, lod: Int = 0, order: Int) {
+            self.pipeline = mesh.pipelineState.map { ObjectIdentifier($0 as AnyObject) }
+            self.material = mesh.material.map { ObjectIdentifier($0) }
+            self.vertexBuffer = mesh.vertexBuffers.first.map { ObjectIdentifier($0.buffer) }
+            if lod > 0 && mesh.lods.isEmpty == false {
+                self.indexBuffer = ObjectIdentifier(mesh.lods[min(lod, mesh.lods.count) - 1].indexBuffer)
+            } else {
+                self.indexBuffer = mesh.indexBuffer.map { ObjectIdentifier($0) }
+            }
+            self.order = order
+        }
+
+        static func < (lhs: SortKey, rhs: SortKey) -> Bool {
+            func less(_ a: ObjectIdentifier?, _ b: ObjectIdentifier?) -> Bool? {
+                if a == b { return nil }
+                guard let a else { return true }
+                guard let b else { return false }
+                return a < b
+            }
+            if let r = less(lhs.pipeline, rhs.pipeline) { return r }
+            if let r = less(lhs.material, rhs.material) { return r }
+            if let r = less(lhs.vertexBuffer, rhs.vertexBuffer) { return r }
+            if let r = less(lhs.indexBuffer, rhs.indexBuffer) { return r }
+            return lhs.order < rhs.order
+        }
+    }
+
+    public private(set) var items: [Item] = []
+    public private(set) var isSorted = true
+
+    public var count: Int { items.count }
+    public var isEmpty: Bool { items.isEmpty }
+
+    public init() {
+    }
+
+    public mutating func append(_ mesh: Mesh, numInstances: Int = 1, baseInstance: Int = 0, lod: Int = 0) {
+        let key = SortKey(mesh: mesh, lod: lod, order: items.count)
+        if let last = items.last, key < last.key {
+            isSorted = false
+        }
+        items.append(Item(mesh: mesh,
+                          numInstances: numInstances,
+                          baseInstance: baseInstance,
+                          lod: lod,
+                          key: key))
+    }
+
+    public mutating func removeAll(keepingCapacity: Bool = true) {
+        items.removeAll(keepingCapacity: keepingCapacity)
+        isSorted = true
+    }
+
+    public mutating func sort() {
+        if isSorted == false {
+            items.sort { $0.key < $1.key }
+            isSorted = true
+        }
+    }
+
+    // Sorts and encodes all draws, returns the number of meshes drawn.
+    @discardableResult
+    public mutating func encode(encoder: RenderCommandEncoder) -> Int {
+        self.sort()
+        var drawn = 0
+        for item in items {
+            if item.mesh.encodeRenderCommand(encoder: encoder,
+                                             numInstances: item.numInstances,
+                                             baseInstance: item.baseInstance,
+                                             lod: item.lod) {
+                drawn += 1
+            }
+        }
+        return drawn
+    }
+}
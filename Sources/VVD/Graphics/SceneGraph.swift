@@ -0,0 +1,284 @@
+//
+//  File: SceneGraph.swift
+//  Author: Hongtae Kim (tiff2766@gmail.com)
+//
+//  Copyright (c) 2022-2024 Hongtae Kim. All rights reserved.
+//
+
+import Foundation
+
+// Flattened scene graph, structure of arrays.
+// Nodes are stored in depth-first pre-order: every subtree occupies a
+// contiguous index range [index, index + subtreeSize), and a parent is
+// always stored before its children. World transforms are cached and
+// only recomputed for subtrees whose local transform has changed.
+//
+// As with SceneNode, the node scale is not inherited by children, it is
+// applied to the mesh matrix of the node only.
+public final class SceneGraph {
+    public typealias NodeIndex = Int
+
+    public private(set) var names: [String] = []
+    public private(set) var meshes: [Mesh?] = []
+    public private(set) var parents: [NodeIndex] = []        // -1 for root nodes
+    public private(set) var subtreeSizes: [Int] = []          // including the node itself
+    public private(set) var scales: [Vector3] = []
+    public private(set) var localTransforms: [Transform] = []
+    public private(set) var worldTransforms: [Transform] = []
+    public private(set) var worldMatrices: [Matrix4] = []     // scale applied, for meshes
+
+    private var dirty: [Bool] = []
+    private var dirtyCount = 0
+
+    // subtrees with at least this many nodes are split across threads.
+    public var parallelUpdateThreshold = 4096
+
+    public var count: Int { parents.count }
+    public var isEmpty: Bool { parents.isEmpty }
+
+    public init() {
+    }
+
+    public convenience init(scene: Scene) {
+        self.init(nodes: scene.nodes)
+    }
+
+    public convenience init(nodes: [SceneNode]) {
+        self.init()
+        nodes.forEach { self.append($0, parent: -1) }
+        self.updateWorldTransforms()
+    }
+
+    // appends node and its children as the last subtree of parent.
+    @discardableResult
+    public func insert(_ node: SceneNode, parent: NodeIndex? = nil) -> NodeIndex {
+        let parent = parent ?? -1
+        if parent >= 0 && parent + subtreeSizes[parent] != count {
+            // not at the end of arrays, build separately and splice.
+            let sub = SceneGraph()
+            sub.append(node, parent: -1)
+            return splice(sub, parent: parent)
+        }
+        return append(node, parent: parent)
+    }
+
+    @discardableResult
+    private func append(_ node: SceneNode, parent: NodeIndex) -> NodeIndex {
+        let index = count
+        names.append(node.name)
+        meshes.append(node.mesh)
+        parents.append(parent)
+        subtreeSizes.append(1)
+        scales.append(node.scale)
+        localTransforms.append(node.transform)
+        worldTransforms.append(node.transform)
+        worldMatrices.append(.identity)
+        dirty.append(true)
+        dirtyCount += 1
+
+        var p = parent
+        while p >= 0 {
+            subtreeSizes[p] += 1
+            p = parents[p]
+        }
+        for child in node.children {
+            append(child, parent: index)
+        }
+        return index
+    }
+
+    private func splice(_ sub: SceneGraph, parent: NodeIndex) -> NodeIndex {
+        let at = parent + subtreeSizes[parent]
+        let n = sub.count
+        for i in 0..<count where parents[i] >= at {
+            parents[i] += n
+        }
+        let subParents = sub.parents.map { $0 < 0 ? parent : $0 + at }
+        names.insert(contentsOf: sub.names, at: at)
+        meshes.insert(contentsOf: sub.meshes, at: at)
+        parents.insert(contentsOf: subParents, at: at)
+        subtreeSizes.insert(contentsOf: sub.subtreeSizes, at: at)
+        scales.insert(contentsOf: sub.scales, at: at)
+        localTransforms.insert(contentsOf: sub.localTransforms, at: at)
+        worldTransforms.insert(contentsOf: sub.worldTransforms, at: at)
+        worldMatrices.insert(contentsOf: sub.worldMatrices, at: at)
+        dirty.insert(contentsOf: sub.dirty, at: at)
+        dirtyCount += sub.dirtyCount
+
+        var p = parent
+        while p >= 0 {
+            subtreeSizes[p] += n
+            p = parents[p]
+        }
+        return at
+    }
+
+    public func children(of index: NodeIndex) -> [NodeIndex] {
+        var result: [NodeIndex] = []
+        var child = index + 1
+        let end = index + subtreeSizes[index]
+        while child < end {
+            result.append(child)
+            child += subtreeSizes[child]
+        }
+        return result
+    }
+
+    public func setLocalTransform(_ transform: Transform, at index: NodeIndex) {
+        localTransforms[index] = transform
+        markDirty(index)
+    }
+
+    public func setScale(_ scale: Vector3, at index: NodeIndex) {
+        scales[index] = scale
+        markDirty(index)
+    }
+
+    public func setMesh(_ mesh: Mesh?, at index: NodeIndex) {
+        meshes[index] = mesh
+    }
+
+    private func markDirty(_ index: NodeIndex) {
+        if dirty[index] == false {
+            dirty[index] = true
+            dirtyCount += 1
+        }
+    }
+
+    public var needsUpdate: Bool { dirtyCount > 0 }
+
+    // Recomputes world transforms of dirty subtrees,
+    // returns the number of nodes updated.
+    @discardableResult
+    public func updateWorldTransforms() -> Int {
+        if dirtyCount == 0 { return 0 }
+
+        // top-most dirty subtrees, disjoint ranges.
+        var ranges: [Range<Int>] = []
+        var i = 0
+        let n = count
+        while i < n {
+            if dirty[i] {
+                let end = i + subtreeSizes[i]
+                ranges.append(i..<end)
+                i = end
+            } else {
+                i += 1
+            }
+        }
+        let updated = ranges.reduce(0) { $0 + $1.count }
+
+        let threshold = max(parallelUpdateThreshold, 1)
+        let numThreads = ProcessInfo.processInfo.activeProcessorCount
+        var work: [Range<Int>] = []
+        if numThreads > 1 && updated >= threshold {
+            // split large subtrees: update the root first and
+            // process child subtrees as separate work items.
+            var pending = ranges
+            while let range = pending.popLast() {
+                if range.count < threshold {
+                    work.append(range)
+                    continue
+                }
+                work.append(range.lowerBound..<(range.lowerBound + 1))
+                for child in children(of: range.lowerBound) {
+                    pending.append(child..<(child + subtreeSizes[child]))
+                }
+            }
+        }
+
+        parents.withUnsafeBufferPointer { parents in
+            scales.withUnsafeBufferPointer { scales in
+                localTransforms.withUnsafeBufferPointer { localTransforms in
+                    worldTransforms.withUnsafeMutableBufferPointer { worldTransforms in
+                        worldMatrices.withUnsafeMutableBufferPointer { worldMatrices in
+                            let buffers = UpdateBuffers(parents: parents,
+                                                        scales: scales,
+                                                        localTransforms: localTransforms,
+                                                        worldTransforms: worldTransforms,
+                                                        worldMatrices: worldMatrices)
+                            if work.isEmpty {
+                                ranges.forEach { buffers.update($0) }
+                                return
+                            }
+                            // single node ranges of split roots were appended before
+                            // their children, update them first in order.
+                            var subtrees: [Range<Int>] = []
+                            for range in work {
+                                if range.count == 1 && subtreeSizes[range.lowerBound] >= threshold {
+                                    buffers.update(range)
+                                } else {
+                                    subtrees.append(range)
+                                }
+                            }
+                            // batch work items into roughly equal chunks.
+                            let chunkSize = max(updated / (numThreads * 4), threshold)
+                            var chunks: [[Range<Int>]] = [[]]
+                            var chunkNodes = 0
+                            for range in subtrees {
+                                if chunkNodes >= chunkSize {
+                                    chunks.append([])
+                                    chunkNodes = 0
+                                }
+                                chunks[chunks.count - 1].append(range)
+                                chunkNodes += range.count
+                            }
+                            DispatchQueue.concurrentPerform(iterations: chunks.count) { index in
+                                chunks[index].forEach { buffers.update($0) }
+                            }
+                        }
+                    }
+                }
+            }
+        }
+
+        dirty.withUnsafeMutableBufferPointer { dirty in
+            for range in ranges {
+                dirty[range].update(repeating: false)
+            }
+        }
+        dirtyCount = 0
+        return updated
+    }
+
+    private struct UpdateBuffers {
+        let parents: UnsafeBufferPointer<NodeIndex>
+        let scales: UnsafeBufferPointer<Vector3>
+        let localTransforms: UnsafeBufferPointer<Transform>
+        let worldTransforms: UnsafeMutableBufferPointer<Transform>
+        let worldMatrices: UnsafeMutableBufferPointer<Matrix4>
+
+        // parents of the range must be up to date.
+        func update(_ range: Range<Int>) {
+            for i in range {
+                let parent = parents[i]
+                let world = if parent >= 0 {
+                    localTransforms[i].concatenating(worldTransforms[parent])
+                } else {
+                    localTransforms[i]
+                }
+                worldTransforms[i] = world
+                worldMatrices[i] = SceneGraph.meshMatrix(world, scale: scales[i])
+            }
+        }
+    }
+
+    @inline(__always)
+    static func meshMatrix(_ transform: Transform, scale s: Vector3) -> Matrix4 {
+        let m = transform.orientation.matrix3
+        let p = transform.position
+        return Matrix4(m.m11 * s.x, m.m12 * s.x, m.m13 * s.x, 0.0,
+                       m.m21 * s.y, m.m22 * s.y, m.m23 * s.y, 0.0,
+                       m.m31 * s.z, m.m32 * s.z, m.m33 * s.z, 0.0,
+                       p.x, p.y, p.z, 1.0)
+    }
+
+    public func forEachMesh(_ body: (Mesh, Matrix4) throws -> Void) rethrows {
+        if needsUpdate { updateWorldTransforms() }
+        for i in 0..<count {
+            if let mesh = meshes[i] {
+                try body(mesh, worldMatrices[i])
+            }
+        }
+    }
+}
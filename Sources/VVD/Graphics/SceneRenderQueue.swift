@@ -0,0 +1,225 @@
+//
+//  File: SceneRenderQueue.swift
+//  Author: Hongtae Kim (tiff2766@gmail.com)
+//
+//  Copyright (c) 2022-2024 Hongtae Kim. All rights reserved.
+//
+
+import Foundation
+
+// Collects scene nodes for a frame and groups nodes sharing a mesh into
+// instanced draws. Model matrices of grouped nodes are written to a
+// per-frame instance buffer, bound to the transformMatrixArray resource
+// of the mesh material (see Mesh.supportsInstancing).
+// Meshes whose material does not support instancing are drawn per node,
+// their uniform buffers are written to the per-frame buffer for each draw.
+// If lodSelector is set, the level of detail is selected per node. The
+// levels of a mesh share one instance range and binding, each level is
+// drawn with its own baseInstance, shaders index the transforms with the
+// instance index (gl_InstanceIndex, [[instance_id]]) including it.
+public final class SceneRenderQueue {
+    public struct Statistics {
+        public var nodes = 0
+        public var batches = 0
+        public var drawCalls = 0
+        public var instances = 0
+    }
+
+    struct Batch {
+        let mesh: Mesh
+        let instanced: Bool
+        var levels: [[Matrix4]] = []   // transforms for each level of detail
+        var count = 0
+    }
+
+    public let device: GraphicsDevice
+    public let maxFramesInFlight: Int
+    public private(set) var statistics = Statistics()
+    public var lodSelector: LODSelector?
+
+    static let instanceStride = MemoryLayout<Float4x4>.stride
+    static let instanceBufferAlignment = 256  // minStorageBufferOffsetAlignment
+    static let uniformBufferAlignment = 256   // minUniformBufferOffsetAlignment
+
+    private var batches: [Batch] = []
+    private var batchIndices: [ObjectIdentifier: Int] = [:]
+    private var instanceBuffers: [GPUBuffer?]
+    private var frameIndex = 0
+    private var drawList = RenderDrawList()
+
+    public init(device: GraphicsDevice, maxFramesInFlight: Int = 3) {
+        self.device = device
+        self.maxFramesInFlight = max(maxFramesInFlight, 1)
+        self.instanceBuffers = .init(repeating: nil, count: self.maxFramesInFlight)
+    }
+
+    // Starts a new frame, the instance buffer of the frame that was
+    // submitted maxFramesInFlight frames ago is reused.
+    public func beginFrame() {
+        frameIndex = (frameIndex + 1) % maxFramesInFlight
+        for i in 0..<batches.count {
+            for lod in 0..<batches[i].levels.count {
+                batches[i].levels[lod].removeAll(keepingCapacity: true)
+            }
+            batches[i].count = 0
+        }
+        statistics = Statistics()
+    }
+
+    public func enqueue(scene: Scene, transform: Matrix4 = .identity) {
+        for node in scene.nodes {
+            enqueue(node: node, parentTransform: transform)
+        }
+    }
+
+    // As with SceneGraph, the node scale is applied to the node's mesh only
+    // and is not inherited by children.
+    public func enqueue(node: SceneNode, parentTransform: Matrix4 = .identity) {
+        enqueue(node: node, world: .identity, transform: parentTransform)
+    }
+
+    private func enqueue(node: SceneNode, world parent: Transform, transform: Matrix4) {
+        let world = node.transform.concatenating(parent)
+        if let mesh = node.mesh {
+            let model = SceneGraph.meshMatrix(world, scale: node.scale)
+            enqueue(mesh: mesh, transform: model.concatenating(transform))
+        }
+        for child in node.children {
+            enqueue(node: child, world: world, transform: transform)
+        }
+    }
+
+    // Updates dirty world transforms of the graph and enqueues its meshes.
+    public func enqueue(sceneGraph: SceneGraph, transform: Matrix4 = .identity) {
+        let isIdentity = transform == .identity
+        sceneGraph.forEachMesh { mesh, model in
+            enqueue(mesh: mesh,
+                    transform: isIdentity ? model : model.concatenating(transform))
+        }
+    }
+
+    public func enqueue(mesh: Mesh, transform: Matrix4) {
+        let lod = lodSelector?.lod(for: mesh, transform: transform) ?? 0
+        let key = ObjectIdentifier(mesh)
+        let index: Int
+        if let i = batchIndices[key] {
+            index = i
+        } else {
+            index = batches.count
+            batchIndices[key] = index
+            batches.append(Batch(mesh: mesh, instanced: mesh.supportsInstancing))
+        }
+        if batches[index].levels.count <= lod {
+            batches[index].levels.append(contentsOf:
+                Array(repeating: [], count: lod - batches[index].levels.count + 1))
+        }
+        batches[index].levels[lod].append(transform)
+        batches[index].count += 1
+        statistics.nodes += 1
+    }
+
+    // Removes cached batches of meshes that are no longer in use.
+    public func removeAll() {
+        batches.removeAll()
+        batchIndices.removeAll()
+        statistics = Statistics()
+    }
+
+    private func instanceBuffer(length: Int) -> GPUBuffer? {
+        if let buffer = instanceBuffers[frameIndex], buffer.length >= length {
+            return buffer
+        }
+        let length = max(length, (instanceBuffers[frameIndex]?.length ?? 0) * 2)
+        let buffer = device.makeBuffer(length: length,
+                                       storageMode: .shared,
+                                       cpuCacheMode: .writeCombined)
+        if buffer == nil {
+            Log.error("SceneRenderQueue: failed to make instance buffer with length \(length)")
+        }
+        instanceBuffers[frameIndex] = buffer
+        return buffer
+    }
+
+    @discardableResult
+    public func encode(encoder: RenderCommandEncoder, sceneState: SceneState) -> Statistics {
+        let instanceBufferLength = batches.reduce(0) { length, batch in
+            if batch.instanced == false || batch.count == 0 { return length }
+            return length + (batch.count * Self.instanceStride)
+                .alignedUp(toMultipleOf: Self.instanceBufferAlignment)
+        }
+        let uniformBufferLength = batches.reduce(0) { length, batch in
+            if batch.instanced || batch.count == 0 { return length }
+            return length + batch.count * batch.mesh
+                .uniformBufferLength(alignment: Self.uniformBufferAlignment)
+        }
+
+        var buffer: GPUBuffer? = nil
+        var contents: UnsafeMutableRawPointer? = nil
+        if instanceBufferLength + uniformBufferLength > 0 {
+            buffer = instanceBuffer(length: instanceBufferLength + uniformBufferLength)
+            contents = buffer?.contents()
+        }
+
+        // instanced batches: upload transforms of all levels, update shading
+        // properties once per mesh, then draw sorted by pipeline and material.
+        var offset = 0
+        var state = sceneState
+        state.model = .identity
+        drawList.removeAll()
+        for batch in batches where batch.instanced && batch.count > 0 {
+            guard let buffer, let contents else { break }
+            let length = batch.count * Self.instanceStride
+            let p = contents + offset
+            var baseInstance = 0
+            for (lod, transforms) in batch.levels.enumerated() where transforms.isEmpty == false {
+                for (i, transform) in transforms.enumerated() {
+                    p.storeBytes(of: transform.float4x4,
+                                 toByteOffset: (baseInstance + i) * Self.instanceStride,
+                                 as: Float4x4.self)
+                }
+                drawList.append(batch.mesh,
+                                numInstances: transforms.count,
+                                baseInstance: baseInstance,
+                                lod: lod)
+                baseInstance += transforms.count
+                statistics.batches += 1
+            }
+            batch.mesh.instanceTransforms = BufferBindingInfo(buffer: buffer,
+                                                              offset: offset,
+                                                              length: length)
+            batch.mesh.updateShadingProperties(sceneState: state)
+            batch.mesh.instanceTransforms = nil
+
+            statistics.instances += batch.count
+            offset += length.alignedUp(toMultipleOf: Self.instanceBufferAlignment)
+        }
+        statistics.drawCalls += drawList.encode(encoder: encoder)
+
+        // meshes without instancing support, one draw per node, each with
+        // its own region of the buffer for the uniforms.
+        offset = instanceBufferLength
+        let uniformBufferAllocator = { (length: Int) -> BufferBindingInfo? in
+            guard let buffer, offset + length <= buffer.length else { return nil }
+            let region = BufferBindingInfo(buffer: buffer, offset: offset, length: length)
+            offset += length.alignedUp(toMultipleOf: Self.uniformBufferAlignment)
+            return region
+        }
+        for batch in batches where batch.instanced == false {
+            batch.mesh.uniformBufferAllocator = uniformBufferAllocator
+            for (lod, transforms) in batch.levels.enumerated() where transforms.isEmpty == false {
+                for transform in transforms {
+                    state.model = transform
+                    batch.mesh.updateShadingProperties(sceneState: state)
+                    if batch.mesh.encodeRenderCommand(encoder: encoder, lod: lod) {
+                        statistics.drawCalls += 1
+                    }
+                    statistics.instances += 1
+                }
+                statistics.batches += 1
+            }
+            batch.mesh.uniformBufferAllocator = nil
+        }
+        buffer?.flush()
+        return statistics
+    }
+}
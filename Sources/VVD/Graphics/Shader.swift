@@ -33,6 +33,10 @@ public struct ShaderDescriptor {
     public var type : ShaderDescriptorType
 }
 
+extension ShaderAttribute: Codable {}
+extension ShaderDescriptorType: Codable {}
+extension ShaderDescriptor: Codable {}
+
 private func dataTypeFromSPVC(type: spvc_type?) -> ShaderDataType {
 
     let basetype = spvc_type_get_basetype(type)
@@ -408,9 +412,74 @@ public class Shader: CustomStringConvertible {
         }
     }
 
+    // reflection results keyed by the SHA256 of the SPIR-V,
+    // set to nil to reflect every shader.
+    // the identity changes with the layout of Reflection.
+    nonisolated(unsafe) public static var reflectionCache: DiskCache? =
+        DiskCache(name: "ShaderReflection", identity: Data("Shader.Reflection.1".utf8))
+
+    struct Reflection: Codable {
+        var stage: ShaderStage
+        var functionNames: [String]
+        var inputAttributes: [ShaderAttribute]
+        var outputAttributes: [ShaderAttribute]
+        var resources: [ShaderResource]
+        var pushConstantLayouts: [ShaderPushConstantLayout]
+        var descriptors: [ShaderDescriptor]
+        var threadgroupSize: [Int]
+    }
+
+    var reflection: Reflection {
+        Reflection(stage: self.stage,
+                   functionNames: self.functionNames,
+                   inputAttributes: self.inputAttributes,
+                   outputAttributes: self.outputAttributes,
+                   resources: self.resources,
+                   pushConstantLayouts: self.pushConstantLayouts,
+                   descriptors: self.descriptors,
+                   threadgroupSize: [self.threadgroupSize.x, self.threadgroupSize.y, self.threadgroupSize.z])
+    }
+
+    func apply(_ reflection: Reflection) -> Bool {
+        guard reflection.stage != .unknown, reflection.threadgroupSize.count == 3 else { return false }
+        self.stage = reflection.stage
+        self.functionNames = reflection.functionNames
+        self.inputAttributes = reflection.inputAttributes
+        self.outputAttributes = reflection.outputAttributes
+        self.resources = reflection.resources
+        self.pushConstantLayouts = reflection.pushConstantLayouts
+        self.descriptors = reflection.descriptors
+        self.threadgroupSize = (reflection.threadgroupSize[0],
+                                reflection.threadgroupSize[1],
+                                reflection.threadgroupSize[2])
+        return true
+    }
+
     public func compile(data: Data) -> Bool {
         guard data.count > 0 else { return false }
 
+        guard let cache = Self.reflectionCache else {
+            return reflect(data: data)
+        }
+        let key = SHA256.hash(data: data).string
+        if let cached = cache.data(forKey: key),
+           let reflection = try? PropertyListDecoder().decode(Reflection.self, from: cached),
+           self.apply(reflection) {
+            self.spirvData = data
+            return true
+        }
+        if reflect(data: data) == false {
+            return false
+        }
+        let encoder = PropertyListEncoder()
+        encoder.outputFormat = .binary
+        if let encoded = try? encoder.encode(self.reflection) {
+            cache.setData(encoded, forKey: key)
+        }
+        return true
+    }
+
+    private func reflect(data: Data) -> Bool {
         class SPVCErrorCallback {
             var message: String = String()
         }
@@ -373,3 +373,16 @@ extension ShaderResource: CustomStringConvertible {
         return str
     }
 }
+
+// reflection results are stored in the shader cache (Shader.reflectionCache)
+extension ShaderDataType: Codable {}
+extension ShaderStage: Codable {}
+extension ShaderStageFlags: Codable {}
+extension ShaderResourceBuffer: Codable {}
+extension ShaderResourceTexture: Codable {}
+extension ShaderResourceThreadgroup: Codable {}
+extension ShaderResourceStructMember: Codable {}
+extension ShaderResourceType: Codable {}
+extension ShaderResourceAccess: Codable {}
+extension ShaderResource: Codable {}
+extension ShaderPushConstantLayout: Codable {}
@@ -0,0 +1,358 @@
+//
+//  File: TLSFAllocator.swift
+//  Author: Hongtae Kim (tiff2766@gmail.com)
+//
+//  Copyright (c) 2022-2024 Hongtae Kim. All rights reserved.
+//
+
+import Foundation
+
+// Two-level segregated fit allocator
+// (Masmano, Ripoll, Crespo, Real: TLSF: a New Dynamic Memory Allocator for Real-Time Systems).
+// Manages offsets in a heap of a fixed size, the backing memory is owned
+// by the caller (device memory of a VulkanMemoryChunk, or a plain buffer).
+// Free blocks are kept in segregated lists found through two bitmaps,
+// so that alloc and free are O(1). Adjacent free blocks are merged on free.
+// Linear and optimal resources never share a page of granularity bytes
+// (see VkPhysicalDeviceLimits.bufferImageGranularity).
+struct TLSFAllocator {
+    enum ResourceKind: UInt8 {
+        case free
+        case linear     // buffers, linear tiling images
+        case optimal    // optimal tiling images
+    }
+
+    struct Allocation: Hashable {
+        let offset: UInt64
+        let size: UInt64
+        let block: Int32
+    }
+
+    struct Statistics {
+        var size: UInt64 = 0
+        var requestedSize: UInt64 = 0       // sum of requested sizes
+        var allocatedSize: UInt64 = 0       // sum of allocated blocks
+        var freeSize: UInt64 = 0
+        var largestFreeBlock: UInt64 = 0
+        var numAllocations = 0
+        var numFreeBlocks = 0
+
+        // memory lost to rounding of allocations, 0...1
+        var internalFragmentation: Double {
+            allocatedSize > 0 ? 1.0 - Double(requestedSize) / Double(allocatedSize) : 0
+        }
+        // free memory not available to a single allocation, 0...1
+        var externalFragmentation: Double {
+            freeSize > 0 ? 1.0 - Double(largestFreeBlock) / Double(freeSize) : 0
+        }
+
+        static func + (lhs: Statistics, rhs: Statistics) -> Statistics {
+            Statistics(size: lhs.size + rhs.size,
+                       requestedSize: lhs.requestedSize + rhs.requestedSize,
+                       allocatedSize: lhs.allocatedSize + rhs.allocatedSize,
+                       freeSize: lhs.freeSize + rhs.freeSize,
+                       largestFreeBlock: max(lhs.largestFreeBlock, rhs.largestFreeBlock),
+                       numAllocations: lhs.numAllocations + rhs.numAllocations,
+                       numFreeBlocks: lhs.numFreeBlocks + rhs.numFreeBlocks)
+        }
+    }
+
+    struct Block {
+        var offset: UInt64
+        var size: UInt64
+        var requested: UInt64 = 0
+        var kind: ResourceKind = .free
+        var prevPhysical: Int32 = -1
+        var nextPhysical: Int32 = -1
+        var prevFree: Int32 = -1
+        var nextFree: Int32 = -1
+    }
+
+    // every block size and offset is a multiple of minAlignment.
+    static let minAlignment: UInt64 = 8
+    static let slCountLog2 = 5
+    static let slCount = 1 << slCountLog2
+    // sizes below smallBlockSize are mapped linearly into the first level.
+    static let flShift = 8
+    static let smallBlockSize: UInt64 = 1 << UInt64(flShift)
+    static let flCount = 64 - flShift + 1
+
+    let size: UInt64
+    let granularity: UInt64
+
+    private var blocks: [Block] = []
+    private var unusedBlocks: [Int32] = []
+    private var firstBlock: Int32 = -1
+    private var heads: [Int32]
+    private var flBitmap: UInt64 = 0
+    private var slBitmaps: [UInt32]
+
+    private(set) var requestedSize: UInt64 = 0
+    private(set) var allocatedSize: UInt64 = 0
+    private(set) var numAllocations = 0
+    private(set) var numFreeBlocks = 0
+
+    var isEmpty: Bool { numAllocations == 0 }
+
+    init(size: UInt64, granularity: UInt64 = 1) {
+        assert(granularity > 0 && granularity & (granularity - 1) == 0)
+        self.size = size / Self.minAlignment * Self.minAlignment
+        self.granularity = granularity
+        self.heads = .init(repeating: -1, count: Self.flCount * Self.slCount)
+        self.slBitmaps = .init(repeating: 0, count: Self.flCount)
+        if self.size > 0 {
+            firstBlock = newBlock(Block(offset: 0, size: self.size))
+            insertFree(firstBlock)
+        }
+    }
+
+    static func alignUp(_ value: UInt64, _ alignment: UInt64) -> UInt64 {
+        (value + alignment - 1) & ~(alignment - 1)
+    }
+
+    static func mapping(_ size: UInt64) -> (fl: Int, sl: Int) {
+        if size < smallBlockSize {
+            return (0, Int(size / (smallBlockSize / UInt64(slCount))))
+        }
+        let log2 = 63 - size.leadingZeroBitCount
+        let sl = Int(size >> UInt64(log2 - slCountLog2)) ^ slCount
+        return (log2 - flShift + 1, sl)
+    }
+
+    // rounds up to the next list, any block of the list found is large enough.
+    static func mappingSearch(_ size: UInt64) -> (fl: Int, sl: Int) {
+        if size < smallBlockSize {
+            return mapping(alignUp(size, smallBlockSize / UInt64(slCount)))
+        }
+        let log2 = 63 - size.leadingZeroBitCount
+        let round = (UInt64(1) << UInt64(log2 - slCountLog2)) - 1
+        return mapping(size + round)
+    }
+
+    private mutating func newBlock(_ block: Block) -> Int32 {
+        if let index = unusedBlocks.popLast() {
+            blocks[Int(index)] = block
+            return index
+        }
+        blocks.append(block)
+        return Int32(blocks.count - 1)
+    }
+
+    private mutating func insertFree(_ index: Int32) {
+        let (fl, sl) = Self.mapping(blocks[Int(index)].size)
+        let list = fl * Self.slCount + sl
+        let head = heads[list]
+        blocks[Int(index)].kind = .free
+        blocks[Int(index)].prevFree = -1
+        blocks[Int(index)].nextFree = head
+        if head >= 0 { blocks[Int(head)].prevFree = index }
+        heads[list] = index
+        flBitmap |= UInt64(1) << UInt64(fl)
+        slBitmaps[fl] |= UInt32(1) << UInt32(sl)
+        numFreeBlocks += 1
+    }
+
+    private mutating func removeFree(_ index: Int32) {
+        let block = blocks[Int(index)]
+        if block.prevFree >= 0 {
+            blocks[Int(block.prevFree)].nextFree = block.nextFree
+        } else {
+            let (fl, sl) = Self.mapping(block.size)
+            let list = fl * Self.slCount + sl
+            assert(heads[list] == index)
+            heads[list] = block.nextFree
+            if block.nextFree < 0 {
+                slBitmaps[fl] &= ~(UInt32(1) << UInt32(sl))
+                if slBitmaps[fl] == 0 {
+                    flBitmap &= ~(UInt64(1) << UInt64(fl))
+                }
+            }
+        }
+        if block.nextFree >= 0 {
+            blocks[Int(block.nextFree)].prevFree = block.prevFree
+        }
+        numFreeBlocks -= 1
+    }
+
+    // head of the first non-empty list at or above (fl, sl).
+    private func findFree(_ fl: Int, _ sl: Int) -> Int32? {
+        if fl >= Self.flCount { return nil }
+        var fl = fl
+        var slMap = slBitmaps[fl] & (~UInt32(0) << UInt32(sl))
+        if slMap == 0 {
+            if fl + 1 >= Self.flCount { return nil }
+            let flMap = flBitmap & (~UInt64(0) << UInt64(fl + 1))
+            if flMap == 0 { return nil }
+            fl = flMap.trailingZeroBitCount
+            slMap = slBitmaps[fl]
+        }
+        return heads[fl * Self.slCount + slMap.trailingZeroBitCount]
+    }
+
+    private func conflicts(_ a: ResourceKind, _ b: ResourceKind) -> Bool {
+        a != .free && b != .free && a != b
+    }
+
+    // aligned offset of an allocation in the free block,
+    // nil if it does not fit or shares a page with a conflicting neighbor.
+    private func placement(_ index: Int32, size: UInt64, alignment: UInt64, kind: ResourceKind) -> UInt64? {
+        let block = blocks[Int(index)]
+        var offset = Self.alignUp(block.offset, alignment)
+        if granularity > 1 && block.prevPhysical >= 0 {
+            let prev = blocks[Int(block.prevPhysical)]
+            if conflicts(prev.kind, kind) && (prev.offset + prev.size - 1) / granularity == offset / granularity {
+                offset = Self.alignUp(offset, granularity)
+            }
+        }
+        let end = offset + size
+        if end > block.offset + block.size { return nil }
+        if granularity > 1 && block.nextPhysical >= 0 {
+            let next = blocks[Int(block.nextPhysical)]
+            if conflicts(kind, next.kind) && (end - 1) / granularity == next.offset / granularity {
+                return nil
+            }
+        }
+        return offset
+    }
+
+    mutating func alloc(size requested: UInt64, alignment: UInt64 = 1, kind: ResourceKind = .linear) -> Allocation? {
+        assert(kind != .free)
+        assert(alignment & (alignment - 1) == 0)
+        guard requested > 0 else { return nil }
+        let alignment = max(alignment, Self.minAlignment)
+        let size = Self.alignUp(requested, Self.minAlignment)
+        if size > self.size { return nil }
+
+        // any block of the first list fits with the alignment padding.
+        // blocks of the second list also fit with the granularity padding.
+        // the last list is for a block that fits only if already aligned.
+        var found: (index: Int32, offset: UInt64)? = nil
+        search: for pass in 0..<3 {
+            var padding: UInt64 = 0
+            switch pass {
+            case 0:
+                padding = alignment - Self.minAlignment
+            case 1:
+                if granularity == 1 { continue search }
+                padding = max(alignment, granularity) * 2
+            default:
+                if alignment == Self.minAlignment && granularity == 1 { break search }
+            }
+            let (fl, sl) = Self.mappingSearch(size + padding)
+            if let index = findFree(fl, sl),
+               let offset = placement(index, size: size, alignment: alignment, kind: kind) {
+                found = (index, offset)
+                break
+            }
+        }
+        guard let found else { return nil }
+        let index = found.index, offset = found.offset
+
+        removeFree(index)
+        let i = Int(index)
+        // leading padding stays free.
+        if offset > blocks[i].offset {
+            let padding = newBlock(Block(offset: blocks[i].offset,
+                                         size: offset - blocks[i].offset,
+                                         prevPhysical: blocks[i].prevPhysical,
+                                         nextPhysical: index))
+            if blocks[i].prevPhysical >= 0 {
+                blocks[Int(blocks[i].prevPhysical)].nextPhysical = padding
+            } else {
+                firstBlock = padding
+            }
+            blocks[i].prevPhysical = padding
+            blocks[i].size -= offset - blocks[i].offset
+            blocks[i].offset = offset
+            insertFree(padding)
+        }
+        // split the remainder.
+        if blocks[i].size > size {
+            let remainder = newBlock(Block(offset: offset + size,
+                                           size: blocks[i].size - size,
+                                           prevPhysical: index,
+                                           nextPhysical: blocks[i].nextPhysical))
+            if blocks[i].nextPhysical >= 0 {
+                blocks[Int(blocks[i].nextPhysical)].prevPhysical = remainder
+            }
+            blocks[i].nextPhysical = remainder
+            blocks[i].size = size
+            insertFree(remainder)
+        }
+        blocks[i].kind = kind
+        blocks[i].requested = requested
+
+        requestedSize += requested
+        allocatedSize += size
+        numAllocations += 1
+        return Allocation(offset: offset, size: requested, block: index)
+    }
+
+    mutating func free(_ allocation: Allocation) {
+        var index = allocation.block
+        assert(blocks[Int(index)].kind != .free, "double free")
+        assert(blocks[Int(index)].offset == allocation.offset)
+
+        requestedSize -= blocks[Int(index)].requested
+        allocatedSize -= blocks[Int(index)].size
+        numAllocations -= 1
+        blocks[Int(index)].requested = 0
+        blocks[Int(index)].kind = .free
+
+        let prev = blocks[Int(index)].prevPhysical
+        if prev >= 0 && blocks[Int(prev)].kind == .free {
+            removeFree(prev)
+            let next = blocks[Int(index)].nextPhysical
+            blocks[Int(prev)].size += blocks[Int(index)].size
+            blocks[Int(prev)].nextPhysical = next
+            if next >= 0 { blocks[Int(next)].prevPhysical = prev }
+            unusedBlocks.append(index)
+            index = prev
+        }
+        let next = blocks[Int(index)].nextPhysical
+        if next >= 0 && blocks[Int(next)].kind == .free {
+            removeFree(next)
+            let nextNext = blocks[Int(next)].nextPhysical
+            blocks[Int(index)].size += blocks[Int(next)].size
+            blocks[Int(index)].nextPhysical = nextNext
+            if nextNext >= 0 { blocks[Int(nextNext)].prevPhysical = index }
+            unusedBlocks.append(next)
+        }
+        insertFree(index)
+    }
+
+    var largestFreeBlock: UInt64 {
+        if flBitmap == 0 { return 0 }
+        let fl = 63 - flBitmap.leadingZeroBitCount
+        let sl = 31 - slBitmaps[fl].leadingZeroBitCount
+        var largest: UInt64 = 0
+        var index = heads[fl * Self.slCount + sl]
+        while index >= 0 {
+            largest = max(largest, blocks[Int(index)].size)
+            index = blocks[Int(index)].nextFree
+        }
+        return largest
+    }
+
+    var statistics: Statistics {
+        Statistics(size: size,
+                   requestedSize: requestedSize,
+                   allocatedSize: allocatedSize,
+                   freeSize: size - allocatedSize,
+                   largestFreeBlock: largestFreeBlock,
+                   numAllocations: numAllocations,
+                   numFreeBlocks: numFreeBlocks)
+    }
+
+    // allocated blocks in address order.
+    func forEachAllocation(_ body: (Allocation, ResourceKind) throws -> Void) rethrows {
+        var index = firstBlock
+        while index >= 0 {
+            let block = blocks[Int(index)]
+            if block.kind != .free {
+                try body(Allocation(offset: block.offset, size: block.requested, block: index), block.kind)
+            }
+            index = block.nextPhysical
+        }
+    }
+}
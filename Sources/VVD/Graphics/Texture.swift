@@ -82,3 +82,5 @@ public struct TextureDescriptor {
         self.usage = usage
     }
 }
+
+extension TextureType: Codable {}
@@ -63,7 +63,7 @@ public class TextureFont: Font {
         var offset: CGFloat = 0.0
         var c1 = UnicodeScalar(UInt8(0))
         for c2 in text.unicodeScalars {
-            if let glyph = self.glyphData(for: c2) {
+            if let glyph = self.loadGlyphData(for: c2) {
                 if offset > 0.0 {
                     let posMin = CGPoint(x: offset + glyph.offset.x,
                                          y: glyph.offset.y - glyph.frame.height)
@@ -88,6 +88,8 @@ public class TextureFont: Font {
             }
             c1 = c2
         }
+        self.deviceContext.uploadManager?.flush()
+
         let size = CGSize(width: ceil(bboxMax.x - bboxMin.x), height: ceil(bboxMax.y - bboxMin.y))
         return CGRect(x: bboxMin.x,
                       y: self.ascender - bboxMax.y, // adjust coordinates from baseline to bitmap
@@ -96,6 +98,14 @@ public class TextureFont: Font {
     }
 
     public func glyphData(for c: UnicodeScalar) -> GlyphData? {
+        let glyph = self.loadGlyphData(for: c)
+        self.deviceContext.uploadManager?.flush()
+        return glyph
+    }
+
+    // the texture upload of a newly loaded glyph is pending
+    // until the upload manager of the device context is flushed.
+    func loadGlyphData(for c: UnicodeScalar) -> GlyphData? {
         if c.value == 0 { return nil }
         var cachedData = self.withFaceLock { self.glyphMap[c] }
         if let cachedData {
@@ -137,38 +147,20 @@ public class TextureFont: Font {
         let height = Int(height)
 
         let device = deviceContext.device
-        let queue = deviceContext.copyQueue()!
+        let uploadManager = deviceContext.uploadManager!
         var texture: Texture? = nil
 
-        let updateTexture = { (queue: CommandQueue, texture: Texture, rect: CGRect, data: UnsafePointer<UInt8>) in
+        // glyph uploads are batched, submitted by the caller.
+        let updateTexture = { (texture: Texture, rect: CGRect, data: UnsafePointer<UInt8>) in
             let x = Int(rect.minX.rounded())
             let y = Int(rect.minY.rounded())
             let width = Int(rect.width.rounded())
             let height = Int(rect.height.rounded())
 
-            let bufferLength = width * height
-
-            let device = queue.device
-            if let stagingBuffer = device.makeBuffer(length: bufferLength, storageMode: .shared, cpuCacheMode: .writeCombined) {
-                let buff = stagingBuffer.contents()!
-
-                for i in 0..<height {
-                    let src = data.advanced(by: i * width)
-                    let dst = buff.advanced(by: i * width)
-
-                    dst.copyMemory(from: src, byteCount: width)
-                }
-
-                let cb = queue.makeCommandBuffer()!
-                let encoder = cb.makeCopyCommandEncoder()!
-                encoder.copy(from: stagingBuffer,
-                             sourceOffset: BufferImageOrigin(offset: 0, imageWidth: width, imageHeight: height),
-                             to: texture,
-                             destinationOffset: TextureOrigin(layer: 0, level: 0, x: x, y: y, z: 0),
-                             size: TextureSize(width: width, height: height, depth: 1))
-                encoder.endEncoding()
-                cb.commit()
-            }
+            uploadManager.upload(UnsafeRawBufferPointer(start: data, count: width * height),
+                                 to: texture,
+                                 origin: TextureOrigin(layer: 0, level: 0, x: x, y: y, z: 0),
+                                 size: TextureSize(width: width, height: height, depth: 1))
         }
 
         let haveEnoughSpace = { (atlas: GlyphTextureAtlas, width: Int, height: Int) -> Bool in
@@ -210,7 +202,7 @@ public class TextureFont: Font {
                                y: gta.filledVertical + topMargin,
                                width: width,
                                height: height)
-                updateTexture(queue, gta.texture, frame, data)
+                updateTexture(gta.texture, frame, data)
 
                 gta.currentLineWidth += width + hPadding
                 if (height + vPadding > gta.currentLineMaxHeight) {
@@ -278,7 +270,7 @@ public class TextureFont: Font {
                                y: CGFloat(topMargin),
                                width: CGFloat(width),
                                height: CGFloat(height))
-                updateTexture(queue, texture, frame, data)
+                updateTexture(texture, frame, data)
 
                 let gta = GlyphTextureAtlas(
                     texture: texture,
@@ -328,7 +320,7 @@ public extension TextureFont {
         var c1 = UnicodeScalar(UInt8(0)) 
         for c2 in str {
             // get glyph info from font object
-            if let glyph = self.glyphData(for: c2) {
+            if let glyph = self.loadGlyphData(for: c2) {
                 let posMin = Vector2(Scalar(glyph.offset.x + offset), Scalar(glyph.offset.y))
                 let posMax = Vector2(Scalar(glyph.frame.width), Scalar(glyph.frame.height)) + posMin
 
@@ -370,6 +362,9 @@ public extension TextureFont {
             }
             c1 = c2
         }
+        // submit the glyphs loaded for the text at once.
+        self.deviceContext.uploadManager?.flush()
+
         if let bbox = boundingBox {
             bbox.pointee = CGRect(x: CGFloat(bboxMin.x),
                                   y: CGFloat(bboxMin.y),
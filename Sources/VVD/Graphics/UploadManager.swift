@@ -0,0 +1,451 @@
+//
+//  File: UploadManager.swift
+//  Author: Hongtae Kim (tiff2766@gmail.com)
+//
+//  Copyright (c) 2022-2024 Hongtae Kim. All rights reserved.
+//
+
+import Foundation
+
+// Uploads of buffer and texture data through a persistent staging ring.
+// Uploads are recorded into one copy encoder and submitted together with
+// flush(), or when the ring runs out of space. The ring space of a batch
+// is reused after its command buffer has completed.
+// Uploads larger than half of the ring use a dedicated staging buffer.
+//
+// With a destination queue, the uploaded resources are handed off to it:
+// the batch releases their queue ownership and signals a timeline semaphore,
+// a command buffer of the destination queue waits for it and acquires them.
+// Uploads on a dedicated transfer queue overlap with rendering this way.
+public final class UploadManager: @unchecked Sendable {
+
+    public final class Future: @unchecked Sendable {
+        private var completed = false
+        private var handlers: [() -> Void] = []
+        private let condition = NSCondition()
+        fileprivate weak var manager: UploadManager?
+
+        fileprivate init(manager: UploadManager) {
+            self.manager = manager
+        }
+
+        public var isCompleted: Bool {
+            self.condition.withLock { self.completed }
+        }
+
+        // waits until the GPU has finished the copies of the batch,
+        // the batch is submitted if it is still pending.
+        @discardableResult
+        public func wait(timeout: Double = .infinity) -> Bool {
+            if self.isCompleted { return true }
+            self.manager?.submit(self)
+
+            let deadline = timeout.isFinite ? Date(timeIntervalSinceNow: timeout) : .distantFuture
+            self.condition.lock()
+            defer { self.condition.unlock() }
+            while self.completed == false {
+                if self.condition.wait(until: deadline) == false {
+                    return self.completed
+                }
+            }
+            return true
+        }
+
+        // resumes after the GPU has finished the copies of the batch,
+        // the batch is submitted if it is still pending.
+        public func completed() async {
+            if self.isCompleted { return }
+            self.manager?.submit(self)
+            await withCheckedContinuation { continuation in
+                self.notify { continuation.resume() }
+            }
+        }
+
+        // the handler is called after completion, from the completion
+        // thread or immediately if the batch has already completed.
+        public func notify(_ handler: @escaping () -> Void) {
+            let completed = self.condition.withLock {
+                if self.completed { return true }
+                self.handlers.append(handler)
+                return false
+            }
+            if completed { handler() }
+        }
+
+        fileprivate func complete() {
+            let handlers = self.condition.withLock {
+                self.completed = true
+                self.condition.broadcast()
+                defer { self.handlers.removeAll() }
+                return self.handlers
+            }
+            handlers.forEach { $0() }
+        }
+    }
+
+    public struct Statistics {
+        public var submissions: UInt64 = 0
+        public var uploads: UInt64 = 0
+        public var bytes: UInt64 = 0
+        public var stalls: UInt64 = 0           // waits for free ring space
+        public var dedicatedBuffers: UInt64 = 0 // uploads too large for the ring
+    }
+
+    private enum Destination {
+        case buffer(GPUBuffer)
+        case texture(Texture)
+    }
+
+    private struct Batch {
+        let commandBuffer: CommandBuffer
+        let encoder: CopyCommandEncoder
+        let future: Future
+        var stagingBuffers: [GPUBuffer] = []
+        // resources to hand off to the destination queue.
+        var destinations: [ObjectIdentifier: Destination] = [:]
+    }
+
+    public let queue: CommandQueue
+    public let destinationQueue: CommandQueue?
+    public let ringSize: Int
+
+    private let handoffSemaphore: GPUSemaphore?
+    private var handoffValue: UInt64 = 0
+
+    private let ring: GPUBuffer
+    private let ringMemory: UnsafeMutableRawPointer
+    // monotonic offsets, the ring space in use is tail..<head.
+    private var head = 0
+    private var tail = 0
+    private var batch: Batch?
+    private var numBatchesInFlight = 0
+    private var _statistics = Statistics()
+    private let condition = NSCondition()
+
+    // offsets of the staged data, valid for buffer-to-texture copies
+    // of all pixel formats the ring is used for.
+    private static let alignment = 16
+
+    public var statistics: Statistics {
+        self.condition.withLock { self._statistics }
+    }
+
+    public init?(queue: CommandQueue, destinationQueue: CommandQueue? = nil, ringSize: Int = 16 << 20) {
+        if destinationQueue != nil {
+            guard let semaphore = queue.device.makeSemaphore() else {
+                Log.err("UploadManager: failed to create semaphore.")
+                return nil
+            }
+            self.handoffSemaphore = semaphore
+        } else {
+            self.handoffSemaphore = nil
+        }
+        guard let ring = queue.device.makeBuffer(length: ringSize,
+                                                 storageMode: .shared,
+                                                 cpuCacheMode: .writeCombined),
+              let memory = ring.contents() else {
+            Log.err("UploadManager: failed to create staging buffer of \(ringSize) bytes.")
+            return nil
+        }
+        self.queue = queue
+        self.destinationQueue = destinationQueue
+        self.ringSize = ringSize
+        self.ring = ring
+        self.ringMemory = memory
+    }
+
+    deinit {
+        if let batch = self.batch {
+            Log.warn("UploadManager: pending uploads are submitted on deinit.")
+            let ring = self.ring
+            let stagingBuffers = batch.stagingBuffers
+            let future = batch.future
+            batch.encoder.endEncoding()
+            ring.flush()
+            batch.commandBuffer.addCompletedHandler { _ in
+                withExtendedLifetime((ring, stagingBuffers)) {
+                    future.complete()
+                }
+            }
+            batch.commandBuffer.commit()
+        }
+    }
+
+    @discardableResult
+    public func upload(_ data: UnsafeRawBufferPointer, to buffer: GPUBuffer, offset: Int = 0) -> Future? {
+        if data.count == 0 { return nil }
+        if offset < 0 || offset + data.count > buffer.length {
+            Log.err("UploadManager.upload: range exceeds the buffer length.")
+            return nil
+        }
+        return self.stage(data, destination: .buffer(buffer)) { encoder, staging, stagingOffset in
+            encoder.copy(from: staging, sourceOffset: stagingOffset,
+                         to: buffer, destinationOffset: offset,
+                         size: data.count)
+        }
+    }
+
+    // the data must be tightly packed rows of size.width pixels.
+    @discardableResult
+    public func upload(_ data: UnsafeRawBufferPointer,
+                       to texture: Texture,
+                       origin: TextureOrigin = TextureOrigin(layer: 0, level: 0, x: 0, y: 0, z: 0),
+                       size: TextureSize) -> Future? {
+        let length = size.width * size.height * size.depth * texture.pixelFormat.bytesPerPixel
+        if length == 0 { return nil }
+        if data.count < length {
+            Log.err("UploadManager.upload: insufficient data for the texture region.")
+            return nil
+        }
+        return self.stage(UnsafeRawBufferPointer(rebasing: data[0..<length]),
+                          destination: .texture(texture)) { encoder, staging, stagingOffset in
+            encoder.copy(from: staging,
+                         sourceOffset: BufferImageOrigin(offset: stagingOffset,
+                                                         imageWidth: size.width,
+                                                         imageHeight: size.height),
+                         to: texture,
+                         destinationOffset: origin,
+                         size: size)
+        }
+    }
+
+    // submits the pending uploads, returns nil if nothing is pending.
+    @discardableResult
+    public func flush() -> Future? {
+        self.condition.withLock { self.submitBatch() }
+    }
+
+    // submits the pending uploads and waits for all uploads to complete.
+    public func waitUntilCompleted() {
+        self.condition.withLock {
+            self.submitBatch()
+            while self.numBatchesInFlight > 0 {
+                self.condition.wait()
+            }
+        }
+    }
+
+    fileprivate func submit(_ future: Future) {
+        self.condition.withLock {
+            if self.batch?.future === future {
+                self.submitBatch()
+            }
+        }
+    }
+
+    private func stage(_ data: UnsafeRawBufferPointer,
+                       destination: Destination,
+                       copy: (CopyCommandEncoder, GPUBuffer, Int) -> Void) -> Future? {
+        self.condition.lock()
+        defer { self.condition.unlock() }
+
+        var staging = self.ring
+        var stagingOffset = 0
+        var dedicated: GPUBuffer? = nil
+        if data.count > self.ringSize / 2 {
+            guard let buffer = self.queue.device.makeBuffer(length: data.count,
+                                                            storageMode: .shared,
+                                                            cpuCacheMode: .writeCombined),
+                  let memory = buffer.contents() else {
+                Log.err("UploadManager: failed to create staging buffer of \(data.count) bytes.")
+                return nil
+            }
+            memory.copyMemory(from: data.baseAddress!, byteCount: data.count)
+            buffer.flush()
+            staging = buffer
+            dedicated = buffer
+            self._statistics.dedicatedBuffers += 1
+        } else {
+            stagingOffset = self.allocate(data.count)
+            (self.ringMemory + stagingOffset).copyMemory(from: data.baseAddress!, byteCount: data.count)
+        }
+
+        guard self.openBatch() else { return nil }
+        copy(self.batch!.encoder, staging, stagingOffset)
+        if let dedicated {
+            self.batch!.stagingBuffers.append(dedicated)
+        }
+        if self.destinationQueue != nil {
+            switch destination {
+            case .buffer(let buffer):
+                self.batch!.destinations[ObjectIdentifier(buffer)] = destination
+            case .texture(let texture):
+                self.batch!.destinations[ObjectIdentifier(texture)] = destination
+            }
+        }
+        self._statistics.uploads += 1
+        self._statistics.bytes += UInt64(data.count)
+        return self.batch!.future
+    }
+
+    // returns the ring offset of the length bytes, waits for
+    // the in-flight batches if the ring is full.
+    // called with the lock held.
+    private func allocate(_ length: Int) -> Int {
+        let alignment = Self.alignment
+        while true {
+            if self.batch == nil && self.numBatchesInFlight == 0 {
+                // the ring is not in use.
+                self.head = 0
+                self.tail = 0
+            }
+            var offset = (self.head + alignment - 1) / alignment * alignment
+            if offset % self.ringSize + length > self.ringSize {
+                // the data does not wrap around, skip to the beginning.
+                offset = (offset / self.ringSize + 1) * self.ringSize
+            }
+            if offset + length - self.tail <= self.ringSize {
+                self.head = offset + length
+                return offset % self.ringSize
+            }
+            self._statistics.stalls += 1
+            self.submitBatch()
+            self.condition.wait()
+        }
+    }
+
+    // called with the lock held.
+    private func openBatch() -> Bool {
+        if self.batch != nil { return true }
+        guard let commandBuffer = self.queue.makeCommandBuffer(),
+              let encoder = commandBuffer.makeCopyCommandEncoder() else {
+            Log.err("UploadManager: failed to create command encoder.")
+            return false
+        }
+        self.batch = Batch(commandBuffer: commandBuffer,
+                           encoder: encoder,
+                           future: Future(manager: self))
+        return true
+    }
+
+    // called with the lock held.
+    @discardableResult
+    private func submitBatch() -> Future? {
+        guard let batch = self.batch else { return nil }
+        self.batch = nil
+
+        var handoff: (queue: CommandQueue, semaphore: GPUSemaphore, value: UInt64)? = nil
+        if let destinationQueue, let semaphore = self.handoffSemaphore {
+            for destination in batch.destinations.values {
+                switch destination {
+                case .buffer(let buffer):
+                    batch.encoder.releaseOwnership(of: buffer, to: destinationQueue)
+                case .texture(let texture):
+                    batch.encoder.releaseOwnership(of: texture, to: destinationQueue)
+                }
+            }
+            self.handoffValue += 1
+            batch.encoder.signalSemaphoreValue(semaphore, value: self.handoffValue)
+            handoff = (destinationQueue, semaphore, self.handoffValue)
+        }
+        batch.encoder.endEncoding()
+        self.ring.flush()
+
+        let ringEnd = self.head
+        let stagingBuffers = batch.stagingBuffers
+        let future = batch.future
+        self.numBatchesInFlight += 1
+        self._statistics.submissions += 1
+
+        // the ring space is reusable after the copies, the batch is
+        // completed after the handoff if it has a destination queue.
+        let handoffCommandBuffer = handoff.flatMap {
+            self.makeHandoffCommandBuffer(queue: $0.queue,
+                                          semaphore: $0.semaphore,
+                                          value: $0.value,
+                                          destinations: batch.destinations.values)
+        }
+        batch.commandBuffer.addCompletedHandler { _ in
+            withExtendedLifetime(stagingBuffers) {
+                self.condition.withLock {
+                    self.tail = max(self.tail, ringEnd)
+                    if handoffCommandBuffer == nil {
+                        self.numBatchesInFlight -= 1
+                    }
+                    self.condition.broadcast()
+                }
+            }
+            if handoffCommandBuffer == nil {
+                future.complete()
+            }
+        }
+        if batch.commandBuffer.commit() == false {
+            Log.err("UploadManager: failed to commit command buffer.")
+            self.tail = max(self.tail, ringEnd)
+            self.numBatchesInFlight -= 1
+            self.condition.broadcast()
+            // future handlers may upload, not called with the lock held.
+            DispatchQueue.global().async { future.complete() }
+            return future
+        }
+
+        if let handoffCommandBuffer {
+            handoffCommandBuffer.addCompletedHandler { _ in
+                self.condition.withLock {
+                    self.numBatchesInFlight -= 1
+                    self.condition.broadcast()
+                }
+                future.complete()
+            }
+            if handoffCommandBuffer.commit() == false {
+                Log.err("UploadManager: failed to commit command buffer of the destination queue.")
+                self.numBatchesInFlight -= 1
+                self.condition.broadcast()
+                DispatchQueue.global().async { future.complete() }
+            }
+        }
+        return future
+    }
+
+    // waits for the copies and acquires the resources on the destination queue.
+    private func makeHandoffCommandBuffer(queue: CommandQueue,
+                                          semaphore: GPUSemaphore,
+                                          value: UInt64,
+                                          destinations: some Sequence<Destination>) -> CommandBuffer? {
+        guard let commandBuffer = queue.makeCommandBuffer(),
+              let encoder = commandBuffer.makeCopyCommandEncoder() else {
+            Log.err("UploadManager: failed to create command encoder of the destination queue.")
+            return nil
+        }
+        encoder.waitSemaphoreValue(semaphore, value: value)
+        for destination in destinations {
+            switch destination {
+            case .buffer(let buffer):
+                encoder.acquireOwnership(of: buffer, from: self.queue)
+            case .texture(let texture):
+                encoder.acquireOwnership(of: texture, from: self.queue)
+            }
+        }
+        encoder.endEncoding()
+        return commandBuffer
+    }
+}
+
+// MARK: - Async resource creation
+extension UploadManager {
+    // returns a private buffer that is ready to use on the destination queue,
+    // or on the upload queue without a destination queue.
+    public func makeBuffer(_ data: some ContiguousBytes) async -> GPUBuffer? {
+        let upload: (buffer: GPUBuffer, future: Future)? = data.withUnsafeBytes { data in
+            guard let buffer = self.queue.device.makeBuffer(length: data.count,
+                                                            storageMode: .private,
+                                                            cpuCacheMode: .defaultCache) else {
+                Log.err("UploadManager.makeBuffer: failed to create buffer of \(data.count) bytes.")
+                return nil
+            }
+            guard let future = self.upload(data, to: buffer) else { return nil }
+            return (buffer, future)
+        }
+        guard let upload else { return nil }
+        await upload.future.completed()
+        return upload.buffer
+    }
+
+    public func makeTexture(_ image: Image, usage: TextureUsage = .sampled) async -> Texture? {
+        guard let upload = image.uploadTexture(uploadManager: self, usage: usage) else {
+            return nil
+        }
+        await upload.future.completed()
+        return upload.texture
+    }
+}
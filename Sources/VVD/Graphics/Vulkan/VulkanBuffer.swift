@@ -7,32 +7,44 @@
 
 #if ENABLE_VULKAN
 import Foundation
+import Synchronization
 import Vulkan
 
 final class VulkanBuffer {
-    var buffer: VkBuffer
     var usage: VkBufferUsageFlags
     var sharingMode: VkSharingMode
     var size: VkDeviceSize
-
-    let memory: VulkanMemoryBlock?
     let device: GraphicsDevice
 
+    // the handle and the memory are exchanged by the memory defragmenter
+    // on the completion thread, while the encoders read them.
+    // GPU writes are counted, only idle buffers are relocated and the
+    // relocation is discarded if the buffer is written while it is moved.
+    private struct State {
+        var buffer: VkBuffer
+        var memory: VulkanMemoryBlock?
+        var writesEncoded: UInt64 = 0
+        var writesPending: Int = 0
+        var pinned = false  // written by shaders or viewed by texel buffer views.
+    }
+    private let state: Mutex<State>
+
+    var buffer: VkBuffer { state.withLock { $0.buffer } }
+    var memory: VulkanMemoryBlock? { state.withLock { $0.memory } }
+
     init(device: VulkanGraphicsDevice, memory: VulkanMemoryBlock, buffer: VkBuffer, bufferCreateInfo: VkBufferCreateInfo) {
         self.device = device
-        self.memory = memory
-        self.buffer = buffer
+        self.state = Mutex(State(buffer: buffer, memory: memory))
         self.usage = bufferCreateInfo.usage
         self.sharingMode = bufferCreateInfo.sharingMode
         self.size = bufferCreateInfo.size
 
-        assert(self.memory!.size >= self.size)
+        assert(memory.size >= self.size)
     }
 
     init(device: VulkanGraphicsDevice, buffer: VkBuffer, size: VkDeviceSize) {
         self.device = device
-        self.memory = nil
-        self.buffer = buffer
+        self.state = Mutex(State(buffer: buffer, memory: nil))
         self.usage = 0
         self.sharingMode = VK_SHARING_MODE_EXCLUSIVE
         self.size = size
@@ -42,14 +54,63 @@ final class VulkanBuffer {
 
     deinit {
         let device = self.device as! VulkanGraphicsDevice
+        let (buffer, memory) = state.withLock { ($0.buffer, $0.memory) }
         vkDestroyBuffer(device.device, buffer, device.allocationCallbacks)
-        if var memory = self.memory {
+        if var memory {
             memory.chunk!.pool.dealloc(&memory)
         }
     }
 
     var length: Int { Int(self.size) }
 
+    // exchanges the buffer and its memory with a relocated copy, unless
+    // the buffer has been written since writeSerial was taken, or has been
+    // bound for shader writes since. (pinned)
+    // the copy keeps the previous ones until it is released.
+    func exchange(with other: VulkanBuffer, writeSerial: UInt64) -> Bool {
+        assert(self.size == other.size)
+        assert(self !== other)
+        return self.state.withLock { lhs in
+            if lhs.pinned || lhs.writesEncoded != writeSerial { return false }
+            other.state.withLock { rhs in
+                swap(&lhs.buffer, &rhs.buffer)
+                swap(&lhs.memory, &rhs.memory)
+            }
+            return true
+        }
+    }
+
+    // the handle to be written by the GPU, endWrite() must be called
+    // when the write is complete.
+    func beginWrite() -> VkBuffer {
+        state.withLock {
+            $0.writesEncoded += 1
+            $0.writesPending += 1
+            return $0.buffer
+        }
+    }
+
+    func endWrite() {
+        state.withLock { $0.writesPending -= 1 }
+    }
+
+    func pin() {
+        state.withLock { $0.pinned = true }
+    }
+
+    // number of writes encoded if the buffer is idle, to detect writes
+    // during a move.
+    var idleWriteSerial: UInt64? {
+        state.withLock {
+            $0.pinned == false && $0.writesPending == 0 ? $0.writesEncoded : nil
+        }
+    }
+
+    // no writes in flight and never written by shaders.
+    var isIdle: Bool {
+        state.withLock { $0.pinned == false && $0.writesPending == 0 }
+    }
+
     func contents() -> UnsafeMutableRawPointer? {
         if let memory = self.memory {
             assert(memory.chunk != nil)
@@ -81,6 +142,9 @@ final class VulkanBuffer {
 
                 assert(offset & UInt(alignment) == 0)
 
+                // texel buffer views refer to the handle.
+                self.pin()
+
                 var bufferViewCreateInfo = VkBufferViewCreateInfo()
                 bufferViewCreateInfo.sType = VK_STRUCTURE_TYPE_BUFFER_VIEW_CREATE_INFO
                 bufferViewCreateInfo.buffer = buffer
@@ -50,6 +50,7 @@ final class VulkanCommandBuffer: CommandBuffer, @unchecked Sendable {
     private let lock = NSLock()
 
     private let commandPool: VkCommandPool
+    private let epoch: UInt64   // of VulkanGraphicsDevice.retiredResources
     private var retainedCommandBuffers: [VkCommandBuffer] = []
     private var completedHandlers: [CommandBufferHandler] = []
 
@@ -78,6 +79,7 @@ final class VulkanCommandBuffer: CommandBuffer, @unchecked Sendable {
         self.device = queue.device
         self.commandPool = pool
         self._status = .ready
+        self.epoch = (queue.device as! VulkanGraphicsDevice).retiredResources.beginCommandBuffer()
     }
 
     deinit {
@@ -87,16 +89,37 @@ final class VulkanCommandBuffer: CommandBuffer, @unchecked Sendable {
             vkFreeCommandBuffers(device.device, commandPool, UInt32(tmp.count), &tmp)
         }
         vkDestroyCommandPool(device.device, commandPool, device.allocationCallbacks)
+        device.retiredResources.endCommandBuffer(epoch: self.epoch)
     }
 
     func makeRenderCommandEncoder(descriptor: RenderPassDescriptor) -> RenderCommandEncoder? {
+        self.lock.lock()
+        defer { self.lock.unlock() }
+
+        if let renderContext = self.makeRenderContext(descriptor: descriptor, caller: "makeRenderCommandEncoder") {
+            self._status = .encoding
+            return VulkanRenderCommandEncoder(buffer: self, context: renderContext)
+        }
+        return nil
+    }
+
+    func makeParallelRenderCommandEncoder(descriptor: RenderPassDescriptor) -> ParallelRenderCommandEncoder? {
+        self.lock.lock()
+        defer { self.lock.unlock() }
+
+        if let renderContext = self.makeRenderContext(descriptor: descriptor, caller: "makeParallelRenderCommandEncoder") {
+            self._status = .encoding
+            return VulkanParallelRenderCommandEncoder(buffer: self, context: renderContext)
+        }
+        return nil
+    }
+
+    // called with the lock held.
+    private func makeRenderContext(descriptor: RenderPassDescriptor, caller: String) -> VulkanRenderCommandEncoder.RenderContext? {
         let queue = self.commandQueue as! VulkanCommandQueue
         if queue.family.properties.queueFlags & UInt32(VK_QUEUE_GRAPHICS_BIT.rawValue) != 0 {
-            self.lock.lock()
-            defer { self.lock.unlock() }
-
             if self._status != .ready {
-                Log.err("CommandBuffer.makeRenderCommandEncoder failed: CommandBuffer is not in ready state.")
+                Log.err("CommandBuffer.\(caller) failed: CommandBuffer is not in ready state.")
                 return nil
             }
 
@@ -293,11 +316,9 @@ final class VulkanCommandBuffer: CommandBuffer, @unchecked Sendable {
             renderContext.scissorRect = VkRect2D(offset: VkOffset2D(x: 0, y: 0),
                                                 extent: VkExtent2D(width: UInt32(frameWidth),
                                                                     height: UInt32(frameHeight)))
-
-            self._status = .encoding
-            return VulkanRenderCommandEncoder(buffer: self, context: renderContext)
+            return renderContext
         }
-        Log.err("CommandBuffer.makeRenderCommandEncoder failed: CommandQueue does not support graphics operations.")
+        Log.err("CommandBuffer.\(caller) failed: CommandQueue does not support graphics operations.")
         return nil
     }
 
@@ -84,12 +84,39 @@ final class VulkanCommandQueue: CommandQueue, @unchecked Sendable {
         var result: VkResult = VK_SUCCESS
 
         if let callback = callback {
-            let fence: VkFence = device.fence()
+            // the last submission signals the completion timeline of this queue.
+            let monitor = device.completionMonitor
             result = self.lock.withLock {
-                vkQueueSubmit2(self.queue, UInt32(submits.count), submits, fence)
-            }
-            if result == VK_SUCCESS {
-                device.addCompletionHandler(fence: fence, op: callback)
+                let (semaphore, value) = monitor.nextSignal(queue: self.queue)
+
+                var submits = submits
+                if submits.isEmpty {
+                    var submitInfo = VkSubmitInfo2()
+                    submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO_2
+                    submits.append(submitInfo)
+                }
+                var last = submits[submits.count - 1]
+                var signalSemaphoreInfos: [VkSemaphoreSubmitInfo] = []
+                if let p = last.pSignalSemaphoreInfos {
+                    signalSemaphoreInfos.append(contentsOf: UnsafeBufferPointer(start: p, count: Int(last.signalSemaphoreInfoCount)))
+                }
+                var completionInfo = VkSemaphoreSubmitInfo()
+                completionInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO
+                completionInfo.semaphore = semaphore
+                completionInfo.value = value
+                completionInfo.stageMask = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT
+                signalSemaphoreInfos.append(completionInfo)
+
+                let result = signalSemaphoreInfos.withUnsafeBufferPointer {
+                    last.signalSemaphoreInfoCount = UInt32($0.count)
+                    last.pSignalSemaphoreInfos = $0.baseAddress
+                    submits[submits.count - 1] = last
+                    return vkQueueSubmit2(self.queue, UInt32(submits.count), submits, nil)
+                }
+                if result == VK_SUCCESS {
+                    monitor.addHandler(queue: self.queue, value: value, handler: callback)
+                }
+                return result
             }
         } else {
             result = self.lock.withLock {
@@ -0,0 +1,141 @@
+//
+//  File: VulkanCommandStream.swift
+//  Author: Hongtae Kim (tiff2766@gmail.com)
+//
+//  Copyright (c) 2022-2025 Hongtae Kim. All rights reserved.
+//
+
+#if ENABLE_VULKAN
+import Foundation
+import Synchronization
+
+// Linear byte stream of tagged POD records.
+// Encoders append fixed-size records (optionally followed by a variable
+// length payload) and replay them with a switch on the tag, instead of
+// keeping an array of closures with a heap allocated context per command.
+// Object references are not stored in records, they are kept by the
+// encoder in retention arrays and referenced by index.
+//
+// Record layout: [Header][T][payload], each part aligned to 8 bytes.
+final class VulkanCommandStream: @unchecked Sendable {
+    struct Header {
+        var command: UInt32
+        var size: UInt32    // record size including the header
+    }
+
+    static let alignment = 8
+    static let headerSize = MemoryLayout<Header>.size
+
+    private(set) var storage: UnsafeMutableRawPointer
+    private(set) var capacity: Int
+    private(set) var byteCount = 0
+    private(set) var count = 0
+
+    var isEmpty: Bool { count == 0 }
+
+    init(capacity: Int = 16384) {
+        let capacity = max(Self.align(capacity), 256)
+        self.storage = .allocate(byteCount: capacity, alignment: Self.alignment)
+        self.capacity = capacity
+    }
+
+    deinit {
+        storage.deallocate()
+    }
+
+    // keep storage, discard records.
+    func reset() {
+        self.byteCount = 0
+        self.count = 0
+    }
+
+    @inline(__always)
+    static func align(_ size: Int) -> Int {
+        (size + alignment - 1) & ~(alignment - 1)
+    }
+
+    // offset of the variable length payload from the record pointer.
+    @inline(__always)
+    static func payloadOffset<T>(_: T.Type) -> Int {
+        align(MemoryLayout<T>.size)
+    }
+
+    private func reserve(_ size: Int) {
+        let required = self.byteCount + size
+        if required > self.capacity {
+            var capacity = self.capacity * 2
+            while capacity < required { capacity *= 2 }
+            let storage = UnsafeMutableRawPointer.allocate(byteCount: capacity, alignment: Self.alignment)
+            storage.copyMemory(from: self.storage, byteCount: self.byteCount)
+            self.storage.deallocate()
+            self.storage = storage
+            self.capacity = capacity
+        }
+    }
+
+    // appends a record with payloadSize bytes following it,
+    // returns pointer to the payload.
+    @discardableResult
+    func append<T>(_ command: UInt32, _ record: T, payloadSize: Int = 0) -> UnsafeMutableRawPointer {
+        assert(_isPOD(T.self), "Command record must be a trivial type.")
+        assert(MemoryLayout<T>.alignment <= Self.alignment)
+
+        let recordOffset = Self.headerSize
+        let payloadOffset = recordOffset + Self.payloadOffset(T.self)
+        let size = Self.align(payloadOffset + payloadSize)
+        assert(size <= Int(UInt32.max))
+
+        reserve(size)
+        let p = self.storage + self.byteCount
+        p.storeBytes(of: Header(command: command, size: UInt32(size)), as: Header.self)
+        (p + recordOffset).storeBytes(of: record, as: T.self)
+        self.byteCount += size
+        self.count += 1
+        return p + payloadOffset
+    }
+
+    @discardableResult
+    func append<T>(_ command: UInt32, _ record: T, payload: UnsafeRawBufferPointer) -> UnsafeMutableRawPointer {
+        let p = append(command, record, payloadSize: payload.count)
+        if let src = payload.baseAddress, payload.count > 0 {
+            p.copyMemory(from: src, byteCount: payload.count)
+        }
+        return p
+    }
+
+    // calls body with command tag and record pointer, in recording order.
+    @inline(__always)
+    func forEach(_ body: (UInt32, UnsafeRawPointer) throws -> Void) rethrows {
+        var offset = 0
+        let end = self.byteCount
+        let storage = UnsafeRawPointer(self.storage)
+        while offset < end {
+            let p = storage + offset
+            let header = p.load(as: Header.self)
+            try body(header.command, p + Self.headerSize)
+            offset += Int(header.size)
+        }
+    }
+}
+
+extension VulkanCommandStream {
+    // Streams are reused across command buffers, allocated storage is kept.
+    private static let pool = Mutex<[VulkanCommandStream]>([])
+    static let maxPooledStreams = 64
+    static let maxPooledCapacity = 4 * 1024 * 1024
+
+    static func make() -> VulkanCommandStream {
+        pool.withLock { $0.popLast() } ?? VulkanCommandStream()
+    }
+
+    static func recycle(_ stream: VulkanCommandStream) {
+        if stream.capacity > maxPooledCapacity { return }
+        stream.reset()
+        pool.withLock {
+            if $0.count < maxPooledStreams {
+                $0.append(stream)
+            }
+        }
+    }
+}
+#endif //if ENABLE_VULKAN
@@ -17,27 +17,62 @@ final class VulkanComputeCommandEncoder: ComputeCommandEncoder {
         var imageViewLayouts: VulkanDescriptorSet.ImageViewLayoutMap = [:]
     }
 
+    enum Command: UInt32 {
+        case bindPipeline
+        case bindDescriptorSet
+        case pushConstant
+        case memoryBarrier
+        case dispatch
+    }
+
+    struct BindPipelineCommand {
+        var pipelineIndex: Int
+    }
+    struct BindDescriptorSetCommand {
+        var index: UInt32
+        var descriptorSetIndex: Int
+    }
+    struct PushConstantCommand {    // followed by data bytes
+        var stageFlags: VkShaderStageFlags
+        var offset: UInt32
+        var size: UInt32
+    }
+    struct MemoryBarrierCommand {}
+    struct DispatchCommand {
+        var numGroupX: UInt32
+        var numGroupY: UInt32
+        var numGroupZ: UInt32
+    }
+
     final class Encoder: VulkanCommandEncoder {
         unowned let commandBuffer: VulkanCommandBuffer
 
         var pipelineStateObjects: [VulkanComputePipelineState] = []
         var descriptorSets: [VulkanDescriptorSet] = []
+        let descriptorAllocator: VulkanDescriptorSetAllocator
         var buffers: [GPUBuffer] = []
         var events: [GPUEvent] = []
         var semaphores: [GPUSemaphore] = []
 
-        typealias Command = (VkCommandBuffer, inout EncodingState)->Void
-        var commands: [Command] = []
-        var setupCommands: [Command] = []
-        var cleanupCommands: [Command] = []
+        let commands: VulkanCommandStream
 
         init(commandBuffer: VulkanCommandBuffer) {
             self.commandBuffer = commandBuffer
+            self.descriptorAllocator = VulkanDescriptorSetAllocator(
+                device: commandBuffer.device as! VulkanGraphicsDevice)
+            self.commands = VulkanCommandStream.make()
             super.init()
 
-            self.commands.reserveCapacity(self.initialNumberOfCommands)
-            self.setupCommands.reserveCapacity(self.initialNumberOfCommands)
-            self.cleanupCommands.reserveCapacity(self.initialNumberOfCommands)
+            self.pipelineStateObjects.reserveCapacity(self.initialNumberOfCommands)
+            self.descriptorSets.reserveCapacity(self.initialNumberOfCommands)
+        }
+
+        deinit {
+            VulkanCommandStream.recycle(self.commands)
+        }
+
+        func append<T>(_ command: Command, _ record: T) {
+            self.commands.append(command.rawValue, record)
         }
 
         override func encode(commandBuffer: VkCommandBuffer) -> Bool {
@@ -45,8 +80,8 @@ final class VulkanComputeCommandEncoder: ComputeCommandEncoder {
             for ds in self.descriptorSets {
                 ds.collectImageViewLayouts(&state.imageLayouts, &state.imageViewLayouts)
             }
-            for cmd in self.setupCommands {
-                cmd(commandBuffer, &state)
+            for ds in self.descriptorSets {
+                ds.updateImageViewLayouts(state.imageViewLayouts)
             }
             // Set image layout transition
             state.imageLayouts.forEach { (key, value) in
@@ -62,11 +97,56 @@ final class VulkanComputeCommandEncoder: ComputeCommandEncoder {
                                 queueFamilyIndex: self.commandBuffer.queueFamily.familyIndex,
                                 commandBuffer: commandBuffer)
             }
-            for cmd in self.commands {
-                cmd(commandBuffer, &state)
-            }
-            for cmd in self.cleanupCommands {
-                cmd(commandBuffer, &state)
+
+            self.commands.forEach { command, p in
+                switch Command(rawValue: command).unsafelyUnwrapped {
+                case .bindPipeline:
+                    let cmd = p.load(as: BindPipelineCommand.self)
+                    let pipeline = self.pipelineStateObjects[cmd.pipelineIndex]
+                    vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline.pipeline)
+                    state.pipelineState = pipeline
+                case .bindDescriptorSet:
+                    let cmd = p.load(as: BindDescriptorSetCommand.self)
+                    if let pipelineState = state.pipelineState {
+                        var ds: VkDescriptorSet? = self.descriptorSets[cmd.descriptorSetIndex].descriptorSet
+                        vkCmdBindDescriptorSets(commandBuffer,
+                                                VK_PIPELINE_BIND_POINT_COMPUTE,
+                                                pipelineState.layout,
+                                                cmd.index,
+                                                1,
+                                                &ds,
+                                                0,      // dynamic offsets
+                                                nil)
+                    }
+                case .pushConstant:
+                    let cmd = p.load(as: PushConstantCommand.self)
+                    if let pipelineState = state.pipelineState {
+                        vkCmdPushConstants(commandBuffer,
+                                           pipelineState.layout,
+                                           cmd.stageFlags,
+                                           cmd.offset,
+                                           cmd.size,
+                                           p + VulkanCommandStream.payloadOffset(PushConstantCommand.self))
+                    }
+                case .memoryBarrier:
+                    var memoryBarrier = VkMemoryBarrier2()
+                    memoryBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER_2
+                    memoryBarrier.srcStageMask = VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT
+                    memoryBarrier.srcAccessMask = VK_ACCESS_2_NONE
+                    memoryBarrier.dstStageMask = VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT
+                    memoryBarrier.dstAccessMask = VK_ACCESS_2_NONE
+
+                    withUnsafePointer(to: memoryBarrier) { pMemoryBarriers in
+                        var dependencyInfo = VkDependencyInfo()
+                        dependencyInfo.sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO
+                        dependencyInfo.memoryBarrierCount = 1
+                        dependencyInfo.pMemoryBarriers = pMemoryBarriers
+                        vkCmdPipelineBarrier2(commandBuffer, &dependencyInfo)
+                    }
+                case .dispatch:
+                    let cmd = p.load(as: DispatchCommand.self)
+                    vkCmdDispatch(commandBuffer, cmd.numGroupX, cmd.numGroupY, cmd.numGroupZ)
+                }
             }
             return true
         }
@@ -130,91 +210,50 @@ final class VulkanComputeCommandEncoder: ComputeCommandEncoder {
     
     func setResource(_ set: ShaderBindingSet, index: Int) {
         assert(set is VulkanShaderBindingSet)
-        var descriptorSet: VulkanDescriptorSet? = nil
         if let bindingSet = set as? VulkanShaderBindingSet {
-            descriptorSet = bindingSet.makeDescriptorSet()
-            self.encoder!.descriptorSets.append(descriptorSet!)
-        }
-        if let descriptorSet = descriptorSet {
-            let preCommand = { (commandBuffer: VkCommandBuffer, state: inout EncodingState) in
-                descriptorSet.updateImageViewLayouts(state.imageViewLayouts)
-            }
-            self.encoder!.setupCommands.append(preCommand)
-
-            let command = { (commandBuffer: VkCommandBuffer, state: inout EncodingState) in
-                if let pipelineState = state.pipelineState {
-                    var ds: VkDescriptorSet? = descriptorSet.descriptorSet
-                    vkCmdBindDescriptorSets(commandBuffer,
-                                            VK_PIPELINE_BIND_POINT_COMPUTE,
-                                            pipelineState.layout,
-                                            UInt32(index),
-                                            1,
-                                            &ds,
-                                            0,      // dynamic offsets
-                                            nil)
-                }
-            }
-            self.encoder!.commands.append(command)
+            let encoder = self.encoder!
+            let descriptorSetIndex = encoder.descriptorAllocator.descriptorSetIndex(
+                for: bindingSet, descriptorSets: &encoder.descriptorSets)
+            encoder.append(.bindDescriptorSet,
+                           BindDescriptorSetCommand(index: UInt32(index),
+                                                    descriptorSetIndex: descriptorSetIndex))
         }
     }
 
     func setComputePipelineState(_ pso: ComputePipelineState) {
         assert(pso is VulkanComputePipelineState)
         if let pipeline = pso as? VulkanComputePipelineState {
-            let command = { (commandBuffer: VkCommandBuffer, state: inout EncodingState) in
-                vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline.pipeline)
-                state.pipelineState = pipeline
-            }
-            self.encoder!.commands.append(command)
-            self.encoder!.pipelineStateObjects.append(pipeline)
+            let encoder = self.encoder!
+            encoder.append(.bindPipeline,
+                           BindPipelineCommand(pipelineIndex: encoder.pipelineStateObjects.count))
+            encoder.pipelineStateObjects.append(pipeline)
         }
     }
 
     func pushConstant<D: DataProtocol>(stages: ShaderStageFlags, offset: Int, data: D) {
         if stages.contains(.compute) && data.count > 0 {
             let stageFlags = stages.vkFlags()
-            var buffer: [UInt8] = .init(data)
-            assert(buffer.count == data.count)
-
-            let command = { (commandBuffer: VkCommandBuffer, state: inout EncodingState) in
-                if let pipelineState = state.pipelineState {
-                    vkCmdPushConstants(commandBuffer,
-                                       pipelineState.layout,
-                                       stageFlags,
-                                       UInt32(offset),
-                                       UInt32(buffer.count),
-                                       &buffer)
-                }
-            }
-            self.encoder!.commands.append(command)
+            let size = data.count
+            let command = PushConstantCommand(stageFlags: stageFlags,
+                                              offset: UInt32(offset),
+                                              size: UInt32(size))
+            let payload = self.encoder!.commands.append(Command.pushConstant.rawValue,
+                                                        command,
+                                                        payloadSize: size)
+            let copied = data.copyBytes(to: UnsafeMutableRawBufferPointer(start: payload, count: size))
+            assert(copied == size)
         }
     }
 
     func memoryBarrier() {
-        let command = { (commandBuffer: VkCommandBuffer, state: inout EncodingState) in
-            var memoryBarrier = VkMemoryBarrier2()
-            memoryBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER_2
-            memoryBarrier.srcStageMask = VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT
-            memoryBarrier.srcAccessMask = VK_ACCESS_2_NONE
-            memoryBarrier.dstStageMask = VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT
-            memoryBarrier.dstAccessMask = VK_ACCESS_2_NONE
-
-            withUnsafePointer(to: memoryBarrier) { pMemoryBarriers in
-                var dependencyInfo = VkDependencyInfo()
-                dependencyInfo.sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO
-                dependencyInfo.memoryBarrierCount = 1
-                dependencyInfo.pMemoryBarriers = pMemoryBarriers
-                vkCmdPipelineBarrier2(commandBuffer, &dependencyInfo)
-            }
-        }
-        self.encoder!.commands.append(command)
+        self.encoder!.append(.memoryBarrier, MemoryBarrierCommand())
     }
 
     func dispatch(numGroupX: Int, numGroupY: Int, numGroupZ: Int) {
-        let command = { (commandBuffer: VkCommandBuffer, state: inout EncodingState) in
-            vkCmdDispatch(commandBuffer, UInt32(numGroupX), UInt32(numGroupY), UInt32(numGroupZ))
-        }
-        self.encoder!.commands.append(command)
+        self.encoder!.append(.dispatch,
+                             DispatchCommand(numGroupX: UInt32(numGroupX),
+                                             numGroupY: UInt32(numGroupY),
+                                             numGroupZ: UInt32(numGroupZ)))
     }
 }
 #endif //if ENABLE_VULKAN
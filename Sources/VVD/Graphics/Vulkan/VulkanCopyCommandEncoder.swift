@@ -11,41 +11,201 @@ import Vulkan
 
 final class VulkanCopyCommandEncoder: CopyCommandEncoder {
 
-    struct EncodingState {}
+    enum Command: UInt32 {
+        case copyBuffer
+        case copyBufferToImage
+        case copyImageToBuffer
+        case copyImage
+        case fillBuffer
+        case ownershipTransfer
+        case callback
+    }
+
+    struct CopyBufferCommand {
+        var srcBuffer: VkBuffer?
+        var dstBuffer: VkBuffer?
+        var region: VkBufferCopy
+    }
+    struct CopyBufferToImageCommand {
+        var buffer: VkBuffer?
+        var imageIndex: Int
+        var discardOldLayout: Bool
+        var region: VkBufferImageCopy
+    }
+    struct CopyImageToBufferCommand {
+        var imageIndex: Int
+        var buffer: VkBuffer?
+        var region: VkBufferImageCopy
+    }
+    struct CopyImageCommand {
+        var srcImageIndex: Int
+        var dstImageIndex: Int
+        var discardOldLayout: Bool
+        var region: VkImageCopy
+    }
+    struct FillBufferCommand {
+        var buffer: VkBuffer?
+        var offset: VkDeviceSize
+        var length: VkDeviceSize
+        var data: UInt32
+    }
+    struct OwnershipTransferCommand {
+        var buffer: VkBuffer?
+        var imageIndex: Int     // -1 for the buffer
+        var srcQueueFamilyIndex: UInt32
+        var dstQueueFamilyIndex: UInt32
+        var release: Bool
+    }
+    struct CallbackCommand {
+        var callbackIndex: Int
+    }
 
     final class Encoder: VulkanCommandEncoder {
         unowned let commandBuffer: VulkanCommandBuffer
 
         var buffers: [GPUBuffer] = []
         var textures: [Texture] = []
+        var images: [VulkanImage] = []
+        var callbacks: [(VkCommandBuffer)->Void] = []
         var events: [GPUEvent] = []
         var semaphores: [GPUSemaphore] = []
+        var writtenBuffers: [VulkanBuffer] = []
 
-        typealias Command = (VkCommandBuffer, inout EncodingState)->Void
-        var commands: [Command] = []
-        var setupCommands: [Command] = []
-        var cleanupCommands: [Command] = []
+        let commands: VulkanCommandStream
 
         init(commandBuffer: VulkanCommandBuffer) {
             self.commandBuffer = commandBuffer
+            self.commands = VulkanCommandStream.make()
             super.init()
+        }
 
-            self.commands.reserveCapacity(self.initialNumberOfCommands)
-            self.setupCommands.reserveCapacity(self.initialNumberOfCommands)
-            self.cleanupCommands.reserveCapacity(self.initialNumberOfCommands)
+        deinit {
+            VulkanCommandStream.recycle(self.commands)
         }
 
-        override func encode(commandBuffer: VkCommandBuffer) -> Bool {
-            var state = EncodingState()
+        func append<T>(_ command: Command, _ record: T) {
+            self.commands.append(command.rawValue, record)
+        }
 
-            for cmd in self.setupCommands {
-                cmd(commandBuffer, &state)
-            }
-            for cmd in self.commands {
-                cmd(commandBuffer, &state)
+        // the handle of the buffer to be written, counted until completion.
+        func write(_ buffer: VulkanBuffer) -> VkBuffer {
+            self.writtenBuffers.append(buffer)
+            return buffer.beginWrite()
+        }
+
+        func imageIndex(_ image: VulkanImage) -> Int {
+            if let last = self.images.last, last === image {
+                return self.images.count - 1
             }
-            for cmd in self.cleanupCommands {
-                cmd(commandBuffer, &state)
+            self.images.append(image)
+            return self.images.count - 1
+        }
+
+        override func encode(commandBuffer: VkCommandBuffer) -> Bool {
+            let queueFamilyIndex = self.commandBuffer.queueFamily.familyIndex
+
+            self.commands.forEach { command, p in
+                switch Command(rawValue: command).unsafelyUnwrapped {
+                case .copyBuffer:
+                    var cmd = p.load(as: CopyBufferCommand.self)
+                    vkCmdCopyBuffer(commandBuffer, cmd.srcBuffer, cmd.dstBuffer, 1, &cmd.region)
+                case .copyBufferToImage:
+                    var cmd = p.load(as: CopyBufferToImageCommand.self)
+                    let image = self.images[cmd.imageIndex]
+                    image.setLayout(VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                                    discardOldLayout: cmd.discardOldLayout,
+                                    accessMask: VK_ACCESS_2_TRANSFER_WRITE_BIT,
+                                    stageBegin: VK_PIPELINE_STAGE_2_TRANSFER_BIT,
+                                    stageEnd: VK_PIPELINE_STAGE_2_TRANSFER_BIT,
+                                    queueFamilyIndex: queueFamilyIndex,
+                                    commandBuffer: commandBuffer)
+
+                    vkCmdCopyBufferToImage(commandBuffer,
+                                           cmd.buffer,
+                                           image.image,
+                                           VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                                           1, &cmd.region)
+                case .copyImageToBuffer:
+                    var cmd = p.load(as: CopyImageToBufferCommand.self)
+                    let image = self.images[cmd.imageIndex]
+                    image.setLayout(VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+                                    discardOldLayout: false,
+                                    accessMask: VK_ACCESS_2_TRANSFER_READ_BIT,
+                                    stageBegin: VK_PIPELINE_STAGE_2_TRANSFER_BIT,
+                                    stageEnd: VK_PIPELINE_STAGE_2_TRANSFER_BIT,
+                                    queueFamilyIndex: queueFamilyIndex,
+                                    commandBuffer: commandBuffer)
+
+                    vkCmdCopyImageToBuffer(commandBuffer,
+                                           image.image,
+                                           VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+                                           cmd.buffer,
+                                           1, &cmd.region)
+                case .copyImage:
+                    var cmd = p.load(as: CopyImageCommand.self)
+                    let srcImage = self.images[cmd.srcImageIndex]
+                    let dstImage = self.images[cmd.dstImageIndex]
+                    srcImage.setLayout(VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+                                       discardOldLayout: false,
+                                       accessMask: VK_ACCESS_2_TRANSFER_READ_BIT,
+                                       stageBegin: VK_PIPELINE_STAGE_2_TRANSFER_BIT,
+                                       stageEnd: VK_PIPELINE_STAGE_2_TRANSFER_BIT,
+                                       queueFamilyIndex: queueFamilyIndex,
+                                       commandBuffer: commandBuffer)
+
+                    dstImage.setLayout(VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                                       discardOldLayout: cmd.discardOldLayout,
+                                       accessMask: VK_ACCESS_2_TRANSFER_WRITE_BIT,
+                                       stageBegin: VK_PIPELINE_STAGE_2_TRANSFER_BIT,
+                                       stageEnd: VK_PIPELINE_STAGE_2_TRANSFER_BIT,
+                                       queueFamilyIndex: queueFamilyIndex,
+                                       commandBuffer: commandBuffer)
+
+                    vkCmdCopyImage(commandBuffer,
+                                   srcImage.image,
+                                   VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+                                   dstImage.image,
+                                   VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                                   1, &cmd.region)
+                case .fillBuffer:
+                    let cmd = p.load(as: FillBufferCommand.self)
+                    vkCmdFillBuffer(commandBuffer, cmd.buffer, cmd.offset, cmd.length, cmd.data)
+                case .ownershipTransfer:
+                    let cmd = p.load(as: OwnershipTransferCommand.self)
+                    if cmd.imageIndex >= 0 {
+                        self.images[cmd.imageIndex].transferOwnership(from: cmd.srcQueueFamilyIndex,
+                                                                      to: cmd.dstQueueFamilyIndex,
+                                                                      release: cmd.release,
+                                                                      commandBuffer: commandBuffer)
+                    } else {
+                        var barrier = VkBufferMemoryBarrier2()
+                        barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER_2
+                        if cmd.release {
+                            barrier.srcStageMask = VK_PIPELINE_STAGE_2_ALL_TRANSFER_BIT
+                            barrier.srcAccessMask = VK_ACCESS_2_TRANSFER_WRITE_BIT
+                        } else {
+                            barrier.srcStageMask = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT
+                            barrier.dstStageMask = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT
+                            barrier.dstAccessMask = VK_ACCESS_2_MEMORY_READ_BIT | VK_ACCESS_2_MEMORY_WRITE_BIT
+                        }
+                        barrier.srcQueueFamilyIndex = cmd.srcQueueFamilyIndex
+                        barrier.dstQueueFamilyIndex = cmd.dstQueueFamilyIndex
+                        barrier.buffer = cmd.buffer
+                        barrier.offset = 0
+                        barrier.size = VK_WHOLE_SIZE
+
+                        withUnsafePointer(to: barrier) { pBufferMemoryBarriers in
+                            var dependencyInfo = VkDependencyInfo()
+                            dependencyInfo.sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO
+                            dependencyInfo.bufferMemoryBarrierCount = 1
+                            dependencyInfo.pBufferMemoryBarriers = pBufferMemoryBarriers
+                            vkCmdPipelineBarrier2(commandBuffer, &dependencyInfo)
+                        }
+                    }
+                case .callback:
+                    let cmd = p.load(as: CallbackCommand.self)
+                    self.callbacks[cmd.callbackIndex](commandBuffer)
+                }
             }
             return true
         }
@@ -65,6 +225,12 @@ final class VulkanCopyCommandEncoder: CopyCommandEncoder {
 
     func endEncoding() {
         let commandBuffer = self.commandBuffer as! VulkanCommandBuffer
+        let writtenBuffers = self.encoder!.writtenBuffers
+        if writtenBuffers.isEmpty == false {
+            commandBuffer.addCompletedHandler { _ in
+                writtenBuffers.forEach { $0.endWrite() }
+            }
+        }
         commandBuffer.endEncoder(self.encoder!)
         self.encoder = nil
     }
@@ -131,13 +297,13 @@ final class VulkanCopyCommandEncoder: CopyCommandEncoder {
             return
         }
 
-        var region = VkBufferCopy(srcOffset: VkDeviceSize(srcOffset),
+        let region = VkBufferCopy(srcOffset: VkDeviceSize(srcOffset),
                                   dstOffset: VkDeviceSize(dstOffset),
                                        size: VkDeviceSize(size))
-        let command = { (commandBuffer: VkCommandBuffer, state: inout EncodingState) in
-            vkCmdCopyBuffer(commandBuffer, srcBuffer.buffer, dstBuffer.buffer, 1, &region)
-        }
-        self.encoder!.commands.append(command)
+        self.encoder!.append(.copyBuffer,
+                             CopyBufferCommand(srcBuffer: srcBuffer.buffer,
+                                               dstBuffer: self.encoder!.write(dstBuffer),
+                                               region: region))
         self.encoder!.buffers.append(src)
         self.encoder!.buffers.append(dst)
     }
@@ -196,25 +362,12 @@ final class VulkanCopyCommandEncoder: CopyCommandEncoder {
                                size.height == mipDimensions.height &&
                                size.depth == mipDimensions.depth
 
-        let queueFamilyIndex = self.encoder!.commandBuffer.queueFamily.familyIndex
-
-        let command = { (commandBuffer: VkCommandBuffer, state: inout EncodingState) in
-
-            image.setLayout(VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-                            discardOldLayout: discardOldLayout,
-                            accessMask: VK_ACCESS_2_TRANSFER_WRITE_BIT,
-                            stageBegin: VK_PIPELINE_STAGE_2_TRANSFER_BIT,
-                            stageEnd: VK_PIPELINE_STAGE_2_TRANSFER_BIT,
-                            queueFamilyIndex: queueFamilyIndex,
-                            commandBuffer: commandBuffer)
-
-            vkCmdCopyBufferToImage(commandBuffer,
-                                   buffer.buffer,
-                                   image.image,
-                                   VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-                                   1, &region)
-        }
-        self.encoder!.commands.append(command)
+        let encoder = self.encoder!
+        encoder.append(.copyBufferToImage,
+                       CopyBufferToImageCommand(buffer: buffer.buffer,
+                                                imageIndex: encoder.imageIndex(image),
+                                                discardOldLayout: discardOldLayout,
+                                                region: region))
         self.encoder!.buffers.append(src)
         self.encoder!.textures.append(dst)
     }
@@ -267,25 +420,11 @@ final class VulkanCopyCommandEncoder: CopyCommandEncoder {
         region.imageExtent = VkExtent3D(width: UInt32(size.width), height: UInt32(size.height), depth: UInt32(size.depth))
         self.setupSubresource(&region.imageSubresource, origin: srcOffset, layerCount: 1, pixelFormat: pixelFormat)
 
-        let queueFamilyIndex = self.encoder!.commandBuffer.queueFamily.familyIndex
-
-        let command = { (commandBuffer: VkCommandBuffer, state: inout EncodingState) in
-
-            image.setLayout(VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
-                            discardOldLayout: false,
-                            accessMask: VK_ACCESS_2_TRANSFER_READ_BIT,
-                            stageBegin: VK_PIPELINE_STAGE_2_TRANSFER_BIT,
-                            stageEnd: VK_PIPELINE_STAGE_2_TRANSFER_BIT,
-                            queueFamilyIndex: queueFamilyIndex,
-                            commandBuffer: commandBuffer)
-
-            vkCmdCopyImageToBuffer(commandBuffer,
-                                   image.image,
-                                   VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
-                                   buffer.buffer,
-                                   1, &region)
-        }
-        self.encoder!.commands.append(command)
+        let encoder = self.encoder!
+        encoder.append(.copyImageToBuffer,
+                       CopyImageToBufferCommand(imageIndex: encoder.imageIndex(image),
+                                                buffer: encoder.write(buffer),
+                                                region: region))
         self.encoder!.textures.append(src)
         self.encoder!.buffers.append(dst)
     }
@@ -352,34 +491,12 @@ final class VulkanCopyCommandEncoder: CopyCommandEncoder {
                                size.height == dstMipDimensions.height &&
                                size.depth == dstMipDimensions.depth
 
-        let queueFamilyIndex = self.encoder!.commandBuffer.queueFamily.familyIndex
-
-        let command = { (commandBuffer: VkCommandBuffer, state: inout EncodingState) in
-
-            srcImage.setLayout(VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
-                               discardOldLayout: false,
-                               accessMask: VK_ACCESS_2_TRANSFER_READ_BIT,
-                               stageBegin: VK_PIPELINE_STAGE_2_TRANSFER_BIT,
-                               stageEnd: VK_PIPELINE_STAGE_2_TRANSFER_BIT,
-                               queueFamilyIndex: queueFamilyIndex,
-                               commandBuffer: commandBuffer)
-
-            dstImage.setLayout(VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-                               discardOldLayout: discardOldLayout,
-                               accessMask: VK_ACCESS_2_TRANSFER_WRITE_BIT,
-                               stageBegin: VK_PIPELINE_STAGE_2_TRANSFER_BIT,
-                               stageEnd: VK_PIPELINE_STAGE_2_TRANSFER_BIT,
-                               queueFamilyIndex: queueFamilyIndex,
-                               commandBuffer: commandBuffer)
-
-            vkCmdCopyImage(commandBuffer,
-                           srcImage.image,
-                           VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
-                           dstImage.image,
-                           VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-                           1, &region)
-        }
-        self.encoder!.commands.append(command)
+        let encoder = self.encoder!
+        encoder.append(.copyImage,
+                       CopyImageCommand(srcImageIndex: encoder.imageIndex(srcImage),
+                                        dstImageIndex: encoder.imageIndex(dstImage),
+                                        discardOldLayout: discardOldLayout,
+                                        region: region))
         self.encoder!.textures.append(src)
         self.encoder!.textures.append(dst)
     }
@@ -396,22 +513,61 @@ final class VulkanCopyCommandEncoder: CopyCommandEncoder {
 
         let data: UInt32 = UInt32(value) << 24 | UInt32(value) << 16 | UInt32(value) << 8 | UInt32(value)
 
-        let command = { (commandBuffer: VkCommandBuffer, state: inout EncodingState) in
-            vkCmdFillBuffer(commandBuffer,
-                            buf.buffer,
-                            VkDeviceSize(offset),
-                            VkDeviceSize(length),
-                            data)
-        }
-        self.encoder!.commands.append(command)
+        self.encoder!.append(.fillBuffer,
+                             FillBufferCommand(buffer: self.encoder!.write(buf),
+                                               offset: VkDeviceSize(offset),
+                                               length: VkDeviceSize(length),
+                                               data: data))
         self.encoder!.buffers.append(buffer)
     }
 
-    func callback(_ fn: @escaping (_:VkCommandBuffer)->Void) {
-        let command = { (commandBuffer: VkCommandBuffer, state: inout EncodingState) in
-            fn(commandBuffer)
+    func releaseOwnership(of buffer: GPUBuffer, to queue: CommandQueue) {
+        self.transferOwnership(of: buffer, texture: nil, queue: queue, release: true)
+    }
+
+    func releaseOwnership(of texture: Texture, to queue: CommandQueue) {
+        self.transferOwnership(of: nil, texture: texture, queue: queue, release: true)
+    }
+
+    func acquireOwnership(of buffer: GPUBuffer, from queue: CommandQueue) {
+        self.transferOwnership(of: buffer, texture: nil, queue: queue, release: false)
+    }
+
+    func acquireOwnership(of texture: Texture, from queue: CommandQueue) {
+        self.transferOwnership(of: nil, texture: texture, queue: queue, release: false)
+    }
+
+    // resources are created with VK_SHARING_MODE_EXCLUSIVE,
+    // not required between queues of the same family.
+    private func transferOwnership(of buffer: GPUBuffer?, texture: Texture?, queue: CommandQueue, release: Bool) {
+        assert(queue is VulkanCommandQueue)
+        let queueFamilyIndex = (self.commandBuffer as! VulkanCommandBuffer).queueFamily.familyIndex
+        let otherFamilyIndex = (queue as! VulkanCommandQueue).family.familyIndex
+        if queueFamilyIndex == otherFamilyIndex { return }
+
+        let encoder = self.encoder!
+        var cmd = OwnershipTransferCommand(buffer: nil,
+                                           imageIndex: -1,
+                                           srcQueueFamilyIndex: release ? queueFamilyIndex : otherFamilyIndex,
+                                           dstQueueFamilyIndex: release ? otherFamilyIndex : queueFamilyIndex,
+                                           release: release)
+        if let buffer {
+            assert(buffer is VulkanBufferView)
+            cmd.buffer = (buffer as! VulkanBufferView).buffer!.buffer
+            encoder.buffers.append(buffer)
+        }
+        if let texture {
+            assert(texture is VulkanImageView)
+            cmd.imageIndex = encoder.imageIndex((texture as! VulkanImageView).image!)
+            encoder.textures.append(texture)
         }
-        self.encoder!.commands.append(command)
+        encoder.append(.ownershipTransfer, cmd)
+    }
+
+    func callback(_ fn: @escaping (_:VkCommandBuffer)->Void) {
+        let encoder = self.encoder!
+        encoder.append(.callback, CallbackCommand(callbackIndex: encoder.callbacks.count))
+        encoder.callbacks.append(fn)
     }
 
     private func setupSubresource(_ subresource: inout VkImageSubresourceLayers,
@@ -12,7 +12,8 @@ import Vulkan
 final class VulkanDescriptorSet {
     let device: VulkanGraphicsDevice
     let descriptorSet: VkDescriptorSet
-    let descriptorPool: VulkanDescriptorPool
+    // nil if allocated by VulkanDescriptorSetAllocator, the pool is reset as a whole.
+    let descriptorPool: VulkanDescriptorPool?
 
     struct Binding {
         let layoutBinding: VkDescriptorSetLayoutBinding
@@ -27,17 +28,27 @@ final class VulkanDescriptorSet {
 
         var write = VkWriteDescriptorSet()
         var valueSet = false
+
+        // buffers may have been moved by defragmentMemory()
+        func currentBuffer(at index: Int) -> VkBuffer? {
+            if index < bufferViews.count, let buffer = bufferViews[index].buffer {
+                return buffer.buffer
+            }
+            return bufferInfos[index].buffer
+        }
     }
     var bindings: [Binding] = []
 
-    init(device: VulkanGraphicsDevice, descriptorPool: VulkanDescriptorPool, descriptorSet: VkDescriptorSet) {
+    init(device: VulkanGraphicsDevice, descriptorPool: VulkanDescriptorPool?, descriptorSet: VkDescriptorSet) {
         self.device = device
         self.descriptorPool = descriptorPool
         self.descriptorSet = descriptorSet
     }
 
     deinit {
-        device.releaseDescriptorSets([self.descriptorSet], pool: self.descriptorPool)
+        if let descriptorPool {
+            device.releaseDescriptorSets([self.descriptorSet], pool: descriptorPool)
+        }
     }
 
     struct ImageLayoutInfo {
@@ -0,0 +1,153 @@
+//
+//  File: VulkanDescriptorSetAllocator.swift
+//  Author: Hongtae Kim (tiff2766@gmail.com)
+//
+//  Copyright (c) 2022-2025 Hongtae Kim. All rights reserved.
+//
+
+#if ENABLE_VULKAN
+import Foundation
+import Vulkan
+
+// Linear descriptor set allocator of a command encoder.
+// Sets are never freed one by one, the pools are returned to the device
+// and reset when the encoder is released, which happens after the command
+// buffer has completed. Used from the encoding thread only, no locks.
+// Binding sets with identical contents share a descriptor set.
+final class VulkanDescriptorSetAllocator {
+    // fixed size key, contents of the bindings are hashed without
+    // copying them. a set found by the key is verified with matches().
+    struct ContentKey: Hashable {
+        let layout: VkDescriptorSetLayout
+        let contents: Int
+
+        init(layout: VkDescriptorSetLayout, bindings: [VulkanDescriptorSet.Binding]) {
+            var hasher = Hasher()
+            for binding in bindings where binding.valueSet {
+                hasher.combine(binding.layoutBinding.binding)
+                hasher.combine(binding.layoutBinding.descriptorType.rawValue)
+                for info in binding.imageInfos {
+                    hasher.combine(info.sampler)
+                    hasher.combine(info.imageView)
+                    hasher.combine(info.imageLayout.rawValue)
+                }
+                for (index, info) in binding.bufferInfos.enumerated() {
+                    hasher.combine(binding.currentBuffer(at: index))
+                    hasher.combine(info.offset)
+                    hasher.combine(info.range)
+                }
+                for view in binding.texelBufferViews {
+                    hasher.combine(view)
+                }
+            }
+            self.layout = layout
+            self.contents = hasher.finalize()
+        }
+
+        // bindings written to a descriptor set, compared with the current
+        // bindings of the same layout.
+        static func matches(_ written: [VulkanDescriptorSet.Binding],
+                            _ bindings: [VulkanDescriptorSet.Binding]) -> Bool {
+            if written.count != bindings.count { return false }
+            for (w, b) in zip(written, bindings) {
+                if w.valueSet != b.valueSet { return false }
+                if b.valueSet == false { continue }
+                if w.layoutBinding.binding != b.layoutBinding.binding ||
+                    w.layoutBinding.descriptorType != b.layoutBinding.descriptorType {
+                    return false
+                }
+                if w.imageInfos.count != b.imageInfos.count ||
+                    w.bufferInfos.count != b.bufferInfos.count ||
+                    w.texelBufferViews != b.texelBufferViews {
+                    return false
+                }
+                for (x, y) in zip(w.imageInfos, b.imageInfos) {
+                    if x.sampler != y.sampler || x.imageView != y.imageView ||
+                        x.imageLayout != y.imageLayout {
+                        return false
+                    }
+                }
+                for (index, (x, y)) in zip(w.bufferInfos, b.bufferInfos).enumerated() {
+                    if x.buffer != b.currentBuffer(at: index) ||
+                        x.offset != y.offset || x.range != y.range {
+                        return false
+                    }
+                }
+            }
+            return true
+        }
+    }
+
+    struct Statistics {
+        var requested = 0
+        var allocated = 0
+        var reused: Int { requested - allocated }
+        var pools = 0
+    }
+
+    let device: VulkanGraphicsDevice
+    private(set) var statistics = Statistics()
+    private var pools: [VkDescriptorPool] = []
+    private var cache: [ContentKey: Int] = [:]
+
+    init(device: VulkanGraphicsDevice) {
+        self.device = device
+    }
+
+    deinit {
+        device.recycleLinearDescriptorPools(pools, statistics: statistics)
+    }
+
+    // returns the index of the descriptor set in descriptorSets,
+    // a new set is appended unless a set with the same contents exists.
+    func descriptorSetIndex(for bindingSet: VulkanShaderBindingSet,
+                            descriptorSets: inout [VulkanDescriptorSet]) -> Int {
+        statistics.requested += 1
+
+        let key = ContentKey(layout: bindingSet.descriptorSetLayout, bindings: bindingSet.bindings)
+        if let index = cache[key],
+           ContentKey.matches(descriptorSets[index].bindings, bindingSet.bindings) {
+            return index
+        }
+        statistics.allocated += 1
+
+        let descriptorSet: VulkanDescriptorSet
+        if let set = allocate(layout: bindingSet.descriptorSetLayout) {
+            descriptorSet = VulkanDescriptorSet(device: device, descriptorPool: nil, descriptorSet: set)
+            bindingSet.writeDescriptorSet(descriptorSet, bindings: bindingSet.currentBindings())
+        } else {
+            // the layout does not fit in a linear pool.
+            descriptorSet = bindingSet.makeDescriptorSet()
+        }
+        let index = descriptorSets.count
+        descriptorSets.append(descriptorSet)
+        cache[key] = index
+        return index
+    }
+
+    private func allocate(layout: VkDescriptorSetLayout) -> VkDescriptorSet? {
+        if let pool = pools.last, let set = allocate(layout: layout, pool: pool) {
+            return set
+        }
+        // the current pool is full.
+        guard let pool = device.acquireLinearDescriptorPool() else { return nil }
+        pools.append(pool)
+        statistics.pools += 1
+        return allocate(layout: layout, pool: pool)
+    }
+
+    private func allocate(layout: VkDescriptorSetLayout, pool: VkDescriptorPool) -> VkDescriptorSet? {
+        var allocateInfo = VkDescriptorSetAllocateInfo()
+        allocateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO
+        allocateInfo.descriptorPool = pool
+        allocateInfo.descriptorSetCount = 1
+
+        var descriptorSet: VkDescriptorSet? = nil
+        let result: VkResult = withUnsafePointer(to: Optional(layout)) {
+            allocateInfo.pSetLayouts = $0
+            return vkAllocateDescriptorSets(device.device, &allocateInfo, &descriptorSet)
+        }
+        return result == VK_SUCCESS ? descriptorSet : nil
+    }
+}
+#endif //if ENABLE_VULKAN
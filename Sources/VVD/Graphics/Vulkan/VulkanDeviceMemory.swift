@@ -12,6 +12,7 @@ import Vulkan
 struct VulkanMemoryBlock {
     let offset: UInt64
     let size: UInt64
+    let allocation: TLSFAllocator.Allocation
     unowned var chunk: VulkanMemoryChunk?
 
     var propertyFlags: VkMemoryPropertyFlags {
@@ -22,13 +23,12 @@ struct VulkanMemoryBlock {
 struct VulkanMemoryAllocationContext {
     let device: VkDevice
     let atomSize: VkDeviceSize
+    let bufferImageGranularity: VkDeviceSize
     let allocationCallbacks: ()->UnsafePointer<VkAllocationCallbacks>?
 }
 
 final class VulkanMemoryChunk {
     let chunkSize: UInt64
-    let blockSize: UInt64
-    let totalBlocks: UInt64
     let dedicated: Bool
 
     var mapped: UnsafeMutableRawPointer?
@@ -39,7 +39,10 @@ final class VulkanMemoryChunk {
     unowned let allocator: VulkanMemoryAllocator?
 
     private let context: VulkanMemoryAllocationContext
-    private var freeBlocks: [VulkanMemoryBlock]
+    // synchronized by the owner (allocator or pool)
+    fileprivate var heap: TLSFAllocator
+    // allocations are being moved out, no new allocations.
+    fileprivate var isEvacuating = false
 
     @discardableResult
     func invalidate(offset: UInt64, size: UInt64) -> Bool {
@@ -114,21 +117,26 @@ final class VulkanMemoryChunk {
         return false
     }
 
-    func push(_ block: VulkanMemoryBlock) {
-        assert(block.chunk === self)
-        assert(block.size <= self.blockSize)
-        assert(block.offset < self.chunkSize)
-
-        let block2 = VulkanMemoryBlock(offset: block.offset, size: blockSize, chunk: self)
-        freeBlocks.append(block2)
-        assert(freeBlocks.count <= totalBlocks)
+    func alloc(size: UInt64, alignment: UInt64, kind: TLSFAllocator.ResourceKind) -> VulkanMemoryBlock? {
+        if let allocation = heap.alloc(size: size, alignment: alignment, kind: kind) {
+            return VulkanMemoryBlock(offset: allocation.offset,
+                                     size: allocation.size,
+                                     allocation: allocation,
+                                     chunk: self)
+        }
+        return nil
     }
 
-    func pop() -> VulkanMemoryBlock? {
-        freeBlocks.popLast()
+    func free(_ block: VulkanMemoryBlock) {
+        assert(block.chunk === self)
+        assert(block.offset < self.chunkSize)
+        heap.free(block.allocation)
     }
 
-    var numFreeBlocks: Int { freeBlocks.count }
+    var isEmpty: Bool { heap.isEmpty }
+    var numAllocations: Int { heap.numAllocations }
+    var memorySizeInUse: UInt64 { heap.requestedSize }
+    var statistics: TLSFAllocator.Statistics { heap.statistics }
 
     init(context: VulkanMemoryAllocationContext,
          pool: VulkanMemoryPool,
@@ -136,8 +144,7 @@ final class VulkanMemoryChunk {
          memory: VkDeviceMemory,
          propertyFlags: VkMemoryPropertyFlags,
          chunkSize: UInt64,
-         blockSize: UInt64,
-         totalBlocks: UInt64,
+         granularity: UInt64,
          dedicated: Bool) {
         let atomSize = context.atomSize
         assert(chunkSize % atomSize == 0)
@@ -148,9 +155,9 @@ final class VulkanMemoryChunk {
         self.memory = memory
         self.propertyFlags = propertyFlags
         self.chunkSize = chunkSize
-        self.blockSize = blockSize
-        self.totalBlocks = totalBlocks
         self.dedicated = dedicated
+        self.heap = TLSFAllocator(size: TLSFAllocator.alignUp(chunkSize, TLSFAllocator.minAlignment),
+                                  granularity: granularity)
 
         if propertyFlags & UInt32(VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT.rawValue) != 0 {
             let offset: VkDeviceSize = 0
@@ -161,19 +168,10 @@ final class VulkanMemoryChunk {
                 Log.err("vkMapMemory failed: \(result)")
             }
         }
-
-        self.freeBlocks = []
-        freeBlocks.reserveCapacity(Int(totalBlocks))
-        var offset: UInt64 = 0
-        for _ in 0..<totalBlocks {
-            let block = VulkanMemoryBlock(offset: offset, size: blockSize, chunk: self)
-            freeBlocks.append(block)
-            offset += blockSize
-        }
     }
 
     deinit {
-        assert(freeBlocks.count == totalBlocks)        
+        assert(heap.isEmpty)
         if self.mapped != nil {
             vkUnmapMemory(context.device, self.memory)
             self.mapped = nil
@@ -186,7 +184,7 @@ final class VulkanMemoryAllocator {
     var numAllocations: Int {
         mutex.withLock {
             chunks.reduce(0) { result, chunk in
-                result + Int(chunk.totalBlocks) - chunk.numFreeBlocks
+                result + chunk.numAllocations
             }
         }
     }
@@ -204,27 +202,36 @@ final class VulkanMemoryAllocator {
     }
 
     var memorySizeInUse: UInt64 { 
-        mutex.withLock { self.memoryInUse }
+        mutex.withLock {
+            chunks.reduce(UInt64(0)) { result, chunk in
+                result + chunk.memorySizeInUse
+            }
+        }
     }
 
-    func alloc(_ size: UInt64) -> VulkanMemoryBlock? {
-        if size > blockSize { return nil }
+    var statistics: TLSFAllocator.Statistics {
+        mutex.withLock {
+            chunks.reduce(TLSFAllocator.Statistics()) { result, chunk in
+                result + chunk.statistics
+            }
+        }
+    }
+
+    func alloc(size: UInt64, alignment: UInt64, kind: TLSFAllocator.ResourceKind) -> VulkanMemoryBlock? {
+        if size > maxAllocationSize { return nil }
 
         mutex.lock()
         defer { mutex.unlock() }
 
-        if let chunk = self.chunks.first(where: { $0.numFreeBlocks > 0 }) {
-            let block = chunk.pop()!
-            assert(block.size >= size)
-            self.memoryInUse += size
-            return VulkanMemoryBlock(offset: block.offset, size: size, chunk: block.chunk)
+        for chunk in self.chunks where chunk.isEvacuating == false {
+            if let block = chunk.alloc(size: size, alignment: alignment, kind: kind) {
+                return block
+            }
         }
         // allocate new chunk
         let context = pool.context
         let memoryTypeIndex = pool.memoryTypeIndex
         let memoryPropertyFlags = pool.memoryPropertyFlags
-        
-        let chunkSize = blockSize * blocksPerChunk
 
         var memAllocInfo = VkMemoryAllocateInfo()
         memAllocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO
@@ -244,14 +251,12 @@ final class VulkanMemoryAllocator {
                                       memory: memory!,
                                       propertyFlags: memoryPropertyFlags,
                                       chunkSize: chunkSize,
-                                      blockSize: blockSize,
-                                      totalBlocks: blocksPerChunk,
+                                      granularity: context.bufferImageGranularity,
                                       dedicated: false)
         self.chunks.append(chunk)
-        let block = chunk.pop()!
-        assert(block.size >= size)
-        self.memoryInUse += size
-        return VulkanMemoryBlock(offset: block.offset, size: size, chunk: block.chunk)
+        let block = chunk.alloc(size: size, alignment: alignment, kind: kind)
+        assert(block != nil)
+        return block
     }
 
     func dealloc(_ block: inout VulkanMemoryBlock) {
@@ -260,24 +265,19 @@ final class VulkanMemoryAllocator {
             defer { mutex.unlock() }
 
             assert(chunk.allocator === self)
-            assert(chunk.blockSize == self.blockSize)
-            assert(self.memoryInUse >= block.size)
-            self.memoryInUse -= block.size
-            chunk.push(block)
+            relocatableBuffers[BlockKey(chunk: ObjectIdentifier(chunk), block: block.allocation.block)] = nil
+            chunk.free(block)
             block.chunk = nil
 
-            if chunk.numFreeBlocks == chunk.totalBlocks {
-                let freeBlocks = self.chunks.reduce(0) { result, chunk in
-                    result + chunk.numFreeBlocks
-                }
-                if freeBlocks > blocksPerChunk + (blocksPerChunk >> 2) {
+            // keep one empty chunk to avoid reallocating device memory
+            // when the usage goes back and forth around a chunk boundary.
+            if chunk.isEmpty {
+                if self.chunks.contains(where: { $0 !== chunk && $0.isEmpty }) {
                     if let index = self.chunks.firstIndex(where: { $0 === chunk }) {
                         self.chunks.remove(at: index)
                     }
                 }
             }
-            // sort by most used to reduce fragmentation
-            chunks.sort { $0.numFreeBlocks < $1.numFreeBlocks }
         }
     }
 
@@ -285,82 +285,214 @@ final class VulkanMemoryAllocator {
         var purged: UInt64 = 0
         mutex.lock()
         defer { mutex.unlock() }
-        while true {
-            let index = chunks.firstIndex(where: {
-                $0.numFreeBlocks == $0.totalBlocks
-            })
-            guard let index else { break }
-            let chunk = chunks[index]
-            purged += chunk.chunkSize
-            chunks.remove(at: index)
+        self.chunks.removeAll { chunk in
+            if chunk.isEmpty {
+                purged += chunk.chunkSize
+                return true
+            }
+            return false
         }
         return purged
     }
 
-    let blockSize: UInt64
-    let blocksPerChunk: UInt64
+    // buffers that can be moved by defragment(),
+    // images and host visible buffers are never moved.
+    func setRelocatable(_ buffer: VulkanBuffer, alignment: UInt64) {
+        guard let memory = buffer.memory, let chunk = memory.chunk else { return }
+        assert(chunk.allocator === self)
+        mutex.withLock {
+            let key = BlockKey(chunk: ObjectIdentifier(chunk), block: memory.allocation.block)
+            relocatableBuffers[key] = RelocatableBuffer(buffer: WeakObject(buffer), alignment: alignment)
+        }
+    }
+
+    // plans a pass and encodes copies of the buffers to be moved.
+    // buffers are switched to the new memory when the copies are complete,
+    // the previous buffers are released after every command buffer created
+    // before the switch is released. (VulkanRetiredResources)
+    // only idle buffers are moved, a buffer written while its copy is in
+    // flight keeps the previous memory and the copy is discarded.
+    func defragment(commandBuffer: CommandBuffer, defragmenter: MemoryDefragmenter) -> MemoryDefragmenter.Pass {
+        mutex.lock()
+        defer { mutex.unlock() }
+
+        if passInFlight { return MemoryDefragmenter.Pass() }
+
+        var heaps = chunks.map(\.heap)
+        var pass = defragmenter.plan(&heaps) { index, allocation in
+            let key = BlockKey(chunk: ObjectIdentifier(chunks[index]), block: allocation.block)
+            if let entry = relocatableBuffers[key], let buffer = entry.buffer.value, buffer.isIdle {
+                return entry.alignment
+            }
+            return nil
+        }
+        if pass.moves.isEmpty { return pass }
+        for (chunk, heap) in zip(chunks, heaps) {
+            chunk.heap = heap
+        }
+
+        guard let encoder = commandBuffer.makeCopyCommandEncoder() else {
+            for move in pass.moves {
+                chunks[move.destination].heap.free(move.destinationAllocation)
+            }
+            return MemoryDefragmenter.Pass()
+        }
+
+        var relocations: [Relocation] = []
+        var moves: [MemoryDefragmenter.Move] = []
+        var failedHeaps: Set<Int> = []
+        for move in pass.moves {
+            let source = chunks[move.source]
+            let destination = chunks[move.destination]
+            let key = BlockKey(chunk: ObjectIdentifier(source), block: move.sourceAllocation.block)
+            let block = VulkanMemoryBlock(offset: move.destinationAllocation.offset,
+                                          size: move.destinationAllocation.size,
+                                          allocation: move.destinationAllocation,
+                                          chunk: destination)
+            guard let entry = relocatableBuffers[key],
+                  let buffer = entry.buffer.value,
+                  let writeSerial = buffer.idleWriteSerial,
+                  let copy = makeBuffer(like: buffer, memory: block) else {
+                destination.heap.free(move.destinationAllocation)
+                failedHeaps.insert(move.source)
+                continue
+            }
+            encoder.copy(from: VulkanBufferView(buffer: buffer), sourceOffset: 0,
+                         to: VulkanBufferView(buffer: copy), destinationOffset: 0,
+                         size: buffer.length)
+            relocations.append(Relocation(buffer: buffer,
+                                          copy: copy,
+                                          writeSerial: writeSerial,
+                                          alignment: entry.alignment,
+                                          source: key,
+                                          destination: BlockKey(chunk: ObjectIdentifier(destination),
+                                                                block: move.destinationAllocation.block)))
+            moves.append(move)
+            source.isEvacuating = true
+        }
+        encoder.endEncoding()
+
+        pass.moves = moves
+        pass.bytesMoved = moves.reduce(0) { $0 + $1.sourceAllocation.size }
+        pass.releasedHeaps.removeAll { failedHeaps.contains($0) }
+        pass.reclaimedBytes = pass.releasedHeaps.reduce(0) { $0 + chunks[$1].chunkSize }
+        if relocations.isEmpty { return pass }
+
+        let evacuating = chunks.filter { $0.isEvacuating }
+        let retiredResources = (commandBuffer.device as! VulkanGraphicsDevice).retiredResources
+        passInFlight = true
+        commandBuffer.addCompletedHandler { _ in
+            // retire() may release buffers of previous passes, dealloc() locks again.
+            defer { relocations.forEach { retiredResources.retire($0.copy) } }
+            self.mutex.withLock {
+                for relocation in relocations {
+                    // after the exchange, the copy holds the previous buffer.
+                    // a stale copy (written during the move) is only used by
+                    // this command buffer, which is still alive.
+                    if relocation.buffer.exchange(with: relocation.copy,
+                                                  writeSerial: relocation.writeSerial) {
+                        self.relocatableBuffers[relocation.source] = nil
+                        self.relocatableBuffers[relocation.destination] =
+                            RelocatableBuffer(buffer: WeakObject(relocation.buffer), alignment: relocation.alignment)
+                    }
+                }
+                evacuating.forEach { $0.isEvacuating = false }
+                self.passInFlight = false
+            }
+        }
+        return pass
+    }
+
+    // called if the command buffer of the last pass could not be committed,
+    // the completed handler never runs. the copies and their destination
+    // allocations are released with the command buffer.
+    func cancelDefragment() {
+        mutex.withLock {
+            guard passInFlight else { return }
+            chunks.forEach { $0.isEvacuating = false }
+            passInFlight = false
+        }
+    }
+
+    private func makeBuffer(like buffer: VulkanBuffer, memory: VulkanMemoryBlock) -> VulkanBuffer? {
+        let device = buffer.device as! VulkanGraphicsDevice
+
+        var bufferCreateInfo = VkBufferCreateInfo()
+        bufferCreateInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO
+        bufferCreateInfo.size = buffer.size
+        bufferCreateInfo.usage = buffer.usage
+        bufferCreateInfo.sharingMode = buffer.sharingMode
+
+        var handle: VkBuffer? = nil
+        var result = vkCreateBuffer(device.device, &bufferCreateInfo, device.allocationCallbacks, &handle)
+        if result != VK_SUCCESS {
+            Log.err("vkCreateBuffer failed: \(result)")
+            return nil
+        }
+        result = vkBindBufferMemory(device.device, handle, memory.chunk!.memory, memory.offset)
+        if result != VK_SUCCESS {
+            Log.err("vkBindBufferMemory failed: \(result)")
+            vkDestroyBuffer(device.device, handle, device.allocationCallbacks)
+            return nil
+        }
+        return VulkanBuffer(device: device, memory: memory, buffer: handle!, bufferCreateInfo: bufferCreateInfo)
+    }
+
+    let chunkSize: UInt64
+    let maxAllocationSize: UInt64
 
     unowned let pool: VulkanMemoryPool
 
     private let mutex = NSLock()
-    private var memoryInUse: UInt64 = 0
     private var chunks: [VulkanMemoryChunk] = []
 
-    init(pool: VulkanMemoryPool, size: UInt64, blocks: UInt64) {
+    private struct BlockKey: Hashable {
+        let chunk: ObjectIdentifier
+        let block: Int32
+    }
+    private struct RelocatableBuffer {
+        let buffer: WeakObject<VulkanBuffer>
+        let alignment: UInt64
+    }
+    private struct Relocation {
+        let buffer: VulkanBuffer
+        let copy: VulkanBuffer
+        let writeSerial: UInt64
+        let alignment: UInt64
+        let source: BlockKey
+        let destination: BlockKey
+    }
+    private var relocatableBuffers: [BlockKey: RelocatableBuffer] = [:]
+    private var passInFlight = false
+
+    init(pool: VulkanMemoryPool, chunkSize: UInt64, maxAllocationSize: UInt64) {
         self.pool = pool
-        self.blockSize = size
-        self.blocksPerChunk = blocks
+        self.chunkSize = chunkSize
+        self.maxAllocationSize = maxAllocationSize
     }
 }
 
-private let memoryChunkSizeBlocks: [(blockSize: UInt64, numBlocks: UInt64)] = [
-    ( 1024, 512 ),
-    ( 2048, 512 ),
-    ( 4096, 512 ),
-    ( 8192, 512 ),
-    ( 16384, 256 ),
-    ( 32768, 256 ),
-    ( 65536, 256 ),
-    ( 131072, 256 ),
-    ( 262144, 256 ),
-    ( 524288, 256 ),
-    ( 1048576, 128 ),
-    ( 2097152, 64 ),
-    ( 4194304, 32 ),
-    ( 8388608, 16 ),
-    ( 16777216, 8 ),
-    ( 33554432, 4 ), // 32M
-]
-
 final class VulkanMemoryPool {
     let memoryTypeIndex: UInt32
     let memoryPropertyFlags: VkMemoryPropertyFlags
     let memoryHeap: VkMemoryHeap
 
-    func alloc(size: UInt64) -> VulkanMemoryBlock? {
+    // 256MB chunks, 1/8 of the heap for small heaps.
+    // allocations larger than 1/8 of the chunk get their own device memory.
+    static let maxChunkSize: UInt64 = 256 << 20
+    static let minChunkSize: UInt64 = 4 << 20
+
+    static func chunkSize(heapSize: UInt64) -> UInt64 {
+        let size = min(heapSize / 8, maxChunkSize)
+        if size <= minChunkSize { return minChunkSize }
+        return UInt64(1) << UInt64(63 - size.leadingZeroBitCount)
+    }
+
+    func alloc(size: UInt64, alignment: UInt64 = 1, kind: TLSFAllocator.ResourceKind = .linear) -> VulkanMemoryBlock? {
         assert(size > 0)
 
-        let lowerBound = { (size: UInt)-> VulkanMemoryAllocator? in
-            var first = 0
-            var count = self.allocators.count
-            while count > 0 {
-                let step = count / 2
-                let pos = first + step
-                if self.allocators[pos].blockSize < size {
-                    first = pos + 1
-                    count -= step + 1
-                } else {
-                    count = step
-                }
-            }
-            if first < self.allocators.count {
-                return self.allocators[first]
-            }
-            return nil
-        }
-        if let allocator = lowerBound(UInt(size)) {
-            assert(allocator.blockSize >= size)
-            return allocator.alloc(size)
+        if size <= allocator.maxAllocationSize {
+            return allocator.alloc(size: size, alignment: alignment, kind: kind)
         }
 
         var memAllocInfo = VkMemoryAllocateInfo()
@@ -379,13 +511,12 @@ final class VulkanMemoryPool {
                                       memory: memory!,
                                       propertyFlags: memoryPropertyFlags,
                                       chunkSize: size,
-                                      blockSize: size,
-                                      totalBlocks: 1,
+                                      granularity: 1,
                                       dedicated: false)
         mutex.lock()
         defer { mutex.unlock() }
         self.dedicatedAllocations.updateValue(chunk, forKey: ObjectIdentifier(chunk))
-        return chunk.pop()
+        return chunk.alloc(size: size, alignment: 1, kind: kind)
     }
 
     func allocDedicated(size: UInt64, image: VkImage?, buffer: VkBuffer?) -> VulkanMemoryBlock? {
@@ -420,13 +551,12 @@ final class VulkanMemoryPool {
                                       memory: memory!,
                                       propertyFlags: memoryPropertyFlags,
                                       chunkSize: size,
-                                      blockSize: size,
-                                      totalBlocks: 1,
-                                      dedicated: false)
+                                      granularity: 1,
+                                      dedicated: true)
         mutex.lock()
         defer { mutex.unlock() }
         self.dedicatedAllocations.updateValue(chunk, forKey: ObjectIdentifier(chunk))
-        return chunk.pop()
+        return chunk.alloc(size: size, alignment: 1, kind: image != nil ? .optimal : .linear)
     }
 
     func dealloc(_ block: inout VulkanMemoryBlock) {
@@ -441,36 +571,40 @@ final class VulkanMemoryPool {
                 dedicatedAllocations[ObjectIdentifier(chunk)] = nil
                 mutex.unlock()
 
-                chunk.push(block)
+                chunk.free(block)
                 block.chunk = nil
             }
         }
     }
 
     func purge() -> UInt64 {
-        allocators.reduce(UInt64(0)) { result, alloc in
-            result + alloc.purge()
-        }
+        allocator.purge()
+    }
+
+    func setRelocatable(_ buffer: VulkanBuffer, alignment: UInt64) {
+        buffer.memory?.chunk?.allocator?.setRelocatable(buffer, alignment: alignment)
+    }
+
+    func defragment(commandBuffer: CommandBuffer, defragmenter: MemoryDefragmenter) -> MemoryDefragmenter.Pass {
+        allocator.defragment(commandBuffer: commandBuffer, defragmenter: defragmenter)
+    }
+
+    func cancelDefragment() {
+        allocator.cancelDefragment()
     }
 
     var numAllocations: Int {
-        let count = allocators.reduce(0) { result, alloc in
-            result + alloc.numAllocations
-        }
+        let count = allocator.numAllocations
         return mutex.withLock { count + dedicatedAllocations.count }
     }
 
     var numDeviceAllocations: Int { 
-        let count = allocators.reduce(0) { result, alloc in
-            result + alloc.numDeviceAllocations
-        }
+        let count = allocator.numDeviceAllocations
         return mutex.withLock { count + dedicatedAllocations.count }
     }
 
     var totalMemorySize: UInt64 { 
-        let size = allocators.reduce(UInt64(0)) { result, alloc in
-            result + alloc.totalMemorySize
-        }
+        let size = allocator.totalMemorySize
         return mutex.withLock {
             dedicatedAllocations.reduce(size) { result, element in
                 return result + element.1.chunkSize
@@ -479,9 +613,7 @@ final class VulkanMemoryPool {
     }
 
     var memorySizeInUse: UInt64 { 
-        let size = allocators.reduce(UInt64(0)) { result, alloc in
-            result + alloc.memorySizeInUse
-        }
+        let size = allocator.memorySizeInUse
         return mutex.withLock {
             dedicatedAllocations.reduce(size) { result, element in
                 return result + element.1.chunkSize
@@ -489,9 +621,20 @@ final class VulkanMemoryPool {
         }
     }
 
+    // sub-allocated chunks and standalone allocations together,
+    // fragmentation is only meaningful for the sub-allocated part.
+    var statistics: TLSFAllocator.Statistics {
+        let stats = allocator.statistics
+        return mutex.withLock {
+            dedicatedAllocations.reduce(stats) { result, element in
+                return result + element.1.statistics
+            }
+        }
+    }
+
     let context: VulkanMemoryAllocationContext
 
-    private var allocators: [VulkanMemoryAllocator]
+    private var allocator: VulkanMemoryAllocator!
     private let mutex = NSLock()
     var dedicatedAllocations: [ObjectIdentifier: VulkanMemoryChunk] = [:]
 
@@ -501,10 +644,10 @@ final class VulkanMemoryPool {
         self.memoryPropertyFlags = flags
         self.memoryHeap = heap
 
-        self.allocators = []
-        self.allocators = memoryChunkSizeBlocks.map {
-            VulkanMemoryAllocator(pool: self, size: $0.blockSize, blocks: $0.numBlocks)
-        }
+        let chunkSize = Self.chunkSize(heapSize: heap.size)
+        self.allocator = VulkanMemoryAllocator(pool: self,
+                                               chunkSize: chunkSize,
+                                               maxAllocationSize: chunkSize / 8)
     }
 
     deinit {
@@ -9,7 +9,9 @@
 import Foundation
 import Vulkan
 
+// pipeline cache used to be stored in UserDefaults, removed on load.
 private let pipelineCacheDataKey = "_SavedSystemStates.Vulkan.PipelineCacheData"
+private let pipelineCacheFileKey = "PipelineCacheData"
 
 extension VkSampleCountFlagBits {
     init?(from value: Int) {
@@ -47,22 +49,32 @@ final class VulkanGraphicsDevice: GraphicsDevice, @unchecked Sendable {
     private var memoryPools: [VulkanMemoryPool]
 
     private var pipelineCache: VkPipelineCache?
+    private var pipelineCacheStore: DiskCache?
+    // parent directory of the pipeline cache of devices created after,
+    // nil for DiskCache.defaultDirectory.
+    nonisolated(unsafe) static var pipelineCacheDirectory: URL? = nil
+    private var savedPipelineCacheSize = 0
+    private let pipelineCacheLock = NSLock()
 
-    private struct FenceCallback {
-        let fence: VkFence
-        let operation: @Sendable () -> Void
-    }
-    private var pendingFenceCallbacks: [FenceCallback] = []
-    private var reusableFences: [VkFence] = []
-    private var numberOfFences: UInt = 0
-    private var fenceCompletionLock = NSLock()
+    let completionMonitor: VulkanQueueCompletionMonitor
+    let retiredResources = VulkanRetiredResources()
 
     private struct DescriptorPoolChainMap {
         var poolChainMap: [VulkanDescriptorPoolID: VulkanDescriptorPoolChain] = [:]
         let lock = NSLock()
     }
     private var descriptorPoolChainMaps: [DescriptorPoolChainMap] = .init(repeating: DescriptorPoolChainMap(), count: 7)
-    private var task: Task<Void, Never>?
+
+    // pools of VulkanDescriptorSetAllocator, reset when returned.
+    private struct LinearDescriptorPools {
+        var pools: [VkDescriptorPool] = []
+        var numPools = 0
+        var statistics = VulkanDescriptorSetAllocator.Statistics()
+    }
+    private var linearDescriptorPools = LinearDescriptorPools()
+    private let linearDescriptorPoolLock = NSLock()
+    private let linearDescriptorPoolMaxSets: UInt32 = 256
+    private let maxReusableLinearDescriptorPools = 16
 
     init?(instance: VulkanInstance,
           physicalDevice: VulkanPhysicalDeviceDescription,
@@ -175,6 +187,8 @@ final class VulkanGraphicsDevice: GraphicsDevice, @unchecked Sendable {
         }
         self.device = device!
         self.extensionProc.load(device: self.device)
+        self.completionMonitor = VulkanQueueCompletionMonitor(device: self.device,
+                                                              allocationCallbacks: instance.allocationCallbacks)
 
         self.deviceMemoryTypes = .init(unsafeUninitializedCapacity: Int(physicalDevice.memory.memoryTypeCount)) {
             buffer, initializedCount in
@@ -244,7 +258,8 @@ final class VulkanGraphicsDevice: GraphicsDevice, @unchecked Sendable {
         // init memory pools
         let memoryAllocationContext = VulkanMemoryAllocationContext(
             device: self.device, 
-            atomSize: self.properties.limits.nonCoherentAtomSize) {
+            atomSize: self.properties.limits.nonCoherentAtomSize,
+            bufferImageGranularity: self.properties.limits.bufferImageGranularity) {
             instance.allocationCallbacks
         }
         self.memoryPools = self.deviceMemoryTypes.enumerated().map { index, type in
@@ -255,104 +270,15 @@ final class VulkanGraphicsDevice: GraphicsDevice, @unchecked Sendable {
         }
 
         self.loadPipelineCache()
-
-        self.task = .detached(priority: .background) { [weak self] in
-            let taskID = UUID()
-            detachedServiceTasks.withLock { $0[taskID] = "VulkanGraphicsDevice Helper task" }
-            defer {
-                detachedServiceTasks.withLock { $0[taskID] = nil }
-            }
-
-            Log.info("VulkanGraphicsDevice Helper task is started.")
-
-            var err: VkResult = VK_SUCCESS
-            var fences: [VkFence?] = []
-            var waitingFences: [FenceCallback] = []
-            var completionHandlers: [@Sendable ()->Void] = []
-
-            let fenceWaitInterval = DispatchTimeInterval.milliseconds(4)
-            var timestamp = DispatchTime.now()
-
-            mainLoop: while true {
-                guard let self = self else { break }
-                if Task.isCancelled { break }
-
-                self.fenceCompletionLock.withLock {
-                    waitingFences.append(contentsOf: self.pendingFenceCallbacks)
-                    self.pendingFenceCallbacks.removeAll(keepingCapacity: true)
-                }
-
-                if waitingFences.isEmpty == false {
-                    fences.removeAll(keepingCapacity: true)
-                    fences.reserveCapacity(waitingFences.count)
-                    waitingFences.forEach { fences.append($0.fence) }
-
-                    err = vkWaitForFences(self.device, UInt32(fences.count), fences, VK_FALSE, 0)
-                    fences.removeAll(keepingCapacity: true)
-
-                    if err == VK_SUCCESS {
-                        var waitingFencesCopy: [FenceCallback] = []
-                        waitingFencesCopy.reserveCapacity(waitingFences.count)
-
-                        for cb in waitingFences {
-                            if vkGetFenceStatus(self.device, cb.fence) == VK_SUCCESS {
-                                fences.append(cb.fence)
-                                completionHandlers.append(cb.operation)
-                            } else {
-                                waitingFencesCopy.append(cb)  // fence is not ready (unsignaled)
-                            }
-                        }
-                        // save unsignaled fences
-                        waitingFences = waitingFencesCopy
-
-                        // reset signaled fences
-                        if fences.count > 0 {
-                            err = vkResetFences(self.device, UInt32(fences.count), fences)
-                            if err != VK_SUCCESS {
-                                Log.err("vkResetFences failed: \(err)")
-                                assertionFailure("vkResetFences failed: \(err)")
-                            }
-                        }
-                    } else if err != VK_TIMEOUT {
-                        Log.err("vkWaitForFences failed: \(err)")
-                        assertionFailure("vkWaitForFences failed: \(err)")
-                    }
-
-                    if completionHandlers.count > 0 {
-                        let dispatchQueue = DispatchQueue.global()
-                        for handler in completionHandlers {
-                            dispatchQueue.async { handler() }
-                        }
-                        completionHandlers.removeAll(keepingCapacity: true)
-                    }
-
-                    if fences.count > 0 {
-                        self.fenceCompletionLock.withLock {
-                            self.reusableFences.append(contentsOf: fences.compactMap{ $0 })
-                        }
-                        fences.removeAll(keepingCapacity: true)
-                    }
-
-                    if err == VK_SUCCESS {
-                        continue
-                    }
-                }
-                repeat {
-                    if Task.isCancelled { break mainLoop }
-                    await Task.yield()
-                } while timestamp + fenceWaitInterval > DispatchTime.now()
-                timestamp = DispatchTime.now()
-            }
-            assert(completionHandlers.isEmpty, "completionHandlers must be empty!")
-            Log.info("VulkanGraphicsDevice Helper task is finished.")
-        }
     }
     
     deinit {
         //Log.debug("VulkanGraphicsDevice is being destroyed.")
 
-        self.task?.cancel()
-
+        for pool in self.linearDescriptorPools.pools {
+            vkDestroyDescriptorPool(self.device, pool, self.allocationCallbacks)
+        }
+        self.linearDescriptorPools.pools.removeAll()
         for maps in self.descriptorPoolChainMaps {
             maps.poolChainMap.forEach{
                 $0.value.descriptorPools.forEach { (pool) in
@@ -364,14 +290,7 @@ final class VulkanGraphicsDevice: GraphicsDevice, @unchecked Sendable {
         }
         vkDeviceWaitIdle(self.device)
 
-        assert(self.pendingFenceCallbacks.isEmpty, "CompletionHandler must be empty!")
-
-        if self.reusableFences.count != self.numberOfFences {
-            Log.warn("Some fences were not returned. \(self.reusableFences.count)/\(self.numberOfFences)")
-        }
-        for fence in self.reusableFences {
-            vkDestroyFence(self.device, fence, self.allocationCallbacks)
-        }
+        self.completionMonitor.stop()
 
         // destroy pipeline cache
         if let pipelineCache = self.pipelineCache {
@@ -394,17 +313,46 @@ final class VulkanGraphicsDevice: GraphicsDevice, @unchecked Sendable {
         var pipelineCacheCreateInfo = VkPipelineCacheCreateInfo()
         pipelineCacheCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO
 
-        // load from user-data
-        if let data = UserDefaults.standard.data(forKey: pipelineCacheDataKey) {
-            let length = data.count
-            if length > 0 {
-                let buffer: UnsafeMutablePointer<UInt8> = .allocate(capacity: length)
-                defer { buffer.deallocate() }
+        if UserDefaults.standard.object(forKey: pipelineCacheDataKey) != nil {
+            UserDefaults.standard.removeObject(forKey: pipelineCacheDataKey)
+        }
+
+        // the cache is only valid for the same device and driver.
+        if self.pipelineCacheStore == nil {
+            let properties = self.properties
+            var identity = Data()
+            withUnsafeBytes(of: properties.vendorID.littleEndian) { identity.append(contentsOf: $0) }
+            withUnsafeBytes(of: properties.deviceID.littleEndian) { identity.append(contentsOf: $0) }
+            withUnsafeBytes(of: properties.driverVersion.littleEndian) { identity.append(contentsOf: $0) }
+            withUnsafeBytes(of: properties.pipelineCacheUUID) { identity.append(contentsOf: $0) }
+            self.pipelineCacheStore = DiskCache(name: "Vulkan.PipelineCache",
+                                                identity: identity,
+                                                directory: Self.pipelineCacheDirectory)
+        }
 
-                data.copyBytes(to: buffer, count: length)
-                pipelineCacheCreateInfo.initialDataSize = length
-                pipelineCacheCreateInfo.pInitialData = UnsafeRawPointer(buffer)
+        let start = DispatchTime.now().uptimeNanoseconds
+        let data = self.pipelineCacheStore?.data(forKey: pipelineCacheFileKey)
+        if let data, data.count > 0 {
+            let length = data.count
+            let buffer: UnsafeMutablePointer<UInt8> = .allocate(capacity: length)
+            defer { buffer.deallocate() }
+
+            data.copyBytes(to: buffer, count: length)
+            pipelineCacheCreateInfo.initialDataSize = length
+            pipelineCacheCreateInfo.pInitialData = UnsafeRawPointer(buffer)
+
+            var pipelineCache: VkPipelineCache? = nil
+            let err = vkCreatePipelineCache(self.device, &pipelineCacheCreateInfo, self.allocationCallbacks, &pipelineCache)
+            if err == VK_SUCCESS {
+                self.pipelineCache = pipelineCache
+                self.savedPipelineCacheSize = length
+                let elapsed = Double(DispatchTime.now().uptimeNanoseconds - start) * 0.000_001
+                Log.info("Vulkan PipelineCache loaded \(length) bytes. (\(String(format: "%.2f", elapsed)) ms)")
+                return
             }
+            Log.warn("vkCreatePipelineCache with saved data failed: \(err)")
+            pipelineCacheCreateInfo.initialDataSize = 0
+            pipelineCacheCreateInfo.pInitialData = nil
         }
         var pipelineCache: VkPipelineCache? = nil
         let err = vkCreatePipelineCache(self.device, &pipelineCacheCreateInfo, self.allocationCallbacks, &pipelineCache)
@@ -440,10 +388,17 @@ final class VulkanGraphicsDevice: GraphicsDevice, @unchecked Sendable {
                     let data: Data = .init(bytesNoCopy: buffer, count: dataLength, deallocator: .custom {
                         pointer, size in pointer.deallocate()
                     })
-                    UserDefaults.standard.set(data, forKey: pipelineCacheDataKey)
-                    UserDefaults.standard.synchronize()
-
-                    Log.info("Vulkan PipelineCache saved \(dataLength) bytes.")
+                    // the cache only grows, unchanged size means unchanged contents.
+                    let changed = pipelineCacheLock.withLock {
+                        if self.savedPipelineCacheSize == dataLength { return false }
+                        self.savedPipelineCacheSize = dataLength
+                        return true
+                    }
+                    if changed, let store = self.pipelineCacheStore {
+                        if store.setData(data, forKey: pipelineCacheFileKey) {
+                            Log.info("Vulkan PipelineCache saved \(dataLength) bytes.")
+                        }
+                    }
                 }
             } else {
                 Log.err("vkGetPipelineCacheData failed: \(result)")
@@ -1179,7 +1134,9 @@ final class VulkanGraphicsDevice: GraphicsDevice, @unchecked Sendable {
         if dedicatedRequirements.prefersDedicatedAllocation != 0 {
             memory = self.memoryPools[memoryTypeIndex].allocDedicated(size: memReqs.size, image: nil, buffer: buffer)
         } else {
-            memory = self.memoryPools[memoryTypeIndex].alloc(size: memReqs.size)
+            memory = self.memoryPools[memoryTypeIndex].alloc(size: memReqs.size,
+                                                             alignment: memReqs.alignment,
+                                                             kind: .linear)
         }
         guard let mem = memory else {
             Log.error("Memory allocation failed.")
@@ -1195,9 +1152,43 @@ final class VulkanGraphicsDevice: GraphicsDevice, @unchecked Sendable {
         buffer = nil
         memory = nil
 
+        // device local buffers can be moved by defragmentMemory()
+        if mem.chunk!.allocator != nil && mem.chunk!.mapped == nil {
+            self.memoryPools[memoryTypeIndex].setRelocatable(bufferObject, alignment: memReqs.alignment)
+        }
         return VulkanBufferView(buffer: bufferObject)
     }
 
+    func defragmentMemory(queue: CommandQueue, maxBytesPerPass: Int) -> Int {
+        guard let commandBuffer = queue.makeCommandBuffer() else { return 0 }
+
+        var defragmenter = MemoryDefragmenter(maxBytesPerPass: UInt64(maxBytesPerPass))
+        var numMoves = 0
+        var bytesMoved: UInt64 = 0
+        var reclaimedBytes: UInt64 = 0
+        let hostVisible = VkMemoryPropertyFlags(VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT.rawValue)
+        for pool in self.memoryPools where pool.memoryPropertyFlags & hostVisible == 0 {
+            defragmenter.maxBytesPerPass = UInt64(maxBytesPerPass) - bytesMoved
+            if defragmenter.maxBytesPerPass == 0 { break }
+            let pass = pool.defragment(commandBuffer: commandBuffer, defragmenter: defragmenter)
+            numMoves += pass.moves.count
+            bytesMoved += pass.bytesMoved
+            reclaimedBytes += pass.reclaimedBytes
+        }
+        if numMoves > 0 {
+            if commandBuffer.commit() == false {
+                Log.err("VulkanGraphicsDevice.defragmentMemory(): CommandBuffer commit failed.")
+                // the buffers stay in place, the copies are released with the command buffer.
+                for pool in self.memoryPools where pool.memoryPropertyFlags & hostVisible == 0 {
+                    pool.cancelDefragment()
+                }
+                return 0
+            }
+            Log.debug("defragmentMemory moved \(numMoves) buffers, \(bytesMoved) bytes, reclaimed \(reclaimedBytes) bytes.")
+        }
+        return Int(reclaimedBytes)
+    }
+
     func makeTexture(descriptor desc: TextureDescriptor) -> Texture? {
         var image: VkImage? = nil
         var memory: VulkanMemoryBlock? = nil
@@ -1311,7 +1302,9 @@ final class VulkanGraphicsDevice: GraphicsDevice, @unchecked Sendable {
         if dedicatedRequirements.prefersDedicatedAllocation != 0 {
             memory = self.memoryPools[memoryTypeIndex].allocDedicated(size: memReqs.size, image: image, buffer: nil)
         } else {
-            memory = self.memoryPools[memoryTypeIndex].alloc(size: memReqs.size)
+            memory = self.memoryPools[memoryTypeIndex].alloc(size: memReqs.size,
+                                                             alignment: memReqs.alignment,
+                                                             kind: .optimal)
         }
         guard let mem = memory else {
             Log.error("Memory allocation failed.")
@@ -1445,7 +1438,9 @@ final class VulkanGraphicsDevice: GraphicsDevice, @unchecked Sendable {
         if dedicatedRequirements.prefersDedicatedAllocation != 0 {
             memory = self.memoryPools[memoryTypeIndex].allocDedicated(size: memReqs.size, image: image, buffer: nil)
         } else {
-            memory = self.memoryPools[memoryTypeIndex].alloc(size: memReqs.size)
+            memory = self.memoryPools[memoryTypeIndex].alloc(size: memReqs.size,
+                                                             alignment: memReqs.alignment,
+                                                             kind: .optimal)
         }
         guard let mem = memory else {
             Log.error("Memory allocation failed.")
@@ -1621,6 +1616,68 @@ final class VulkanGraphicsDevice: GraphicsDevice, @unchecked Sendable {
         return nil
     }
 
+    func acquireLinearDescriptorPool() -> VkDescriptorPool? {
+        let pool = linearDescriptorPoolLock.withLock { self.linearDescriptorPools.pools.popLast() }
+        if let pool { return pool }
+
+        let descriptorCount = linearDescriptorPoolMaxSets * 2
+        let poolSizes: [VkDescriptorPoolSize] = descriptorTypes.compactMap { type in
+            if type == VK_DESCRIPTOR_TYPE_INLINE_UNIFORM_BLOCK_EXT { return nil }
+            return VkDescriptorPoolSize(type: type, descriptorCount: descriptorCount)
+        }
+        var poolCreateInfo = VkDescriptorPoolCreateInfo()
+        poolCreateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO
+        poolCreateInfo.flags = 0
+        poolCreateInfo.poolSizeCount = UInt32(poolSizes.count)
+        poolCreateInfo.maxSets = linearDescriptorPoolMaxSets
+
+        var descriptorPool: VkDescriptorPool?
+        let result: VkResult = poolSizes.withUnsafeBufferPointer {
+            poolCreateInfo.pPoolSizes = $0.baseAddress
+            return vkCreateDescriptorPool(self.device, &poolCreateInfo, self.allocationCallbacks, &descriptorPool)
+        }
+        if result != VK_SUCCESS {
+            Log.err("vkCreateDescriptorPool failed: \(result)")
+            return nil
+        }
+        linearDescriptorPoolLock.withLock { self.linearDescriptorPools.numPools += 1 }
+        return descriptorPool
+    }
+
+    func recycleLinearDescriptorPools(_ pools: [VkDescriptorPool],
+                                      statistics: VulkanDescriptorSetAllocator.Statistics) {
+        // the command buffer has completed, sets of the pools are no longer in use.
+        for pool in pools {
+            vkResetDescriptorPool(self.device, pool, 0)
+        }
+        let unused: [VkDescriptorPool] = linearDescriptorPoolLock.withLock {
+            self.linearDescriptorPools.statistics.requested += statistics.requested
+            self.linearDescriptorPools.statistics.allocated += statistics.allocated
+            self.linearDescriptorPools.statistics.pools += statistics.pools
+            self.linearDescriptorPools.pools.append(contentsOf: pools)
+            let count = self.linearDescriptorPools.pools.count - maxReusableLinearDescriptorPools
+            if count > 0 {
+                self.linearDescriptorPools.numPools -= count
+                let unused = Array(self.linearDescriptorPools.pools.prefix(count))
+                self.linearDescriptorPools.pools.removeFirst(count)
+                return unused
+            }
+            return []
+        }
+        for pool in unused {
+            vkDestroyDescriptorPool(self.device, pool, self.allocationCallbacks)
+        }
+    }
+
+    // totals of the released command encoders.
+    // requested: descriptor sets bound, allocated: sets written,
+    // pools: pools used by encoders (numPools: pools created)
+    var descriptorSetStatistics: (statistics: VulkanDescriptorSetAllocator.Statistics, numPools: Int) {
+        linearDescriptorPoolLock.withLock {
+            (self.linearDescriptorPools.statistics, self.linearDescriptorPools.numPools)
+        }
+    }
+
     func releaseDescriptorSets(_ sets: [VkDescriptorSet], pool: VulkanDescriptorPool) {
         let poolID = pool.poolID
         assert(poolID.mask != 0)
@@ -1811,34 +1868,5 @@ final class VulkanGraphicsDevice: GraphicsDevice, @unchecked Sendable {
         }
         return pipelineLayout
     }
-
-    func addCompletionHandler(fence: VkFence, op: @escaping @Sendable ()->Void) {
-        self.fenceCompletionLock.withLock {
-            let cb = FenceCallback(fence: fence, operation: op)
-            self.pendingFenceCallbacks.append(cb)
-        }
-    }
-
-    func fence() -> VkFence {
-        var fence: VkFence? = self.fenceCompletionLock.withLock {
-            if self.reusableFences.count > 0 {
-                return self.reusableFences.removeFirst()
-            }
-            return nil
-        }
-        if fence == nil {
-            var fenceCreateInfo = VkFenceCreateInfo()
-            fenceCreateInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO
-
-            let err = vkCreateFence(self.device, &fenceCreateInfo, self.allocationCallbacks, &fence)
-            if err != VK_SUCCESS {
-                Log.err("vkCreateFence failed: \(err)")
-                assertionFailure("vkCreateFence failed: \(err)")
-            }
-            self.numberOfFences += 1
-            Log.verbose("VulkanQueueCompletionHandlerFence: \(self.numberOfFences) fences created.")
-        }
-        return fence!
-    }
 }
 #endif //if ENABLE_VULKAN
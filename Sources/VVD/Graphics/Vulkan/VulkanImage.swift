@@ -264,6 +264,79 @@ final class VulkanImage {
         return oldLayoutInfo.layout
     }
 
+    // Queue family ownership transfer, the layout is kept.
+    // The release is recorded on the source queue and the acquire on the
+    // destination queue, they are skipped if the image is not owned by
+    // the source family.
+    func transferOwnership(from srcQueueFamilyIndex: UInt32,
+                           to dstQueueFamilyIndex: UInt32,
+                           release: Bool,
+                           commandBuffer: VkCommandBuffer) {
+        assert(srcQueueFamilyIndex != VK_QUEUE_FAMILY_IGNORED)
+        assert(dstQueueFamilyIndex != VK_QUEUE_FAMILY_IGNORED)
+
+        self.layoutLock.lock()
+        defer { self.layoutLock.unlock() }
+
+        if self.layoutInfo.queueFamilyIndex != srcQueueFamilyIndex { return }
+
+        var barrier = VkImageMemoryBarrier2()
+        barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2
+        barrier.oldLayout = self.layoutInfo.layout
+        barrier.newLayout = self.layoutInfo.layout
+        barrier.srcQueueFamilyIndex = srcQueueFamilyIndex
+        barrier.dstQueueFamilyIndex = dstQueueFamilyIndex
+        barrier.image = image
+
+        let pixelFormat = self.pixelFormat
+        if pixelFormat.isColorFormat {
+            barrier.subresourceRange.aspectMask = VkImageAspectFlags(VK_IMAGE_ASPECT_COLOR_BIT.rawValue)
+        } else {
+            if pixelFormat.isDepthFormat {
+                barrier.subresourceRange.aspectMask |= UInt32(VK_IMAGE_ASPECT_DEPTH_BIT.rawValue)
+            }
+            if pixelFormat.isStencilFormat {
+                barrier.subresourceRange.aspectMask |= UInt32(VK_IMAGE_ASPECT_STENCIL_BIT.rawValue)
+            }
+        }
+        barrier.subresourceRange.baseMipLevel = 0
+        barrier.subresourceRange.levelCount = VK_REMAINING_MIP_LEVELS
+        barrier.subresourceRange.baseArrayLayer = 0
+        barrier.subresourceRange.layerCount = VK_REMAINING_ARRAY_LAYERS
+
+        if release {
+            barrier.srcStageMask = self.layoutInfo.stageMaskEnd
+            barrier.srcAccessMask = self.layoutInfo.accessMask
+            barrier.dstStageMask = VK_PIPELINE_STAGE_2_NONE
+            barrier.dstAccessMask = VK_ACCESS_2_NONE
+        } else {
+            // after the semaphore wait of the destination queue.
+            barrier.srcStageMask = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT
+            barrier.srcAccessMask = VK_ACCESS_2_NONE
+            barrier.dstStageMask = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT
+            barrier.dstAccessMask = VK_ACCESS_2_MEMORY_READ_BIT | VK_ACCESS_2_MEMORY_WRITE_BIT
+        }
+        if barrier.srcStageMask == VK_PIPELINE_STAGE_2_BOTTOM_OF_PIPE_BIT  {
+            barrier.srcStageMask = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT
+        }
+
+        withUnsafePointer(to: barrier) { pImageMemoryBarriers in
+            var dependencyInfo = VkDependencyInfo()
+            dependencyInfo.sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO
+            dependencyInfo.imageMemoryBarrierCount = 1
+            dependencyInfo.pImageMemoryBarriers = pImageMemoryBarriers
+            vkCmdPipelineBarrier2(commandBuffer, &dependencyInfo)
+        }
+
+        if release == false {
+            self.layoutInfo.accessMask = VK_ACCESS_2_NONE
+            self.layoutInfo.stageMaskBegin = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT
+            self.layoutInfo.stageMaskEnd = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT
+            self.layoutInfo.queueFamilyIndex = dstQueueFamilyIndex
+            self.layoutInfo.lastUpdatedThread = Platform.currentThreadID()
+        }
+    }
+
     func layout() -> VkImageLayout {
         self.layoutLock.withLock { self.layoutInfo.layout }
     }
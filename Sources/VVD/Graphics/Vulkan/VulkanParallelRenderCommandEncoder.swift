@@ -0,0 +1,164 @@
+//
+//  File: VulkanParallelRenderCommandEncoder.swift
+//  Author: Hongtae Kim (tiff2766@gmail.com)
+//
+//  Copyright (c) 2022-2025 Hongtae Kim. All rights reserved.
+//
+
+#if ENABLE_VULKAN
+import Foundation
+import Vulkan
+
+// The child encoders record into their own command streams and descriptor
+// allocators without locking, the costly part of encoding (state filtering,
+// descriptor set allocation and update) runs on the recording threads.
+// At commit, the render pass begins once and the child command streams are
+// replayed in creation order into the primary command buffer.
+final class VulkanParallelRenderCommandEncoder: ParallelRenderCommandEncoder {
+
+    final class Encoder: VulkanCommandEncoder {
+        unowned let commandBuffer: VulkanCommandBuffer
+        let context: VulkanRenderCommandEncoder.RenderContext
+
+        // in creation order, nil until the child encoder has ended.
+        var children: [VulkanRenderCommandEncoder.Encoder?] = []
+        var events: [GPUEvent] = []
+        var semaphores: [GPUSemaphore] = []
+
+        init(commandBuffer: VulkanCommandBuffer, context: VulkanRenderCommandEncoder.RenderContext) {
+            self.commandBuffer = commandBuffer
+            self.context = context
+            super.init()
+            self.addAttachmentSemaphores(context)
+        }
+
+        func merge(_ child: VulkanRenderCommandEncoder.Encoder) {
+            child.waitSemaphores.forEach { semaphore, p in
+                self.addWaitSemaphore(semaphore, value: p.value, flags: p.stages)
+            }
+            child.signalSemaphores.forEach { semaphore, p in
+                self.addSignalSemaphore(semaphore, value: p.value, flags: p.stages)
+            }
+        }
+
+        override func encode(commandBuffer: VkCommandBuffer) -> Bool {
+            let children = self.children.compactMap { $0 }
+
+            VulkanRenderCommandEncoder.Encoder.beginRendering(
+                context: self.context,
+                descriptorSets: children.flatMap(\.descriptorSets),
+                queueFamilyIndex: self.commandBuffer.queueFamily.familyIndex,
+                commandBuffer: commandBuffer)
+
+            for child in children where child.commands.isEmpty == false {
+                child.replay(commandBuffer: commandBuffer)
+            }
+
+            // end render pass
+            vkCmdEndRendering(commandBuffer)
+
+            return true
+        }
+    }
+
+    private var encoder: Encoder?
+    private var numActiveEncoders = 0
+    private let lock = NSLock()
+    let commandBuffer: CommandBuffer
+
+    init(buffer: VulkanCommandBuffer, context: VulkanRenderCommandEncoder.RenderContext) {
+        self.commandBuffer = buffer
+        self.encoder = Encoder(commandBuffer: buffer, context: context)
+    }
+
+    func makeRenderCommandEncoder() -> RenderCommandEncoder? {
+        self.lock.withLock {
+            guard let encoder = self.encoder else {
+                Log.err("ParallelRenderCommandEncoder.makeRenderCommandEncoder failed: encoding has ended.")
+                return nil
+            }
+            let buffer = self.commandBuffer as! VulkanCommandBuffer
+            let index = encoder.children.count
+            encoder.children.append(nil)
+            self.numActiveEncoders += 1
+            return VulkanRenderCommandEncoder(
+                buffer: buffer,
+                encoder: VulkanRenderCommandEncoder.Encoder(commandBuffer: buffer, context: encoder.context),
+                parallelEncoder: self,
+                parallelIndex: index)
+        }
+    }
+
+    // called by the child encoder, from its recording thread.
+    func endEncoder(_ child: VulkanRenderCommandEncoder.Encoder, index: Int) {
+        self.lock.withLock {
+            guard let encoder = self.encoder else {
+                Log.err("ParallelRenderCommandEncoder: child encoder ended after endEncoding(), commands discarded.")
+                return
+            }
+            encoder.children[index] = child
+            encoder.merge(child)
+            self.numActiveEncoders -= 1
+        }
+    }
+
+    func endEncoding() {
+        let encoder = self.lock.withLock {
+            if self.numActiveEncoders > 0 {
+                Log.err("ParallelRenderCommandEncoder.endEncoding: \(self.numActiveEncoders) child encoder(s) still encoding, commands discarded.")
+            }
+            assert(self.numActiveEncoders == 0)
+            defer { self.encoder = nil }
+            return self.encoder!
+        }
+        let commandBuffer = self.commandBuffer as! VulkanCommandBuffer
+        commandBuffer.endEncoder(encoder)
+    }
+
+    var isCompleted: Bool { self.lock.withLock { self.encoder == nil } }
+
+    func waitEvent(_ event: GPUEvent) {
+        assert(event is VulkanSemaphore)
+        if let semaphore = event as? VulkanSemaphore {
+            let pipelineStages = VK_PIPELINE_STAGE_2_ALL_GRAPHICS_BIT
+            self.lock.withLock {
+                self.encoder!.addWaitSemaphore(semaphore.semaphore, value: semaphore.nextWaitValue, flags: pipelineStages)
+                self.encoder!.events.append(event)
+            }
+        }
+    }
+
+    func signalEvent(_ event: GPUEvent) {
+        assert(event is VulkanSemaphore)
+        if let semaphore = event as? VulkanSemaphore {
+            let pipelineStages = VK_PIPELINE_STAGE_2_ALL_GRAPHICS_BIT
+            self.lock.withLock {
+                self.encoder!.addSignalSemaphore(semaphore.semaphore, value: semaphore.nextWaitValue, flags: pipelineStages)
+                self.encoder!.events.append(event)
+            }
+        }
+    }
+
+    func waitSemaphoreValue(_ sema: GPUSemaphore, value: UInt64) {
+        assert(sema is VulkanTimelineSemaphore)
+        if let semaphore = sema as? VulkanTimelineSemaphore {
+            let pipelineStages = VK_PIPELINE_STAGE_2_ALL_GRAPHICS_BIT
+            self.lock.withLock {
+                self.encoder!.addWaitSemaphore(semaphore.semaphore, value: value, flags: pipelineStages)
+                self.encoder!.semaphores.append(sema)
+            }
+        }
+    }
+
+    func signalSemaphoreValue(_ sema: GPUSemaphore, value: UInt64) {
+        assert(sema is VulkanTimelineSemaphore)
+        if let semaphore = sema as? VulkanTimelineSemaphore {
+            let pipelineStages = VK_PIPELINE_STAGE_2_ALL_GRAPHICS_BIT
+            self.lock.withLock {
+                self.encoder!.addSignalSemaphore(semaphore.semaphore, value: value, flags: pipelineStages)
+                self.encoder!.semaphores.append(sema)
+            }
+        }
+    }
+}
+#endif //if ENABLE_VULKAN
@@ -0,0 +1,230 @@
+//
+//  File: VulkanQueueCompletionMonitor.swift
+//  Author: Hongtae Kim (tiff2766@gmail.com)
+//
+//  Copyright (c) 2022-2025 Hongtae Kim. All rights reserved.
+//
+
+#if ENABLE_VULKAN
+import Foundation
+import Vulkan
+
+// Completion tracking of queue submissions.
+// Each VkQueue has a timeline semaphore, a submission with a completion
+// handler signals the next value of it. A dedicated thread blocks in
+// vkWaitSemaphores until any queue reaches its oldest pending value and
+// dispatches all completed handlers at once. The thread does not wake up
+// while nothing is pending.
+final class VulkanQueueCompletionMonitor: @unchecked Sendable {
+    typealias Handler = @Sendable () -> Void
+
+    struct Statistics {
+        var wakeups: UInt64 = 0
+        var handlers: UInt64 = 0
+        var batches: UInt64 = 0
+    }
+
+    private struct Timeline {
+        let semaphore: VkSemaphore
+        var lastValue: UInt64 = 0
+        var handlers: [(value: UInt64, handler: Handler)] = []
+    }
+
+    private let device: VkDevice
+    private let allocationCallbacks: UnsafePointer<VkAllocationCallbacks>?
+    private var timelines: [VkQueue: Timeline] = [:]
+
+    // signaled from the host to wake the thread up when a queue gets
+    // its first pending handler, or to stop the thread.
+    private let wakeSemaphore: VkSemaphore
+    private var wakeValue: UInt64 = 0
+    private var isWaiting = false
+    private var isStopped = false
+    private let finished = DispatchSemaphore(value: 0)
+
+    private var _statistics = Statistics()
+    private let lock = NSLock()
+
+    var statistics: Statistics { self.lock.withLock { _statistics } }
+
+    init(device: VkDevice, allocationCallbacks: UnsafePointer<VkAllocationCallbacks>?) {
+        self.device = device
+        self.allocationCallbacks = allocationCallbacks
+        self.wakeSemaphore = Self.makeTimelineSemaphore(device: device, allocationCallbacks: allocationCallbacks)
+
+        let thread = Thread { [self] in
+            let taskID = UUID()
+            detachedServiceTasks.withLock { $0[taskID] = "VulkanQueueCompletionMonitor thread" }
+            defer {
+                detachedServiceTasks.withLock { $0[taskID] = nil }
+            }
+            Log.info("VulkanQueueCompletionMonitor thread is started.")
+            self.run()
+            Log.info("VulkanQueueCompletionMonitor thread is finished.")
+            self.finished.signal()
+        }
+        thread.name = "VulkanQueueCompletionMonitor"
+        thread.qualityOfService = .userInitiated
+        thread.start()
+    }
+
+    // stops the thread and destroys the semaphores,
+    // call after the device is idle.
+    func stop() {
+        let running = self.lock.withLock {
+            if self.isStopped { return false }
+            self.isStopped = true
+            self.wake()
+            return true
+        }
+        if running {
+            self.finished.wait()
+        }
+        self.lock.withLock {
+            for (_, timeline) in self.timelines {
+                assert(timeline.handlers.isEmpty, "CompletionHandler must be empty!")
+                vkDestroySemaphore(self.device, timeline.semaphore, self.allocationCallbacks)
+            }
+            self.timelines.removeAll()
+        }
+        vkDestroySemaphore(self.device, self.wakeSemaphore, self.allocationCallbacks)
+    }
+
+    // Returns the semaphore and the value the next submission of the queue
+    // signals. Call with the queue locked, values must be submitted in order.
+    func nextSignal(queue: VkQueue) -> (semaphore: VkSemaphore, value: UInt64) {
+        self.lock.withLock {
+            if self.timelines[queue] == nil {
+                let semaphore = Self.makeTimelineSemaphore(device: self.device,
+                                                           allocationCallbacks: self.allocationCallbacks)
+                self.timelines[queue] = Timeline(semaphore: semaphore)
+            }
+            self.timelines[queue]!.lastValue += 1
+            let timeline = self.timelines[queue]!
+            return (timeline.semaphore, timeline.lastValue)
+        }
+    }
+
+    // registers the handler of a submitted value, with the queue locked.
+    func addHandler(queue: VkQueue, value: UInt64, handler: @escaping Handler) {
+        self.lock.withLock {
+            let wasIdle = self.timelines[queue]!.handlers.isEmpty
+            self.timelines[queue]!.handlers.append((value, handler))
+            // the thread does not wait for this queue yet.
+            if wasIdle && self.isWaiting {
+                self.wake()
+            }
+        }
+    }
+
+    // called with the lock held.
+    private func wake() {
+        self.isWaiting = false
+        self.wakeValue += 1
+
+        var signalInfo = VkSemaphoreSignalInfo()
+        signalInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_SIGNAL_INFO
+        signalInfo.semaphore = self.wakeSemaphore
+        signalInfo.value = self.wakeValue
+        let err = vkSignalSemaphore(self.device, &signalInfo)
+        if err != VK_SUCCESS {
+            Log.err("vkSignalSemaphore failed: \(err)")
+        }
+    }
+
+    private func run() {
+        var semaphores: [VkSemaphore?] = []
+        var values: [UInt64] = []
+        var completed: [Handler] = []
+
+        while true {
+            let stop = self.lock.withLock {
+                if self.isStopped { return true }
+
+                semaphores.removeAll(keepingCapacity: true)
+                values.removeAll(keepingCapacity: true)
+                semaphores.append(self.wakeSemaphore)
+                values.append(self.wakeValue + 1)
+                for timeline in self.timelines.values {
+                    if let first = timeline.handlers.first {
+                        semaphores.append(timeline.semaphore)
+                        values.append(first.value)
+                    }
+                }
+                self.isWaiting = true
+                return false
+            }
+            if stop { break }
+
+            var waitInfo = VkSemaphoreWaitInfo()
+            waitInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO
+            waitInfo.flags = VkSemaphoreWaitFlags(VK_SEMAPHORE_WAIT_ANY_BIT.rawValue)
+            waitInfo.semaphoreCount = UInt32(semaphores.count)
+            let err = semaphores.withUnsafeBufferPointer { pSemaphores in
+                values.withUnsafeBufferPointer { pValues in
+                    waitInfo.pSemaphores = pSemaphores.baseAddress
+                    waitInfo.pValues = pValues.baseAddress
+                    return vkWaitSemaphores(self.device, &waitInfo, UInt64.max)
+                }
+            }
+            if err != VK_SUCCESS && err != VK_TIMEOUT {
+                Log.err("vkWaitSemaphores failed: \(err)")
+                assertionFailure("vkWaitSemaphores failed: \(err)")
+                break
+            }
+
+            self.lock.withLock {
+                self.isWaiting = false
+                self._statistics.wakeups += 1
+
+                for queue in self.timelines.keys {
+                    let timeline = self.timelines[queue]!
+                    if timeline.handlers.isEmpty { continue }
+
+                    var value: UInt64 = 0
+                    vkGetSemaphoreCounterValue(self.device, timeline.semaphore, &value)
+                    let count = timeline.handlers.prefix { $0.value <= value }.count
+                    if count > 0 {
+                        completed.append(contentsOf: timeline.handlers.prefix(count).map(\.handler))
+                        self.timelines[queue]!.handlers.removeFirst(count)
+                    }
+                }
+                if completed.isEmpty == false {
+                    self._statistics.handlers += UInt64(completed.count)
+                    self._statistics.batches += 1
+                }
+            }
+
+            if completed.isEmpty == false {
+                let handlers = completed
+                DispatchQueue.global().async {
+                    handlers.forEach { $0() }
+                }
+                completed.removeAll(keepingCapacity: true)
+            }
+        }
+    }
+
+    private static func makeTimelineSemaphore(device: VkDevice,
+                                              allocationCallbacks: UnsafePointer<VkAllocationCallbacks>?) -> VkSemaphore {
+        var createInfo = VkSemaphoreCreateInfo()
+        createInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO
+
+        var typeCreateInfo = VkSemaphoreTypeCreateInfo()
+        typeCreateInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO
+        typeCreateInfo.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE
+        typeCreateInfo.initialValue = 0
+
+        var semaphore: VkSemaphore? = nil
+        let err: VkResult = withUnsafePointer(to: typeCreateInfo) {
+            createInfo.pNext = UnsafeRawPointer($0)
+            return vkCreateSemaphore(device, &createInfo, allocationCallbacks, &semaphore)
+        }
+        if err != VK_SUCCESS {
+            Log.err("vkCreateSemaphore failed: \(err)")
+            assertionFailure("vkCreateSemaphore failed: \(err)")
+        }
+        return semaphore!
+    }
+}
+#endif //if ENABLE_VULKAN
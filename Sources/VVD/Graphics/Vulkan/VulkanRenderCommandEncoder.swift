@@ -33,13 +33,99 @@ final class VulkanRenderCommandEncoder: RenderCommandEncoder {
         var _bufferHolder: TemporaryBufferHolder
     }
 
+    enum Command: UInt32 {
+        case bindPipeline
+        case bindDescriptorSet
+        case setViewport
+        case setScissor
+        case bindVertexBuffers
+        case setDepthStencilState
+        case setCullMode
+        case setFrontFace
+        case setBlendConstants
+        case setStencilReference
+        case setDepthBias
+        case pushConstant
+        case memoryBarrier
+        case draw
+        case drawIndexed
+    }
+
+    struct BindPipelineCommand {
+        var pipelineIndex: Int
+    }
+    struct BindDescriptorSetCommand {
+        var index: UInt32
+        var descriptorSetIndex: Int
+    }
+    struct SetViewportCommand {
+        var viewport: VkViewport
+    }
+    struct SetScissorCommand {
+        var scissorRect: VkRect2D
+    }
+    struct BindVertexBuffersCommand {   // followed by VkBuffer[count], VkDeviceSize[count]
+        var firstBinding: UInt32
+        var count: UInt32
+    }
+    struct SetDepthStencilStateCommand {
+        var depthStencilIndex: Int  // -1 for default state
+    }
+    struct SetCullModeCommand {
+        var cullMode: VkCullModeFlags
+    }
+    struct SetFrontFaceCommand {
+        var frontFace: VkFrontFace
+    }
+    struct SetBlendConstantsCommand {
+        var red: Float
+        var green: Float
+        var blue: Float
+        var alpha: Float
+    }
+    struct SetStencilReferenceCommand {
+        var faceMask: VkStencilFaceFlags
+        var reference: UInt32
+    }
+    struct SetDepthBiasCommand {
+        var constantFactor: Float
+        var clamp: Float
+        var slopeFactor: Float
+    }
+    struct PushConstantCommand {    // followed by data bytes
+        var stageFlags: VkShaderStageFlags
+        var offset: UInt32
+        var size: UInt32
+    }
+    struct MemoryBarrierCommand {
+        var srcStages: VkPipelineStageFlags2
+        var dstStages: VkPipelineStageFlags2
+    }
+    struct DrawCommand {
+        var vertexCount: UInt32
+        var instanceCount: UInt32
+        var firstVertex: UInt32
+        var firstInstance: UInt32
+    }
+    struct DrawIndexedCommand {
+        var indexBuffer: VkBuffer?
+        var indexBufferOffset: VkDeviceSize
+        var indexType: VkIndexType
+        var indexCount: UInt32
+        var instanceCount: UInt32
+        var vertexOffset: Int32
+        var firstInstance: UInt32
+    }
+
     final class Encoder: VulkanCommandEncoder {
         unowned let commandBuffer: VulkanCommandBuffer
         let device: VulkanGraphicsDevice
         let context: RenderContext
 
         var pipelineStateObjects: [VulkanRenderPipelineState] = []
+        var depthStencilStates: [VulkanDepthStencilState] = []
         var descriptorSets: [VulkanDescriptorSet] = []
+        let descriptorAllocator: VulkanDescriptorSetAllocator
         var buffers: [GPUBuffer] = []
         var events: [GPUEvent] = []
         var semaphores: [GPUSemaphore] = []
@@ -47,50 +133,29 @@ final class VulkanRenderCommandEncoder: RenderCommandEncoder {
         var framebuffer: VkFramebuffer?
         var renderPass: VkRenderPass?
 
-        typealias Command = (VkCommandBuffer, inout EncodingState)->Void
-        var commands: [Command] = []
-        var setupCommands: [Command] = []
-        var cleanupCommands: [Command] = []
+        let commands: VulkanCommandStream
 
         var drawCount = 0
         var setDynamicStates: Set<VkDynamicState> = []
+        var shadowState = RenderCommandEncoderShadowState()
 
         init(commandBuffer: VulkanCommandBuffer, context: RenderContext) {   
             self.commandBuffer = commandBuffer
             self.context = context
             self.device = commandBuffer.device as! VulkanGraphicsDevice
+            self.descriptorAllocator = VulkanDescriptorSetAllocator(device: self.device)
+            self.commands = VulkanCommandStream.make()
             super.init()
 
-            self.commands.reserveCapacity(self.initialNumberOfCommands)
-            self.setupCommands.reserveCapacity(self.initialNumberOfCommands)
-            self.cleanupCommands.reserveCapacity(self.initialNumberOfCommands)
+            self.pipelineStateObjects.reserveCapacity(self.initialNumberOfCommands)
+            self.descriptorSets.reserveCapacity(self.initialNumberOfCommands)
+            self.buffers.reserveCapacity(self.initialNumberOfCommands)
 
-            let colorAttachments = context.colorAttachments.map(\.0) + context.colorResolveTargets
-            let depthStencilAttachments = [context.depthStencilAttachment?.0, context.depthStencilResolveTarget].compactMap { $0 }
-
-            for rt in colorAttachments {
-                if rt.image != nil {
-                    if let semaphore = rt.waitSemaphore {
-                        self.addWaitSemaphore(semaphore, value: 0, flags: VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT)
-                    }
-                    if let semaphore = rt.signalSemaphore {
-                        self.addSignalSemaphore(semaphore, value: 0, flags: VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT)
-                    }
-                }
-            }
-            for rt in depthStencilAttachments {
-                if rt.image != nil {
-                    if let semaphore = rt.waitSemaphore {
-                        self.addWaitSemaphore(semaphore, value: 0, flags: VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT)
-                    }
-                    if let semaphore = rt.signalSemaphore {
-                        self.addSignalSemaphore(semaphore, value: 0, flags: VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT)
-                    }
-                }
-            }
+            self.addAttachmentSemaphores(context)
         }
 
         deinit {
+            VulkanCommandStream.recycle(self.commands)
             if let renderPass = self.renderPass {
                 vkDestroyRenderPass(device.device, renderPass, device.allocationCallbacks)
             }
@@ -99,15 +164,38 @@ final class VulkanRenderCommandEncoder: RenderCommandEncoder {
             }
         }
 
+        func append<T>(_ command: Command, _ record: T) {
+            self.commands.append(command.rawValue, record)
+        }
+
         override func encode(commandBuffer: VkCommandBuffer) -> Bool {
+            Self.beginRendering(context: self.context,
+                                descriptorSets: self.descriptorSets,
+                                queueFamilyIndex: self.commandBuffer.queueFamily.familyIndex,
+                                commandBuffer: commandBuffer)
+            self.replay(commandBuffer: commandBuffer)
+
+            // end render pass
+            vkCmdEndRendering(commandBuffer)
+
+            return true
+        }
+
+        // Transitions the images of the descriptor sets and attachments
+        // and begins the render pass. A parallel render pass passes the
+        // descriptor sets of all child encoders.
+        static func beginRendering(context: RenderContext,
+                                   descriptorSets: [VulkanDescriptorSet],
+                                   queueFamilyIndex: UInt32,
+                                   commandBuffer: VkCommandBuffer) {
             var state = EncodingState()
 
             // collect image layout transition
-            for ds in self.descriptorSets {
+            for ds in descriptorSets {
                 ds.collectImageViewLayouts(&state.imageLayouts, &state.imageViewLayouts)
             }
-            for cmd in self.setupCommands {
-                cmd(commandBuffer, &state)
+            for ds in descriptorSets {
+                ds.updateImageViewLayouts(state.imageViewLayouts)
             }
             // Set image layout transition
             state.imageLayouts.forEach { (key, value) in
@@ -120,7 +208,7 @@ final class VulkanRenderCommandEncoder: RenderCommandEncoder {
                                 accessMask: accessMask,
                                 stageBegin: VK_PIPELINE_STAGE_2_ALL_GRAPHICS_BIT,
                                 stageEnd: VK_PIPELINE_STAGE_2_ALL_GRAPHICS_BIT,
-                                queueFamilyIndex: self.commandBuffer.queueFamily.familyIndex,
+                                queueFamilyIndex: queueFamilyIndex,
                                 commandBuffer: commandBuffer)
             }
 
@@ -140,7 +228,7 @@ final class VulkanRenderCommandEncoder: RenderCommandEncoder {
                         accessMask: VK_ACCESS_2_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_2_COLOR_ATTACHMENT_WRITE_BIT,
                         stageBegin: VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT,
                         stageEnd: VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT,
-                        queueFamilyIndex: self.commandBuffer.queueFamily.familyIndex,
+                        queueFamilyIndex: queueFamilyIndex,
                         commandBuffer: commandBuffer)
                 }
             }
@@ -152,7 +240,7 @@ final class VulkanRenderCommandEncoder: RenderCommandEncoder {
                         accessMask: VK_ACCESS_2_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_2_COLOR_ATTACHMENT_WRITE_BIT,
                         stageBegin: VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT,
                         stageEnd: VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT,
-                        queueFamilyIndex: self.commandBuffer.queueFamily.familyIndex,
+                        queueFamilyIndex: queueFamilyIndex,
                         commandBuffer: commandBuffer)
                 }
             }
@@ -164,7 +252,7 @@ final class VulkanRenderCommandEncoder: RenderCommandEncoder {
                         accessMask: VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT,
                         stageBegin: VK_PIPELINE_STAGE_2_EARLY_FRAGMENT_TESTS_BIT,
                         stageEnd: VK_PIPELINE_STAGE_2_LATE_FRAGMENT_TESTS_BIT,
-                        queueFamilyIndex: self.commandBuffer.queueFamily.familyIndex,
+                        queueFamilyIndex: queueFamilyIndex,
                         commandBuffer: commandBuffer)
                 }
             }
@@ -175,14 +263,17 @@ final class VulkanRenderCommandEncoder: RenderCommandEncoder {
                     accessMask: VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT,
                     stageBegin: VK_PIPELINE_STAGE_2_EARLY_FRAGMENT_TESTS_BIT,
                     stageEnd: VK_PIPELINE_STAGE_2_LATE_FRAGMENT_TESTS_BIT,
-                    queueFamilyIndex: self.commandBuffer.queueFamily.familyIndex,
+                    queueFamilyIndex: queueFamilyIndex,
                     commandBuffer: commandBuffer)
             }
 
             // begin render pass
             var renderingInfo = context.renderingInfo
             vkCmdBeginRendering(commandBuffer, &renderingInfo)
+        }
 
+        // Records the commands into the render pass that has begun.
+        func replay(commandBuffer: VkCommandBuffer) {
             // setup dynamic states to default.
             if setDynamicStates.contains(VK_DYNAMIC_STATE_VIEWPORT) == false {
                 var viewport = context.viewport
@@ -231,33 +322,164 @@ final class VulkanRenderCommandEncoder: RenderCommandEncoder {
                 vkCmdSetFrontFace(commandBuffer, VK_FRONT_FACE_CLOCKWISE)
             }
 
+            var state = EncodingState()
             // recording commands
-            for cmd in self.commands {
-                cmd(commandBuffer, &state)
+            self.commands.forEach { command, p in
+                self.execute(Command(rawValue: command).unsafelyUnwrapped, p,
+                             commandBuffer: commandBuffer, state: &state)
             }
-            // end render pass
-            vkCmdEndRendering(commandBuffer)
+        }
 
-            // process post-renderpass commands
-            for cmd in self.cleanupCommands {
-                cmd(commandBuffer, &state)
+        @inline(__always)
+        private func execute(_ command: Command,
+                             _ p: UnsafeRawPointer,
+                             commandBuffer: VkCommandBuffer,
+                             state: inout EncodingState) {
+            switch command {
+            case .bindPipeline:
+                let cmd = p.load(as: BindPipelineCommand.self)
+                let pipeline = self.pipelineStateObjects[cmd.pipelineIndex]
+                vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline.pipeline)
+                state.pipelineState = pipeline
+            case .bindDescriptorSet:
+                let cmd = p.load(as: BindDescriptorSetCommand.self)
+                if let pipelineState = state.pipelineState {
+                    var ds: VkDescriptorSet? = self.descriptorSets[cmd.descriptorSetIndex].descriptorSet
+                    vkCmdBindDescriptorSets(commandBuffer,
+                                            VK_PIPELINE_BIND_POINT_GRAPHICS,
+                                            pipelineState.layout,
+                                            cmd.index,
+                                            1,
+                                            &ds,
+                                            0,      // dynamic offsets
+                                            nil)
+                }
+            case .setViewport:
+                var cmd = p.load(as: SetViewportCommand.self)
+                vkCmdSetViewport(commandBuffer, 0, 1, &cmd.viewport)
+            case .setScissor:
+                var cmd = p.load(as: SetScissorCommand.self)
+                vkCmdSetScissor(commandBuffer, 0, 1, &cmd.scissorRect)
+            case .bindVertexBuffers:
+                let cmd = p.load(as: BindVertexBuffersCommand.self)
+                let count = Int(cmd.count)
+                let buffers = p + VulkanCommandStream.payloadOffset(BindVertexBuffersCommand.self)
+                let offsets = buffers + MemoryLayout<VkBuffer?>.stride * count
+                vkCmdBindVertexBuffers(commandBuffer, cmd.firstBinding, cmd.count,
+                                       buffers.assumingMemoryBound(to: VkBuffer?.self),
+                                       offsets.assumingMemoryBound(to: VkDeviceSize.self))
+            case .setDepthStencilState:
+                let cmd = p.load(as: SetDepthStencilStateCommand.self)
+                let depthStencilState = cmd.depthStencilIndex >= 0 ?
+                    self.depthStencilStates[cmd.depthStencilIndex] : nil
+                if let depthStencilState = depthStencilState {
+                    depthStencilState.bind(commandBuffer: commandBuffer)
+                } else {
+                    // reset to default
+                    vkCmdSetDepthTestEnable(commandBuffer, VK_FALSE)
+                    vkCmdSetStencilTestEnable(commandBuffer, VK_FALSE)
+                    vkCmdSetDepthBoundsTestEnable(commandBuffer, VK_FALSE)
+
+                    if state.depthStencilState == nil {
+                        vkCmdSetDepthCompareOp(commandBuffer, VK_COMPARE_OP_ALWAYS)
+                        vkCmdSetDepthWriteEnable(commandBuffer, VK_FALSE)
+                        vkCmdSetDepthBounds(commandBuffer, 0.0, 1.0)
+
+                        let faceMask = VkStencilFaceFlags(VK_STENCIL_FACE_FRONT_AND_BACK.rawValue)
+                        vkCmdSetStencilCompareMask(commandBuffer, faceMask, 0xffffffff)
+                        vkCmdSetStencilWriteMask(commandBuffer, faceMask, 0xffffffff)
+                        vkCmdSetStencilOp(commandBuffer, faceMask,
+                                          VK_STENCIL_OP_KEEP, VK_STENCIL_OP_KEEP,
+                                          VK_STENCIL_OP_KEEP, VK_COMPARE_OP_ALWAYS)
+                    }
+                }
+                state.depthStencilState = depthStencilState
+            case .setCullMode:
+                let cmd = p.load(as: SetCullModeCommand.self)
+                vkCmdSetCullMode(commandBuffer, cmd.cullMode)
+            case .setFrontFace:
+                let cmd = p.load(as: SetFrontFaceCommand.self)
+                vkCmdSetFrontFace(commandBuffer, cmd.frontFace)
+            case .setBlendConstants:
+                vkCmdSetBlendConstants(commandBuffer, p.assumingMemoryBound(to: Float.self))
+            case .setStencilReference:
+                let cmd = p.load(as: SetStencilReferenceCommand.self)
+                vkCmdSetStencilReference(commandBuffer, cmd.faceMask, cmd.reference)
+            case .setDepthBias:
+                let cmd = p.load(as: SetDepthBiasCommand.self)
+                vkCmdSetDepthBias(commandBuffer, cmd.constantFactor, cmd.clamp, cmd.slopeFactor)
+            case .pushConstant:
+                let cmd = p.load(as: PushConstantCommand.self)
+                if let pipelineState = state.pipelineState {
+                    vkCmdPushConstants(commandBuffer,
+                                       pipelineState.layout,
+                                       cmd.stageFlags,
+                                       cmd.offset,
+                                       cmd.size,
+                                       p + VulkanCommandStream.payloadOffset(PushConstantCommand.self))
+                }
+            case .memoryBarrier:
+                let cmd = p.load(as: MemoryBarrierCommand.self)
+                var memoryBarrier = VkMemoryBarrier2()
+                memoryBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER_2
+                memoryBarrier.srcStageMask = cmd.srcStages
+                memoryBarrier.srcAccessMask = VK_ACCESS_2_NONE
+                memoryBarrier.dstStageMask = cmd.dstStages
+                memoryBarrier.dstAccessMask = VK_ACCESS_2_NONE
+
+                withUnsafePointer(to: memoryBarrier) { pMemoryBarriers in
+                    var dependencyInfo = VkDependencyInfo()
+                    dependencyInfo.sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO
+                    dependencyInfo.memoryBarrierCount = 1
+                    dependencyInfo.pMemoryBarriers = pMemoryBarriers
+                    vkCmdPipelineBarrier2(commandBuffer, &dependencyInfo)
+                }
+            case .draw:
+                let cmd = p.load(as: DrawCommand.self)
+                vkCmdDraw(commandBuffer,
+                          cmd.vertexCount,
+                          cmd.instanceCount,
+                          cmd.firstVertex,
+                          cmd.firstInstance)
+            case .drawIndexed:
+                let cmd = p.load(as: DrawIndexedCommand.self)
+                vkCmdBindIndexBuffer(commandBuffer, cmd.indexBuffer, cmd.indexBufferOffset, cmd.indexType)
+                vkCmdDrawIndexed(commandBuffer,
+                                 cmd.indexCount,
+                                 cmd.instanceCount,
+                                 0,  // firstIndex = 0
+                                 cmd.vertexOffset,
+                                 cmd.firstInstance)
             }
-
-            return true
         }
     }
 
     private var encoder: Encoder?
     let commandBuffer: CommandBuffer
 
-    init(buffer: VulkanCommandBuffer, context: RenderContext) {   
+    // set for the child encoders of a parallel render pass.
+    private let parallelEncoder: VulkanParallelRenderCommandEncoder?
+    private let parallelIndex: Int
+
+    convenience init(buffer: VulkanCommandBuffer, context: RenderContext) {
+        self.init(buffer: buffer, encoder: Encoder(commandBuffer: buffer, context: context))
+    }
+
+    init(buffer: VulkanCommandBuffer, encoder: Encoder,
+         parallelEncoder: VulkanParallelRenderCommandEncoder? = nil, parallelIndex: Int = 0) {
         self.commandBuffer = buffer
-        self.encoder = Encoder(commandBuffer: buffer, context: context)
+        self.encoder = encoder
+        self.parallelEncoder = parallelEncoder
+        self.parallelIndex = parallelIndex
     }
 
     func endEncoding() {
-        let commandBuffer = self.commandBuffer as! VulkanCommandBuffer
-        commandBuffer.endEncoder(self.encoder!)
+        if let parallelEncoder {
+            parallelEncoder.endEncoder(self.encoder!, index: self.parallelIndex)
+        } else {
+            let commandBuffer = self.commandBuffer as! VulkanCommandBuffer
+            commandBuffer.endEncoder(self.encoder!)
+        }
         self.encoder = nil
     }
 
@@ -301,43 +523,29 @@ final class VulkanRenderCommandEncoder: RenderCommandEncoder {
     
     func setResource(_ set: ShaderBindingSet, index: Int) {
         assert(set is VulkanShaderBindingSet)
-        var descriptorSet: VulkanDescriptorSet? = nil
         if let bindingSet = set as? VulkanShaderBindingSet {
-            descriptorSet = bindingSet.makeDescriptorSet()
-            self.encoder!.descriptorSets.append(descriptorSet!)
-        }
-        if let descriptorSet = descriptorSet {
-            let preCommand = { (commandBuffer: VkCommandBuffer, state: inout EncodingState) in
-                descriptorSet.updateImageViewLayouts(state.imageViewLayouts)
-            }
-            self.encoder!.setupCommands.append(preCommand)
-
-            let command = { (commandBuffer: VkCommandBuffer, state: inout EncodingState) in
-                if let pipelineState = state.pipelineState {
-                    var ds: VkDescriptorSet? = descriptorSet.descriptorSet
-                    vkCmdBindDescriptorSets(commandBuffer,
-                                            VK_PIPELINE_BIND_POINT_GRAPHICS,
-                                            pipelineState.layout,
-                                            UInt32(index),
-                                            1,
-                                            &ds,
-                                            0,      // dynamic offsets
-                                            nil)
-                }
+            let encoder = self.encoder!
+            if encoder.shadowState.setResource(bindingSet, version: bindingSet.version, index: index) == false {
+                return
             }
-            self.encoder!.commands.append(command)
+            let descriptorSetIndex = encoder.descriptorAllocator.descriptorSetIndex(
+                for: bindingSet, descriptorSets: &encoder.descriptorSets)
+            encoder.append(.bindDescriptorSet,
+                           BindDescriptorSetCommand(index: UInt32(index),
+                                                    descriptorSetIndex: descriptorSetIndex))
         }
     }
 
     func setRenderPipelineState(_ pso: RenderPipelineState) {
         assert(pso is VulkanRenderPipelineState)
         if let pipeline = pso as? VulkanRenderPipelineState {
-            let command = { (commandBuffer: VkCommandBuffer, state: inout EncodingState) in
-                vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline.pipeline)
-                state.pipelineState = pipeline
+            let encoder = self.encoder!
+            if encoder.shadowState.setRenderPipelineState(pipeline) == false {
+                return
             }
-            self.encoder!.commands.append(command)
-            self.encoder!.pipelineStateObjects.append(pipeline)
+            encoder.append(.bindPipeline,
+                           BindPipelineCommand(pipelineIndex: encoder.pipelineStateObjects.count))
+            encoder.pipelineStateObjects.append(pipeline)
         }
     }
 
@@ -352,97 +560,78 @@ final class VulkanRenderCommandEncoder: RenderCommandEncoder {
             viewport.y = viewport.y + viewport.height // set origin to lower-left.
             viewport.height = -(viewport.height) // negative height.
         }
-        let command = { (commandBuffer: VkCommandBuffer, state: inout EncodingState) in
-            vkCmdSetViewport(commandBuffer, 0, 1, &viewport)
-        }
-        self.encoder!.commands.append(command)
+        self.encoder!.append(.setViewport, SetViewportCommand(viewport: viewport))
         if self.encoder!.drawCount == 0 {
             self.encoder!.setDynamicStates.insert(VK_DYNAMIC_STATE_VIEWPORT)
         }
     }
 
     func setScissorRect(_ r: ScissorRect) {
-        var scissorRect = VkRect2D(offset: VkOffset2D(x: Int32(r.x),
+        let scissorRect = VkRect2D(offset: VkOffset2D(x: Int32(r.x),
                                                       y: Int32(r.y)),
                                    extent: VkExtent2D(width: UInt32(r.width),
                                                       height: UInt32(r.height)))
-        let command = { (commandBuffer: VkCommandBuffer, state: inout EncodingState) in
-            vkCmdSetScissor(commandBuffer, 0, 1, &scissorRect)
-        }
-        self.encoder!.commands.append(command)
+        self.encoder!.append(.setScissor, SetScissorCommand(scissorRect: scissorRect))
         if self.encoder!.drawCount == 0 {
             self.encoder!.setDynamicStates.insert(VK_DYNAMIC_STATE_SCISSOR)
         }
     }
 
     func setVertexBuffer(_ buffer: GPUBuffer, offset: Int, index: Int) {
-        setVertexBuffers([buffer], offsets: [offset], index: index)
+        if self.encoder!.shadowState.setVertexBuffer(buffer, offset: offset, index: index) {
+            encodeVertexBuffers([buffer], offsets: [offset], index: index)
+        }
     }
 
     func setVertexBuffers(_ buffers: [GPUBuffer], offsets: [Int], index: Int) {
+        if self.encoder!.shadowState.setVertexBuffers(buffers, offsets: offsets, index: index) {
+            encodeVertexBuffers(buffers, offsets: offsets, index: index)
+        }
+    }
+
+    private func encodeVertexBuffers(_ buffers: [GPUBuffer], offsets: [Int], index: Int) {
         assert(buffers.count == offsets.count)
         let count = min(buffers.count, offsets.count)
         if count > 0 {
-            var bufferArray: [VkBuffer?] = []
-            var offsetArray: [VkDeviceSize] = []
-            bufferArray.reserveCapacity(count)
-            offsetArray.reserveCapacity(count)
-
-            for (buffer, offset) in zip(buffers, offsets) {
+            let encoder = self.encoder!
+            let command = BindVertexBuffersCommand(firstBinding: UInt32(index), count: UInt32(count))
+            let payloadSize = (MemoryLayout<VkBuffer?>.stride + MemoryLayout<VkDeviceSize>.stride) * count
+            let payload = encoder.commands.append(Command.bindVertexBuffers.rawValue,
+                                                  command,
+                                                  payloadSize: payloadSize)
+            let bufferArray = payload.bindMemory(to: VkBuffer?.self, capacity: count)
+            let offsetArray = (payload + MemoryLayout<VkBuffer?>.stride * count)
+                .bindMemory(to: VkDeviceSize.self, capacity: count)
+
+            for (i, (buffer, offset)) in zip(buffers, offsets).prefix(count).enumerated() {
                 assert(buffer is VulkanBufferView)
                 if let bufferView = buffer as? VulkanBufferView {
                     assert(bufferView.buffer != nil)
-                    bufferArray.append(bufferView.buffer!.buffer)
-                    offsetArray.append(VkDeviceSize(offset))
+                    bufferArray[i] = bufferView.buffer!.buffer
+                    offsetArray[i] = VkDeviceSize(offset)
 
-                    self.encoder!.buffers.append(buffer)
+                    encoder.buffers.append(buffer)
                 } else {
-                    bufferArray.append(nil)
-                    offsetArray.append(0)
+                    bufferArray[i] = nil
+                    offsetArray[i] = 0
                 }
             }
-            assert(bufferArray.count == count)
-            assert(offsetArray.count == count)
-
-            let command = { (commandBuffer: VkCommandBuffer, state: inout EncodingState) in
-                vkCmdBindVertexBuffers(commandBuffer, UInt32(index), UInt32(count), &bufferArray, &offsetArray)
-            }
-            self.encoder!.commands.append(command)
         }
     }
 
     func setDepthStencilState(_ state: DepthStencilState?) {
-        var depthStencilState: VulkanDepthStencilState? = nil
-        if let state = state {
-            assert(state is VulkanDepthStencilState)
-            depthStencilState = state as? VulkanDepthStencilState
-        }
-
-        let command = { (commandBuffer: VkCommandBuffer, state: inout EncodingState) in
-            if let depthStencilState = depthStencilState {
-                depthStencilState.bind(commandBuffer: commandBuffer)
-            } else {
-                // reset to default
-                vkCmdSetDepthTestEnable(commandBuffer, VK_FALSE)
-                vkCmdSetStencilTestEnable(commandBuffer, VK_FALSE)
-                vkCmdSetDepthBoundsTestEnable(commandBuffer, VK_FALSE)
-                
-                if state.depthStencilState == nil {
-                    vkCmdSetDepthCompareOp(commandBuffer, VK_COMPARE_OP_ALWAYS)
-                    vkCmdSetDepthWriteEnable(commandBuffer, VK_FALSE)
-                    vkCmdSetDepthBounds(commandBuffer, 0.0, 1.0)
-
-                    let faceMask = VkStencilFaceFlags(VK_STENCIL_FACE_FRONT_AND_BACK.rawValue)
-                    vkCmdSetStencilCompareMask(commandBuffer, faceMask, 0xffffffff)
-                    vkCmdSetStencilWriteMask(commandBuffer, faceMask, 0xffffffff)
-                    vkCmdSetStencilOp(commandBuffer, faceMask,
-                                      VK_STENCIL_OP_KEEP, VK_STENCIL_OP_KEEP,
-                                      VK_STENCIL_OP_KEEP, VK_COMPARE_OP_ALWAYS)
-                }
-            }
-            state.depthStencilState = depthStencilState
-        }
-        self.encoder!.commands.append(command)
+        assert(state == nil || state is VulkanDepthStencilState)
+        let depthStencilState = state as? VulkanDepthStencilState
+        if self.encoder!.shadowState.setDepthStencilState(depthStencilState) == false {
+            return
+        }
+        var depthStencilIndex = -1
+        if let depthStencilState {
+            depthStencilIndex = self.encoder!.depthStencilStates.count
+            self.encoder!.depthStencilStates.append(depthStencilState)
+        }
+        self.encoder!.append(.setDepthStencilState,
+                             SetDepthStencilStateCommand(depthStencilIndex: depthStencilIndex))
         if self.encoder!.drawCount == 0 {
             self.encoder!.setDynamicStates.insert(VK_DYNAMIC_STATE_DEPTH_TEST_ENABLE)
             self.encoder!.setDynamicStates.insert(VK_DYNAMIC_STATE_STENCIL_TEST_ENABLE)
@@ -490,73 +679,66 @@ final class VulkanRenderCommandEncoder: RenderCommandEncoder {
     }
 
     func setCullMode(_ mode: CullMode) {
-        let command = { (commandBuffer: VkCommandBuffer, state: inout EncodingState) in
-            let flags = switch mode {
-            case .none:     VkCullModeFlags(VK_CULL_MODE_NONE.rawValue)
-            case .front:    VkCullModeFlags(VK_CULL_MODE_FRONT_BIT.rawValue)
-            case .back:     VkCullModeFlags(VK_CULL_MODE_BACK_BIT.rawValue)
-            }
-            vkCmdSetCullMode(commandBuffer, flags)
+        if self.encoder!.shadowState.setCullMode(mode) == false {
+            return
         }
-        self.encoder!.commands.append(command)
+        let flags = switch mode {
+        case .none:     VkCullModeFlags(VK_CULL_MODE_NONE.rawValue)
+        case .front:    VkCullModeFlags(VK_CULL_MODE_FRONT_BIT.rawValue)
+        case .back:     VkCullModeFlags(VK_CULL_MODE_BACK_BIT.rawValue)
+        }
+        self.encoder!.append(.setCullMode, SetCullModeCommand(cullMode: flags))
         if self.encoder!.drawCount == 0 {
             self.encoder!.setDynamicStates.insert(VK_DYNAMIC_STATE_CULL_MODE)
         }
     }
 
     func setFrontFacing(_ winding: Winding) {
-           let command = { (commandBuffer: VkCommandBuffer, state: inout EncodingState) in
-            let frontFace = switch winding {
-            case .clockwise:        VkFrontFace(VK_FRONT_FACE_CLOCKWISE.rawValue)
-            case .counterClockwise: VkFrontFace(VK_FRONT_FACE_COUNTER_CLOCKWISE.rawValue)
-            }
-            vkCmdSetFrontFace(commandBuffer, frontFace)
+        if self.encoder!.shadowState.setFrontFacing(winding) == false {
+            return
         }
-        self.encoder!.commands.append(command)
+        let frontFace = switch winding {
+        case .clockwise:        VkFrontFace(VK_FRONT_FACE_CLOCKWISE.rawValue)
+        case .counterClockwise: VkFrontFace(VK_FRONT_FACE_COUNTER_CLOCKWISE.rawValue)
+        }
+        self.encoder!.append(.setFrontFace, SetFrontFaceCommand(frontFace: frontFace))
         if self.encoder!.drawCount == 0 {
             self.encoder!.setDynamicStates.insert(VK_DYNAMIC_STATE_FRONT_FACE)
         }
     }
 
     func setBlendColor(red: Float, green: Float, blue: Float, alpha: Float) {
-        let command = { (commandBuffer: VkCommandBuffer, state: inout EncodingState) in
-            let blendConstants = (red, green, blue, alpha)
-            withUnsafeBytes(of: blendConstants) {
-                vkCmdSetBlendConstants(commandBuffer, $0.bindMemory(to: Float.self).baseAddress)
-            }
-        }
-        self.encoder!.commands.append(command)
+        self.encoder!.append(.setBlendConstants,
+                             SetBlendConstantsCommand(red: red, green: green, blue: blue, alpha: alpha))
         if self.encoder!.drawCount == 0 {
             self.encoder!.setDynamicStates.insert(VK_DYNAMIC_STATE_BLEND_CONSTANTS)
         }
     }
 
     func setStencilReferenceValue(_ value: UInt32) {
-        let command = { (commandBuffer: VkCommandBuffer, state: inout EncodingState) in
-            vkCmdSetStencilReference(commandBuffer, VkStencilFaceFlags(VK_STENCIL_FACE_FRONT_AND_BACK.rawValue), value)
-        }
-        self.encoder!.commands.append(command)
+        self.encoder!.append(.setStencilReference,
+                             SetStencilReferenceCommand(faceMask: VkStencilFaceFlags(VK_STENCIL_FACE_FRONT_AND_BACK.rawValue),
+                                                        reference: value))
         if self.encoder!.drawCount == 0 {
             self.encoder!.setDynamicStates.insert(VK_DYNAMIC_STATE_STENCIL_REFERENCE)
         }
     }
 
     func setStencilReferenceValues(front: UInt32, back: UInt32) {
-        let command = { (commandBuffer: VkCommandBuffer, state: inout EncodingState) in
-            vkCmdSetStencilReference(commandBuffer, VkStencilFaceFlags(VK_STENCIL_FACE_FRONT_BIT.rawValue), front)
-            vkCmdSetStencilReference(commandBuffer, VkStencilFaceFlags(VK_STENCIL_FACE_BACK_BIT.rawValue), back)
-        }
-        self.encoder!.commands.append(command)
+        self.encoder!.append(.setStencilReference,
+                             SetStencilReferenceCommand(faceMask: VkStencilFaceFlags(VK_STENCIL_FACE_FRONT_BIT.rawValue),
+                                                        reference: front))
+        self.encoder!.append(.setStencilReference,
+                             SetStencilReferenceCommand(faceMask: VkStencilFaceFlags(VK_STENCIL_FACE_BACK_BIT.rawValue),
+                                                        reference: back))
         if self.encoder!.drawCount == 0 {
             self.encoder!.setDynamicStates.insert(VK_DYNAMIC_STATE_STENCIL_REFERENCE)
         }
     }
 
     func setDepthBias(_ depthBias: Float, slopeScale: Float, clamp: Float) {
-        let command = { (commandBuffer: VkCommandBuffer, state: inout EncodingState) in
-            vkCmdSetDepthBias(commandBuffer, depthBias, clamp, slopeScale)
-        }
-        self.encoder!.commands.append(command)
+        self.encoder!.append(.setDepthBias,
+                             SetDepthBiasCommand(constantFactor: depthBias, clamp: clamp, slopeFactor: slopeScale))
         if self.encoder!.drawCount == 0 {
             self.encoder!.setDynamicStates.insert(VK_DYNAMIC_STATE_DEPTH_BIAS)
         }
@@ -565,20 +747,15 @@ final class VulkanRenderCommandEncoder: RenderCommandEncoder {
     func pushConstant<D: DataProtocol>(stages: ShaderStageFlags, offset: Int, data: D) {
         let stageFlags = stages.vkFlags()
         if stageFlags != 0 && data.count > 0 {
-            var buffer: [UInt8] = .init(data)
-            assert(buffer.count == data.count)
-
-            let command = { (commandBuffer: VkCommandBuffer, state: inout EncodingState) in
-                if let pipelineState = state.pipelineState {
-                    vkCmdPushConstants(commandBuffer,
-                                       pipelineState.layout,
-                                       stageFlags,
-                                       UInt32(offset),
-                                       UInt32(buffer.count),
-                                       &buffer)
-                }
-            }
-            self.encoder!.commands.append(command)
+            let size = data.count
+            let command = PushConstantCommand(stageFlags: stageFlags,
+                                              offset: UInt32(offset),
+                                              size: UInt32(size))
+            let payload = self.encoder!.commands.append(Command.pushConstant.rawValue,
+                                                        command,
+                                                        payloadSize: size)
+            let copied = data.copyBytes(to: UnsafeMutableRawBufferPointer(start: payload, count: size))
+            assert(copied == size)
         }
     }
  
@@ -604,37 +781,19 @@ final class VulkanRenderCommandEncoder: RenderCommandEncoder {
         let srcStages = stageMask(after)
         let dstStages = stageMask(before)
 
-        let command = { (commandBuffer: VkCommandBuffer, state: inout EncodingState) in
-            var memoryBarrier = VkMemoryBarrier2()
-            memoryBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER_2
-            memoryBarrier.srcStageMask = srcStages
-            memoryBarrier.srcAccessMask = VK_ACCESS_2_NONE
-            memoryBarrier.dstStageMask = dstStages
-            memoryBarrier.dstAccessMask = VK_ACCESS_2_NONE
-
-            withUnsafePointer(to: memoryBarrier) { pMemoryBarriers in
-                var dependencyInfo = VkDependencyInfo()
-                dependencyInfo.sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO
-                dependencyInfo.memoryBarrierCount = 1
-                dependencyInfo.pMemoryBarriers = pMemoryBarriers
-                vkCmdPipelineBarrier2(commandBuffer, &dependencyInfo)
-            }
-        }
-        self.encoder!.commands.append(command)
+        self.encoder!.append(.memoryBarrier,
+                             MemoryBarrierCommand(srcStages: srcStages, dstStages: dstStages))
     }
 
     func draw(vertexStart: Int, vertexCount: Int, instanceCount: Int, baseInstance: Int) {
         if vertexCount > 0 && instanceCount > 0 {
             assert(vertexStart >= 0)
             assert(baseInstance >= 0)
-            let command = { (commandBuffer: VkCommandBuffer, state: inout EncodingState) in
-                vkCmdDraw(commandBuffer,
-                          UInt32(vertexCount),
-                          UInt32(instanceCount),
-                          UInt32(vertexStart),
-                          UInt32(baseInstance))
-            }
-            self.encoder!.commands.append(command)
+            self.encoder!.append(.draw,
+                                 DrawCommand(vertexCount: UInt32(vertexCount),
+                                             instanceCount: UInt32(instanceCount),
+                                             firstVertex: UInt32(vertexStart),
+                                             firstInstance: UInt32(baseInstance)))
             self.encoder!.drawCount += 1
         }
     }
@@ -655,19 +814,45 @@ final class VulkanRenderCommandEncoder: RenderCommandEncoder {
             case .uint32:   VK_INDEX_TYPE_UINT32
             }
 
-            let command = { (commandBuffer: VkCommandBuffer, state: inout EncodingState) in
-                vkCmdBindIndexBuffer(commandBuffer, buffer.buffer, VkDeviceSize(indexBufferOffset), type)
-                vkCmdDrawIndexed(commandBuffer,
-                                 UInt32(indexCount),
-                                 UInt32(instanceCount),
-                                 0,  // firstIndex = 0
-                                 Int32(baseVertex),
-                                 UInt32(baseInstance))
-            }
+            self.encoder!.append(.drawIndexed,
+                                 DrawIndexedCommand(indexBuffer: buffer.buffer,
+                                                    indexBufferOffset: VkDeviceSize(indexBufferOffset),
+                                                    indexType: type,
+                                                    indexCount: UInt32(indexCount),
+                                                    instanceCount: UInt32(instanceCount),
+                                                    vertexOffset: Int32(baseVertex),
+                                                    firstInstance: UInt32(baseInstance)))
             self.encoder!.buffers.append(bufferView)
-            self.encoder!.commands.append(command)
             self.encoder!.drawCount += 1
         }
     }
 }
+
+extension VulkanCommandEncoder {
+    func addAttachmentSemaphores(_ context: VulkanRenderCommandEncoder.RenderContext) {
+        let colorAttachments = context.colorAttachments.map(\.0) + context.colorResolveTargets
+        let depthStencilAttachments = [context.depthStencilAttachment?.0, context.depthStencilResolveTarget].compactMap { $0 }
+
+        for rt in colorAttachments {
+            if rt.image != nil {
+                if let semaphore = rt.waitSemaphore {
+                    self.addWaitSemaphore(semaphore, value: 0, flags: VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT)
+                }
+                if let semaphore = rt.signalSemaphore {
+                    self.addSignalSemaphore(semaphore, value: 0, flags: VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT)
+                }
+            }
+        }
+        for rt in depthStencilAttachments {
+            if rt.image != nil {
+                if let semaphore = rt.waitSemaphore {
+                    self.addWaitSemaphore(semaphore, value: 0, flags: VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT)
+                }
+                if let semaphore = rt.signalSemaphore {
+                    self.addSignalSemaphore(semaphore, value: 0, flags: VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT)
+                }
+            }
+        }
+    }
+}
 #endif //if ENABLE_VULKAN
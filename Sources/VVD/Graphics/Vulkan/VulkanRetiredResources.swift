@@ -0,0 +1,65 @@
+//
+//  File: VulkanRetiredResources.swift
+//  Author: Hongtae Kim (tiff2766@gmail.com)
+//
+//  Copyright (c) 2022-2025 Hongtae Kim. All rights reserved.
+//
+
+#if ENABLE_VULKAN
+import Foundation
+
+// Objects replaced while command buffers may still refer to them,
+// such as the previous buffers of relocated memory.
+// Command buffers capture handles while recording, and keep them until
+// they are released after completion. A retired object is released once
+// every command buffer created before it was retired has been released.
+final class VulkanRetiredResources: @unchecked Sendable {
+    private var epoch: UInt64 = 0
+    private var liveCommandBuffers: [UInt64: Int] = [:]  // per epoch
+    private var retired: [(epoch: UInt64, object: AnyObject)] = []
+    private let lock = NSLock()
+
+    // called when a command buffer is created, returns its epoch.
+    func beginCommandBuffer() -> UInt64 {
+        self.lock.withLock {
+            self.liveCommandBuffers[self.epoch, default: 0] += 1
+            return self.epoch
+        }
+    }
+
+    // called when a command buffer is released.
+    func endCommandBuffer(epoch: UInt64) {
+        let released: [AnyObject] = self.lock.withLock {
+            if let count = self.liveCommandBuffers[epoch], count > 1 {
+                self.liveCommandBuffers[epoch] = count - 1
+            } else {
+                self.liveCommandBuffers[epoch] = nil
+            }
+            return self.collect()
+        }
+        // released outside of the lock, deinit may call back.
+        _ = released
+    }
+
+    func retire(_ object: AnyObject) {
+        let released: [AnyObject] = self.lock.withLock {
+            self.retired.append((self.epoch, object))
+            self.epoch += 1
+            return self.collect()
+        }
+        _ = released
+    }
+
+    var count: Int { self.lock.withLock { self.retired.count } }
+
+    // called with the lock held.
+    private func collect() -> [AnyObject] {
+        let oldest = self.liveCommandBuffers.keys.min() ?? .max
+        let count = self.retired.prefix { $0.epoch < oldest }.count
+        if count == 0 { return [] }
+        let released = self.retired.prefix(count).map(\.object)
+        self.retired.removeFirst(count)
+        return released
+    }
+}
+#endif //if ENABLE_VULKAN
@@ -17,7 +17,11 @@ final class VulkanShaderBindingSet: ShaderBindingSet {
     private let poolID: VulkanDescriptorPoolID
     
     typealias DescriptorBinding = VulkanDescriptorSet.Binding    
-    var bindings: [DescriptorBinding]
+    var bindings: [DescriptorBinding] {
+        didSet { version &+= 1 }
+    }
+    // incremented on every binding update, used to filter redundant binds.
+    private(set) var version: UInt64 = 0
 
     init(device: VulkanGraphicsDevice,
          layout: VkDescriptorSetLayout,
@@ -96,6 +100,11 @@ final class VulkanShaderBindingSet: ShaderBindingSet {
                     let buffer = bufferView?.buffer
                     assert(buffer != nil)
                     if let buffer = buffer {
+                        if descriptor.descriptorType == VK_DESCRIPTOR_TYPE_STORAGE_BUFFER ||
+                           descriptor.descriptorType == VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC {
+                            // may be written by shaders, not relocatable.
+                            buffer.pin()
+                        }
                         var bufferInfo = VkDescriptorBufferInfo()
                         bufferInfo.buffer = buffer.buffer
                         bufferInfo.offset = VkDeviceSize(buffers[i].offset)
@@ -289,9 +298,29 @@ final class VulkanShaderBindingSet: ShaderBindingSet {
     func makeDescriptorSet() -> VulkanDescriptorSet {
         let device = self.device as! VulkanGraphicsDevice
         let descriptorSet = device.makeDescriptorSet(layout: self.descriptorSetLayout, poolID: self.poolID)!
-        descriptorSet.bindings = self.bindings
+        self.writeDescriptorSet(descriptorSet, bindings: self.currentBindings())
+        return descriptorSet
+    }
 
-        let tempHolder = TemporaryBufferHolder(label: "VulkanShaderBindingSet.makeDescriptorSet")
+    // bindings with the current buffer handles,
+    // buffers may have been moved by defragmentMemory()
+    func currentBindings() -> [DescriptorBinding] {
+        var bindings = self.bindings
+        for i in 0..<bindings.count where bindings[i].valueSet && bindings[i].bufferInfos.isEmpty == false {
+            for (j, bufferView) in bindings[i].bufferViews.prefix(bindings[i].bufferInfos.count).enumerated() {
+                if let buffer = bufferView.buffer {
+                    bindings[i].bufferInfos[j].buffer = buffer.buffer
+                }
+            }
+        }
+        return bindings
+    }
+
+    func writeDescriptorSet(_ descriptorSet: VulkanDescriptorSet, bindings: [DescriptorBinding]) {
+        let device = self.device as! VulkanGraphicsDevice
+        descriptorSet.bindings = bindings
+
+        let tempHolder = TemporaryBufferHolder(label: "VulkanShaderBindingSet.writeDescriptorSet")
 
         var descriptorWrites: [VkWriteDescriptorSet] = []
         descriptorWrites.reserveCapacity(descriptorSet.bindings.count)
@@ -327,8 +356,6 @@ final class VulkanShaderBindingSet: ShaderBindingSet {
         assert(descriptorWrites.count > 0)
 
         vkUpdateDescriptorSets(device.device, UInt32(descriptorWrites.count), &descriptorWrites, 0, nil)
-
-        return descriptorSet
     }
 
     private func findDescriptorBinding(_ binding: Int) -> DescriptorBinding? {
@@ -0,0 +1,195 @@
+//
+//  File: BatchTransform.swift
+//  Author: Hongtae Kim (tiff2766@gmail.com)
+//
+//  Copyright (c) 2022-2025 Hongtae Kim. All rights reserved.
+//
+
+import Foundation
+
+// Strided Float3 or Float4 elements in memory, such as an attribute of
+// an interleaved vertex buffer. Can point to mapped GPU buffer memory.
+public struct StridedVectors {
+    public enum Format: Int {
+        case float3 = 3
+        case float4 = 4
+    }
+
+    public let baseAddress: UnsafeMutableRawPointer
+    public let stride: Int
+    public let count: Int
+    public let format: Format
+
+    public init(_ baseAddress: UnsafeMutableRawPointer, stride: Int? = nil, count: Int, format: Format) {
+        self.baseAddress = baseAddress
+        self.stride = stride ?? format.rawValue * MemoryLayout<Float32>.stride
+        self.count = count
+        self.format = format
+        assert(self.stride >= format.rawValue * MemoryLayout<Float32>.stride)
+    }
+
+    // source only, elements are not written.
+    public init(readOnly baseAddress: UnsafeRawPointer, stride: Int? = nil, count: Int, format: Format) {
+        self.init(UnsafeMutableRawPointer(mutating: baseAddress), stride: stride, count: count, format: format)
+    }
+
+    @inline(__always)
+    func load(_ index: Int, w: Float32) -> SIMD4<Float32> {
+        let p = baseAddress + index * stride
+        if format == .float4 {
+            return p.loadUnaligned(as: SIMD4<Float32>.self)
+        }
+        return SIMD4(p.loadUnaligned(fromByteOffset: 0, as: Float32.self),
+                     p.loadUnaligned(fromByteOffset: 4, as: Float32.self),
+                     p.loadUnaligned(fromByteOffset: 8, as: Float32.self),
+                     w)
+    }
+
+    @inline(__always)
+    func store(_ v: SIMD4<Float32>, _ index: Int) {
+        let p = baseAddress + index * stride
+        if format == .float4 {
+            p.storeBytes(of: v, as: SIMD4<Float32>.self)
+        } else {
+            p.storeBytes(of: v.x, toByteOffset: 0, as: Float32.self)
+            p.storeBytes(of: v.y, toByteOffset: 4, as: Float32.self)
+            p.storeBytes(of: v.z, toByteOffset: 8, as: Float32.self)
+        }
+    }
+}
+
+// Transforms arrays of positions and normals with one transform,
+// in Float32 SIMD, and accumulates the bounds of the transformed positions.
+// Positions of a projective matrix are divided by w, as Vector3.applying(_:w:).
+// Source and destination may be the same memory (in-place).
+public struct BatchTransform {
+    public let matrix: Matrix4f
+    public let normalMatrix: Matrix4f   // inverse transpose of the 3x3 part
+    public let isAffine: Bool           // the last column is (0, 0, 0, 1)
+
+    public init(_ matrix: Matrix4) {
+        self.init(Matrix4f(matrix))
+    }
+
+    public init(_ transform: AffineTransform3) {
+        self.init(Matrix4f(transform.matrix4))
+    }
+
+    public init(_ transform: Transform) {
+        self.init(Matrix4f(transform.matrix4))
+    }
+
+    public init(_ matrix: Matrix4f) {
+        self.matrix = matrix
+        self.isAffine = matrix.r1.w == 0 && matrix.r2.w == 0 && matrix.r3.w == 0 && matrix.r4.w == 1
+        var linear = matrix
+        linear.r1.w = 0; linear.r2.w = 0; linear.r3.w = 0
+        linear.r4 = SIMD4(0, 0, 0, 1)
+        self.normalMatrix = linear.inverted()?.transposed() ?? linear
+    }
+
+    // Transforms positions (w = 1), returns the bounds of the result.
+    // Float4 destinations get w = 1, after the perspective divide.
+    @discardableResult
+    public func transformPoints(_ source: StridedVectors, into destination: StridedVectors) -> AABB {
+        assert(destination.count >= source.count)
+        let (r1, r2, r3, r4) = (matrix.r1, matrix.r2, matrix.r3, matrix.r4)
+        var minimum = SIMD4<Float32>(repeating: .greatestFiniteMagnitude)
+        var maximum = SIMD4<Float32>(repeating: -.greatestFiniteMagnitude)
+        for i in 0..<source.count {
+            let v = source.load(i, w: 1)
+            let p = point(r1 * v.x + r2 * v.y + r3 * v.z + r4)
+            minimum = pointwiseMin(minimum, p)
+            maximum = pointwiseMax(maximum, p)
+            destination.store(p, i)
+        }
+        return Self.aabb(minimum, maximum, source.count)
+    }
+
+    // Transforms and normalizes normals (w = 0).
+    public func transformNormals(_ source: StridedVectors, into destination: StridedVectors) {
+        assert(destination.count >= source.count)
+        let (n1, n2, n3) = (normalMatrix.r1, normalMatrix.r2, normalMatrix.r3)
+        for i in 0..<source.count {
+            let v = source.load(i, w: 0)
+            destination.store(Self.normalized(n1 * v.x + n2 * v.y + n3 * v.z, w: v.w), i)
+        }
+    }
+
+    // Transforms positions and normals of the same vertices in one pass,
+    // returns the bounds of the transformed positions.
+    @discardableResult
+    public func transformVertices(positions: StridedVectors, into positionDestination: StridedVectors,
+                                  normals: StridedVectors, into normalDestination: StridedVectors) -> AABB {
+        assert(normals.count >= positions.count)
+        assert(positionDestination.count >= positions.count)
+        assert(normalDestination.count >= positions.count)
+        let (r1, r2, r3, r4) = (matrix.r1, matrix.r2, matrix.r3, matrix.r4)
+        let (n1, n2, n3) = (normalMatrix.r1, normalMatrix.r2, normalMatrix.r3)
+        var minimum = SIMD4<Float32>(repeating: .greatestFiniteMagnitude)
+        var maximum = SIMD4<Float32>(repeating: -.greatestFiniteMagnitude)
+        for i in 0..<positions.count {
+            let v = positions.load(i, w: 1)
+            let p = point(r1 * v.x + r2 * v.y + r3 * v.z + r4)
+            minimum = pointwiseMin(minimum, p)
+            maximum = pointwiseMax(maximum, p)
+            positionDestination.store(p, i)
+
+            let n = normals.load(i, w: 0)
+            normalDestination.store(Self.normalized(n1 * n.x + n2 * n.y + n3 * n.z, w: n.w), i)
+        }
+        return Self.aabb(minimum, maximum, positions.count)
+    }
+
+    // Bounds of the transformed positions, source is not modified.
+    public func bounds(_ source: StridedVectors) -> AABB {
+        let (r1, r2, r3, r4) = (matrix.r1, matrix.r2, matrix.r3, matrix.r4)
+        var minimum = SIMD4<Float32>(repeating: .greatestFiniteMagnitude)
+        var maximum = SIMD4<Float32>(repeating: -.greatestFiniteMagnitude)
+        for i in 0..<source.count {
+            let v = source.load(i, w: 1)
+            let p = point(r1 * v.x + r2 * v.y + r3 * v.z + r4)
+            minimum = pointwiseMin(minimum, p)
+            maximum = pointwiseMax(maximum, p)
+        }
+        return Self.aabb(minimum, maximum, source.count)
+    }
+
+    // Transformed positions as Vector3 array.
+    public func transformedPoints(_ source: StridedVectors) -> [Vector3] {
+        let (r1, r2, r3, r4) = (matrix.r1, matrix.r2, matrix.r3, matrix.r4)
+        return [Vector3](unsafeUninitializedCapacity: source.count) { buffer, count in
+            for i in 0..<source.count {
+                let v = source.load(i, w: 1)
+                let p = point(r1 * v.x + r2 * v.y + r3 * v.z + r4)
+                (buffer.baseAddress! + i).initialize(to: Vector3(p.x, p.y, p.z))
+            }
+            count = source.count
+        }
+    }
+
+    // perspective divide, the result of an affine matrix already has w = 1.
+    @inline(__always)
+    func point(_ p: SIMD4<Float32>) -> SIMD4<Float32> {
+        if isAffine { return p }
+        return p / p.w
+    }
+
+    @inline(__always)
+    static func normalized(_ v: SIMD4<Float32>, w: Float32) -> SIMD4<Float32> {
+        var n = v
+        n.w = 0
+        let lengthSq = (n * n).sum()
+        if lengthSq > 0 {
+            n /= lengthSq.squareRoot()
+        }
+        n.w = w
+        return n
+    }
+
+    static func aabb(_ minimum: SIMD4<Float32>, _ maximum: SIMD4<Float32>, _ count: Int) -> AABB {
+        if count == 0 { return .null }
+        return AABB(min: Vector3(minimum.x, minimum.y, minimum.z),
+                    max: Vector3(maximum.x, maximum.y, maximum.z))
+    }
+}
@@ -0,0 +1,215 @@
+//
+//  File: Matrix4f.swift
+//  Author: Hongtae Kim (tiff2766@gmail.com)
+//
+//  Copyright (c) 2022-2025 Hongtae Kim. All rights reserved.
+//
+
+import Foundation
+
+// Float32 SIMD-backed 4x4 matrix, stored as rows (row vector, v * M)
+// like Matrix4. Memory layout is identical to Float4x4, values can be
+// copied to GPU buffers as they are.
+public struct Matrix4f: Hashable, Sendable {
+    public var r1, r2, r3, r4: SIMD4<Float32>
+
+    public static let identity = Matrix4f(r1: SIMD4(1, 0, 0, 0),
+                                          r2: SIMD4(0, 1, 0, 0),
+                                          r3: SIMD4(0, 0, 1, 0),
+                                          r4: SIMD4(0, 0, 0, 1))
+
+    public init(r1: SIMD4<Float32>, r2: SIMD4<Float32>, r3: SIMD4<Float32>, r4: SIMD4<Float32>) {
+        self.r1 = r1
+        self.r2 = r2
+        self.r3 = r3
+        self.r4 = r4
+    }
+
+    public init(_ m: Matrix4) {
+        self.r1 = SIMD4(Float32(m.m11), Float32(m.m12), Float32(m.m13), Float32(m.m14))
+        self.r2 = SIMD4(Float32(m.m21), Float32(m.m22), Float32(m.m23), Float32(m.m24))
+        self.r3 = SIMD4(Float32(m.m31), Float32(m.m32), Float32(m.m33), Float32(m.m34))
+        self.r4 = SIMD4(Float32(m.m41), Float32(m.m42), Float32(m.m43), Float32(m.m44))
+    }
+
+    public init(_ m: Float4x4) {
+        self = unsafeBitCast(m, to: Matrix4f.self)
+    }
+
+    public var matrix4: Matrix4 {
+        Matrix4(r1.x, r1.y, r1.z, r1.w,
+                r2.x, r2.y, r2.z, r2.w,
+                r3.x, r3.y, r3.z, r3.w,
+                r4.x, r4.y, r4.z, r4.w)
+    }
+
+    public var float4x4: Float4x4 { unsafeBitCast(self, to: Float4x4.self) }
+
+    public subscript(row: Int, column: Int) -> Float32 {
+        get {
+            switch row {
+            case 0: return r1[column]
+            case 1: return r2[column]
+            case 2: return r3[column]
+            case 3: return r4[column]
+            default:
+                fatalError("Index out of range")
+            }
+        }
+        set {
+            switch row {
+            case 0: r1[column] = newValue
+            case 1: r2[column] = newValue
+            case 2: r3[column] = newValue
+            case 3: r4[column] = newValue
+            default:
+                fatalError("Index out of range")
+            }
+        }
+    }
+
+    public func transposed() -> Self {
+        Self(r1: SIMD4(r1.x, r2.x, r3.x, r4.x),
+             r2: SIMD4(r1.y, r2.y, r3.y, r4.y),
+             r3: SIMD4(r1.z, r2.z, r3.z, r4.z),
+             r4: SIMD4(r1.w, r2.w, r3.w, r4.w))
+    }
+
+    @inline(__always)
+    func row(_ v: SIMD4<Float32>) -> SIMD4<Float32> {
+        r1 * v.x + r2 * v.y + r3 * v.z + r4 * v.w
+    }
+
+    public func concatenating(_ m: Self) -> Self {
+        Self(r1: m.row(r1), r2: m.row(r2), r3: m.row(r3), r4: m.row(r4))
+    }
+
+    public static func * (lhs: Self, rhs: Self) -> Self {
+        lhs.concatenating(rhs)
+    }
+
+    // 2x2 sub-determinants of rows 1..3 for columns (p, q)
+    @inline(__always)
+    private func factor(_ p: Int, _ q: Int) -> SIMD4<Float32> {
+        SIMD4(r3[p], r3[p], r2[p], r2[p]) * SIMD4(r4[q], r4[q], r4[q], r3[q]) -
+        SIMD4(r4[p], r4[p], r4[p], r3[p]) * SIMD4(r3[q], r3[q], r2[q], r2[q])
+    }
+
+    public var determinant: Float32 {
+        let cof = cofactors()
+        return (r1 * SIMD4(cof.0.x, cof.1.x, cof.2.x, cof.3.x)).sum()
+    }
+
+    private func cofactors() -> (SIMD4<Float32>, SIMD4<Float32>, SIMD4<Float32>, SIMD4<Float32>) {
+        let fac0 = factor(2, 3), fac1 = factor(1, 3), fac2 = factor(1, 2)
+        let fac3 = factor(0, 3), fac4 = factor(0, 2), fac5 = factor(0, 1)
+
+        let v0 = SIMD4(r2.x, r1.x, r1.x, r1.x)
+        let v1 = SIMD4(r2.y, r1.y, r1.y, r1.y)
+        let v2 = SIMD4(r2.z, r1.z, r1.z, r1.z)
+        let v3 = SIMD4(r2.w, r1.w, r1.w, r1.w)
+
+        let signA = SIMD4<Float32>(1, -1, 1, -1)
+        let signB = SIMD4<Float32>(-1, 1, -1, 1)
+        return ((v1 * fac0 - v2 * fac1 + v3 * fac2) * signA,
+                (v0 * fac0 - v2 * fac3 + v3 * fac4) * signB,
+                (v0 * fac1 - v1 * fac3 + v3 * fac5) * signA,
+                (v0 * fac2 - v1 * fac4 + v2 * fac5) * signB)
+    }
+
+    public func inverted() -> Self? {
+        let (c1, c2, c3, c4) = cofactors()
+        let d = (r1 * SIMD4(c1.x, c2.x, c3.x, c4.x)).sum()
+        if d.isZero { return nil }
+        let inv = 1 / d
+        return Self(r1: c1 * inv, r2: c2 * inv, r3: c3 * inv, r4: c4 * inv)
+    }
+}
+
+// transform array kernels
+public extension Matrix4f {
+    // homogeneous transform of points (w = 1) without perspective divide.
+    func transform(points: UnsafeBufferPointer<Vector3f>, into output: UnsafeMutableBufferPointer<Vector3f>) {
+        assert(output.count >= points.count)
+        let (r1, r2, r3, r4) = (self.r1, self.r2, self.r3, self.r4)
+        for i in 0..<points.count {
+            let p = points[i].simd
+            let v = r1 * p.x + r2 * p.y + r3 * p.z + r4
+            output[i] = Vector3f(SIMD3(v.x, v.y, v.z))
+        }
+    }
+
+    // transform of directions (w = 0).
+    func transform(vectors: UnsafeBufferPointer<Vector3f>, into output: UnsafeMutableBufferPointer<Vector3f>) {
+        assert(output.count >= vectors.count)
+        let (r1, r2, r3) = (self.r1, self.r2, self.r3)
+        for i in 0..<vectors.count {
+            let p = vectors[i].simd
+            let v = r1 * p.x + r2 * p.y + r3 * p.z
+            output[i] = Vector3f(SIMD3(v.x, v.y, v.z))
+        }
+    }
+
+    // packed Float3 variants of the above, for vertex data.
+    // input and output can be the same buffer.
+    func transform(points: UnsafeBufferPointer<Float3>, into output: UnsafeMutableBufferPointer<Float3>) {
+        assert(output.count >= points.count)
+        let (r1, r2, r3, r4) = (self.r1, self.r2, self.r3, self.r4)
+        for i in 0..<points.count {
+            let p = points[i]
+            let v = r1 * p.0 + r2 * p.1 + r3 * p.2 + r4
+            output[i] = (v.x, v.y, v.z)
+        }
+    }
+
+    func transform(vectors: UnsafeBufferPointer<Float3>, into output: UnsafeMutableBufferPointer<Float3>) {
+        assert(output.count >= vectors.count)
+        let (r1, r2, r3) = (self.r1, self.r2, self.r3)
+        for i in 0..<vectors.count {
+            let p = vectors[i]
+            let v = r1 * p.0 + r2 * p.1 + r3 * p.2
+            output[i] = (v.x, v.y, v.z)
+        }
+    }
+
+    func transform(_ vectors: UnsafeMutableBufferPointer<Vector4f>) {
+        for i in 0..<vectors.count {
+            vectors[i] = Vector4f(row(vectors[i].simd))
+        }
+    }
+
+    func transform(points: [Vector3f]) -> [Vector3f] {
+        [Vector3f](unsafeUninitializedCapacity: points.count) { buffer, count in
+            points.withUnsafeBufferPointer { transform(points: $0, into: buffer) }
+            count = points.count
+        }
+    }
+
+    // output[i] = matrices[i] * self
+    static func concatenate(_ matrices: UnsafeBufferPointer<Matrix4f>, _ m: Matrix4f,
+                            into output: UnsafeMutableBufferPointer<Matrix4f>) {
+        assert(output.count >= matrices.count)
+        for i in 0..<matrices.count {
+            output[i] = matrices[i].concatenating(m)
+        }
+    }
+
+    // copies matrices in Float4x4 layout, for GPU buffers.
+    static func store(_ matrices: UnsafeBufferPointer<Matrix4f>, to buffer: UnsafeMutableRawPointer) {
+        if let base = matrices.baseAddress {
+            buffer.copyMemory(from: base, byteCount: matrices.count * MemoryLayout<Float4x4>.stride)
+        }
+    }
+}
+
+public extension Matrix4 {
+    var matrix4f: Matrix4f { Matrix4f(self) }
+}
+
+public extension Vector3 {
+    var vector3f: Vector3f { Vector3f(self) }
+}
+
+public extension Quaternion {
+    var quaternionf: Quaternionf { Quaternionf(self) }
+}
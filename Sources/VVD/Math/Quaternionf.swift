@@ -0,0 +1,73 @@
+//
+//  File: Quaternionf.swift
+//  Author: Hongtae Kim (tiff2766@gmail.com)
+//
+//  Copyright (c) 2022-2025 Hongtae Kim. All rights reserved.
+//
+
+import Foundation
+
+// Float32 SIMD-backed quaternion (x, y, z, w), same conventions as Quaternion.
+public struct Quaternionf: Hashable, Sendable {
+    public var simd: SIMD4<Float32>
+
+    public var x: Float32 { simd.x }
+    public var y: Float32 { simd.y }
+    public var z: Float32 { simd.z }
+    public var w: Float32 { simd.w }
+
+    public static let identity = Quaternionf(SIMD4(0, 0, 0, 1))
+
+    public init(_ simd: SIMD4<Float32>) {
+        self.simd = simd
+    }
+
+    public init(_ x: Float32, _ y: Float32, _ z: Float32, _ w: Float32) {
+        self.simd = SIMD4(x, y, z, w)
+    }
+
+    public init(_ q: Quaternion) {
+        self.simd = SIMD4(Float32(q.x), Float32(q.y), Float32(q.z), Float32(q.w))
+    }
+
+    public init(angle: Float32, axis: Vector3f) {
+        self.simd = SIMD4(0, 0, 0, 1)
+        if axis.lengthSquared > 0 {
+            let a = angle * 0.5
+            self.simd = SIMD4(axis.normalized().simd * sin(a), cos(a))
+        }
+    }
+
+    public var quaternion: Quaternion { Quaternion(x, y, z, w) }
+
+    public func conjugated() -> Self {
+        Self(simd * SIMD4(-1, -1, -1, 1))
+    }
+
+    public func normalized() -> Self {
+        let lengthSq = (simd * simd).sum()
+        if lengthSq > 0 {
+            return Self(simd / lengthSq.squareRoot())
+        }
+        return self
+    }
+
+    // same as Quaternion.concatenating: q * self
+    public func concatenating(_ q: Self) -> Self {
+        let a = q.simd, b = self.simd
+        let sign = SIMD4<Float32>(1, 1, 1, -1)
+        let r = SIMD4(repeating: a.w) * b
+            + SIMD4(a.x, a.y, a.z, a.x) * SIMD4(b.w, b.w, b.w, b.x) * sign
+            + SIMD4(a.y, a.z, a.x, a.y) * SIMD4(b.z, b.x, b.y, b.y) * sign
+            - SIMD4(a.z, a.x, a.y, a.z) * SIMD4(b.y, b.z, b.x, b.z)
+        return Self(r)
+    }
+
+    public var matrix4: Matrix4f {
+        let (x, y, z, w) = (simd.x, simd.y, simd.z, simd.w)
+        return Matrix4f(r1: SIMD4(1 - 2 * (y * y + z * z), 2 * (x * y + z * w), 2 * (x * z - y * w), 0),
+                        r2: SIMD4(2 * (x * y - z * w), 1 - 2 * (x * x + z * z), 2 * (y * z + x * w), 0),
+                        r3: SIMD4(2 * (x * z + y * w), 2 * (y * z - x * w), 1 - 2 * (x * x + y * y), 0),
+                        r4: SIMD4(0, 0, 0, 1))
+    }
+}
@@ -0,0 +1,107 @@
+//
+//  File: Vector3f.swift
+//  Author: Hongtae Kim (tiff2766@gmail.com)
+//
+//  Copyright (c) 2022-2025 Hongtae Kim. All rights reserved.
+//
+
+import Foundation
+
+// Float32 SIMD-backed 3D vector, for bulk transforms.
+// Same conventions as Vector3 (row vector, v * M).
+// SIMD3 is padded to 16 bytes, so arrays of Vector3f are not layout
+// compatible with Float3 (12 bytes) or packed vertex data. Use the Float3
+// kernels of Matrix4f, or store(_:to:) to write packed buffers.
+public struct Vector3f: Hashable, Sendable {
+    public var simd: SIMD3<Float32>
+
+    public var x: Float32 {
+        get { simd.x }
+        set { simd.x = newValue }
+    }
+    public var y: Float32 {
+        get { simd.y }
+        set { simd.y = newValue }
+    }
+    public var z: Float32 {
+        get { simd.z }
+        set { simd.z = newValue }
+    }
+
+    public static let zero = Vector3f(0, 0, 0)
+
+    public init(_ simd: SIMD3<Float32>) {
+        self.simd = simd
+    }
+
+    public init(_ x: Float32, _ y: Float32, _ z: Float32) {
+        self.simd = SIMD3(x, y, z)
+    }
+
+    public init(_ v: Vector3) {
+        self.simd = SIMD3(Float32(v.x), Float32(v.y), Float32(v.z))
+    }
+
+    public init(_ v: Float3) {
+        self.simd = SIMD3(v.0, v.1, v.2)
+    }
+
+    public var vector3: Vector3 { Vector3(x, y, z) }
+    public var float3: Float3 { (simd.x, simd.y, simd.z) }
+
+    public var lengthSquared: Float32 { (simd * simd).sum() }
+    public var length: Float32 { lengthSquared.squareRoot() }
+
+    public func normalized() -> Self {
+        let lengthSq = self.lengthSquared
+        if lengthSq > 0 {
+            return Self(simd / lengthSq.squareRoot())
+        }
+        return self
+    }
+
+    public static func dot(_ v1: Self, _ v2: Self) -> Float32 {
+        (v1.simd * v2.simd).sum()
+    }
+
+    public static func cross(_ v1: Self, _ v2: Self) -> Self {
+        let a = v1.simd, b = v2.simd
+        return Self(SIMD3(a.y, a.z, a.x) * SIMD3(b.z, b.x, b.y) -
+                    SIMD3(a.z, a.x, a.y) * SIMD3(b.y, b.z, b.x))
+    }
+
+    // homogeneous transform
+    public func applying(_ m: Matrix4f, w: Float32 = 1.0) -> Self {
+        let v = m.r1 * x + m.r2 * y + m.r3 * z + m.r4 * w
+        let xyz = SIMD3(v.x, v.y, v.z)
+        if w == .zero { return Self(xyz) }
+        return Self(xyz / v.w)
+    }
+
+    public func applying(_ q: Quaternionf) -> Self {
+        let v = Vector3f(q.x, q.y, q.z)
+        let uv = Self.cross(v, self)
+        let uuv = Self.cross(v, uv)
+        return Self(simd + uv.simd * (2 * q.w) + uuv.simd * 2)
+    }
+
+    public static func + (lhs: Self, rhs: Self) -> Self { Self(lhs.simd + rhs.simd) }
+    public static func - (lhs: Self, rhs: Self) -> Self { Self(lhs.simd - rhs.simd) }
+    public static func * (lhs: Self, rhs: Self) -> Self { Self(lhs.simd * rhs.simd) }
+    public static func * (lhs: Self, rhs: Float32) -> Self { Self(lhs.simd * rhs) }
+    public static func / (lhs: Self, rhs: Float32) -> Self { Self(lhs.simd / rhs) }
+    public static prefix func - (v: Self) -> Self { Self(-v.simd) }
+}
+
+public extension Vector3f {
+    // copies vectors as packed Float3, for vertex buffers.
+    static func store(_ vectors: UnsafeBufferPointer<Vector3f>, to buffer: UnsafeMutableRawPointer) {
+        let output = buffer.bindMemory(to: Float32.self, capacity: vectors.count * 3)
+        for i in 0..<vectors.count {
+            let v = vectors[i].simd
+            output[i * 3] = v.x
+            output[i * 3 + 1] = v.y
+            output[i * 3 + 2] = v.z
+        }
+    }
+}
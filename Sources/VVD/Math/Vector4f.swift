@@ -0,0 +1,81 @@
+//
+//  File: Vector4f.swift
+//  Author: Hongtae Kim (tiff2766@gmail.com)
+//
+//  Copyright (c) 2022-2025 Hongtae Kim. All rights reserved.
+//
+
+import Foundation
+
+// Float32 SIMD-backed 4D vector, memory layout identical to Float4.
+public struct Vector4f: Hashable, Sendable {
+    public var simd: SIMD4<Float32>
+
+    public var x: Float32 {
+        get { simd.x }
+        set { simd.x = newValue }
+    }
+    public var y: Float32 {
+        get { simd.y }
+        set { simd.y = newValue }
+    }
+    public var z: Float32 {
+        get { simd.z }
+        set { simd.z = newValue }
+    }
+    public var w: Float32 {
+        get { simd.w }
+        set { simd.w = newValue }
+    }
+
+    public static let zero = Vector4f(0, 0, 0, 0)
+
+    public init(_ simd: SIMD4<Float32>) {
+        self.simd = simd
+    }
+
+    public init(_ x: Float32, _ y: Float32, _ z: Float32, _ w: Float32) {
+        self.simd = SIMD4(x, y, z, w)
+    }
+
+    public init(_ v: Vector3f, w: Float32) {
+        self.simd = SIMD4(v.simd, w)
+    }
+
+    public init(_ v: Vector4) {
+        self.simd = SIMD4(Float32(v.x), Float32(v.y), Float32(v.z), Float32(v.w))
+    }
+
+    public init(_ v: Float4) {
+        self.simd = unsafeBitCast(v, to: SIMD4<Float32>.self)
+    }
+
+    public var vector4: Vector4 { Vector4(x, y, z, w) }
+    public var float4: Float4 { unsafeBitCast(simd, to: Float4.self) }
+
+    public var lengthSquared: Float32 { (simd * simd).sum() }
+    public var length: Float32 { lengthSquared.squareRoot() }
+
+    public func normalized() -> Self {
+        let lengthSq = self.lengthSquared
+        if lengthSq > 0 {
+            return Self(simd / lengthSq.squareRoot())
+        }
+        return self
+    }
+
+    public static func dot(_ v1: Self, _ v2: Self) -> Float32 {
+        (v1.simd * v2.simd).sum()
+    }
+
+    public func applying(_ m: Matrix4f) -> Self {
+        Self(m.r1 * x + m.r2 * y + m.r3 * z + m.r4 * w)
+    }
+
+    public static func + (lhs: Self, rhs: Self) -> Self { Self(lhs.simd + rhs.simd) }
+    public static func - (lhs: Self, rhs: Self) -> Self { Self(lhs.simd - rhs.simd) }
+    public static func * (lhs: Self, rhs: Self) -> Self { Self(lhs.simd * rhs.simd) }
+    public static func * (lhs: Self, rhs: Float32) -> Self { Self(lhs.simd * rhs) }
+    public static func / (lhs: Self, rhs: Float32) -> Self { Self(lhs.simd / rhs) }
+    public static prefix func - (v: Self) -> Self { Self(-v.simd) }
+}
@@ -0,0 +1,153 @@
+/*******************************************************************************
+ File: AudioRingBuffer.cpp
+ Author: Hongtae Kim (tiff2766@gmail.com)
+
+ Copyright (c) 2004-2024 Hongtae Kim. All rights reserved.
+
+*******************************************************************************/
+
+#include <new>
+#include <atomic>
+#include <string.h>
+#include "AudioRingBuffer.h"
+#include "Malloc.h"
+#include "Log.h"
+
+namespace
+{
+    // avoid false sharing between producer and consumer indices
+    constexpr size_t cacheLineSize = 64;
+
+    struct Slot
+    {
+        size_t byteCount;
+        double timeStamp;
+        uint32_t flags;
+        uint32_t generation;
+    };
+}
+
+struct _VVDAudioRingBuffer
+{
+    alignas(cacheLineSize) std::atomic<size_t> head; // next slot to write, owned by producer
+    alignas(cacheLineSize) std::atomic<size_t> tail; // next slot to read, owned by consumer
+
+    alignas(cacheLineSize) size_t mask;
+    size_t slotSize;
+    Slot* slots;
+    uint8_t* data;
+};
+
+extern "C" VVDAudioRingBuffer* VVDAudioRingBufferCreate(size_t slotCount, size_t slotSize)
+{
+    if (slotCount == 0 || slotSize == 0)
+        return nullptr;
+
+    size_t count = 1;
+    while (count < slotCount)
+        count <<= 1;
+
+    // keep each slot aligned for float samples
+    slotSize = (slotSize + 15) & ~size_t(15);
+
+    // the header is over-aligned, operator new takes its alignment (C++17).
+    VVDAudioRingBuffer* rb = new(std::nothrow) VVDAudioRingBuffer{};
+    Slot* slots = (Slot*)VVDMalloc(sizeof(Slot) * count);
+    uint8_t* data = (uint8_t*)VVDMalloc(slotSize * count);
+    if (rb == nullptr || slots == nullptr || data == nullptr)
+    {
+        VVDLogE("VVDAudioRingBufferCreate: Out of memory! (%zu x %zu bytes)", count, slotSize);
+        delete rb;
+        VVDFree(slots);
+        VVDFree(data);
+        return nullptr;
+    }
+    memset(slots, 0, sizeof(Slot) * count);
+
+    rb->head.store(0, std::memory_order_relaxed);
+    rb->tail.store(0, std::memory_order_relaxed);
+    rb->mask = count - 1;
+    rb->slotSize = slotSize;
+    rb->slots = slots;
+    rb->data = data;
+    return rb;
+}
+
+extern "C" void VVDAudioRingBufferDestroy(VVDAudioRingBuffer* rb)
+{
+    if (rb)
+    {
+        VVDFree(rb->slots);
+        VVDFree(rb->data);
+        delete rb;
+    }
+}
+
+extern "C" size_t VVDAudioRingBufferSlotCount(VVDAudioRingBuffer* rb)
+{
+    return rb->mask + 1;
+}
+
+extern "C" size_t VVDAudioRingBufferSlotSize(VVDAudioRingBuffer* rb)
+{
+    return rb->slotSize;
+}
+
+extern "C" size_t VVDAudioRingBufferNumBlocks(VVDAudioRingBuffer* rb)
+{
+    size_t tail = rb->tail.load(std::memory_order_acquire);
+    size_t head = rb->head.load(std::memory_order_acquire);
+    return head - tail;
+}
+
+extern "C" void* VVDAudioRingBufferAcquire(VVDAudioRingBuffer* rb)
+{
+    size_t head = rb->head.load(std::memory_order_relaxed);
+    size_t tail = rb->tail.load(std::memory_order_acquire);
+    if (head - tail > rb->mask)
+        return nullptr;    // full
+    return rb->data + (head & rb->mask) * rb->slotSize;
+}
+
+extern "C" void VVDAudioRingBufferCommit(VVDAudioRingBuffer* rb, size_t byteCount, double timeStamp, uint32_t flags, uint32_t generation)
+{
+    size_t head = rb->head.load(std::memory_order_relaxed);
+    Slot& slot = rb->slots[head & rb->mask];
+    slot.byteCount = byteCount < rb->slotSize ? byteCount : rb->slotSize;
+    slot.timeStamp = timeStamp;
+    slot.flags = flags;
+    slot.generation = generation;
+    rb->head.store(head + 1, std::memory_order_release);
+}
+
+extern "C" bool VVDAudioRingBufferPeek(VVDAudioRingBuffer* rb, VVDAudioRingBufferBlock* block)
+{
+    size_t tail = rb->tail.load(std::memory_order_relaxed);
+    size_t head = rb->head.load(std::memory_order_acquire);
+    if (head == tail)
+        return false;  // empty
+
+    size_t index = tail & rb->mask;
+    const Slot& slot = rb->slots[index];
+    block->data = rb->data + index * rb->slotSize;
+    block->byteCount = slot.byteCount;
+    block->timeStamp = slot.timeStamp;
+    block->flags = slot.flags;
+    block->generation = slot.generation;
+    return true;
+}
+
+extern "C" void VVDAudioRingBufferRelease(VVDAudioRingBuffer* rb)
+{
+    size_t tail = rb->tail.load(std::memory_order_relaxed);
+    size_t head = rb->head.load(std::memory_order_acquire);
+    if (head != tail)
+        rb->tail.store(tail + 1, std::memory_order_release);
+}
+
+extern "C" void VVDAudioRingBufferReset(VVDAudioRingBuffer* rb)
+{
+    rb->head.store(0, std::memory_order_relaxed);
+    rb->tail.store(0, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+}
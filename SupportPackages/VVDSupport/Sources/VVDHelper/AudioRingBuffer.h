@@ -0,0 +1,69 @@
+/*******************************************************************************
+ File: AudioRingBuffer.h
+ Author: Hongtae Kim (tiff2766@gmail.com)
+
+ Copyright (c) 2004-2024 Hongtae Kim. All rights reserved.
+
+*******************************************************************************/
+
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif /* __cplusplus */
+
+/*
+ Lock-free single-producer / single-consumer ring of PCM blocks.
+ Each slot holds up to 'slotSize' bytes with its own time stamp, so a
+ decoder thread can fill blocks ahead while the submission thread takes
+ them without any lock. All functions except Create/Destroy/Reset are
+ wait-free. Acquire/Commit must be called from the producer thread only,
+ Peek/Release from the consumer thread only.
+*/
+typedef struct _VVDAudioRingBuffer VVDAudioRingBuffer;
+
+enum
+{
+    VVDAudioRingBufferFlag_EndOfStream = 1,   /* no more data after this block */
+    VVDAudioRingBufferFlag_Error = 2,         /* producer failed to read stream */
+};
+
+typedef struct _VVDAudioRingBufferBlock
+{
+    void* data;
+    size_t byteCount;
+    double timeStamp;
+    uint32_t flags;
+    uint32_t generation;
+} VVDAudioRingBufferBlock;
+
+/* slotCount is rounded up to power of two */
+VVDAudioRingBuffer* VVDAudioRingBufferCreate(size_t slotCount, size_t slotSize);
+void VVDAudioRingBufferDestroy(VVDAudioRingBuffer*);
+
+size_t VVDAudioRingBufferSlotCount(VVDAudioRingBuffer*);
+size_t VVDAudioRingBufferSlotSize(VVDAudioRingBuffer*);
+
+/* number of committed blocks not released yet, can be called from any thread */
+size_t VVDAudioRingBufferNumBlocks(VVDAudioRingBuffer*);
+
+/* producer: returns writable slot memory (slotSize bytes) or NULL if full */
+void* VVDAudioRingBufferAcquire(VVDAudioRingBuffer*);
+/* producer: publishes acquired slot */
+void VVDAudioRingBufferCommit(VVDAudioRingBuffer*, size_t byteCount, double timeStamp, uint32_t flags, uint32_t generation);
+
+/* consumer: gets oldest block without removing, returns false if empty */
+bool VVDAudioRingBufferPeek(VVDAudioRingBuffer*, VVDAudioRingBufferBlock*);
+/* consumer: removes oldest block */
+void VVDAudioRingBufferRelease(VVDAudioRingBuffer*);
+
+/* discards all blocks, both sides must be idle */
+void VVDAudioRingBufferReset(VVDAudioRingBuffer*);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
@@ -91,6 +91,8 @@ extern "C" VVDAudioStream* VVDAudioStreamCreate(VVDStream* stream)
 
 extern "C" void VVDAudioStreamDestroy(VVDAudioStream* stream)
 {
+    VVDAudioStreamReleaseSeekTable(stream);
+
     switch (stream->mediaType)
     {
     case VVDAudioStreamEncodingFormat_OggVorbis:
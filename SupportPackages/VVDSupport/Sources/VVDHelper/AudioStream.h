@@ -47,6 +47,28 @@ typedef uint64_t (*VVDAudioStreamRawTotalFn)(struct _VVDAudioStream*);
 typedef uint64_t (*VVDAudioStreamPcmTotalFn)(struct _VVDAudioStream*);
 typedef double (*VVDAudioStreamTimeTotalFn)(struct _VVDAudioStream*);
 
+typedef bool (*VVDAudioStreamBuildSeekTableFn)(struct _VVDAudioStream*, uint32_t);
+
+/* seek point: decoding from 'offset' (source stream byte offset) yields 'pcm' */
+typedef struct _VVDAudioSeekPoint
+{
+    uint64_t pcm;
+    uint64_t offset;
+} VVDAudioSeekPoint;
+
+/* seek points are placed every 'interval' pcm frames,
+   points[n] can be used to seek any pcm in [n*interval, (n+1)*interval) */
+typedef struct _VVDAudioSeekTable
+{
+    VVDAudioStreamEncodingFormat mediaType;
+    uint32_t sampleRate;
+    uint32_t channels;
+    uint32_t interval;
+    uint64_t pcmTotal;
+    uint64_t numPoints;
+    VVDAudioSeekPoint* points;
+} VVDAudioSeekTable;
+
 typedef struct _VVDAudioStream
 {
     void* userContext;
@@ -70,6 +92,9 @@ typedef struct _VVDAudioStream
     VVDAudioStreamPcmTotalFn pcmTotal;
     VVDAudioStreamTimeTotalFn timeTotal;
 
+    VVDAudioStreamBuildSeekTableFn buildSeekTable;  /* NULL if not supported */
+    VVDAudioSeekTable* seekTable;
+
     void* decoder;
 } VVDAudioStream;
 
@@ -87,6 +112,16 @@ typedef struct _VVDAudioStream
 VVDAudioStream* VVDAudioStreamCreate(VVDStream*);
 void VVDAudioStreamDestroy(VVDAudioStream*);
 
+#define VVDAUDIO_SEEK_TABLE_DEFAULT_INTERVAL 100 /* milliseconds */
+
+/* build seek table by scanning entire stream. (current position is preserved) */
+bool VVDAudioStreamBuildSeekTable(VVDAudioStream*, uint32_t intervalMs);
+/* returns number of bytes required, writes data only if the buffer is large enough. */
+size_t VVDAudioStreamSerializeSeekTable(VVDAudioStream*, void*, size_t);
+/* restore seek table previously serialized from the same source. */
+bool VVDAudioStreamDeserializeSeekTable(VVDAudioStream*, const void*, size_t);
+void VVDAudioStreamReleaseSeekTable(VVDAudioStream*);
+
 #ifdef __cplusplus
 }
 #endif /* __cplusplus */
@@ -12,6 +12,7 @@
 #include "../libFLAC/include/FLAC/stream_decoder.h"
 
 #include "AudioStream.h"
+#include "AudioStreamSeekTable.h"
 #include "Malloc.h"
 #include "Log.h"
 
@@ -22,7 +23,8 @@ namespace {
         VVDStream* stream;
 
         FLAC__uint64 totalSamples;
-        FLAC__uint64 sampleNumber;
+        FLAC__uint64 sampleNumber;  // end of the last decoded frame
+        FLAC__uint64 firstFrameOffset;
         unsigned int sampleRate;
         unsigned int channels;
         unsigned int bps;
@@ -116,7 +118,7 @@ namespace {
             size_t blockSize = frame->header.blocksize;
             size_t buffSize = ctxt->buffer.size();
 
-            ctxt->sampleNumber = frame->header.number.sample_number;
+            ctxt->sampleNumber = frame->header.number.sample_number + blockSize;
             ctxt->buffer.reserve(buffSize + (blockSize * frame->header.channels));
             for (unsigned int i = 0; i < frame->header.blocksize; ++i)
             {
@@ -164,6 +166,10 @@ namespace {
 
         if (FLAC__stream_decoder_process_until_end_of_metadata(context->decoder))
         {
+            // not available for Ogg-FLAC.
+            if (!FLAC__stream_decoder_get_decode_position(context->decoder, &context->firstFrameOffset))
+                context->firstFrameOffset = 0;
+
             if ((context->bps == 8 || context->bps == 16 || context->bps == 24) &&
                 (context->totalSamples > 0 && context->sampleRate > 0 && context->channels > 0))
             {
@@ -197,6 +203,67 @@ namespace {
         }
         return false;
     }
+
+    // Seek using seek table: jump to the frame offset directly,
+    // then decode and discard samples before the target.
+    bool FLAC_SeekWithTable(VVDAudioStream* stream, FLAC_Context* context, FLAC__uint64 pos)
+    {
+        const VVDAudioSeekPoint* point = VVDAudioSeekTableLookup(stream->seekTable, pos);
+        if (point == nullptr || point->pcm > pos || context->firstFrameOffset == 0)
+            return false;
+
+        if (!FLAC__stream_decoder_flush(context->decoder))
+            return false;
+        if (VVDSTREAM_SET_POSITION(context->stream, point->offset) != point->offset)
+            return false;
+
+        context->buffer.clear();
+        context->sampleNumber = point->pcm;
+        while (true)
+        {
+            if (!FLAC__stream_decoder_process_single(context->decoder))
+            {
+                FLAC__StreamDecoderState st = FLAC__stream_decoder_get_state(context->decoder);
+                VVDLogE("FLAC__stream_decoder_process_single failed. (state:%s)\n", FLAC__StreamDecoderStateString[st]);
+                context->buffer.clear();
+                return false;
+            }
+            if (context->sampleNumber > pos)
+                break;
+            context->buffer.clear();
+
+            FLAC__StreamDecoderState st = FLAC__stream_decoder_get_state(context->decoder);
+            if (st == FLAC__STREAM_DECODER_END_OF_STREAM || st == FLAC__STREAM_DECODER_ABORTED)
+                return true;
+        }
+
+        FLAC__uint64 buffered = context->buffer.size() / context->channels;
+        FLAC__uint64 frameStart = context->sampleNumber - buffered;
+        if (pos > frameStart)
+        {
+            size_t skip = (pos - frameStart) * context->channels;
+            context->buffer.erase(context->buffer.begin(), context->buffer.begin() + skip);
+        }
+        return true;
+    }
+
+    bool FLAC_Seek(VVDAudioStream* stream, FLAC_Context* context, FLAC__uint64 pos)
+    {
+        if (FLAC_SeekWithTable(stream, context, pos))
+            return true;
+
+        context->buffer.clear();
+        if (FLAC__stream_decoder_seek_absolute(context->decoder, pos))
+        {
+            FLAC__stream_decoder_process_single(context->decoder);
+            return true;
+        }
+        FLAC__StreamDecoderState st = FLAC__stream_decoder_get_state(context->decoder);
+        VVDLogE("FLAC__stream_decoder_seek_absolute failed:%s\n", FLAC__StreamDecoderStateString[st]);
+        if (st == FLAC__STREAM_DECODER_SEEK_ERROR)
+            FLAC__stream_decoder_flush(context->decoder);
+        return false;
+    }
 }
 
 uint64_t VVDAudioStreamFLACRead(VVDAudioStream* stream, void* buffer, size_t size)
@@ -284,18 +351,8 @@ uint64_t VVDAudioStreamFLACSeekRaw(VVDAudioStream* stream, uint64_t pos)
     {
         pos = (pos / context->channels) / (context->bps / 8);   // raw to pcm(sample)
         pos = std::clamp<uint64_t>(pos, 0, context->totalSamples);
-        if (FLAC__stream_decoder_seek_absolute(context->decoder, pos))
-        {
-            FLAC__stream_decoder_process_single(context->decoder);
+        if (FLAC_Seek(stream, context, pos))
             return pos * context->channels * (context->bps / 8);
-        }
-        else
-        {
-            FLAC__StreamDecoderState st = FLAC__stream_decoder_get_state(context->decoder);
-            VVDLog("FLAC__stream_decoder_process_until_end_of_metadata failed:%s\n", FLAC__StreamDecoderStateString[st]);
-            if (st == FLAC__STREAM_DECODER_SEEK_ERROR)
-                FLAC__stream_decoder_flush(context->decoder);
-        }
     }
     return 0;
 }
@@ -306,18 +363,8 @@ uint64_t VVDAudioStreamFLACSeekPcm(VVDAudioStream* stream, uint64_t pos)
     if (context->decoder)
     {
         pos = std::clamp<uint64_t>(pos, 0, context->totalSamples);
-        if (FLAC__stream_decoder_seek_absolute(context->decoder, pos))
-        {
-            FLAC__stream_decoder_process_single(context->decoder);
+        if (FLAC_Seek(stream, context, pos))
             return pos;
-        }
-        else
-        {
-            FLAC__StreamDecoderState st = FLAC__stream_decoder_get_state(context->decoder);
-            VVDLog("FLAC__stream_decoder_process_until_end_of_metadata failed:%s\n", FLAC__StreamDecoderStateString[st]);
-            if (st == FLAC__STREAM_DECODER_SEEK_ERROR)
-                FLAC__stream_decoder_flush(context->decoder);
-        }
     }
     return 0;
 }
@@ -329,18 +376,8 @@ double VVDAudioStreamFLACSeekTime(VVDAudioStream* stream, double t)
     {
         FLAC__uint64 pos = t * context->sampleRate;
         pos = std::clamp<uint64_t>(pos, 0, context->totalSamples);
-        if (FLAC__stream_decoder_seek_absolute(context->decoder, pos))
-        {
-            FLAC__stream_decoder_process_single(context->decoder);
+        if (FLAC_Seek(stream, context, pos))
             return static_cast<double>(pos) / context->sampleRate;
-        }
-        else
-        {
-            FLAC__StreamDecoderState st = FLAC__stream_decoder_get_state(context->decoder);
-            VVDLogE("FLAC__stream_decoder_process_until_end_of_metadata failed:%s\n", FLAC__StreamDecoderStateString[st]);
-            if (st == FLAC__STREAM_DECODER_SEEK_ERROR)
-                FLAC__stream_decoder_flush(context->decoder);
-        }
     }
     return 0;
 }
@@ -417,6 +454,67 @@ double VVDAudioStreamFLACTimeTotal(VVDAudioStream* stream)
     return 0;
 }
 
+bool VVDAudioStreamFLACBuildSeekTable(VVDAudioStream* stream, uint32_t intervalMs)
+{
+    FLAC_Context* context = reinterpret_cast<FLAC_Context*>(stream->decoder);
+    // frame offsets are not available for Ogg-FLAC.
+    if (context->decoder == nullptr || context->firstFrameOffset == 0 || context->totalSamples == 0)
+        return false;
+
+    FLAC__uint64 position = VVDAudioStreamFLACPcmPosition(stream);
+
+    if (!FLAC__stream_decoder_flush(context->decoder))
+        return false;
+    if (VVDSTREAM_SET_POSITION(context->stream, context->firstFrameOffset) != context->firstFrameOffset)
+        return false;
+    context->buffer.clear();
+
+    uint32_t interval = VVDAudioSeekTableInterval(stream, intervalMs);
+    uint64_t numPoints = VVDAudioSeekTableNumPoints(context->totalSamples, interval);
+    VVDAudioSeekTable* table = VVDAudioSeekTableCreate(stream, interval, numPoints);
+
+    // skip frames without decoding, only frame headers are needed.
+    uint64_t index = 0;
+    FLAC__uint64 frameStart = 0;
+    while (index < numPoints)
+    {
+        FLAC__uint64 offset = 0;
+        if (!FLAC__stream_decoder_get_decode_position(context->decoder, &offset))
+            break;
+        if (!FLAC__stream_decoder_skip_single_frame(context->decoder))
+            break;
+        FLAC__StreamDecoderState st = FLAC__stream_decoder_get_state(context->decoder);
+        if (st == FLAC__STREAM_DECODER_END_OF_STREAM || st == FLAC__STREAM_DECODER_ABORTED)
+            break;
+
+        FLAC__uint64 frameEnd = frameStart + FLAC__stream_decoder_get_blocksize(context->decoder);
+        for (; index < numPoints && index * interval < frameEnd; ++index)
+        {
+            table->points[index].pcm = frameStart;
+            table->points[index].offset = offset;
+        }
+        frameStart = frameEnd;
+    }
+
+    if (index == 0)
+    {
+        VVDLogE("FLAC: Failed to build seek table.\n");
+        VVDAudioSeekTableDestroy(table);
+        FLAC__stream_decoder_seek_absolute(context->decoder, position);
+        return false;
+    }
+    // stream is shorter than STREAMINFO reported.
+    for (; index < numPoints; ++index)
+        table->points[index] = table->points[index - 1];
+
+    VVDAudioStreamReleaseSeekTable(stream);
+    stream->seekTable = table;
+
+    // restore position
+    FLAC_Seek(stream, context, position);
+    return true;
+}
+
 VVDAudioStream* VVDAudioStreamFLACCreate(VVDStream* stream)
 {
     if (stream && VVDSTREAM_IS_READABLE(stream))
@@ -458,6 +556,7 @@ VVDAudioStream* VVDAudioStreamFLACCreate(VVDStream* stream)
                 audioStream->rawTotal = VVDAudioStreamFLACRawTotal;
                 audioStream->pcmTotal = VVDAudioStreamFLACPcmTotal;
                 audioStream->timeTotal = VVDAudioStreamFLACTimeTotal;
+                audioStream->buildSeekTable = VVDAudioStreamFLACBuildSeekTable;
                 return audioStream;
             }
             FLAC__stream_decoder_finish(context->decoder);
@@ -516,6 +615,7 @@ VVDAudioStream* VVDAudioStreamOggFLACCreate(VVDStream* stream)
                 audioStream->rawTotal = VVDAudioStreamFLACRawTotal;
                 audioStream->pcmTotal = VVDAudioStreamFLACPcmTotal;
                 audioStream->timeTotal = VVDAudioStreamFLACTimeTotal;
+                audioStream->buildSeekTable = VVDAudioStreamFLACBuildSeekTable;
                 return audioStream;
             }
             FLAC__stream_decoder_finish(context->decoder);
@@ -7,10 +7,12 @@
 *******************************************************************************/
 
 #include <vector>
+#include <algorithm>
 #define MINIMP3_IMPLEMENTATION
 #include "../minimp3/minimp3_ex.h"
 
 #include "AudioStream.h"
+#include "AudioStreamSeekTable.h"
 #include "Malloc.h"
 #include "Log.h"
 
@@ -22,6 +24,58 @@ namespace {
         mp3dec_io_t io;
         std::vector<uint8_t> buffer;
     };
+
+    // mp3dec_ex_t counts samples of all channels,
+    // position of VVDAudioStream is in pcm frames.
+
+    // Seek using seek table, without frame index of minimp3.
+    // (minimp3 scans entire stream to build index for VBR-tagged stream)
+    bool MP3_SeekWithTable(VVDAudioStream* stream, MP3Context* context, uint64_t pos)
+    {
+        const VVDAudioSeekPoint* point = VVDAudioSeekTableLookup(stream->seekTable, pos);
+        if (point == nullptr)
+            return false;
+
+        mp3dec_ex_t& dec = context->dec;
+        uint64_t channels = dec.info.channels;
+        uint64_t position = pos * channels + dec.start_delay;
+        uint64_t start = point->pcm * channels;
+        if (start > position)
+            return false;
+
+        if (dec.io && dec.io->seek(point->offset, dec.io->seek_data))
+            return false;
+
+        dec.cur_sample = pos * channels;
+        dec.offset = point->offset;
+        dec.to_skip = int(position - start);
+        dec.buffer_samples = 0;
+        dec.buffer_consumed = 0;
+        dec.input_consumed = 0;
+        dec.input_filled = 0;
+        dec.last_error = 0;
+        mp3dec_init(&dec.mp3d);
+        return true;
+    }
+
+    bool MP3_Seek(VVDAudioStream* stream, MP3Context* context, uint64_t pos)
+    {
+        if (MP3_SeekWithTable(stream, context, pos))
+            return true;
+
+        int result = mp3dec_ex_seek(&context->dec, pos * context->dec.info.channels);
+        if (result)
+        {
+            VVDLogE("AudioStreamMP3: Seek error! (%x)\n", result);
+            return false;
+        }
+        return true;
+    }
+
+    uint64_t MP3_PcmTotal(MP3Context* context)
+    {
+        return context->dec.samples / context->dec.info.channels;
+    }
 }
 
 uint64_t VVDAudioStreamMP3Read(VVDAudioStream* stream, void* buffer, size_t size)
@@ -46,48 +100,33 @@ uint64_t VVDAudioStreamMP3Read(VVDAudioStream* stream, void* buffer, size_t size
 uint64_t VVDAudioStreamMP3SeekRaw(VVDAudioStream* stream, uint64_t pos)
 {
     MP3Context* context = reinterpret_cast<MP3Context*>(stream->decoder);
-    pos = pos / sizeof(mp3d_sample_t);
-    if (pos > context->dec.samples)
-        pos = context->dec.samples;
+    pos = pos / (sizeof(mp3d_sample_t) * context->dec.info.channels);
+    pos = std::min(pos, MP3_PcmTotal(context));
 
-    int result = mp3dec_ex_seek(&context->dec, pos);
-    if (result)
-    {
-        VVDLogE("AudioStreamMP3: Seek error! (%x)\n", result);
+    if (!MP3_Seek(stream, context, pos))
         return VVDSTREAM_ERROR;
-    }
-    return (context->dec.offset - context->dec.start_offset);
+    return context->dec.cur_sample * sizeof(mp3d_sample_t);
 }
 
 uint64_t VVDAudioStreamMP3SeekPcm(VVDAudioStream* stream, uint64_t pos)
 {
     MP3Context* context = reinterpret_cast<MP3Context*>(stream->decoder);
-    if (pos > context->dec.samples)
-        pos = context->dec.samples;
+    pos = std::min(pos, MP3_PcmTotal(context));
 
-    int result = mp3dec_ex_seek(&context->dec, pos);
-    if (result)
-    {
-        VVDLogE("AudioStreamMP3: Seek error! (%x)\n", result);
+    if (!MP3_Seek(stream, context, pos))
         return VVDSTREAM_ERROR;
-    }
-    return (context->dec.offset - context->dec.start_offset) / sizeof(mp3d_sample_t);
+    return pos;
 }
 
 double VVDAudioStreamMP3SeekTime(VVDAudioStream* stream, double t)
 {
     MP3Context* context = reinterpret_cast<MP3Context*>(stream->decoder);
-    uint64_t pos = uint64_t(double(context->dec.info.hz) * t);
-    if (pos > context->dec.samples)
-        pos = context->dec.samples;
+    uint64_t pos = uint64_t(double(context->dec.info.hz) * std::max(t, 0.0));
+    pos = std::min(pos, MP3_PcmTotal(context));
 
-    int result = mp3dec_ex_seek(&context->dec, pos);
-    if (result)
-    {
-        VVDLogE("AudioStreamMP3: Seek error! (%x)\n", result);
+    if (!MP3_Seek(stream, context, pos))
         return -1.0;
-    }
-    return t;
+    return double(pos) / double(context->dec.info.hz);
 }
 
 uint64_t VVDAudioStreamMP3RawPosition(VVDAudioStream* stream)
@@ -99,14 +138,14 @@ uint64_t VVDAudioStreamMP3RawPosition(VVDAudioStream* stream)
 uint64_t VVDAudioStreamMP3PcmPosition(VVDAudioStream* stream)
 {
     MP3Context* context = reinterpret_cast<MP3Context*>(stream->decoder);
-    return context->dec.cur_sample;
+    return context->dec.cur_sample / context->dec.info.channels;
 }
 
 double VVDAudioStreamMP3TimePosition(VVDAudioStream* stream)
 {
     MP3Context* context = reinterpret_cast<MP3Context*>(stream->decoder);
     double freq = double(context->dec.info.hz);
-    double t = double(context->dec.cur_sample) / freq;
+    double t = double(context->dec.cur_sample / context->dec.info.channels) / freq;
     return t;
 }
 
@@ -119,17 +158,96 @@ uint64_t VVDAudioStreamMP3RawTotal(VVDAudioStream* stream)
 uint64_t VVDAudioStreamMP3PcmTotal(VVDAudioStream* stream)
 {
     MP3Context* context = reinterpret_cast<MP3Context*>(stream->decoder);
-    return context->dec.samples;
+    return MP3_PcmTotal(context);
 }
 
 double VVDAudioStreamMP3TimeTotal(VVDAudioStream* stream)
 {
     MP3Context* context = reinterpret_cast<MP3Context*>(stream->decoder);
     double freq = double(context->dec.info.hz);
-    double t = double(context->dec.samples) / freq;
+    double t = double(MP3_PcmTotal(context)) / freq;
     return t;
 }
 
+bool VVDAudioStreamMP3BuildSeekTable(VVDAudioStream* stream, uint32_t intervalMs)
+{
+    MP3Context* context = reinterpret_cast<MP3Context*>(stream->decoder);
+    mp3dec_ex_t& dec = context->dec;
+    uint64_t channels = dec.info.channels;
+    uint64_t position = dec.cur_sample / channels;
+
+    if (!dec.indexes_built)
+    {
+        // seeking non-zero position makes minimp3 build frame index.
+        // the total length from VBR tag must be kept, the table should
+        // match the total of streams opened without scanning.
+        uint64_t samples = dec.samples;
+        uint64_t detectedSamples = dec.detected_samples;
+        int result = mp3dec_ex_seek(&dec, channels);
+        dec.samples = samples;
+        dec.detected_samples = detectedSamples;
+        if (result)
+        {
+            VVDLogE("AudioStreamMP3: Failed to build frame index! (%x)\n", result);
+            return false;
+        }
+    }
+    if (dec.index.num_frames == 0)
+    {
+        MP3_Seek(stream, context, position);
+        return false;
+    }
+
+    const mp3dec_frame_t* frames = dec.index.frames;
+    size_t numFrames = dec.index.num_frames;
+
+    uint32_t interval = VVDAudioSeekTableInterval(stream, intervalMs);
+    uint64_t numPoints = VVDAudioSeekTableNumPoints(MP3_PcmTotal(context), interval);
+    VVDAudioSeekTable* table = VVDAudioSeekTableCreate(stream, interval, numPoints);
+
+    size_t frame = 0;
+    for (uint64_t index = 0; index < numPoints; ++index)
+    {
+        uint64_t target = index * interval * channels + dec.start_delay;
+        while (frame + 1 < numFrames && frames[frame + 1].sample <= target)
+            ++frame;
+
+        // start decoding a few frames earlier, to fill synthesis state and bit-reservoir.
+        size_t i = frame - std::min(frame, size_t(MINIMP3_PREDECODE_FRAMES));
+        if (dec.info.layer == 3)
+        {
+            // layer-3 main data can begin up to 511 bytes before the frame.
+            uint64_t reservoir = 0;
+            while (i > 0 && reservoir < 511)
+            {
+                uint64_t frameBytes = frames[i].offset - frames[i - 1].offset;
+                reservoir += frameBytes > HDR_SIZE + 32 ? frameBytes - (HDR_SIZE + 32) : 0;
+                --i;
+            }
+        }
+
+        VVDAudioSeekPoint& point = table->points[index];
+        if (frames[i].sample == 0)
+        {
+            // leading frames may not be decodable, decode from the beginning.
+            point.pcm = 0;
+            point.offset = dec.start_offset;
+        }
+        else
+        {
+            point.pcm = frames[i].sample / channels;
+            point.offset = frames[i].offset;
+        }
+    }
+
+    VVDAudioStreamReleaseSeekTable(stream);
+    stream->seekTable = table;
+
+    // restore position
+    MP3_Seek(stream, context, position);
+    return true;
+}
+
 VVDAudioStream* VVDAudioStreamMP3Create(VVDStream* stream)
 {
     if (stream && VVDSTREAM_IS_READABLE(stream))
@@ -200,6 +318,7 @@ VVDAudioStream* VVDAudioStreamMP3Create(VVDStream* stream)
             audioStream->rawTotal = VVDAudioStreamMP3RawTotal;
             audioStream->pcmTotal = VVDAudioStreamMP3PcmTotal;
             audioStream->timeTotal = VVDAudioStreamMP3TimeTotal;
+            audioStream->buildSeekTable = VVDAudioStreamMP3BuildSeekTable;
 
             return audioStream; 
         }
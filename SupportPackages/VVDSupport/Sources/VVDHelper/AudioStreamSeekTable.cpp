@@ -0,0 +1,217 @@
+/*******************************************************************************
+ File: AudioStreamSeekTable.cpp
+ Author: Hongtae Kim (tiff2766@gmail.com)
+
+ Copyright (c) 2004-2024 Hongtae Kim. All rights reserved.
+ 
+*******************************************************************************/
+
+#include <memory.h>
+#include <string.h>
+#include "AudioStreamSeekTable.h"
+#include "Endianness.h"
+#include "Malloc.h"
+#include "Log.h"
+
+namespace {
+    constexpr char seekTableMagic[4] = { 'V', 'A', 'S', 'T' };
+    constexpr uint32_t seekTableVersion = 1;
+
+#pragma pack(push, 4)
+    struct SeekTableHeader
+    {
+        char     magic[4];
+        uint32_t version;
+        uint32_t mediaType;
+        uint32_t sampleRate;
+        uint32_t channels;
+        uint32_t interval;
+        uint64_t pcmTotal;
+        uint64_t numPoints;
+    };
+#pragma pack(pop)
+
+    // returns number of bytes, p can be null to calculate length only.
+    size_t WriteVarUInt(uint64_t value, uint8_t* p)
+    {
+        size_t length = 0;
+        do
+        {
+            uint8_t byte = value & 0x7f;
+            value >>= 7;
+            if (value)
+                byte |= 0x80;
+            if (p)
+                p[length] = byte;
+            ++length;
+        } while (value);
+        return length;
+    }
+
+    // Points are stored as deltas from the previous point in LEB128 varint,
+    // both pcm and offset are monotonic, most deltas fit in 2~3 bytes.
+    size_t WriteSeekPoints(const VVDAudioSeekTable* table, uint8_t* p)
+    {
+        size_t length = 0;
+        uint64_t pcm = 0;
+        uint64_t offset = 0;
+        for (uint64_t i = 0; i < table->numPoints; ++i)
+        {
+            const VVDAudioSeekPoint& pt = table->points[i];
+            length += WriteVarUInt(pt.pcm - pcm, p ? p + length : nullptr);
+            length += WriteVarUInt(pt.offset - offset, p ? p + length : nullptr);
+            pcm = pt.pcm;
+            offset = pt.offset;
+        }
+        return length;
+    }
+
+    bool ReadVarUInt(const uint8_t*& p, const uint8_t* end, uint64_t& value)
+    {
+        value = 0;
+        for (int shift = 0; shift < 64 && p < end; shift += 7)
+        {
+            uint8_t byte = *p++;
+            value |= uint64_t(byte & 0x7f) << shift;
+            if ((byte & 0x80) == 0)
+                return true;
+        }
+        return false;
+    }
+}
+
+VVDAudioSeekTable* VVDAudioSeekTableCreate(VVDAudioStream* stream, uint32_t interval, uint64_t numPoints)
+{
+    VVDAudioSeekTable* table = (VVDAudioSeekTable*)VVDMalloc(sizeof(VVDAudioSeekTable));
+    memset(table, 0, sizeof(VVDAudioSeekTable));
+    table->mediaType = stream->mediaType;
+    table->sampleRate = stream->sampleRate;
+    table->channels = stream->channels;
+    table->interval = interval;
+    table->pcmTotal = VVDAUDIO_STREAM_PCM_TOTAL(stream);
+    table->numPoints = numPoints;
+    if (numPoints > 0)
+    {
+        table->points = (VVDAudioSeekPoint*)VVDMalloc(sizeof(VVDAudioSeekPoint) * numPoints);
+        memset(table->points, 0, sizeof(VVDAudioSeekPoint) * numPoints);
+    }
+    return table;
+}
+
+void VVDAudioSeekTableDestroy(VVDAudioSeekTable* table)
+{
+    if (table)
+    {
+        if (table->points)
+            VVDFree(table->points);
+        VVDFree(table);
+    }
+}
+
+extern "C" bool VVDAudioStreamBuildSeekTable(VVDAudioStream* stream, uint32_t intervalMs)
+{
+    if (stream && stream->seekable && stream->buildSeekTable)
+    {
+        if (intervalMs == 0)
+            intervalMs = VVDAUDIO_SEEK_TABLE_DEFAULT_INTERVAL;
+        return stream->buildSeekTable(stream, intervalMs);
+    }
+    return false;
+}
+
+extern "C" void VVDAudioStreamReleaseSeekTable(VVDAudioStream* stream)
+{
+    if (stream && stream->seekTable)
+    {
+        VVDAudioSeekTableDestroy(stream->seekTable);
+        stream->seekTable = nullptr;
+    }
+}
+
+extern "C" size_t VVDAudioStreamSerializeSeekTable(VVDAudioStream* stream, void* buffer, size_t size)
+{
+    const VVDAudioSeekTable* table = stream ? stream->seekTable : nullptr;
+    if (table == nullptr)
+        return 0;
+
+    // nothing is written unless the buffer can hold the entire table.
+    size_t length = sizeof(SeekTableHeader) + WriteSeekPoints(table, nullptr);
+    if (buffer == nullptr || size < length)
+        return length;
+
+    SeekTableHeader header = {};
+    memcpy(header.magic, seekTableMagic, sizeof(seekTableMagic));
+    header.version = VVDSystemToLittleEndian(seekTableVersion);
+    header.mediaType = VVDSystemToLittleEndian(uint32_t(table->mediaType));
+    header.sampleRate = VVDSystemToLittleEndian(table->sampleRate);
+    header.channels = VVDSystemToLittleEndian(table->channels);
+    header.interval = VVDSystemToLittleEndian(table->interval);
+    header.pcmTotal = VVDSystemToLittleEndian(table->pcmTotal);
+    header.numPoints = VVDSystemToLittleEndian(table->numPoints);
+
+    uint8_t* p = reinterpret_cast<uint8_t*>(buffer);
+    memcpy(p, &header, sizeof(SeekTableHeader));
+    WriteSeekPoints(table, p + sizeof(SeekTableHeader));
+    return length;
+}
+
+extern "C" bool VVDAudioStreamDeserializeSeekTable(VVDAudioStream* stream, const void* data, size_t size)
+{
+    if (stream == nullptr || stream->buildSeekTable == nullptr ||
+        data == nullptr || size < sizeof(SeekTableHeader))
+        return false;
+
+    SeekTableHeader header;
+    memcpy(&header, data, sizeof(SeekTableHeader));
+    if (memcmp(header.magic, seekTableMagic, sizeof(seekTableMagic)) != 0 ||
+        VVDLittleEndianToSystem(header.version) != seekTableVersion)
+        return false;
+
+    uint32_t mediaType = VVDLittleEndianToSystem(header.mediaType);
+    uint32_t sampleRate = VVDLittleEndianToSystem(header.sampleRate);
+    uint32_t channels = VVDLittleEndianToSystem(header.channels);
+    uint32_t interval = VVDLittleEndianToSystem(header.interval);
+    uint64_t pcmTotal = VVDLittleEndianToSystem(header.pcmTotal);
+    uint64_t numPoints = VVDLittleEndianToSystem(header.numPoints);
+
+    // seek table must be created from the same source.
+    if (mediaType != uint32_t(stream->mediaType) ||
+        sampleRate != stream->sampleRate ||
+        channels != stream->channels ||
+        pcmTotal != VVDAUDIO_STREAM_PCM_TOTAL(stream) ||
+        interval == 0 ||
+        numPoints != VVDAudioSeekTableNumPoints(pcmTotal, interval))
+    {
+        VVDLogW("AudioStream: Seek table does not match with stream.\n");
+        return false;
+    }
+
+    // each point takes at least 2 bytes.
+    if ((size - sizeof(SeekTableHeader)) / 2 < numPoints)
+        return false;
+
+    VVDAudioSeekTable* table = VVDAudioSeekTableCreate(stream, interval, numPoints);
+
+    const uint8_t* p = reinterpret_cast<const uint8_t*>(data) + sizeof(SeekTableHeader);
+    const uint8_t* end = reinterpret_cast<const uint8_t*>(data) + size;
+    uint64_t pcm = 0;
+    uint64_t offset = 0;
+    for (uint64_t i = 0; i < numPoints; ++i)
+    {
+        uint64_t pcmDelta, offsetDelta;
+        if (!ReadVarUInt(p, end, pcmDelta) || !ReadVarUInt(p, end, offsetDelta))
+        {
+            VVDLogE("AudioStream: Seek table data corrupted.\n");
+            VVDAudioSeekTableDestroy(table);
+            return false;
+        }
+        pcm += pcmDelta;
+        offset += offsetDelta;
+        table->points[i].pcm = pcm;
+        table->points[i].offset = offset;
+    }
+
+    VVDAudioStreamReleaseSeekTable(stream);
+    stream->seekTable = table;
+    return true;
+}
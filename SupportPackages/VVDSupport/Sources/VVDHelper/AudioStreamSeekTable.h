@@ -0,0 +1,39 @@
+/*******************************************************************************
+ File: AudioStreamSeekTable.h
+ Author: Hongtae Kim (tiff2766@gmail.com)
+
+ Copyright (c) 2004-2024 Hongtae Kim. All rights reserved.
+ 
+*******************************************************************************/
+
+#pragma once
+#include "AudioStream.h"
+
+#ifdef __cplusplus
+VVDAudioSeekTable* VVDAudioSeekTableCreate(VVDAudioStream*, uint32_t interval, uint64_t numPoints);
+void VVDAudioSeekTableDestroy(VVDAudioSeekTable*);
+
+inline uint32_t VVDAudioSeekTableInterval(VVDAudioStream* stream, uint32_t intervalMs)
+{
+    uint64_t interval = (uint64_t(stream->sampleRate) * intervalMs) / 1000;
+    return interval > 0 ? uint32_t(interval) : 1;
+}
+
+inline uint64_t VVDAudioSeekTableNumPoints(uint64_t pcmTotal, uint32_t interval)
+{
+    return pcmTotal / interval + 1;
+}
+
+/// O(1) lookup, returns nullptr if table is not available.
+inline const VVDAudioSeekPoint* VVDAudioSeekTableLookup(const VVDAudioSeekTable* table, uint64_t pcm)
+{
+    if (table && table->numPoints > 0)
+    {
+        uint64_t index = pcm / table->interval;
+        if (index >= table->numPoints)
+            index = table->numPoints - 1;
+        return &table->points[index];
+    }
+    return nullptr;
+}
+#endif /* __cplusplus */
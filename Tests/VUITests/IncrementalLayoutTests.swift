@@ -0,0 +1,163 @@
+import XCTest
+import Foundation
+import VVD
+@testable import VUI
+
+// Lays out view hierarchies without a window or a graphics device,
+// the same way as WindowContext does in headless mode.
+final class IncrementalLayoutTests: XCTestCase {
+    final class HeadlessApp: AppContext {
+        var graphicsDeviceContext: GraphicsDeviceContext? { nil }
+        var audioDeviceContext: AudioDeviceContext? { nil }
+        func resourceData(forURL: URL) -> (any DataProtocol)? { nil }
+        func setResource(data: (any DataProtocol)?, forURL: URL) {}
+        func checkWindowActivities() {}
+        var isActive: Bool { true }
+    }
+
+    struct Rows: View {
+        let count: Int
+        var body: some View {
+            VStack(spacing: 0) {
+                ForEach(0..<count) { _ in
+                    Color.gray.frame(width: 200, height: 20)
+                }
+            }
+        }
+    }
+
+    struct RowsSceneRoot: SceneRoot {
+        let root: Rows
+        let graph: _GraphValue<Rows>
+        let app: AppContext
+    }
+
+    final class Harness {
+        let app = HeadlessApp()
+        let scene: SceneContext
+        let sharedContext: SharedContext
+        let view: ViewContext
+        var bounds = CGRect(x: 0, y: 0, width: 400, height: 300)
+
+        init(rows: Int) {
+            let content = Rows(count: rows)
+            let graph = _GraphValue<Rows>.root()
+            self.scene = SceneContext(inputs: _SceneInputs(
+                root: RowsSceneRoot(root: content, graph: graph, app: app),
+                environment: EnvironmentValues()))
+            self.sharedContext = SharedContext(scene: scene)
+
+            var properties = PropertyList()
+            properties.setValue(VStackLayout(), forKey: DefaultLayoutProperty.self)
+            properties.setValue(EdgeInsets(_all: 16), forKey: DefaultPaddingEdgeInsetsProperty.self)
+            let baseInputs = _GraphInputs(sharedContext: sharedContext,
+                                          properties: properties,
+                                          environment: scene.environment,
+                                          modifiers: [],
+                                          _modifierTypeGraphs: [:])
+            let outputs = Rows._makeView(view: graph, inputs: _ViewInputs.inputs(with: baseInputs))
+            self.view = outputs.view!.makeView()
+
+            sharedContext.root = TypedViewRoot(root: content, graph: graph, scene: scene)
+            sharedContext.contentBounds = bounds
+            view.updateContent()
+            view.setNeedsLayout()
+        }
+
+        // returns the views laid out.
+        @discardableResult
+        func layout() -> UInt64 {
+            let layouts = sharedContext.layoutStatistics.layouts
+            while sharedContext.needsLayout {
+                let isInitialLayout = view.frame == .zero
+                sharedContext.needsLayout = isInitialLayout
+                view.place(at: CGPoint(x: bounds.midX, y: bounds.midY),
+                           anchor: .center,
+                           proposal: ProposedViewSize(bounds.size))
+                view.updateTransformIfNeeded(.identity)
+                sharedContext.layoutStatistics.passes += 1
+            }
+            return sharedContext.layoutStatistics.layouts - layouts
+        }
+
+        // views with their own size inside of the layout boundaries (rows).
+        func rowContents() -> [ViewContext] {
+            var contents: [ViewContext] = []
+            var views = [view]
+            while let view = views.popLast() {
+                let subviews = Self.subviews(of: view)
+                if subviews.isEmpty, view.superview?.isLayoutBoundary == true {
+                    contents.append(view)
+                }
+                views.append(contentsOf: subviews.reversed())
+            }
+            return contents
+        }
+
+        static func subviews(of view: ViewContext) -> [ViewContext] {
+            var subviews: [ViewContext] = []
+            var mirror: Mirror? = Mirror(reflecting: view)
+            while let m = mirror {
+                for child in m.children {
+                    if child.label == "body", let body = child.value as? ViewContext {
+                        subviews.append(body)
+                    } else if child.label == "activeSubviews", let views = child.value as? [ViewContext] {
+                        subviews.append(contentsOf: views)
+                    }
+                }
+                mirror = m.superclassMirror
+            }
+            return subviews
+        }
+    }
+
+    static func measure(_ body: () -> Void) -> Double {
+        let start = DispatchTime.now().uptimeNanoseconds
+        body()
+        return Double(DispatchTime.now().uptimeNanoseconds - start) * 0.000_000_001
+    }
+
+    func testRelayoutOfOneRowIn10kRows() {
+        let harness = Harness(rows: 10_000)
+        let initial = Self.measure { harness.layout() }
+
+        let rows = harness.rowContents()
+        XCTAssertEqual(rows.count, 10_000)
+        let row = rows[rows.count / 2]
+        let frame = row.frame
+        let transform = row.transformToRoot
+        let last = rows.last!.transformToRoot
+
+        var layouts: UInt64 = 0
+        let incremental = Self.measure {
+            row.setNeedsLayout()
+            layouts = harness.layout()
+        }
+        // only the row and the ancestors above its layout boundary.
+        XCTAssertGreaterThan(layouts, 0)
+        XCTAssertLessThan(layouts, 16)
+        XCTAssertEqual(row.frame, frame)
+        XCTAssertEqual(row.transformToRoot, transform)
+        XCTAssertEqual(rows.last!.transformToRoot, last)
+
+        harness.bounds = CGRect(x: 0, y: 0, width: 600, height: 300)
+        harness.sharedContext.contentBounds = harness.bounds
+        harness.view.setNeedsLayout()
+        let full = Self.measure { harness.layout() }
+        XCTAssertNotEqual(row.transformToRoot, transform)
+
+        print("Layout 10k rows: initial \(initial * 1000.0) ms, one row \(incremental * 1000.0) ms (\(layouts) views), full \(full * 1000.0) ms")
+    }
+
+    func testRowTransforms() {
+        let harness = Harness(rows: 100)
+        harness.layout()
+        let rows = harness.rowContents()
+        XCTAssertEqual(rows.count, 100)
+        for (index, row) in rows.enumerated() {
+            let origin = CGPoint.zero.applying(row.transformToRoot)
+            XCTAssertEqual(origin.y - CGPoint.zero.applying(rows[0].transformToRoot).y,
+                           CGFloat(index * 20), accuracy: 0.001)
+        }
+    }
+}
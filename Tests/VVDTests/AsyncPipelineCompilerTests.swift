@@ -0,0 +1,121 @@
+import XCTest
+import Foundation
+@testable import VVD
+
+final class AsyncPipelineCompilerTests: XCTestCase {
+    final class Counter: @unchecked Sendable {
+        private var values: [Int: Int] = [:]
+        private let lock = NSLock()
+        func increment(_ key: Int) { lock.withLock { values[key, default: 0] += 1 } }
+        func count(_ key: Int) -> Int { lock.withLock { values[key, default: 0] } }
+    }
+
+    func testDeduplication() {
+        let compiler = AsyncPipelineCompiler<Int, String>(maxConcurrentTasks: 4)
+        let counter = Counter()
+        let compile = { @Sendable (key: Int) -> () -> String? in
+            {
+                counter.increment(key)
+                Thread.sleep(forTimeInterval: 0.01)
+                return "state\(key)"
+            }
+        }
+
+        // the same keys requested from many threads.
+        DispatchQueue.concurrentPerform(iterations: 64) { i in
+            let key = i % 8
+            switch compiler.state(for: key, compile: compile(key)) {
+            case .ready(let state): XCTAssertEqual(state, "state\(key)")
+            case .pending: break
+            case .failed: XCTFail()
+            }
+        }
+        compiler.waitUntilIdle()
+        XCTAssertEqual(compiler.numPendingStates, 0)
+        XCTAssertEqual(compiler.numCompiledStates, 8)
+        for key in 0..<8 {
+            XCTAssertEqual(counter.count(key), 1)
+            guard case .ready(let state) = compiler.state(for: key, compile: compile(key)) else {
+                XCTFail("state not ready")
+                continue
+            }
+            XCTAssertEqual(state, "state\(key)")
+        }
+    }
+
+    func testWaitForPendingState() {
+        let compiler = AsyncPipelineCompiler<Int, String>(maxConcurrentTasks: 1)
+        let counter = Counter()
+        guard case .pending = compiler.state(for: 1, compile: {
+            counter.increment(1)
+            Thread.sleep(forTimeInterval: 0.05)
+            return "async"
+        }) else {
+            XCTFail("expected pending state")
+            return
+        }
+        // waits for the worker or compiles it here, never twice.
+        let state = compiler.waitForState(for: 1) {
+            counter.increment(1)
+            return "sync"
+        }
+        XCTAssertNotNil(state)
+        XCTAssertEqual(counter.count(1), 1)
+
+        XCTAssertEqual(compiler.waitForState(for: 2) { "sync" }, "sync")
+    }
+
+    func testCompletionHandler() {
+        let compiler = AsyncPipelineCompiler<Int, String>(maxConcurrentTasks: 1)
+        let counter = Counter()
+        let done = DispatchSemaphore(value: 0)
+        let compile = { @Sendable () -> String? in
+            Thread.sleep(forTimeInterval: 0.05)
+            return "state"
+        }
+        // both requests of a draw skipped twice are notified.
+        for _ in 0..<2 {
+            guard case .pending = compiler.state(for: 1, compile: compile, whenDone: {
+                counter.increment(1)
+                done.signal()
+            }) else {
+                XCTFail("expected pending state")
+                return
+            }
+        }
+        XCTAssertEqual(done.wait(timeout: .now() + 5.0), .success)
+        XCTAssertEqual(done.wait(timeout: .now() + 5.0), .success)
+        guard case .ready = compiler.state(for: 1, compile: compile, whenDone: {
+            counter.increment(1)
+        }) else {
+            XCTFail("expected ready state")
+            return
+        }
+        XCTAssertEqual(counter.count(1), 2)
+    }
+
+    func testFailure() {
+        let compiler = AsyncPipelineCompiler<Int, String>()
+        _ = compiler.state(for: 1) { nil }
+        compiler.waitUntilIdle()
+        guard case .failed = compiler.state(for: 1, compile: { "retry" }) else {
+            XCTFail("expected failed state")
+            return
+        }
+        XCTAssertNil(compiler.waitForState(for: 1) { "retry" })
+    }
+
+    func testFrameTimeHitches() {
+        var stats = FrameTimeStatistics(capacity: 60)
+        let interval = 1.0 / 60.0
+        for _ in 0..<60 {
+            XCTAssertFalse(stats.record(interval * Double.random(in: 0.95...1.05), targetInterval: interval))
+        }
+        XCTAssert(stats.record(0.1, targetInterval: interval))
+        XCTAssertFalse(stats.record(interval, targetInterval: interval))
+        XCTAssertEqual(stats.numHitches, 1)
+        XCTAssertEqual(stats.lastHitch, 0.1)
+        XCTAssertEqual(stats.median, interval, accuracy: interval * 0.06)
+        XCTAssertEqual(stats.percentile(1.0), 0.1)
+    }
+}
@@ -0,0 +1,81 @@
+import XCTest
+import Foundation
+@testable import VVD
+
+final class AudioOfflineRendererTests: XCTestCase {
+    // 16-bit mono PCM wave of a sine tone.
+    static func makeTone(frequency: Double, duration: Double, sampleRate: Int = 44100) -> Data {
+        let frames = Int(duration * Double(sampleRate))
+        var data = Data()
+        func append<T: FixedWidthInteger>(_ value: T) {
+            withUnsafeBytes(of: value.littleEndian) { data.append(contentsOf: $0) }
+        }
+        data.append(contentsOf: Array("RIFF".utf8))
+        append(UInt32(36 + frames * 2))
+        data.append(contentsOf: Array("WAVE".utf8))
+        data.append(contentsOf: Array("fmt ".utf8))
+        append(UInt32(16))
+        append(UInt16(1))
+        append(UInt16(1))
+        append(UInt32(sampleRate))
+        append(UInt32(sampleRate * 2))
+        append(UInt16(2))
+        append(UInt16(16))
+        data.append(contentsOf: Array("data".utf8))
+        append(UInt32(frames * 2))
+        for i in 0..<frames {
+            let t = Double(i) / Double(sampleRate)
+            append(Int16(sin(2.0 * .pi * frequency * t) * 16000.0))
+        }
+        return data
+    }
+
+    func renderTone(duration: Double) throws -> (pcm: Data, format: AudioRenderFormat) {
+        guard let context = makeOfflineAudioDeviceContext() else {
+            throw XCTSkip("Loopback audio device is not available.")
+        }
+        let stream = try XCTUnwrap(AudioStream(data: Self.makeTone(frequency: 440, duration: duration)))
+        let player = try XCTUnwrap(context.makePlayer(stream: stream))
+        let renderer = try XCTUnwrap(AudioOfflineRenderer(context: context))
+        player.play()
+        let pcm = renderer.renderUntilIdle(maxDuration: duration + 2.0)
+        return (pcm, renderer.format)
+    }
+
+    // the tone must be rendered without gaps and truncation.
+    func testToneSampleCount() throws {
+        let duration = 3.0
+        let (pcm, format) = try renderTone(duration: duration)
+        XCTAssertEqual(format.sampleType, .int16)
+        XCTAssertEqual(pcm.count % format.bytesPerFrame, 0)
+
+        let samples = pcm.withUnsafeBytes { Array($0.bindMemory(to: Int16.self)) }
+        let channels = format.channels
+        let frames = samples.count / channels
+        let toneFrames = Int(duration * Double(format.sampleRate))
+        XCTAssertGreaterThanOrEqual(frames, toneFrames)
+
+        let audible = (0..<frames).map { frame in
+            (0..<channels).contains { abs(Int(samples[frame * channels + $0])) > 64 }
+        }
+        let first = try XCTUnwrap(audible.firstIndex(of: true))
+        let last = try XCTUnwrap(audible.lastIndex(of: true))
+        XCTAssertLessThan(abs(last - first + 1 - toneFrames), 100)
+
+        // a 440 Hz sine has no silence longer than a half period.
+        var silence = 0
+        var longestSilence = 0
+        for frame in first...last {
+            silence = audible[frame] ? 0 : silence + 1
+            longestSilence = max(longestSilence, silence)
+        }
+        XCTAssertLessThan(longestSilence, format.sampleRate / 440)
+    }
+
+    func testDeterministic() throws {
+        let first = try renderTone(duration: 1.5)
+        let second = try renderTone(duration: 1.5)
+        XCTAssertEqual(first.pcm.count, second.pcm.count)
+        XCTAssertTrue(first.pcm == second.pcm)
+    }
+}
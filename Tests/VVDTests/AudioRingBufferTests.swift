@@ -0,0 +1,155 @@
+import XCTest
+import Synchronization
+@testable import VVD
+
+final class AudioRingBufferTests: XCTestCase {
+    func testOrderAndWrapAround() throws {
+        let rb = try XCTUnwrap(AudioRingBuffer(slotCount: 3, slotSize: 16))
+        XCTAssertEqual(rb.slotCount, 4)
+        XCTAssertNil(rb.peek())
+
+        for i in 0..<10 {
+            let p = try XCTUnwrap(rb.acquire())
+            p.storeBytes(of: Int32(i), as: Int32.self)
+            rb.commit(byteCount: 4, timeStamp: Double(i), generation: 1, endOfStream: i == 9)
+
+            let block = try XCTUnwrap(rb.peek())
+            XCTAssertEqual(block.data.load(as: Int32.self), Int32(i))
+            XCTAssertEqual(block.timeStamp, Double(i))
+            XCTAssertEqual(block.generation, 1)
+            XCTAssertEqual(block.endOfStream, i == 9)
+            rb.release()
+        }
+        for _ in 0..<4 {
+            XCTAssertNotNil(rb.acquire())
+            rb.commit(byteCount: 0, timeStamp: 0)
+        }
+        XCTAssertNil(rb.acquire())  // full
+        XCTAssertEqual(rb.count, 4)
+    }
+
+    // 64 decode-ahead producers, one submission thread.
+    // Compares the lock-free ring with a mutex-protected queue per player.
+    func testContention64Players() throws {
+        let numPlayers = 64
+        let blocksPerPlayer = 2000
+        let blockSize = 4096
+
+        final class LockedQueue: @unchecked Sendable {
+            let queue = Mutex<[Data]>([])
+        }
+
+        func run(produce: @escaping @Sendable (Int, Int) -> Bool,
+                 consume: (Int) -> Int?) -> Double {
+            let start = DispatchTime.now().uptimeNanoseconds
+            let threads = (0..<numPlayers).map { player in
+                Thread {
+                    var i = 0
+                    while i < blocksPerPlayer {
+                        if produce(player, i) { i += 1 } else { sched_yield() }
+                    }
+                }
+            }
+            threads.forEach { $0.start() }
+
+            var next = [Int](repeating: 0, count: numPlayers)
+            var remaining = numPlayers * blocksPerPlayer
+            while remaining > 0 {
+                for player in 0..<numPlayers {
+                    while let value = consume(player) {
+                        XCTAssertEqual(value, next[player])
+                        next[player] += 1
+                        remaining -= 1
+                    }
+                }
+            }
+            return Double(DispatchTime.now().uptimeNanoseconds - start) * 0.000_000_001
+        }
+
+        let rings = (0..<numPlayers).map { _ in AudioRingBuffer(slotCount: 4, slotSize: blockSize)! }
+        let ringTime = run(produce: { player, i in
+            guard let p = rings[player].acquire() else { return false }
+            p.storeBytes(of: i, as: Int.self)
+            rings[player].commit(byteCount: blockSize, timeStamp: 0)
+            return true
+        }, consume: { player in
+            guard let block = rings[player].peek() else { return nil }
+            defer { rings[player].release() }
+            return block.data.load(as: Int.self)
+        })
+
+        let queues = (0..<numPlayers).map { _ in LockedQueue() }
+        let lockTime = run(produce: { player, i in
+            var data = Data(count: blockSize)
+            data.withUnsafeMutableBytes { $0.storeBytes(of: i, as: Int.self) }
+            return queues[player].queue.withLock {
+                if $0.count >= 4 { return false }
+                $0.append(data)
+                return true
+            }
+        }, consume: { player in
+            queues[player].queue.withLock {
+                $0.isEmpty ? nil : $0.removeFirst().withUnsafeBytes { $0.load(as: Int.self) }
+            }
+        })
+
+        let blocks = Double(numPlayers * blocksPerPlayer)
+        print("AudioRingBuffer \(numPlayers) players: ring \(ringTime)s (\(blocks / ringTime) blocks/s), mutex \(lockTime)s (\(blocks / lockTime) blocks/s)")
+    }
+
+    // 64 players of an AudioDeviceContext, end to end.
+    // The loopback context decodes on update, mixed as fast as possible.
+    func testOfflineContext64Players() throws {
+        guard let context = makeOfflineAudioDeviceContext() else {
+            throw XCTSkip("Loopback audio device is not available.")
+        }
+        let duration = 2.0
+        let tone = AudioOfflineRendererTests.makeTone(frequency: 440, duration: duration)
+        let players = try (0..<64).map { _ in
+            let stream = try XCTUnwrap(AudioStream(data: tone))
+            return try XCTUnwrap(context.makePlayer(stream: stream))
+        }
+        let renderer = try XCTUnwrap(AudioOfflineRenderer(context: context))
+        players.forEach { $0.play() }
+        _ = renderer.renderUntilIdle(maxDuration: duration + 2.0)
+
+        for player in players {
+            XCTAssertFalse(player.playing)
+            XCTAssertEqual(player.bufferedPosition, duration, accuracy: 0.01)
+        }
+        let statistics = renderer.statistics
+        XCTAssertEqual(statistics.voiceSeconds, duration * 64, accuracy: duration * 64 * 0.1)
+        print("AudioDeviceContext offline 64 players: \(statistics.voiceThroughput) voice-seconds/s, realtime x\(statistics.realtimeFactor)")
+    }
+
+    // 64 players of a hardware AudioDeviceContext, each with its own decode task,
+    // submitted by the playback task of the context.
+    func testDeviceContext64Players() throws {
+        guard let context = makeAudioDeviceContext() else {
+            throw XCTSkip("Audio device is not available.")
+        }
+        let duration = 2.0
+        let tone = AudioOfflineRendererTests.makeTone(frequency: 440, duration: duration)
+        let players = try (0..<64).map { _ in
+            let stream = try XCTUnwrap(AudioStream(data: tone))
+            let player = try XCTUnwrap(context.makePlayer(stream: stream))
+            player.source.gain = 0.0
+            return player
+        }
+
+        let start = DispatchTime.now().uptimeNanoseconds
+        players.forEach { $0.play() }
+        var elapsed = 0.0
+        while elapsed < duration + 5.0, players.contains(where: \.playing) {
+            Thread.sleep(forTimeInterval: 0.1)
+            elapsed = Double(DispatchTime.now().uptimeNanoseconds - start) * 0.000_000_001
+        }
+
+        for player in players {
+            XCTAssertFalse(player.playing)
+            XCTAssertEqual(player.bufferedPosition, duration, accuracy: 0.01)
+        }
+        // playing longer than the duration means the submission fell behind.
+        print("AudioDeviceContext 64 players: \(duration)s streams finished in \(elapsed)s")
+    }
+}
@@ -0,0 +1,176 @@
+import XCTest
+import Foundation
+@testable import VVD
+
+final class AudioStreamSeekTests: XCTestCase {
+    static let sampleRate = 44100
+    static let blockSize = 4096
+
+    static func sample(_ index: Int) -> Int16 {
+        let t = Double(index) / Double(sampleRate)
+        return Int16(sin(2.0 * .pi * 440.0 * t) * 16000.0 + sin(2.0 * .pi * 3.0 * t) * 8000.0)
+    }
+
+    // 16-bit mono FLAC with VERBATIM subframes, decoded samples
+    // are identical to the source. (no SEEKTABLE metadata block)
+    static func makeFLAC(blocks: Int) -> Data {
+        var data = Data()
+        data.reserveCapacity(blocks * (blockSize * 2 + 16) + 42)
+        func append<T: FixedWidthInteger>(_ value: T) {
+            withUnsafeBytes(of: value.bigEndian) { data.append(contentsOf: $0) }
+        }
+        func crc8(_ bytes: Data) -> UInt8 {
+            var crc: UInt8 = 0
+            for byte in bytes {
+                crc ^= byte
+                for _ in 0..<8 { crc = crc & 0x80 != 0 ? (crc << 1) ^ 0x07 : crc << 1 }
+            }
+            return crc
+        }
+        let crc16Table: [UInt16] = (0..<256).map { byte in
+            var crc = UInt16(byte) << 8
+            for _ in 0..<8 { crc = crc & 0x8000 != 0 ? (crc << 1) ^ 0x8005 : crc << 1 }
+            return crc
+        }
+        func crc16(_ bytes: Data) -> UInt16 {
+            bytes.reduce(UInt16(0)) { crc, byte in
+                (crc << 8) ^ crc16Table[Int(UInt8(crc >> 8) ^ byte)]
+            }
+        }
+
+        let totalSamples = UInt64(blocks * blockSize)
+        data.append(contentsOf: Array("fLaC".utf8))
+        data.append(contentsOf: [0x80, 0x00, 0x00, 34])  // last block, STREAMINFO
+        append(UInt16(blockSize))
+        append(UInt16(blockSize))
+        data.append(contentsOf: [UInt8](repeating: 0, count: 6))
+        append(UInt64(sampleRate) << 44 | UInt64(0) << 41 | UInt64(15) << 36 | totalSamples)
+        data.append(contentsOf: [UInt8](repeating: 0, count: 16))
+
+        for frame in 0..<blocks {
+            // fixed block size 4096, 44.1kHz, mono, 16 bits.
+            var header = Data([0xff, 0xf8, 0xc9, 0x08])
+            if frame < 0x80 {
+                header.append(UInt8(frame))
+            } else if frame < 0x800 {
+                header.append(contentsOf: [UInt8(0xc0 | (frame >> 6)), UInt8(0x80 | (frame & 0x3f))])
+            } else {
+                header.append(contentsOf: [UInt8(0xe0 | (frame >> 12)),
+                                           UInt8(0x80 | ((frame >> 6) & 0x3f)),
+                                           UInt8(0x80 | (frame & 0x3f))])
+            }
+            header.append(crc8(header))
+            let start = data.count
+            data.append(header)
+            data.append(0x02)   // VERBATIM
+            for i in 0..<blockSize {
+                append(sample(frame * blockSize + i))
+            }
+            append(crc16(data[start...]))
+        }
+        return data
+    }
+
+    struct RandomPositions: RandomNumberGenerator {
+        var state: UInt64
+        mutating func next() -> UInt64 {
+            state = state &* 6364136223846793005 &+ 1442695040888963407
+            return state
+        }
+    }
+
+    static func makeFLAC(minutes: Double) -> Data {
+        makeFLAC(blocks: Int((minutes * 60.0 * Double(sampleRate)).rounded(.up)) / blockSize + 1)
+    }
+
+    static func randomPositions(_ count: Int, total: UInt64) -> [UInt64] {
+        var generator = RandomPositions(state: 0x5eed)
+        return (0..<count).map { _ in UInt64.random(in: 0..<total, using: &generator) }
+    }
+
+    func testSeekTableRoundTrip() throws {
+        let flac = Self.makeFLAC(blocks: 100)
+        let stream = try XCTUnwrap(AudioStream(data: flac))
+        XCTAssertEqual(stream.format, .flac)
+        XCTAssertFalse(stream.hasSeekTable)
+        XCTAssertTrue(stream.buildSeekTable(interval: 0.05))
+
+        let table = try XCTUnwrap(stream.seekTableData())
+        XCTAssertFalse(stream.loadSeekTable(table.prefix(table.count - 1)))
+
+        let cached = try XCTUnwrap(AudioStream(data: flac, seekTable: table))
+        XCTAssertTrue(cached.hasSeekTable)
+        XCTAssertEqual(cached.seekTableData(), table)
+
+        // a table of another stream must be rejected.
+        let other = try XCTUnwrap(AudioStream(data: Self.makeFLAC(blocks: 99)))
+        XCTAssertFalse(other.loadSeekTable(table))
+        XCTAssertFalse(other.hasSeekTable)
+
+        // a missing table is built on the first seek, not at open.
+        let deferred = try XCTUnwrap(AudioStream(data: flac, seekTable: nil))
+        XCTAssertFalse(deferred.hasSeekTable)
+        XCTAssertEqual(deferred.seek(pcm: 0), 0)
+        XCTAssertFalse(deferred.hasSeekTable)
+        XCTAssertEqual(deferred.seek(pcm: 5000), 5000)
+        XCTAssertTrue(deferred.hasSeekTable)
+
+        var samples = [Int16](repeating: 0, count: 256)
+        for pos in Self.randomPositions(100, total: cached.pcmTotal - 256) {
+            XCTAssertEqual(cached.seek(pcm: pos), pos)
+            let read = samples.withUnsafeMutableBytes { cached.read($0) }
+            XCTAssertEqual(read, samples.count * 2)
+            XCTAssertEqual(samples, (0..<samples.count).map { Self.sample(Int(pos) + $0) })
+        }
+    }
+
+    // returns mean and 99th percentile of seek + first read in microseconds.
+    static func measureRandomSeeks(_ stream: AudioStream, count: Int) -> (mean: Double, p99: Double) {
+        var buffer = [UInt8](repeating: 0, count: 4096)
+        var latencies: [Double] = []
+        latencies.reserveCapacity(count)
+        for pos in randomPositions(count, total: stream.pcmTotal) {
+            let start = DispatchTime.now().uptimeNanoseconds
+            _ = stream.seek(pcm: pos)
+            _ = buffer.withUnsafeMutableBytes { stream.read($0) }
+            latencies.append(Double(DispatchTime.now().uptimeNanoseconds - start) * 0.001)
+        }
+        latencies.sort()
+        let mean = latencies.reduce(0, +) / Double(latencies.count)
+        return (mean, latencies[min(latencies.count - 1, latencies.count * 99 / 100)])
+    }
+
+    func benchmarkRandomSeeks(name: String, data: Data) throws {
+        let stream = try XCTUnwrap(AudioStream(data: data))
+        let search = Self.measureRandomSeeks(stream, count: 500)
+        let start = DispatchTime.now().uptimeNanoseconds
+        if stream.buildSeekTable() {
+            let build = Double(DispatchTime.now().uptimeNanoseconds - start) * 0.000_001
+            let table = Self.measureRandomSeeks(stream, count: 500)
+            print("\(name) random seek: \(search.mean) us (p99 \(search.p99) us), with seek table: \(table.mean) us (p99 \(table.p99) us), table built in \(build) ms")
+        } else {
+            print("\(name) random seek: \(search.mean) us (p99 \(search.p99) us), no seek table")
+        }
+    }
+
+    func testRandomSeekLatency() throws {
+        try benchmarkRandomSeeks(name: "FLAC 2 min", data: Self.makeFLAC(minutes: 2))
+
+        // other formats can be measured with local files,
+        // VVD_SEEK_BENCHMARK_FILES=a.mp3:b.ogg
+        if let files = ProcessInfo.processInfo.environment["VVD_SEEK_BENCHMARK_FILES"] {
+            for path in files.split(separator: ":") {
+                let url = URL(fileURLWithPath: String(path))
+                try benchmarkRandomSeeks(name: url.lastPathComponent, data: Data(contentsOf: url))
+            }
+        }
+    }
+
+    // 60 minutes of FLAC is about 320 MB in memory, run with VVD_SEEK_BENCHMARK_LONG=1
+    func testRandomSeekLatency60Minutes() throws {
+        guard ProcessInfo.processInfo.environment["VVD_SEEK_BENCHMARK_LONG"] != nil else {
+            throw XCTSkip("Set VVD_SEEK_BENCHMARK_LONG to run the 60 minutes benchmark.")
+        }
+        try benchmarkRandomSeeks(name: "FLAC 60 min", data: Self.makeFLAC(minutes: 60))
+    }
+}
@@ -0,0 +1,142 @@
+import XCTest
+import Foundation
+@testable import VVD
+
+final class BatchTransformTests: XCTestCase {
+    // interleaved vertex: position (Float3), normal (Float3), uv (Float2)
+    static let vertexStride = 32
+
+    func makeVertices(_ count: Int) -> UnsafeMutableRawBufferPointer {
+        let buffer = UnsafeMutableRawBufferPointer.allocate(byteCount: count * Self.vertexStride,
+                                                            alignment: 16)
+        for i in 0..<count {
+            let p = buffer.baseAddress! + i * Self.vertexStride
+            let x = Float32(i % 1000), y = Float32((i / 1000) % 1000), z = Float32(i % 7)
+            p.storeBytes(of: (x, y, z), as: Float3.self)
+            let n = Vector3(Scalar(x) - 500, Scalar(y) - 500, 1).normalized()
+            p.storeBytes(of: n.float3, toByteOffset: 12, as: Float3.self)
+            p.storeBytes(of: (Float32(0), Float32(0)), toByteOffset: 24, as: Float2.self)
+        }
+        return buffer
+    }
+
+    func makeTransform() -> AffineTransform3 {
+        AffineTransform3(basis: Quaternion(angle: 0.6, axis: Vector3(1, 1, 0)).matrix3, origin: .zero)
+            .scaled(by: Vector3(2, 3, 0.5))
+            .translated(by: Vector3(10, -20, 5))
+    }
+
+    func testTransformMatchesScalar() {
+        let count = 5000
+        let buffer = makeVertices(count)
+        defer { buffer.deallocate() }
+        let base = buffer.baseAddress!
+        let transform = makeTransform()
+        let matrix = transform.matrix4
+        let normalMatrix = transform.matrix3.inverted()!.transposed()
+
+        var expectedPositions: [Vector3] = []
+        var expectedNormals: [Vector3] = []
+        var expectedBounds = AABB.null
+        for i in 0..<count {
+            let p = base + i * Self.vertexStride
+            let v = Vector3(p.load(as: Float3.self)).applying(matrix, w: 1.0)
+            expectedPositions.append(v)
+            expectedBounds.combine(AABB(min: v, max: v))
+            let n = Vector3(p.load(fromByteOffset: 12, as: Float3.self))
+            expectedNormals.append(n.applying(normalMatrix).normalized())
+        }
+
+        let positions = StridedVectors(base, stride: Self.vertexStride, count: count, format: .float3)
+        let normals = StridedVectors(base + 12, stride: Self.vertexStride, count: count, format: .float3)
+        let batch = BatchTransform(transform)
+
+        XCTAssertEqual(batch.transformedPoints(positions).count, count)
+        let bounds = batch.transformVertices(positions: positions, into: positions,
+                                             normals: normals, into: normals)
+        XCTAssertEqual((bounds.min - expectedBounds.min).length, 0, accuracy: 0.01)
+        XCTAssertEqual((bounds.max - expectedBounds.max).length, 0, accuracy: 0.01)
+
+        for i in 0..<count {
+            let p = base + i * Self.vertexStride
+            let v = Vector3(p.load(as: Float3.self))
+            let n = Vector3(p.load(fromByteOffset: 12, as: Float3.self))
+            XCTAssertEqual((v - expectedPositions[i]).length, 0, accuracy: 0.01)
+            XCTAssertEqual((n - expectedNormals[i]).length, 0, accuracy: 0.0001)
+            XCTAssertEqual(p.load(fromByteOffset: 24, as: Float2.self).0, 0)    // untouched
+        }
+
+        // Float4 destination
+        let output = UnsafeMutableBufferPointer<Float4>.allocate(capacity: count)
+        defer { output.deallocate() }
+        let source = StridedVectors(readOnly: base, stride: Self.vertexStride, count: count, format: .float3)
+        BatchTransform(Transform.identity).transformPoints(
+            source, into: StridedVectors(UnsafeMutableRawPointer(output.baseAddress!), count: count, format: .float4))
+        XCTAssertEqual(output[count - 1].0, base.load(fromByteOffset: (count - 1) * Self.vertexStride, as: Float32.self))
+        XCTAssertEqual(output[count - 1].3, 1)
+    }
+
+    // projective matrices divide by w, as Vector3.applying(_:w:).
+    func testProjectiveTransform() {
+        let count = 1000
+        let buffer = makeVertices(count)
+        defer { buffer.deallocate() }
+        let base = buffer.baseAddress!
+        let view = AffineTransform3.identity.translated(by: Vector3(-500, -500, -2000)).matrix4
+        let matrix = view.concatenating(ProjectionTransform.perspective(aspect: 1, fov: 1, near: 1, far: 5000).matrix)
+
+        let batch = BatchTransform(matrix)
+        XCTAssertFalse(batch.isAffine)
+        XCTAssertTrue(BatchTransform(makeTransform()).isAffine)
+
+        let positions = StridedVectors(base, stride: Self.vertexStride, count: count, format: .float3)
+        let points = batch.transformedPoints(positions)
+        let output = UnsafeMutableBufferPointer<Float4>.allocate(capacity: count)
+        defer { output.deallocate() }
+        batch.transformPoints(positions, into: StridedVectors(UnsafeMutableRawPointer(output.baseAddress!),
+                                                              count: count, format: .float4))
+        for i in 0..<count {
+            let v = Vector3(base.load(fromByteOffset: i * Self.vertexStride, as: Float3.self))
+            let expected = v.applying(matrix, w: 1.0)
+            XCTAssertEqual((points[i] - expected).length, 0, accuracy: 0.0001)
+            XCTAssertEqual((Vector3(output[i].0, output[i].1, output[i].2) - expected).length, 0, accuracy: 0.0001)
+            XCTAssertEqual(output[i].3, 1)
+        }
+    }
+
+    // 10M interleaved vertices: per-vertex Vector3.applying vs. batch kernel.
+    func testTransform10MVertices() {
+        let count = 10_000_000
+        let buffer = makeVertices(count)
+        defer { buffer.deallocate() }
+        let base = buffer.baseAddress!
+        let transform = makeTransform()
+
+        var start = DispatchTime.now().uptimeNanoseconds
+        let matrix = transform.matrix4
+        var positions: [Vector3] = []
+        var scalarBounds = AABB.null
+        for i in 0..<count {
+            let v = Vector3((base + i * Self.vertexStride).load(as: Float3.self)).applying(matrix, w: 1.0)
+            positions.append(v)
+            scalarBounds.combine(AABB(min: v, max: v))
+        }
+        let scalarTime = Double(DispatchTime.now().uptimeNanoseconds - start) * 0.000_001
+        positions = []
+
+        start = DispatchTime.now().uptimeNanoseconds
+        let source = StridedVectors(base, stride: Self.vertexStride, count: count, format: .float3)
+        let bounds = BatchTransform(transform).transformPoints(source, into: source)
+        let batchTime = Double(DispatchTime.now().uptimeNanoseconds - start) * 0.000_001
+
+        start = DispatchTime.now().uptimeNanoseconds
+        let normals = StridedVectors(base + 12, stride: Self.vertexStride, count: count, format: .float3)
+        BatchTransform(transform).transformVertices(positions: source, into: source,
+                                                    normals: normals, into: normals)
+        let vertexTime = Double(DispatchTime.now().uptimeNanoseconds - start) * 0.000_001
+
+        XCTAssertEqual((bounds.min - scalarBounds.min).length, 0, accuracy: 0.1)
+        XCTAssertEqual((bounds.max - scalarBounds.max).length, 0, accuracy: 0.1)
+        print("Transform \(count) vertices: per-vertex \(scalarTime) ms, batch points \(batchTime) ms, batch points+normals \(vertexTime) ms")
+    }
+}
@@ -0,0 +1,123 @@
+import XCTest
+import Foundation
+@testable import VVD
+
+final class DiskCacheTests: XCTestCase {
+    var directory: URL!
+
+    override func setUp() {
+        directory = FileManager.default.temporaryDirectory
+            .appendingPathComponent("DiskCacheTests-\(UUID().uuidString)", isDirectory: true)
+    }
+
+    override func tearDown() {
+        try? FileManager.default.removeItem(at: directory)
+    }
+
+    func makeData(_ count: Int) -> Data {
+        Data((0..<count).map { UInt8(truncatingIfNeeded: $0 &* 31 &+ 7) })
+    }
+
+    func testReadWrite() {
+        let cache = DiskCache(name: "test", directory: directory)!
+        let data = makeData(10000)
+        XCTAssertNil(cache.data(forKey: "a"))
+        XCTAssert(cache.setData(data, forKey: "a"))
+        XCTAssertEqual(cache.data(forKey: "a"), data)
+
+        // another instance reads the same files.
+        let cache2 = DiskCache(name: "test", directory: directory)!
+        XCTAssertEqual(cache2.data(forKey: "a"), data)
+        XCTAssertEqual(cache2.totalSize, cache.totalSize)
+
+        cache.removeData(forKey: "a")
+        XCTAssertNil(cache.data(forKey: "a"))
+        XCTAssertEqual(cache.totalSize, 0)
+    }
+
+    func testHeaderValidation() throws {
+        let data = makeData(4096)
+        let device1 = DiskCache(name: "test", identity: Data([1, 2, 3, 4]), directory: directory)!
+        device1.setData(data, forKey: "pipeline")
+
+        // another device or driver does not use the data.
+        let device2 = DiskCache(name: "test", identity: Data([1, 2, 3, 5]), directory: directory)!
+        XCTAssertNil(device2.data(forKey: "pipeline"))
+        XCTAssertNil(device1.data(forKey: "pipeline"))
+
+        // corrupted payload
+        device1.setData(data, forKey: "pipeline")
+        let url = try FileManager.default.contentsOfDirectory(at: device1.directory,
+                                                              includingPropertiesForKeys: nil).first!
+        var contents = try Data(contentsOf: url)
+        contents[contents.count - 100] ^= 0xff
+        try contents.write(to: url)
+        XCTAssertNil(device1.data(forKey: "pipeline"))
+        XCTAssertFalse(FileManager.default.fileExists(atPath: url.path))
+
+        // truncated file
+        device1.setData(data, forKey: "pipeline")
+        try Data(contentsOf: url).prefix(64).write(to: url)
+        XCTAssertNil(device1.data(forKey: "pipeline"))
+    }
+
+    func testSizeLimit() {
+        let cache = DiskCache(name: "test", sizeLimit: 10 * 1100, directory: directory)!
+        for i in 0..<20 {
+            XCTAssert(cache.setData(makeData(1000), forKey: "key\(i)"))
+            XCTAssertLessThanOrEqual(cache.totalSize, cache.sizeLimit)
+        }
+        XCTAssertNotNil(cache.data(forKey: "key19"))
+        XCTAssertNil(cache.data(forKey: "key0"))
+        // larger than the limit.
+        XCTAssertFalse(cache.setData(makeData(20000), forKey: "large"))
+
+        cache.removeAll()
+        XCTAssertEqual(cache.totalSize, 0)
+        XCTAssertNil(cache.data(forKey: "key19"))
+    }
+
+    func testShaderReflection() throws {
+        let member = ShaderResourceStructMember(dataType: .float4x4, name: "transform",
+                                                offset: 0, size: 64, count: 1, stride: 0, members: [])
+        let resources = (0..<8).map { i in
+            ShaderResource(set: 0, binding: i, name: "buffer\(i)", type: .buffer,
+                           stages: [.vertex, .fragment], count: 1, stride: 0,
+                           enabled: true, access: .readOnly,
+                           bufferTypeInfo: ShaderResourceBuffer(dataType: .struct, alignment: 16, size: 64),
+                           textureTypeInfo: nil, threadgroupTypeInfo: nil,
+                           members: [member])
+        }
+        let reflection = Shader.Reflection(
+            stage: .vertex,
+            functionNames: ["main"],
+            inputAttributes: [ShaderAttribute(name: "position", location: 0, type: .float3, enabled: true)],
+            outputAttributes: [],
+            resources: resources,
+            pushConstantLayouts: [ShaderPushConstantLayout(name: "pc", offset: 0, size: 64,
+                                                           stages: .vertex, members: [member])],
+            descriptors: resources.map { ShaderDescriptor(set: $0.set, binding: $0.binding, count: 1, type: .uniformBuffer) },
+            threadgroupSize: [1, 1, 1])
+
+        let encoder = PropertyListEncoder()
+        encoder.outputFormat = .binary
+        let cache = DiskCache(name: "reflection", directory: directory)!
+        let key = SHA256.hash("spirv").string
+
+        let cold = DispatchTime.now().uptimeNanoseconds
+        cache.setData(try encoder.encode(reflection), forKey: key)
+        let warm = DispatchTime.now().uptimeNanoseconds
+        let cached = try XCTUnwrap(cache.data(forKey: key))
+        let decoded = try PropertyListDecoder().decode(Shader.Reflection.self, from: cached)
+        let end = DispatchTime.now().uptimeNanoseconds
+        print("Shader reflection cache store: \(Double(warm - cold) * 0.000_001) ms, load: \(Double(end - warm) * 0.000_001) ms")
+
+        let shader = Shader()
+        XCTAssert(shader.apply(decoded))
+        XCTAssertEqual(shader.stage, .vertex)
+        XCTAssertEqual(shader.resources.map(\.description), resources.map(\.description))
+        XCTAssertEqual(shader.pushConstantLayouts.first?.members.first?.dataType, .float4x4)
+        XCTAssertEqual(shader.descriptors.count, 8)
+        XCTAssertEqual(shader.inputAttributes.first?.type, .float3)
+    }
+}
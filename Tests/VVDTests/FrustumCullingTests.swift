@@ -0,0 +1,117 @@
+import XCTest
+import Foundation
+@testable import VVD
+
+final class FrustumCullingTests: XCTestCase {
+    let frustum = ViewFrustum(
+        view: ViewTransform(position: Vector3(0, 0, 0),
+                            direction: Vector3(0, 0, -1),
+                            up: Vector3(0, 1, 0)),
+        projection: .perspective(aspect: 1.5, fov: .pi / 3, near: 0.1, far: 500))
+
+    func makeAABBs(_ count: Int) -> [AABB] {
+        var rng = SystemRandomNumberGenerator()
+        return (0..<count).map { _ in
+            let center = Vector3(Scalar.random(in: -600...600, using: &rng),
+                                 Scalar.random(in: -600...600, using: &rng),
+                                 Scalar.random(in: -600...600, using: &rng))
+            let half = Vector3(Scalar.random(in: 0.1...4, using: &rng),
+                               Scalar.random(in: 0.1...4, using: &rng),
+                               Scalar.random(in: 0.1...4, using: &rng))
+            return AABB(center: center, halfExtents: half)
+        }
+    }
+
+    // Float32 planes can disagree with the Float64 test for bounds
+    // touching a plane, allow a few mismatches.
+    func assertMatches(_ mask: VisibilityMask, _ expected: [Bool],
+                       file: StaticString = #filePath, line: UInt = #line) {
+        XCTAssertEqual(mask.count, expected.count, file: file, line: line)
+        let mismatches = expected.indices.filter { mask[$0] != expected[$0] }.count
+        XCTAssertLessThanOrEqual(mismatches, expected.count / 10000 + 1, file: file, line: line)
+    }
+
+    func testCullAABBs() {
+        var aabbs = makeAABBs(10_003)
+        aabbs[5] = .null
+        let expected = aabbs.map { frustum.intersects($0) }
+        XCTAssertGreaterThan(expected.filter { $0 }.count, 0)
+
+        var mask = VisibilityMask()
+        frustum.cull(AABBArray(aabbs), into: &mask)
+        assertMatches(mask, expected)
+        XCTAssertFalse(mask[5])
+
+        var parallelMask = VisibilityMask()
+        frustum.cull(AABBArray(aabbs + aabbs + aabbs + aabbs), into: &parallelMask, parallel: true)
+        assertMatches(parallelMask, expected + expected + expected + expected)
+    }
+
+    func testCullSpheres() {
+        var spheres = makeAABBs(10_003).map {
+            Sphere(center: $0.center, radius: $0.extents.length * 0.5)
+        }
+        spheres[7] = Sphere(center: .zero, radius: -1)
+        let expected = spheres.map { frustum.intersects($0) }
+
+        var mask = VisibilityMask()
+        frustum.cull(SphereArray(spheres), into: &mask)
+        assertMatches(mask, expected)
+        XCTAssertFalse(mask[7])
+
+        var visible: [Int] = []
+        mask.forEachVisible { visible.append($0) }
+        XCTAssertEqual(visible.count, mask.visibleCount)
+        XCTAssertTrue(visible.allSatisfy { mask[$0] })
+    }
+
+    func testCullBVH() {
+        let aabbs = makeAABBs(10_000)
+        let bvh = BVH(objects: aabbs)
+        XCTAssertEqual(bvh.numObjects, aabbs.count)
+        XCTAssertEqual(bvh.numNodes, aabbs.count * 2 - 1)
+
+        var mask = VisibilityMask()
+        frustum.cull(bvh, into: &mask)
+        // conservative: every visible object is reported.
+        for (i, aabb) in aabbs.enumerated() where frustum.intersects(aabb) {
+            XCTAssertTrue(mask[i])
+        }
+        let expected = aabbs.filter { frustum.intersects($0) }.count
+        XCTAssertLessThan(mask.visibleCount, expected + expected / 10 + 10)
+    }
+
+    // 1M boxes: intersects() per object vs. batched SIMD vs. BVH.
+    func testCull1MObjects() {
+        let count = 1_000_000
+        let aabbs = makeAABBs(count)
+        let array = AABBArray(aabbs)
+        let bvh = BVH(objects: aabbs)
+        var mask = VisibilityMask()
+
+        func measure(_ body: () -> Int) -> (Double, Int) {
+            let start = DispatchTime.now().uptimeNanoseconds
+            let visible = body()
+            return (Double(DispatchTime.now().uptimeNanoseconds - start) * 0.000_001, visible)
+        }
+        let (scalarTime, scalarVisible) = measure {
+            aabbs.reduce(0) { frustum.intersects($1) ? $0 + 1 : $0 }
+        }
+        let (simdTime, simdVisible) = measure {
+            frustum.cull(array, into: &mask)
+            return mask.visibleCount
+        }
+        let (parallelTime, _) = measure {
+            frustum.cull(array, into: &mask, parallel: true)
+            return mask.visibleCount
+        }
+        let (bvhTime, bvhVisible) = measure {
+            frustum.cull(bvh, into: &mask)
+            return mask.visibleCount
+        }
+        XCTAssertLessThanOrEqual(abs(simdVisible - scalarVisible), count / 10000 + 1)
+        XCTAssertGreaterThanOrEqual(bvhVisible, scalarVisible)
+
+        print("Culling \(count) AABBs (\(scalarVisible) visible): intersects \(scalarTime) ms, SIMD \(simdTime) ms, SIMD parallel \(parallelTime) ms, BVH \(bvhTime) ms")
+    }
+}
@@ -0,0 +1,25 @@
+import Foundation
+@testable import VVD
+
+// CPU memory buffer for the tests without a graphics device.
+final class HostBuffer: GPUBuffer {
+    let length: Int
+    let ptr: UnsafeMutableRawPointer?
+
+    init(length: Int = 0) {
+        self.length = length
+        if length > 0 {
+            let ptr = UnsafeMutableRawPointer.allocate(byteCount: length, alignment: 16)
+            ptr.initializeMemory(as: UInt8.self, repeating: 0, count: length)
+            self.ptr = ptr
+        } else {
+            self.ptr = nil
+        }
+    }
+
+    deinit { ptr?.deallocate() }
+
+    func contents() -> UnsafeMutableRawPointer? { ptr }
+    func flush() {}
+    var device: GraphicsDevice { fatalError("not available") }
+}
@@ -0,0 +1,135 @@
+import XCTest
+import Foundation
+@testable import VVD
+
+final class MemoryDefragmenterTests: XCTestCase {
+    // chunks of host memory, the copies of a pass are done on the CPU.
+    struct SimulatedHeaps {
+        struct Key: Hashable {
+            let heap: Int
+            let allocation: TLSFAllocator.Allocation
+        }
+        var heaps: [TLSFAllocator]
+        var bytes: [[UInt8]]
+        var live: [Key: UInt8] = [:]
+        var pinned: Set<Key> = []
+
+        init(count: Int, size: Int) {
+            heaps = .init(repeating: TLSFAllocator(size: UInt64(size)), count: count)
+            bytes = .init(repeating: .init(repeating: 0, count: size), count: count)
+        }
+
+        // fills the heap with allocations of the given size and keeps the first count.
+        mutating func fill(heap: Int, allocationSize: UInt64, keep count: Int) {
+            var allocations: [TLSFAllocator.Allocation] = []
+            while let allocation = heaps[heap].alloc(size: allocationSize) {
+                allocations.append(allocation)
+            }
+            for (i, allocation) in allocations.enumerated() {
+                if i < count {
+                    let tag = UInt8(truncatingIfNeeded: live.count + 1)
+                    let range = Int(allocation.offset)..<Int(allocation.offset + allocation.size)
+                    bytes[heap].replaceSubrange(range, with: repeatElement(tag, count: range.count))
+                    live[Key(heap: heap, allocation: allocation)] = tag
+                } else {
+                    heaps[heap].free(allocation)
+                }
+            }
+        }
+
+        mutating func plan(_ defragmenter: MemoryDefragmenter) -> MemoryDefragmenter.Pass {
+            let pinned = self.pinned
+            return defragmenter.plan(&heaps) { heap, allocation in
+                pinned.contains(Key(heap: heap, allocation: allocation)) ? nil : 8
+            }
+        }
+
+        mutating func execute(_ pass: MemoryDefragmenter.Pass) {
+            for move in pass.moves {
+                let src = move.sourceAllocation
+                let dst = move.destinationAllocation
+                XCTAssertEqual(src.size, dst.size)
+                let srcRange = Int(src.offset)..<Int(src.offset + src.size)
+                let dstRange = Int(dst.offset)..<Int(dst.offset + dst.size)
+                XCTAssert(bytes[move.destination][dstRange].allSatisfy { $0 == 0 }, "destination in use")
+                let contents = Array(bytes[move.source][srcRange])
+                bytes[move.destination].replaceSubrange(dstRange, with: contents)
+                bytes[move.source].replaceSubrange(srcRange, with: repeatElement(0, count: srcRange.count))
+
+                let tag = live.removeValue(forKey: Key(heap: move.source, allocation: src))
+                XCTAssertNotNil(tag)
+                live[Key(heap: move.destination, allocation: dst)] = tag
+                heaps[move.source].free(src)
+            }
+            for heap in pass.releasedHeaps {
+                XCTAssert(heaps[heap].isEmpty)
+            }
+        }
+
+        func verify() {
+            for (key, tag) in live {
+                let range = Int(key.allocation.offset)..<Int(key.allocation.offset + key.allocation.size)
+                XCTAssert(bytes[key.heap][range].allSatisfy { $0 == tag }, "allocation corrupted")
+            }
+            XCTAssertEqual(heaps.reduce(0) { $0 + $1.numAllocations }, live.count)
+        }
+    }
+
+    func testIncrementalCompaction() {
+        var heaps = SimulatedHeaps(count: 4, size: 64 * 1024)
+        heaps.fill(heap: 0, allocationSize: 1024, keep: 48)
+        heaps.fill(heap: 1, allocationSize: 1024, keep: 20)
+        heaps.fill(heap: 2, allocationSize: 1024, keep: 8)
+        heaps.fill(heap: 3, allocationSize: 1024, keep: 4)
+        let numAllocations = heaps.live.count
+
+        let defragmenter = MemoryDefragmenter(maxBytesPerPass: 8 * 1024)
+        var numPasses = 0
+        var reclaimedBytes: UInt64 = 0
+        while true {
+            let pass = heaps.plan(defragmenter)
+            if pass.moves.isEmpty { break }
+            XCTAssertLessThanOrEqual(pass.bytesMoved, defragmenter.maxBytesPerPass)
+            heaps.execute(pass)
+            heaps.verify()
+            reclaimedBytes += pass.reclaimedBytes
+            numPasses += 1
+            XCTAssertLessThan(numPasses, 10)
+        }
+        XCTAssertEqual(heaps.live.count, numAllocations)
+        XCTAssertEqual(heaps.heaps.filter { $0.isEmpty == false }.count, 2)
+        XCTAssert(heaps.heaps[2].isEmpty)
+        XCTAssert(heaps.heaps[3].isEmpty)
+        XCTAssertEqual(reclaimedBytes, 2 * 64 * 1024)
+    }
+
+    func testPinnedAllocation() {
+        var heaps = SimulatedHeaps(count: 3, size: 64 * 1024)
+        heaps.fill(heap: 0, allocationSize: 1024, keep: 48)
+        heaps.fill(heap: 1, allocationSize: 1024, keep: 4)
+        heaps.fill(heap: 2, allocationSize: 1024, keep: 4)
+        heaps.pinned.insert(heaps.live.keys.first { $0.heap == 1 }!)
+
+        let pass = heaps.plan(MemoryDefragmenter(maxBytesPerPass: .max))
+        XCTAssert(pass.moves.allSatisfy { $0.source == 2 && $0.destination != 1 })
+        XCTAssertEqual(pass.releasedHeaps, [2])
+        XCTAssertEqual(pass.bytesMoved, 4 * 1024)
+        heaps.execute(pass)
+        heaps.verify()
+        XCTAssertEqual(heaps.heaps[1].numAllocations, 4)
+    }
+
+    func testInsufficientSpace() {
+        var heaps = SimulatedHeaps(count: 2, size: 64 * 1024)
+        heaps.fill(heap: 0, allocationSize: 1024, keep: 40)
+        heaps.fill(heap: 1, allocationSize: 1024, keep: 30)
+
+        // heap 1 does not fit in heap 0, nothing is moved.
+        let pass = heaps.plan(MemoryDefragmenter(maxBytesPerPass: .max))
+        XCTAssert(pass.moves.isEmpty)
+        XCTAssertEqual(pass.reclaimedBytes, 0)
+        XCTAssertEqual(heaps.heaps[0].numAllocations, 40)
+        XCTAssertEqual(heaps.heaps[0].statistics.freeSize, 24 * 1024)
+        heaps.verify()
+    }
+}
@@ -0,0 +1,131 @@
+import XCTest
+import Foundation
+@testable import VVD
+
+final class MeshBindingPlanTests: XCTestCase {
+    final class NullBindingSet: ShaderBindingSet {
+        func setBuffer(_: GPUBuffer, offset: Int, length: Int, binding: Int) {}
+        func setBufferArray(_ : [BufferBindingInfo], binding: Int) {}
+        func setTexture(_: Texture, binding: Int) {}
+        func setTextureArray(_: [Texture], binding: Int) {}
+        func setSamplerState(_: SamplerState, binding: Int) {}
+        func setSamplerStateArray(_: [SamplerState], binding: Int) {}
+        var device: GraphicsDevice { fatalError("not available") }
+    }
+
+    // uniform block { float4x4 mvp; struct { float4 color; float4 params; } material; }
+    func makeMesh(material: Material) -> (Mesh, HostBuffer) {
+        let float4 = { (name: String, offset: Int) in
+            ShaderResourceStructMember(dataType: .float4, name: name, offset: offset,
+                                       size: 16, count: 1, stride: 16, members: [])
+        }
+        let members = [
+            ShaderResourceStructMember(dataType: .float4x4, name: "mvp", offset: 0,
+                                       size: 64, count: 1, stride: 64, members: []),
+            ShaderResourceStructMember(dataType: .struct, name: "material", offset: 64,
+                                       size: 32, count: 1, stride: 32,
+                                       members: [float4("color", 0), float4("params", 16)]),
+        ]
+        let resource = ShaderResource(set: 0, binding: 0, name: "ubo", type: .buffer,
+                                      stages: .vertex, count: 1, stride: 96,
+                                      enabled: true, access: .readOnly,
+                                      bufferTypeInfo: ShaderResourceBuffer(dataType: .struct, alignment: 16, size: 96),
+                                      members: members)
+        let mesh = Mesh()
+        mesh.material = material
+        mesh.resourceBindings = [
+            Mesh.ResourceBindingSet(index: 0, bindingSet: NullBindingSet(), resources: [
+                Mesh.ResourceBinding(resource: resource,
+                                     binding: ShaderBinding(binding: 0, type: .uniformBuffer, arrayLength: 1))
+            ])
+        ]
+        let buffer = HostBuffer(length: 96)
+        mesh.bufferResources[ShaderBindingLocation(set: 0, binding: 0, offset: 0)] =
+            Mesh.BufferResource(name: "ubo", buffers: [BufferBindingInfo(buffer: buffer, offset: 0, length: 96)])
+        return (mesh, buffer)
+    }
+
+    func makeMaterial() -> Material {
+        let shaderMap = MaterialShaderMap(
+            functions: [],
+            resourceSemantics: [
+                .location(set: 0, binding: 0, offset: 0): .uniform(.modelViewProjectionMatrix),
+                .location(set: 0, binding: 0, offset: 64): .material(.baseColor),
+            ],
+            inputAttributeSemantics: [:])
+        let material = Material(shaderMap: shaderMap)
+        material.properties[.baseColor] = .scalars([0.25, 0.5, 0.75, 1.0] as [Float])
+        material.userDefinedProperties[.location(set: 0, binding: 0, offset: 80)] =
+            .scalars([1.0, 2.0, 3.0, 4.0] as [Float])
+        return material
+    }
+
+    func sceneState(_ i: Int) -> SceneState {
+        SceneState(view: ViewTransform(position: Vector3(0, 0, -5), direction: Vector3(0, 0, 1), up: Vector3(0, 1, 0)),
+                   projection: .perspective(aspect: 1.0, fov: 1.0, near: 0.1, far: 100.0),
+                   model: AffineTransform3(origin: Vector3(Scalar(i), 0, 0)).matrix4)
+    }
+
+    func testBindingPlanOutput() throws {
+        let material = makeMaterial()
+        let (mesh, buffer) = makeMesh(material: material)
+        let state = sceneState(3)
+        mesh.updateShadingProperties(sceneState: state)
+
+        let mvp = state.model
+            .concatenating(state.view.matrix4)
+            .concatenating(state.projection.matrix)
+        withUnsafeBytes(of: mvp.float4x4) { expected in
+            XCTAssertTrue(memcmp(buffer.ptr!, expected.baseAddress!, 64) == 0)
+        }
+        let floats = buffer.ptr!.advanced(by: 64).assumingMemoryBound(to: Float.self)
+        XCTAssertEqual(Array(UnsafeBufferPointer(start: floats, count: 8)),
+                       [0.25, 0.5, 0.75, 1.0, 1.0, 2.0, 3.0, 4.0])
+
+        // material modified, converted values must be updated.
+        material.userDefinedProperties[.location(set: 0, binding: 0, offset: 80)] =
+            .scalars([5.0, 6.0, 7.0, 8.0] as [Double])
+        mesh.updateShadingProperties(sceneState: state)
+        XCTAssertEqual(Array(UnsafeBufferPointer(start: floats, count: 8)),
+                       [0.25, 0.5, 0.75, 1.0, 5.0, 6.0, 7.0, 8.0])
+
+        // material replaced, plan must be rebuilt.
+        let material2 = makeMaterial()
+        material2.properties[.baseColor] = .scalars([1.0, 1.0, 1.0, 1.0] as [Float])
+        mesh.material = material2
+        mesh.updateShadingProperties(sceneState: state)
+        XCTAssertEqual(floats[0], 1.0)
+
+        // shader map modified, the semantic takes precedence until removed.
+        material2.userDefinedProperties[.location(set: 0, binding: 0, offset: 64)] =
+            .scalars([9.0, 9.0, 9.0, 9.0] as [Float])
+        mesh.updateShadingProperties(sceneState: state)
+        XCTAssertEqual(floats[0], 1.0)
+        material2.shader.resourceSemantics[.location(set: 0, binding: 0, offset: 64)] = nil
+        mesh.updateShadingProperties(sceneState: state)
+        XCTAssertEqual(floats[0], 9.0)
+
+        // pipeline resources replaced.
+        XCTAssertNotNil(mesh.shadingBindingPlan)
+        mesh.resourceBindings = mesh.resourceBindings
+        XCTAssertNil(mesh.shadingBindingPlan)
+    }
+
+    func testBindingPlan10kMeshes() {
+        let material = makeMaterial()
+        let meshes = (0..<10_000).map { _ in makeMesh(material: material) }
+        let states = (0..<16).map { sceneState($0) }
+
+        meshes.forEach { $0.0.updateShadingProperties(sceneState: states[0]) } // compile
+
+        let frames = 10
+        let start = DispatchTime.now().uptimeNanoseconds
+        for frame in 0..<frames {
+            for (index, mesh) in meshes.enumerated() {
+                mesh.0.updateShadingProperties(sceneState: states[(index + frame) & 15])
+            }
+        }
+        let elapsed = Double(DispatchTime.now().uptimeNanoseconds - start) * 0.000_000_001
+        print("updateShadingProperties: \(meshes.count) meshes, \(elapsed / Double(frames) * 1000.0) ms/frame")
+    }
+}
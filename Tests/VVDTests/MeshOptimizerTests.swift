@@ -0,0 +1,104 @@
+import XCTest
+import Foundation
+@testable import VVD
+
+final class MeshOptimizerTests: XCTestCase {
+    // n x n quad grid, triangles shuffled.
+    func makeGrid(_ n: Int) -> (indices: [UInt32], positions: [Vector3]) {
+        var positions: [Vector3] = []
+        for y in 0...n {
+            for x in 0...n {
+                positions.append(Vector3(Scalar(x), Scalar(y), sin(Scalar(x) * 0.3) * 2))
+            }
+        }
+        var triangles: [(UInt32, UInt32, UInt32)] = []
+        for y in 0..<n {
+            for x in 0..<n {
+                let i = UInt32(y * (n + 1) + x)
+                let j = i + UInt32(n + 1)
+                triangles.append((i, i + 1, j))
+                triangles.append((i + 1, j + 1, j))
+            }
+        }
+        var rng = SystemRandomNumberGenerator()
+        triangles.shuffle(using: &rng)
+        return (triangles.flatMap { [$0.0, $0.1, $0.2] }, positions)
+    }
+
+    func sortedTriangles(_ indices: [UInt32]) -> [[UInt32]] {
+        stride(from: 0, to: indices.count, by: 3).map {
+            // rotate so that the smallest index is first, keeping the winding.
+            let t = [indices[$0], indices[$0 + 1], indices[$0 + 2]]
+            let m = t.firstIndex(of: t.min()!)!
+            return [t[m], t[(m + 1) % 3], t[(m + 2) % 3]]
+        }.sorted { $0.lexicographicallyPrecedes($1) }
+    }
+
+    func testVertexCacheOptimization() {
+        let (indices, positions) = makeGrid(100)
+        let before = MeshOptimizer.analyzeVertexCache(indices: indices, vertexCount: positions.count)
+        let optimized = MeshOptimizer.optimizeVertexCache(indices: indices, vertexCount: positions.count)
+        let after = MeshOptimizer.analyzeVertexCache(indices: optimized, vertexCount: positions.count)
+
+        XCTAssertEqual(sortedTriangles(optimized), sortedTriangles(indices))
+        XCTAssertLessThan(after.acmr, before.acmr)
+        XCTAssertLessThan(after.acmr, 1.0)
+        XCTAssertGreaterThanOrEqual(after.atvr, 1.0)
+        print("Vertex cache ACMR \(before.acmr) -> \(after.acmr), ATVR \(before.atvr) -> \(after.atvr)")
+    }
+
+    // triangles reachable only from vertex 0 by the dead-end scan.
+    func testVertexCacheDeadEndFromFirstVertex() {
+        let indices: [UInt32] = [1, 2, 3, 0, 0, 0]
+        let optimized = MeshOptimizer.optimizeVertexCache(indices: indices, vertexCount: 4)
+        XCTAssertEqual(sortedTriangles(optimized), sortedTriangles(indices))
+    }
+
+    func testOverdrawOptimization() {
+        let (indices, positions) = makeGrid(100)
+        let optimized = MeshOptimizer.optimizeOverdraw(indices: indices, positions: positions)
+        XCTAssertEqual(sortedTriangles(optimized), sortedTriangles(indices))
+
+        let before = MeshOptimizer.analyzeVertexCache(indices: indices, vertexCount: positions.count)
+        let after = MeshOptimizer.analyzeVertexCache(indices: optimized, vertexCount: positions.count)
+        XCTAssertLessThan(after.acmr, before.acmr)
+    }
+
+    func testVertexFetchAndWeld() {
+        let (indices, positions) = makeGrid(64)
+        let stride = MemoryLayout<Float3>.stride
+        // unwelded: three vertices per triangle.
+        let flat = indices.map { positions[Int($0)].float3 }
+        let flatIndices = (0..<UInt32(flat.count)).map { $0 }
+
+        let welded = flat.withUnsafeBytes {
+            MeshOptimizer.weldVertices(indices: flatIndices, vertices: $0, vertexStride: stride)
+        }
+        XCTAssertEqual(welded.vertexCount, positions.count)
+        for (i, index) in welded.indices.enumerated() {
+            let p = welded.vertices.withUnsafeBytes {
+                $0.load(fromByteOffset: Int(index) * stride, as: Float3.self)
+            }
+            XCTAssertEqual(p.0, flat[i].0)
+            XCTAssertEqual(p.1, flat[i].1)
+            XCTAssertEqual(p.2, flat[i].2)
+        }
+
+        let cacheOptimized = MeshOptimizer.optimizeVertexCache(indices: welded.indices,
+                                                               vertexCount: welded.vertexCount)
+        let before = MeshOptimizer.analyzeVertexFetch(indices: cacheOptimized,
+                                                      vertexCount: welded.vertexCount,
+                                                      vertexStride: stride)
+        let fetch = welded.vertices.withUnsafeBytes {
+            MeshOptimizer.optimizeVertexFetch(indices: cacheOptimized, vertices: $0, vertexStride: stride)
+        }
+        XCTAssertEqual(fetch.vertexCount, welded.vertexCount)
+        XCTAssertEqual(MeshOptimizer.analyzeVertexCache(indices: fetch.indices, vertexCount: fetch.vertexCount).acmr,
+                       MeshOptimizer.analyzeVertexCache(indices: cacheOptimized, vertexCount: welded.vertexCount).acmr)
+        let after = MeshOptimizer.analyzeVertexFetch(indices: fetch.indices,
+                                                     vertexCount: fetch.vertexCount,
+                                                     vertexStride: stride)
+        XCTAssertLessThanOrEqual(after.overfetch, before.overfetch)
+        print("Vertex fetch overfetch \(before.overfetch) -> \(after.overfetch)")
+    }
+}
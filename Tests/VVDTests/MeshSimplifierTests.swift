@@ -0,0 +1,247 @@
+import XCTest
+import Foundation
+@testable import VVD
+
+final class MeshSimplifierTests: XCTestCase {
+    // n x n quad grid with waves along x and y.
+    func makeGrid(_ n: Int, amplitude: Scalar = 2) -> (indices: [UInt32], positions: [Vector3]) {
+        var positions: [Vector3] = []
+        for y in 0...n {
+            for x in 0...n {
+                positions.append(Vector3(Scalar(x), Scalar(y), (sin(Scalar(x) * 0.3) + cos(Scalar(y) * 0.2)) * amplitude))
+            }
+        }
+        var indices: [UInt32] = []
+        for y in 0..<n {
+            for x in 0..<n {
+                let i = UInt32(y * (n + 1) + x)
+                let j = i + UInt32(n + 1)
+                indices += [i, i + 1, j, i + 1, j + 1, j]
+            }
+        }
+        return (indices, positions)
+    }
+
+    // unit uv sphere, the u = 0 and u = 1 columns are separate vertices
+    // at the same positions, forming a uv seam.
+    func makeSphere(slices: Int, stacks: Int) -> (indices: [UInt32], positions: [Vector3], normals: [Vector3], uvs: [Vector2]) {
+        var positions: [Vector3] = []
+        var uvs: [Vector2] = []
+        for r in 0...stacks {
+            let theta = Scalar.pi * Scalar(r) / Scalar(stacks)
+            for s in 0...slices {
+                let phi = 2.0 * Scalar.pi * Scalar(s) / Scalar(slices)
+                if s == slices {
+                    positions.append(positions[r * (slices + 1)])
+                } else {
+                    positions.append(Vector3(sin(theta) * cos(phi), sin(theta) * sin(phi), cos(theta)))
+                }
+                uvs.append(Vector2(Scalar(s) / Scalar(slices), Scalar(r) / Scalar(stacks)))
+            }
+        }
+        var indices: [UInt32] = []
+        for r in 0..<stacks {
+            for s in 0..<slices {
+                let i = UInt32(r * (slices + 1) + s)
+                let j = i + UInt32(slices + 1)
+                if r != 0 { indices += [i, j, i + 1] }
+                if r != stacks - 1 { indices += [i + 1, j, j + 1] }
+            }
+        }
+        return (indices, positions, positions, uvs)
+    }
+
+    func testGridReduction() {
+        let n = 64
+        let (indices, positions) = makeGrid(n)
+        let target = indices.count / 4
+        let result = MeshSimplifier.simplify(indices: indices, positions: positions, targetIndexCount: target)
+        XCTAssertLessThanOrEqual(result.indices.count, target)
+        XCTAssertGreaterThan(result.indices.count, 0)
+        XCTAssertGreaterThan(result.error, 0)
+        XCTAssertLessThan(result.error, 0.1)
+
+        // corners stay in place, held by the boundary quadrics.
+        let used = Set(result.indices)
+        for corner in [0, n, n * (n + 1), (n + 1) * (n + 1) - 1] {
+            XCTAssertTrue(used.contains(UInt32(corner)))
+        }
+
+        // a flat grid simplifies to two triangles without error.
+        let flat = makeGrid(n, amplitude: 0)
+        let plane = MeshSimplifier.simplify(indices: flat.indices, positions: flat.positions,
+                                            targetIndexCount: 0, targetError: 1.0e-6)
+        XCTAssertEqual(plane.indices.count, 6)
+        XCTAssertEqual(plane.error, 0, accuracy: 1.0e-6)
+
+        // stops at the target error.
+        let bounded = MeshSimplifier.simplify(indices: indices, positions: positions,
+                                              targetIndexCount: 0, targetError: 0.05)
+        XCTAssertLessThanOrEqual(bounded.error, 0.05)
+        XCTAssertGreaterThan(bounded.indices.count, 6)
+        XCTAssertLessThan(bounded.indices.count, indices.count)
+    }
+
+    func testSeamPreserved() {
+        let slices = 32, stacks = 16
+        let sphere = makeSphere(slices: slices, stacks: stacks)
+        for reduction in [2, 4, 8] {
+            let target = sphere.indices.count / reduction
+            let result = MeshSimplifier.simplify(indices: sphere.indices,
+                                                 positions: sphere.positions,
+                                                 normals: sphere.normals,
+                                                 uvs: sphere.uvs,
+                                                 targetIndexCount: target)
+            XCTAssertLessThanOrEqual(result.indices.count, target)
+
+            // both sides of the seam are kept or removed together,
+            // and no triangle spans the seam in uv space.
+            let used = Set(result.indices)
+            for r in 1..<stacks {
+                let u0 = UInt32(r * (slices + 1)), u1 = u0 + UInt32(slices)
+                XCTAssertEqual(used.contains(u0), used.contains(u1))
+            }
+            var deviation: Scalar = 0
+            for t in stride(from: 0, to: result.indices.count, by: 3) {
+                let v = (0..<3).map { Int(result.indices[t + $0]) }
+                let u = v.map { sphere.uvs[$0].x }
+                XCTAssertLessThan(u.max()! - u.min()!, 0.5)
+
+                let centroid = (sphere.positions[v[0]] + sphere.positions[v[1]] + sphere.positions[v[2]]) / 3.0
+                deviation = max(deviation, 1.0 - centroid.length)
+            }
+            // the error is an estimate, from the quadrics of the collapsed vertices.
+            XCTAssertLessThanOrEqual(deviation, result.error * 1.5)
+            print("Sphere \(sphere.indices.count / 3) -> \(result.indices.count / 3) triangles, error: \(result.error), deviation: \(deviation)")
+        }
+    }
+
+    func testLODChainAndSelection() {
+        let (indices, positions) = makeGrid(64)
+        let levels = MeshSimplifier.generateLODChain(indices: indices, positions: positions, maxLevels: 4)
+        XCTAssertEqual(levels.count, 4)
+        var count = indices.count
+        var error: Scalar = 0
+        for level in levels {
+            XCTAssertLessThanOrEqual(level.indices.count * 10, count * 9)
+            XCTAssertGreaterThanOrEqual(level.error, error)
+            count = level.indices.count
+            error = level.error
+        }
+
+        let mesh = Mesh()
+        mesh.aabb = AABB(min: Vector3(0, 0, -2), max: Vector3(64, 64, 2))
+        mesh.lods = levels.map {
+            Mesh.LOD(indexBuffer: HostBuffer(), indexCount: $0.indices.count, error: $0.error)
+        }
+        let selector = LODSelector(viewPosition: Vector3(32, 32, 100),
+                                   fov: (60.0).degreeToRadian(),
+                                   viewportHeight: 1080)
+        // coarser levels as the mesh moves away.
+        var previous = 0
+        for distance in [0.0, 100.0, 1000.0, 10000.0, 100000.0] {
+            let lod = selector.lod(for: mesh, distance: distance)
+            XCTAssertGreaterThanOrEqual(lod, previous)
+            if lod > 0 {
+                XCTAssertLessThanOrEqual(selector.projectedError(mesh.lods[lod - 1].error, distance: distance), 1.0)
+            }
+            previous = lod
+        }
+        XCTAssertEqual(selector.lod(for: mesh, distance: 0), 0)
+        XCTAssertEqual(selector.lod(for: mesh, distance: 1.0e+9), levels.count)
+        // distance to the bounding sphere, scaled by the transform.
+        let radius = mesh.aabb.extents.length * 0.5
+        XCTAssertEqual(selector.lod(for: mesh, transform: .identity),
+                       selector.lod(for: mesh, distance: 100 - radius))
+        let scaled = AffineTransform3.identity.scaled(by: Vector3(4, 4, 4)).matrix4
+        XCTAssertEqual(selector.lod(for: mesh, transform: scaled), 0)     // viewer inside the bounds
+        XCTAssertEqual(selector.lod(for: mesh, transform: AffineTransform3(origin: Vector3(0, 0, -1.0e+9)).matrix4),
+                       levels.count)
+    }
+
+    // Duck.glb of the RenderTest resources, position, normal and uv of the
+    // first primitive. nil if the file is a git-lfs pointer or missing.
+    func loadDuck() -> (indices: [UInt32], positions: [Vector3], normals: [Vector3], uvs: [Vector2])? {
+        let path = URL(fileURLWithPath: #filePath)
+            .deletingLastPathComponent().deletingLastPathComponent().deletingLastPathComponent()
+            .appendingPathComponent("Sources/RenderTest/Resources/glTF/Duck/glTF-Binary/Duck.glb")
+        guard let data = try? Data(contentsOf: path), data.count > 20,
+              data.prefix(4) == Data("glTF".utf8)
+        else { return nil }
+
+        func u32(_ offset: Int) -> Int {
+            data.withUnsafeBytes { Int($0.loadUnaligned(fromByteOffset: offset, as: UInt32.self)) }
+        }
+        let jsonLength = u32(12)
+        let binOffset = 20 + jsonLength + 8
+        guard let json = try? JSONSerialization.jsonObject(with: data[20..<(20 + jsonLength)]) as? [String: Any],
+              let meshes = json["meshes"] as? [[String: Any]],
+              let primitive = (meshes.first?["primitives"] as? [[String: Any]])?.first,
+              let attributes = primitive["attributes"] as? [String: Int],
+              let accessors = json["accessors"] as? [[String: Any]],
+              let bufferViews = json["bufferViews"] as? [[String: Any]]
+        else { return nil }
+
+        // returns (byte offset in the file, stride, count, component type)
+        func accessor(_ index: Int) -> (Int, Int, Int, Int) {
+            let accessor = accessors[index]
+            let view = bufferViews[accessor["bufferView"] as! Int]
+            let offset = binOffset + (view["byteOffset"] as? Int ?? 0) + (accessor["byteOffset"] as? Int ?? 0)
+            return (offset, view["byteStride"] as? Int ?? 0, accessor["count"] as! Int, accessor["componentType"] as! Int)
+        }
+        func floats(_ index: Int?, _ components: Int) -> [[Scalar]] {
+            guard let index else { return [] }
+            let (offset, stride, count, _) = accessor(index)
+            let step = stride > 0 ? stride : components * 4
+            return data.withUnsafeBytes { p in
+                (0..<count).map { i in
+                    (0..<components).map {
+                        Scalar(p.loadUnaligned(fromByteOffset: offset + i * step + $0 * 4, as: Float32.self))
+                    }
+                }
+            }
+        }
+        guard let indexAccessor = primitive["indices"] as? Int else { return nil }
+        let (offset, _, count, type) = accessor(indexAccessor)
+        let indices: [UInt32] = data.withUnsafeBytes { p in
+            (0..<count).map {
+                type == 5125 ? p.loadUnaligned(fromByteOffset: offset + $0 * 4, as: UInt32.self)
+                             : UInt32(p.loadUnaligned(fromByteOffset: offset + $0 * 2, as: UInt16.self))
+            }
+        }
+        let positions = floats(attributes["POSITION"], 3).map { Vector3($0[0], $0[1], $0[2]) }
+        let normals = floats(attributes["NORMAL"], 3).map { Vector3($0[0], $0[1], $0[2]) }
+        let uvs = floats(attributes["TEXCOORD_0"], 2).map { Vector2($0[0], $0[1]) }
+        return (indices, positions, normals, uvs)
+    }
+
+    func testGLTFSampleLODChain() throws {
+        guard let duck = loadDuck() else {
+            throw XCTSkip("Duck.glb is not available (git-lfs)")
+        }
+        var bounds = AABB.null
+        duck.positions.forEach { bounds.expand($0) }
+        let extent = bounds.extents.length
+
+        let start = DispatchTime.now().uptimeNanoseconds
+        let levels = MeshSimplifier.generateLODChain(indices: duck.indices,
+                                                     positions: duck.positions,
+                                                     normals: duck.normals.isEmpty ? nil : duck.normals,
+                                                     uvs: duck.uvs.isEmpty ? nil : duck.uvs)
+        let elapsed = Double(DispatchTime.now().uptimeNanoseconds - start) * 0.000_001
+
+        XCTAssertGreaterThanOrEqual(levels.count, 2)
+        var count = duck.indices.count
+        var error: Scalar = 0
+        for level in levels {
+            XCTAssertLessThanOrEqual(level.indices.count * 10, count * 9)
+            XCTAssertGreaterThanOrEqual(level.error, error)
+            XCTAssertTrue(level.indices.allSatisfy { Int($0) < duck.positions.count })
+            count = level.indices.count
+            error = level.error
+        }
+        // half of the triangles within 5% of the mesh size.
+        XCTAssertLessThan(levels[0].error, extent * 0.05)
+        print("Duck LOD triangles: \([duck.indices.count / 3] + levels.map { $0.indices.count / 3 }), errors: \(levels.map { $0.error / extent }) (relative), \(elapsed) ms")
+    }
+}
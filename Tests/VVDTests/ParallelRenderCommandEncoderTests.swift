@@ -0,0 +1,127 @@
+#if os(Linux) || os(Windows) || os(Android)
+import XCTest
+import Foundation
+@testable import VVD
+
+final class ParallelRenderCommandEncoderTests: XCTestCase {
+    struct Target {
+        let queue: CommandQueue
+        let renderPass: RenderPassDescriptor
+        let pipeline: TestPipeline
+    }
+
+    // runs on any Vulkan device, including lavapipe.
+    func makeTarget() throws -> Target {
+        guard let context = GraphicsDeviceContext.makeDefault(),
+              let queue = context.renderQueue() else {
+            throw XCTSkip("No graphics device available.")
+        }
+        let desc = TextureDescriptor(textureType: .type2D, pixelFormat: .rgba8Unorm,
+                                     width: 256, height: 256, usage: [.renderTarget])
+        guard let texture = context.device.makeTexture(descriptor: desc) else {
+            throw XCTSkip("Failed to create render target.")
+        }
+        guard let pipeline = TestPipeline(device: context.device, colorFormat: .rgba8Unorm) else {
+            throw XCTSkip("Failed to create render pipeline.")
+        }
+        let renderPass = RenderPassDescriptor(colorAttachments: [
+            RenderPassColorAttachmentDescriptor(renderTarget: texture,
+                                                loadAction: .clear,
+                                                storeAction: .store)])
+        return Target(queue: queue, renderPass: renderPass, pipeline: pipeline)
+    }
+
+    // a vertex buffer bind per draw, a cull mode change per 16 draws.
+    func record(_ encoder: RenderCommandEncoder, pipeline: TestPipeline, draws: Range<Int>) {
+        let triangleSize = MemoryLayout<Float2>.stride * 3
+        encoder.setRenderPipelineState(pipeline.state)
+        for i in draws {
+            if i % 16 == 0 {
+                encoder.setCullMode(i % 32 == 0 ? .back : .none)
+            }
+            encoder.setVertexBuffer(pipeline.vertexBuffer,
+                                    offset: (i % TestPipeline.numTriangles) * triangleSize,
+                                    index: 0)
+            encoder.draw(vertexStart: 0, vertexCount: 3, instanceCount: 1, baseInstance: 0)
+        }
+        encoder.endEncoding()
+    }
+
+    // commits and returns the time spent in commit(), which replays the recorded
+    // commands into the Vulkan command buffer, and the time until completion.
+    func commitAndWait(_ commandBuffer: CommandBuffer) -> (commit: Double, completion: Double)? {
+        let completed = DispatchSemaphore(value: 0)
+        commandBuffer.addCompletedHandler { _ in completed.signal() }
+        let start = DispatchTime.now().uptimeNanoseconds
+        guard commandBuffer.commit() else { return nil }
+        let committed = DispatchTime.now().uptimeNanoseconds
+        guard completed.wait(timeout: .now() + 30.0) == .success else { return nil }
+        let end = DispatchTime.now().uptimeNanoseconds
+        return (Double(committed - start) * 0.000_001, Double(end - committed) * 0.000_001)
+    }
+
+    func testChildEncoders() throws {
+        let target = try makeTarget()
+        let commandBuffer = try XCTUnwrap(target.queue.makeCommandBuffer())
+        let encoder = try XCTUnwrap(commandBuffer.makeParallelRenderCommandEncoder(descriptor: target.renderPass))
+        XCTAssertEqual(commandBuffer.status, .encoding)
+
+        let children = (0..<4).compactMap { _ in encoder.makeRenderCommandEncoder() }
+        XCTAssertEqual(children.count, 4)
+        // ended out of order, executed in creation order.
+        for child in children.reversed() {
+            record(child, pipeline: target.pipeline, draws: 0..<10)
+            XCTAssertTrue(child.isCompleted)
+        }
+        encoder.endEncoding()
+        XCTAssertTrue(encoder.isCompleted)
+        XCTAssertEqual(commandBuffer.status, .ready)
+        XCTAssertNil(encoder.makeRenderCommandEncoder())
+        XCTAssertNotNil(commitAndWait(commandBuffer))
+    }
+
+    // 100k draws recorded with 1...N threads.
+    func testRecordingScaling100kDraws() throws {
+        let target = try makeTarget()
+        let numDraws = 100_000
+        let frames = 5
+
+        var threadCounts: [Int] = []
+        var n = 1
+        while n < ProcessInfo.processInfo.activeProcessorCount {
+            threadCounts.append(n)
+            n *= 2
+        }
+        threadCounts.append(ProcessInfo.processInfo.activeProcessorCount)
+
+        var baseline = 0.0
+        for numThreads in threadCounts {
+            var elapsed = 0.0
+            var replay = 0.0
+            var completion = 0.0
+            for _ in 0..<frames {
+                let commandBuffer = try XCTUnwrap(target.queue.makeCommandBuffer())
+                let encoder = try XCTUnwrap(commandBuffer.makeParallelRenderCommandEncoder(descriptor: target.renderPass))
+
+                let start = DispatchTime.now().uptimeNanoseconds
+                let children = (0..<numThreads).compactMap { _ in encoder.makeRenderCommandEncoder() }
+                XCTAssertEqual(children.count, numThreads)
+                DispatchQueue.concurrentPerform(iterations: numThreads) { t in
+                    let first = numDraws * t / numThreads
+                    let last = numDraws * (t + 1) / numThreads
+                    record(children[t], pipeline: target.pipeline, draws: first..<last)
+                }
+                encoder.endEncoding()
+                elapsed += Double(DispatchTime.now().uptimeNanoseconds - start) * 0.000_001
+
+                let times = try XCTUnwrap(commitAndWait(commandBuffer))
+                replay += times.commit
+                completion += times.completion
+            }
+            let frameTime = elapsed / Double(frames)
+            if numThreads == 1 { baseline = frameTime }
+            print("\(numDraws) draws, \(numThreads) thread(s): record \(String(format: "%.2f", frameTime)) ms/frame, x\(String(format: "%.2f", baseline / frameTime)), replay \(String(format: "%.2f", replay / Double(frames))) ms, GPU \(String(format: "%.2f", completion / Double(frames))) ms")
+        }
+    }
+}
+#endif
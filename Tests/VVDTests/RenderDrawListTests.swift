@@ -0,0 +1,192 @@
+import XCTest
+import Foundation
+@testable import VVD
+
+final class RenderDrawListTests: XCTestCase {
+    final class Pipeline: RenderPipelineState {
+        var device: GraphicsDevice { fatalError("not available") }
+    }
+
+    struct VertexFunction: ShaderFunction {
+        var stageInputAttributes: [ShaderAttribute] {
+            [ShaderAttribute(name: "position", location: 0, type: .float3, enabled: true)]
+        }
+        var functionConstants: [String: ShaderFunctionConstant] { [:] }
+        var functionName: String { "main" }
+        var stage: ShaderStage { .vertex }
+        var device: GraphicsDevice { fatalError("not available") }
+    }
+
+    final class BindingSet: ShaderBindingSet {
+        private(set) var version: UInt64 = 0
+        func setBuffer(_: GPUBuffer, offset: Int, length: Int, binding: Int) { version += 1 }
+        func setBufferArray(_: [BufferBindingInfo], binding: Int) { version += 1 }
+        func setTexture(_: Texture, binding: Int) { version += 1 }
+        func setTextureArray(_: [Texture], binding: Int) { version += 1 }
+        func setSamplerState(_: SamplerState, binding: Int) { version += 1 }
+        func setSamplerStateArray(_: [SamplerState], binding: Int) { version += 1 }
+        var device: GraphicsDevice { fatalError("not available") }
+    }
+
+    // Counts binds reaching the encoder, filtered the same way as the backends.
+    final class CountingEncoder: RenderCommandEncoder {
+        var shadowState = RenderCommandEncoderShadowState()
+        let filter: Bool
+        var binds = 0
+        var draws = 0
+
+        init(filter: Bool) { self.filter = filter }
+
+        private func bind(_ changed: Bool) {
+            if changed || filter == false { binds += 1 }
+        }
+
+        func setResource(_ bindingSet: ShaderBindingSet, index: Int) {
+            let version = (bindingSet as? BindingSet)?.version ?? 0
+            bind(shadowState.setResource(bindingSet as AnyObject, version: version, index: index))
+        }
+        func setViewport(_: Viewport) {}
+        func setScissorRect(_: ScissorRect) {}
+        func setRenderPipelineState(_ pso: RenderPipelineState) {
+            bind(shadowState.setRenderPipelineState(pso as AnyObject))
+        }
+        func setVertexBuffer(_ buffer: GPUBuffer, offset: Int, index: Int) {
+            bind(shadowState.setVertexBuffer(buffer, offset: offset, index: index))
+        }
+        func setVertexBuffers(_ buffers: [GPUBuffer], offsets: [Int], index: Int) {
+            bind(shadowState.setVertexBuffers(buffers, offsets: offsets, index: index))
+        }
+        func setDepthStencilState(_: DepthStencilState?) {}
+        func setDepthClipMode(_: DepthClipMode) {}
+        func setCullMode(_ mode: CullMode) { bind(shadowState.setCullMode(mode)) }
+        func setFrontFacing(_ winding: Winding) { bind(shadowState.setFrontFacing(winding)) }
+        func setBlendColor(red: Float, green: Float, blue: Float, alpha: Float) {}
+        func setStencilReferenceValue(_: UInt32) {}
+        func setStencilReferenceValues(front: UInt32, back: UInt32) {}
+        func setDepthBias(_ depthBias: Float, slopeScale: Float, clamp: Float) {}
+        func pushConstant<D: DataProtocol>(stages: ShaderStageFlags, offset: Int, data: D) {}
+        func memoryBarrier(after: RenderStages, before: RenderStages) {}
+        func draw(vertexStart: Int, vertexCount: Int, instanceCount: Int, baseInstance: Int) { draws += 1 }
+        func drawIndexed(indexCount: Int, indexType: IndexType, indexBuffer: GPUBuffer, indexBufferOffset: Int,
+                         instanceCount: Int, baseVertex: Int, baseInstance: Int) { draws += 1 }
+
+        func endEncoding() {}
+        var isCompleted: Bool { false }
+        func waitEvent(_: GPUEvent) {}
+        func signalEvent(_: GPUEvent) {}
+        func waitSemaphoreValue(_: GPUSemaphore, value: UInt64) {}
+        func signalSemaphoreValue(_: GPUSemaphore, value: UInt64) {}
+        var commandBuffer: CommandBuffer { fatalError("not available") }
+    }
+
+    // 8 pipelines, 32 materials, 64 vertex buffers, 4000 meshes in random order.
+    func makeScene() -> [Mesh] {
+        var rng = SystemRandomNumberGenerator()
+        let pipelines = (0..<8).map { _ in Pipeline() }
+        let materials = (0..<32).map { i in
+            let material = Material(shaderMap: MaterialShaderMap(
+                functions: [.init(function: VertexFunction(), descriptors: [])],
+                resourceSemantics: [:],
+                inputAttributeSemantics: [0: .position]))
+            material.cullMode = i % 2 == 0 ? .back : .none
+            material.frontFace = i % 3 == 0 ? .clockwise : .counterClockwise
+            return material
+        }
+        let buffers = (0..<64).map { _ in HostBuffer() }
+        return (0..<4000).map { _ in
+            let m = Int.random(in: 0..<materials.count, using: &rng)
+            let mesh = Mesh()
+            mesh.material = materials[m]
+            mesh.pipelineState = pipelines[m % pipelines.count]
+            mesh.vertexBuffers = [
+                Mesh.VertexBuffer(byteOffset: 0, byteStride: 12, vertexCount: 3,
+                                  buffer: buffers[Int.random(in: 0..<buffers.count, using: &rng)],
+                                  attributes: [.init(semantic: .position, format: .float3,
+                                                     offset: 0, name: "position")])
+            ]
+            return mesh
+        }
+    }
+
+    func testDrawListSortAndBindCounts() {
+        let meshes = makeScene()
+
+        func run(sorted: Bool, filter: Bool) -> CountingEncoder {
+            let encoder = CountingEncoder(filter: filter)
+            if sorted {
+                var list = RenderDrawList()
+                meshes.forEach { list.append($0) }
+                XCTAssertEqual(list.encode(encoder: encoder), meshes.count)
+            } else {
+                meshes.forEach { _ = $0.encodeRenderCommand(encoder: encoder) }
+            }
+            XCTAssertEqual(encoder.draws, meshes.count)
+            return encoder
+        }
+
+        let unfiltered = run(sorted: false, filter: false)
+        let filtered = run(sorted: false, filter: true)
+        let sorted = run(sorted: true, filter: true)
+        XCTAssertLessThan(filtered.binds, unfiltered.binds)
+        XCTAssertLessThan(sorted.binds, filtered.binds)
+
+        print("RenderDrawList \(meshes.count) meshes, binds: unfiltered \(unfiltered.binds), filtered \(filtered.binds), sorted+filtered \(sorted.binds)")
+    }
+
+    func testDrawListKeepsSubmissionOrderForEqualKeys() {
+        let pipeline = Pipeline()
+        let material = Material(shaderMap: MaterialShaderMap(functions: [],
+                                                             resourceSemantics: [:],
+                                                             inputAttributeSemantics: [:]))
+        let meshes = (0..<16).map { _ in
+            let mesh = Mesh()
+            mesh.material = material
+            mesh.pipelineState = pipeline
+            return mesh
+        }
+        var list = RenderDrawList()
+        meshes.forEach { list.append($0) }
+        list.sort()
+        XCTAssertTrue(zip(list.items, meshes).allSatisfy { $0.mesh === $1 })
+    }
+
+    func testResourceBindFiltering() {
+        let encoder = CountingEncoder(filter: true)
+        let pipeline = Pipeline()
+        let bindingSet = BindingSet()
+        encoder.setRenderPipelineState(pipeline)
+        encoder.setResource(bindingSet, index: 0)
+        XCTAssertEqual(encoder.binds, 2)
+
+        // the same set rebound without changes.
+        encoder.setResource(bindingSet, index: 0)
+        encoder.setResource(bindingSet, index: 0)
+        XCTAssertEqual(encoder.binds, 2)
+
+        // another index, then a change of the contents.
+        encoder.setResource(bindingSet, index: 1)
+        XCTAssertEqual(encoder.binds, 3)
+        bindingSet.setBuffer(HostBuffer(), offset: 0, length: 16, binding: 0)
+        encoder.setResource(bindingSet, index: 0)
+        XCTAssertEqual(encoder.binds, 4)
+        encoder.setResource(bindingSet, index: 0)
+        XCTAssertEqual(encoder.binds, 4)
+
+        // a pipeline change invalidates the resources.
+        encoder.setRenderPipelineState(Pipeline())
+        encoder.setResource(bindingSet, index: 0)
+        XCTAssertEqual(encoder.binds, 6)
+        XCTAssertEqual(encoder.shadowState.statistics.skipped, 3)
+    }
+
+    func testResourceBindOfNewSetsWithEqualVersions() {
+        let encoder = CountingEncoder(filter: true)
+        encoder.setRenderPipelineState(Pipeline())
+        // sets released after binding may be allocated at the same address,
+        // each of them must be bound.
+        for _ in 0..<100 {
+            encoder.setResource(BindingSet(), index: 0)
+        }
+        XCTAssertEqual(encoder.binds, 101)
+    }
+}
@@ -0,0 +1,182 @@
+import XCTest
+import Foundation
+@testable import VVD
+
+final class SIMDMathTests: XCTestCase {
+    func randomMatrix(using rng: inout some RandomNumberGenerator) -> Matrix4 {
+        let q = Quaternion(angle: Scalar.random(in: -.pi ... .pi, using: &rng),
+                           axis: Vector3(Scalar.random(in: -1...1, using: &rng),
+                                         Scalar.random(in: -1...1, using: &rng), 1))
+        let s = AffineTransform3.identity.scaled(by: Vector3(Scalar.random(in: 0.5...2, using: &rng),
+                                                             Scalar.random(in: 0.5...2, using: &rng),
+                                                             Scalar.random(in: 0.5...2, using: &rng)))
+        var m = s.matrix4.concatenating(q.matrix4)
+        m.m41 = Scalar.random(in: -10...10, using: &rng)
+        m.m42 = Scalar.random(in: -10...10, using: &rng)
+        m.m43 = Scalar.random(in: -10...10, using: &rng)
+        return m
+    }
+
+    func assertEqual(_ a: Matrix4f, _ b: Matrix4, accuracy: Float32 = 0.001,
+                     file: StaticString = #filePath, line: UInt = #line) {
+        for r in 0..<4 {
+            for c in 0..<4 {
+                XCTAssertEqual(a[r, c], Float32(b[r, c]), accuracy: accuracy, file: file, line: line)
+            }
+        }
+    }
+
+    func testConversionAndLayout() {
+        XCTAssertEqual(MemoryLayout<Matrix4f>.size, MemoryLayout<Float4x4>.size)
+        XCTAssertEqual(MemoryLayout<Vector4f>.size, MemoryLayout<Float4>.size)
+        // Vector3f is padded, packed data uses Float3.
+        XCTAssertEqual(MemoryLayout<Vector3f>.stride, 16)
+        XCTAssertEqual(MemoryLayout<Float3>.stride, 12)
+
+        var rng = SystemRandomNumberGenerator()
+        let m = randomMatrix(using: &rng)
+        let f = Matrix4f(m)
+        assertEqual(f, m, accuracy: 0)
+        assertEqual(Matrix4f(f.float4x4), Matrix4(m.float4x4), accuracy: 0)
+        assertEqual(Matrix4f(f.float4x4), f.matrix4, accuracy: 0)
+    }
+
+    func testMatrixOperations() {
+        var rng = SystemRandomNumberGenerator()
+        for _ in 0..<100 {
+            let a = randomMatrix(using: &rng)
+            let b = randomMatrix(using: &rng)
+            assertEqual(Matrix4f(a).concatenating(Matrix4f(b)), a.concatenating(b))
+            assertEqual(Matrix4f(a).transposed(), a.transposed())
+            XCTAssertEqual(Matrix4f(a).determinant, Float32(a.determinant), accuracy: 0.01)
+            assertEqual(Matrix4f(a).inverted()!, a.inverted()!)
+
+            let p = Vector3(Scalar.random(in: -5...5, using: &rng), 1, 2)
+            let v = Vector3f(p).applying(Matrix4f(a))
+            let expected = p.applying(a)
+            XCTAssertEqual(v.x, Float32(expected.x), accuracy: 0.001)
+            XCTAssertEqual(v.y, Float32(expected.y), accuracy: 0.001)
+            XCTAssertEqual(v.z, Float32(expected.z), accuracy: 0.001)
+        }
+        XCTAssertNil(Matrix4f(r1: .zero, r2: .zero, r3: .zero, r4: .zero).inverted())
+    }
+
+    func testQuaternion() {
+        let q1 = Quaternion(angle: 0.7, axis: Vector3(1, 2, 3))
+        let q2 = Quaternion(angle: -1.3, axis: Vector3(0, 1, 0))
+        let q = Quaternionf(q1).concatenating(Quaternionf(q2))
+        let expected = q1.concatenating(q2)
+        XCTAssertEqual(q.x, Float32(expected.x), accuracy: 0.0001)
+        XCTAssertEqual(q.y, Float32(expected.y), accuracy: 0.0001)
+        XCTAssertEqual(q.z, Float32(expected.z), accuracy: 0.0001)
+        XCTAssertEqual(q.w, Float32(expected.w), accuracy: 0.0001)
+        assertEqual(q.matrix4, expected.matrix4)
+
+        let v = Vector3f(1, 2, 3).applying(q)
+        let ev = Vector3(1, 2, 3).applying(expected)
+        XCTAssertEqual(v.x, Float32(ev.x), accuracy: 0.0001)
+        XCTAssertEqual(v.y, Float32(ev.y), accuracy: 0.0001)
+        XCTAssertEqual(v.z, Float32(ev.z), accuracy: 0.0001)
+    }
+
+    // Float64 scalar types vs. Float32 SIMD types.
+    func testPackedKernels() {
+        var rng = SystemRandomNumberGenerator()
+        let m = Matrix4f(randomMatrix(using: &rng))
+        let points = (0..<100).map { _ in
+            Vector3f(Float32.random(in: -5...5, using: &rng),
+                     Float32.random(in: -5...5, using: &rng),
+                     Float32.random(in: -5...5, using: &rng))
+        }
+        var packed = [Float32](repeating: 0, count: points.count * 3)
+        packed.withUnsafeMutableBytes { buffer in
+            points.withUnsafeBufferPointer { Vector3f.store($0, to: buffer.baseAddress!) }
+        }
+        XCTAssertEqual(packed, points.flatMap { [$0.x, $0.y, $0.z] })
+
+        let expectedPoints = m.transform(points: points)
+        let expectedVectors = [Vector3f](unsafeUninitializedCapacity: points.count) { buffer, count in
+            points.withUnsafeBufferPointer { m.transform(vectors: $0, into: buffer) }
+            count = points.count
+        }
+        var float3 = points.map(\.float3)
+        var output = [Float3](repeating: (0, 0, 0), count: points.count)
+        float3.withUnsafeBufferPointer { src in
+            output.withUnsafeMutableBufferPointer { m.transform(points: src, into: $0) }
+        }
+        for (v, p) in zip(output, expectedPoints) {
+            XCTAssertEqual(Vector3f(v), p)
+        }
+        // in place
+        float3.withUnsafeMutableBufferPointer { buffer in
+            m.transform(vectors: UnsafeBufferPointer(buffer), into: buffer)
+        }
+        for (v, p) in zip(float3, expectedVectors) {
+            XCTAssertEqual(Vector3f(v), p)
+        }
+    }
+
+    func testBenchmark() {
+        let count = 1_000_000
+        var rng = SystemRandomNumberGenerator()
+        let matrices = (0..<64).map { _ in randomMatrix(using: &rng) }
+        let matricesf = matrices.map { Matrix4f($0) }
+        let points = (0..<count).map { i in Vector3(Scalar(i % 100), 1, Scalar(i % 7)) }
+        let pointsf = points.map { Vector3f($0) }
+
+        func measure(_ name: String, _ body: () -> Float32) -> Double {
+            let start = DispatchTime.now().uptimeNanoseconds
+            let result = body()
+            let elapsed = Double(DispatchTime.now().uptimeNanoseconds - start) * 0.000_001
+            XCTAssertFalse(result.isNaN, name)
+            return elapsed
+        }
+
+        var results: [String] = []
+        func compare(_ name: String, _ scalar: () -> Float32, _ simd: () -> Float32) {
+            let t1 = measure(name, scalar)
+            let t2 = measure(name, simd)
+            results.append("\(name): Matrix4 \(t1) ms, Matrix4f \(t2) ms")
+        }
+
+        compare("concatenating x\(count)", {
+            var m = Matrix4.identity
+            for i in 0..<count { m = matrices[i & 63].concatenating(m).transposed().transposed() }
+            return Float32(m.m11)
+        }, {
+            var m = Matrix4f.identity
+            for i in 0..<count { m = matricesf[i & 63].concatenating(m).transposed().transposed() }
+            return m.r1.x
+        })
+        compare("inverted x\(count)", {
+            var sum: Scalar = 0
+            for i in 0..<count { sum += matrices[i & 63].inverted()!.m41 }
+            return Float32(sum)
+        }, {
+            var sum: Float32 = 0
+            for i in 0..<count { sum += matricesf[i & 63].inverted()!.r4.x }
+            return sum
+        })
+        compare("transform \(count) points", {
+            let m = matrices[0]
+            let output = points.map { $0.applying(m) }
+            return Float32(output[count - 1].x)
+        }, {
+            let output = matricesf[0].transform(points: pointsf)
+            return output[count - 1].x
+        })
+        compare("upload \(count) matrices", {
+            var buffer = [Float4x4](repeating: Matrix4.identity.float4x4, count: count)
+            for i in 0..<count { buffer[i] = matrices[i & 63].float4x4 }
+            return buffer[count - 1].3.0
+        }, {
+            let source = (0..<count).map { matricesf[$0 & 63] }
+            var buffer = [Float4x4](repeating: Matrix4.identity.float4x4, count: count)
+            buffer.withUnsafeMutableBytes { dst in
+                source.withUnsafeBufferPointer { Matrix4f.store($0, to: dst.baseAddress!) }
+            }
+            return buffer[count - 1].3.0
+        })
+        results.forEach { print($0) }
+    }
+}
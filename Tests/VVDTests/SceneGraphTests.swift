@@ -0,0 +1,145 @@
+import XCTest
+import Foundation
+@testable import VVD
+
+final class SceneGraphTests: XCTestCase {
+    // random tree, `count` nodes, up to `fanout` children per node.
+    func makeNodes(count: Int, fanout: Int) -> [SceneNode] {
+        var rng = SystemRandomNumberGenerator()
+        func randomTransform() -> Transform {
+            Transform(orientation: Quaternion(angle: Scalar.random(in: -.pi ... .pi, using: &rng),
+                                              axis: Vector3(0, 1, 0)),
+                      position: Vector3(Scalar.random(in: -1...1, using: &rng),
+                                        Scalar.random(in: -1...1, using: &rng),
+                                        Scalar.random(in: -1...1, using: &rng)))
+        }
+        var remaining = count
+        func make(depth: Int) -> SceneNode {
+            remaining -= 1
+            var node = SceneNode(name: "node\(remaining)")
+            node.transform = randomTransform()
+            node.scale = Vector3(1, Scalar.random(in: 0.5...2, using: &rng), 1)
+            if depth < 12 {
+                let n = min(Int.random(in: 0...fanout, using: &rng), remaining)
+                for _ in 0..<n where remaining > 0 {
+                    node.children.append(make(depth: depth + 1))
+                }
+            }
+            return node
+        }
+        var nodes: [SceneNode] = []
+        while remaining > 0 {
+            nodes.append(make(depth: 0))
+        }
+        return nodes
+    }
+
+    func referenceMatrices(_ nodes: [SceneNode]) -> [Matrix4] {
+        var result: [Matrix4] = []
+        func visit(_ node: SceneNode, _ parent: Transform) {
+            let world = node.transform.concatenating(parent)
+            result.append(AffineTransform3.identity.scaled(by: node.scale).matrix4
+                .concatenating(world.matrix4))
+            node.children.forEach { visit($0, world) }
+        }
+        nodes.forEach { visit($0, .identity) }
+        return result
+    }
+
+    func assertEqual(_ a: [Matrix4], _ b: [Matrix4], file: StaticString = #filePath, line: UInt = #line) {
+        XCTAssertEqual(a.count, b.count, file: file, line: line)
+        for (m1, m2) in zip(a, b) {
+            for r in 0..<4 {
+                for c in 0..<4 where abs(m1[r, c] - m2[r, c]) > 0.0001 {
+                    XCTFail("matrix mismatch \(m1) != \(m2)", file: file, line: line)
+                    return
+                }
+            }
+        }
+    }
+
+    func testFlattenAndUpdate() {
+        var nodes = makeNodes(count: 2000, fanout: 4)
+        let graph = SceneGraph(nodes: nodes)
+        XCTAssertEqual(graph.count, 2000)
+        XCTAssertFalse(graph.needsUpdate)
+        assertEqual(graph.worldMatrices, referenceMatrices(nodes))
+
+        // pre-order layout: parent before children, subtrees contiguous.
+        for i in 0..<graph.count {
+            let p = graph.parents[i]
+            if p >= 0 {
+                XCTAssertLessThan(p, i)
+                XCTAssertLessThanOrEqual(i + graph.subtreeSizes[i], p + graph.subtreeSizes[p])
+            }
+        }
+
+        // change the first root, only its subtree is updated.
+        nodes[0].transform.position = Vector3(5, 0, 0)
+        graph.setLocalTransform(nodes[0].transform, at: 0)
+        XCTAssertEqual(graph.updateWorldTransforms(), graph.subtreeSizes[0])
+        XCTAssertEqual(graph.updateWorldTransforms(), 0)
+        assertEqual(graph.worldMatrices, referenceMatrices(nodes))
+
+        // splice a node into the first root, not at the end of arrays.
+        var node = SceneNode(name: "inserted")
+        node.transform.position = Vector3(0, 3, 0)
+        node.children = [SceneNode(name: "child")]
+        let index = graph.insert(node, parent: 0)
+        nodes[0].children.append(node)
+        XCTAssertEqual(graph.names[index], "inserted")
+        XCTAssertEqual(graph.parents[index + 1], index)
+        graph.updateWorldTransforms()
+        assertEqual(graph.worldMatrices, referenceMatrices(nodes))
+    }
+
+    func testParallelUpdateMatchesSerial() {
+        let nodes = makeNodes(count: 20_000, fanout: 8)
+        let serial = SceneGraph(nodes: nodes)
+        let parallel = SceneGraph()
+        parallel.parallelUpdateThreshold = 64
+        nodes.forEach { parallel.insert($0) }
+        parallel.updateWorldTransforms()
+        assertEqual(parallel.worldMatrices, serial.worldMatrices)
+    }
+
+    // 100k nodes, all roots animated every frame:
+    // recursive SceneNode traversal vs. flattened graph update.
+    func testUpdate100kNodes() {
+        let numNodes = 100_000
+        let frames = 10
+        var nodes = makeNodes(count: numNodes, fanout: 6)
+        let graph = SceneGraph(nodes: nodes)
+        let roots = (0..<graph.count).filter { graph.parents[$0] < 0 }
+
+        var sum: Scalar = 0
+        var start = DispatchTime.now().uptimeNanoseconds
+        for frame in 0..<frames {
+            for i in 0..<nodes.count {
+                nodes[i].transform.position.x = Scalar(frame)
+            }
+            let matrices = referenceMatrices(nodes)
+            sum += matrices[matrices.count - 1].m41
+        }
+        let recursiveTime = Double(DispatchTime.now().uptimeNanoseconds - start) * 0.000_000_001
+
+        start = DispatchTime.now().uptimeNanoseconds
+        for frame in 0..<frames {
+            for i in roots {
+                var t = graph.localTransforms[i]
+                t.position.x = Scalar(frame)
+                graph.setLocalTransform(t, at: i)
+            }
+            XCTAssertEqual(graph.updateWorldTransforms(), numNodes)
+            sum += graph.worldMatrices[numNodes - 1].m41
+        }
+        let graphTime = Double(DispatchTime.now().uptimeNanoseconds - start) * 0.000_000_001
+
+        // a single leaf change touches one node.
+        graph.setScale(Vector3(2, 2, 2), at: numNodes - 1)
+        XCTAssertEqual(graph.updateWorldTransforms(), 1)
+
+        XCTAssertFalse(sum.isNaN)
+        print("SceneGraph \(numNodes) nodes update: recursive \(recursiveTime / Double(frames) * 1000.0) ms/frame, flattened \(graphTime / Double(frames) * 1000.0) ms/frame")
+    }
+}
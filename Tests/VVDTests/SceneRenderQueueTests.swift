@@ -0,0 +1,255 @@
+import XCTest
+import Foundation
+@testable import VVD
+
+final class SceneRenderQueueTests: XCTestCase {
+    typealias Pipeline = RenderDrawListTests.Pipeline
+    typealias VertexFunction = RenderDrawListTests.VertexFunction
+
+    // makes host memory buffers only.
+    final class HostDevice: GraphicsDevice {
+        var name: String { "HostDevice" }
+        func makeCommandQueue(flags: CommandQueueFlags) -> CommandQueue? { nil }
+        func makeShaderModule(from: Shader) -> ShaderModule? { nil }
+        func makeShaderBindingSet(layout: ShaderBindingSetLayout) -> ShaderBindingSet? { nil }
+        func makeRenderPipelineState(descriptor: RenderPipelineDescriptor, reflection: UnsafeMutablePointer<PipelineReflection>?) -> RenderPipelineState? { nil }
+        func makeComputePipelineState(descriptor: ComputePipelineDescriptor, reflection: UnsafeMutablePointer<PipelineReflection>?) -> ComputePipelineState? { nil }
+        func makeDepthStencilState(descriptor: DepthStencilDescriptor) -> DepthStencilState? { nil }
+        func makeBuffer(length: Int, storageMode: StorageMode, cpuCacheMode: CPUCacheMode) -> GPUBuffer? {
+            HostBuffer(length: length)
+        }
+        func makeTexture(descriptor: TextureDescriptor) -> Texture? { nil }
+        func makeTransientRenderTarget(type: TextureType, pixelFormat: PixelFormat, width: Int, height: Int, depth: Int, sampleCount: Int) -> Texture? { nil }
+        func makeSamplerState(descriptor: SamplerDescriptor) -> SamplerState? { nil }
+        func makeEvent() -> GPUEvent? { nil }
+        func makeSemaphore() -> GPUSemaphore? { nil }
+    }
+
+    final class BindingSet: ShaderBindingSet {
+        var buffers: [Int: BufferBindingInfo] = [:]
+        func setBuffer(_ buffer: GPUBuffer, offset: Int, length: Int, binding: Int) {
+            buffers[binding] = BufferBindingInfo(buffer: buffer, offset: offset, length: length)
+        }
+        func setBufferArray(_ buffers: [BufferBindingInfo], binding: Int) {
+            self.buffers[binding] = buffers.first
+        }
+        func setTexture(_: Texture, binding: Int) {}
+        func setTextureArray(_: [Texture], binding: Int) {}
+        func setSamplerState(_: SamplerState, binding: Int) {}
+        func setSamplerStateArray(_: [SamplerState], binding: Int) {}
+        var device: GraphicsDevice { fatalError("not available") }
+    }
+
+    struct Draw {
+        let binding: BufferBindingInfo?
+        let indexBuffer: GPUBuffer?
+        let instanceCount: Int
+        let baseInstance: Int
+    }
+
+    // Records draws with the buffer bound to binding 0 when the set was
+    // bound, as the backends write descriptors at setResource.
+    final class CountingEncoder: RenderCommandEncoder {
+        var binding: BufferBindingInfo?
+        var draws: [Draw] = []
+
+        func setResource(_ set: ShaderBindingSet, index: Int) {
+            binding = (set as! BindingSet).buffers[0]
+        }
+        func setViewport(_: Viewport) {}
+        func setScissorRect(_: ScissorRect) {}
+        func setRenderPipelineState(_: RenderPipelineState) {}
+        func setVertexBuffer(_: GPUBuffer, offset: Int, index: Int) {}
+        func setVertexBuffers(_: [GPUBuffer], offsets: [Int], index: Int) {}
+        func setDepthStencilState(_: DepthStencilState?) {}
+        func setDepthClipMode(_: DepthClipMode) {}
+        func setCullMode(_: CullMode) {}
+        func setFrontFacing(_: Winding) {}
+        func setBlendColor(red: Float, green: Float, blue: Float, alpha: Float) {}
+        func setStencilReferenceValue(_: UInt32) {}
+        func setStencilReferenceValues(front: UInt32, back: UInt32) {}
+        func setDepthBias(_ depthBias: Float, slopeScale: Float, clamp: Float) {}
+        func pushConstant<D: DataProtocol>(stages: ShaderStageFlags, offset: Int, data: D) {}
+        func memoryBarrier(after: RenderStages, before: RenderStages) {}
+        func draw(vertexStart: Int, vertexCount: Int, instanceCount: Int, baseInstance: Int) {
+            draws.append(Draw(binding: binding, indexBuffer: nil,
+                              instanceCount: instanceCount, baseInstance: baseInstance))
+        }
+        func drawIndexed(indexCount: Int, indexType: IndexType, indexBuffer: GPUBuffer, indexBufferOffset: Int,
+                         instanceCount: Int, baseVertex: Int, baseInstance: Int) {
+            draws.append(Draw(binding: binding, indexBuffer: indexBuffer,
+                              instanceCount: instanceCount, baseInstance: baseInstance))
+        }
+
+        func endEncoding() {}
+        var isCompleted: Bool { false }
+        func waitEvent(_: GPUEvent) {}
+        func signalEvent(_: GPUEvent) {}
+        func waitSemaphoreValue(_: GPUSemaphore, value: UInt64) {}
+        func signalSemaphoreValue(_: GPUSemaphore, value: UInt64) {}
+        var commandBuffer: CommandBuffer { fatalError("not available") }
+    }
+
+    // float4x4 at set 0, binding 0, an instance array if instanced,
+    // the model matrix otherwise.
+    func makeMesh(instanced: Bool) -> Mesh {
+        let semantic: ShaderUniformSemantic = instanced ? .transformMatrixArray : .modelMatrix
+        let material = Material(shaderMap: MaterialShaderMap(
+            functions: [.init(function: VertexFunction(), descriptors: [])],
+            resourceSemantics: [.location(set: 0, binding: 0, offset: 0): .uniform(semantic)],
+            inputAttributeSemantics: [0: .position]))
+        let resource = ShaderResource(set: 0, binding: 0, name: "transform", type: .buffer,
+                                      stages: .vertex, count: 1, stride: 64,
+                                      enabled: true, access: .readOnly,
+                                      bufferTypeInfo: ShaderResourceBuffer(dataType: .float4x4, alignment: 16, size: 64),
+                                      members: [])
+        let mesh = Mesh()
+        mesh.material = material
+        mesh.pipelineState = Pipeline()
+        mesh.vertexBuffers = [
+            Mesh.VertexBuffer(byteOffset: 0, byteStride: 12, vertexCount: 3,
+                              buffer: HostBuffer(length: 36),
+                              attributes: [.init(semantic: .position, format: .float3,
+                                                 offset: 0, name: "position")])
+        ]
+        mesh.resourceBindings = [
+            Mesh.ResourceBindingSet(index: 0, bindingSet: BindingSet(), resources: [
+                Mesh.ResourceBinding(resource: resource,
+                                     binding: ShaderBinding(binding: 0,
+                                                            type: instanced ? .storageBuffer : .uniformBuffer,
+                                                            arrayLength: 1))
+            ])
+        ]
+        if instanced == false {
+            mesh.bufferResources[ShaderBindingLocation(set: 0, binding: 0, offset: 0)] =
+                Mesh.BufferResource(name: "transform",
+                                    buffers: [BufferBindingInfo(buffer: HostBuffer(length: 64), offset: 0, length: 64)])
+        }
+        return mesh
+    }
+
+    func sceneState() -> SceneState {
+        SceneState(view: ViewTransform(position: .zero, direction: Vector3(0, 0, 1), up: Vector3(0, 1, 0)),
+                   projection: .perspective(aspect: 1.0, fov: 1.0, near: 0.1, far: 1000.0),
+                   model: .identity)
+    }
+
+    func transform(_ x: Scalar, _ y: Scalar, _ z: Scalar) -> Matrix4 {
+        AffineTransform3(origin: Vector3(x, y, z)).matrix4
+    }
+
+    func matrix(at binding: BufferBindingInfo, index: Int) -> Float4x4 {
+        binding.buffer.contents()!.load(fromByteOffset: binding.offset + index * 64, as: Float4x4.self)
+    }
+
+    func assertEqual(_ a: Float4x4, _ b: Matrix4, file: StaticString = #filePath, line: UInt = #line) {
+        withUnsafeBytes(of: a) { a in
+            withUnsafeBytes(of: b.float4x4) { b in
+                XCTAssertTrue(memcmp(a.baseAddress!, b.baseAddress!, 64) == 0, file: file, line: line)
+            }
+        }
+    }
+
+    func testInstancedBatches() {
+        let queue = SceneRenderQueue(device: HostDevice())
+        let meshes = (0..<4).map { _ in makeMesh(instanced: true) }
+        var expected: [ObjectIdentifier: [Matrix4]] = [:]
+        queue.beginFrame()
+        for i in 0..<100 {
+            let mesh = meshes[i % meshes.count]
+            let t = transform(Scalar(i), 0, 10)
+            queue.enqueue(mesh: mesh, transform: t)
+            expected[ObjectIdentifier(mesh), default: []].append(t)
+        }
+        let encoder = CountingEncoder()
+        let stats = queue.encode(encoder: encoder, sceneState: sceneState())
+        XCTAssertEqual(stats.nodes, 100)
+        XCTAssertEqual(stats.batches, meshes.count)
+        XCTAssertEqual(stats.drawCalls, meshes.count)
+        XCTAssertEqual(stats.instances, 100)
+        XCTAssertEqual(encoder.draws.count, meshes.count)
+
+        // each mesh is bound to its own range of the instance buffer.
+        var offsets = Set<Int>()
+        for mesh in meshes {
+            let transforms = expected[ObjectIdentifier(mesh)]!
+            let binding = (mesh.resourceBindings[0].bindingSet as! BindingSet).buffers[0]!
+            XCTAssertEqual(binding.length, transforms.count * 64)
+            offsets.insert(binding.offset)
+            for (i, t) in transforms.enumerated() {
+                assertEqual(matrix(at: binding, index: i), t)
+            }
+        }
+        XCTAssertEqual(offsets.count, meshes.count)
+        for draw in encoder.draws {
+            XCTAssertEqual(draw.instanceCount, 25)
+            XCTAssertEqual(draw.baseInstance, 0)
+        }
+    }
+
+    func testInstancedLevelsOfDetail() {
+        let queue = SceneRenderQueue(device: HostDevice())
+        let mesh = makeMesh(instanced: true)
+        mesh.aabb = AABB(min: Vector3(-0.5, -0.5, -0.5), max: Vector3(0.5, 0.5, 0.5))
+        mesh.indexBuffer = HostBuffer(length: 6)
+        mesh.indexCount = 3
+        mesh.lods = [Mesh.LOD(indexBuffer: HostBuffer(length: 6), indexCount: 3, error: 0.01),
+                     Mesh.LOD(indexBuffer: HostBuffer(length: 6), indexCount: 3, error: 0.1)]
+        // 915 pixels per unit at distance 1, level 1 from 9.2, level 2 from 92.
+        queue.lodSelector = LODSelector(viewPosition: .zero, fov: 1.0,
+                                        viewportHeight: 1000, maxPixelError: 1.0)
+
+        let distances: [Scalar] = [2, 50, 500]
+        var expected: [[Matrix4]] = [[], [], []]
+        queue.beginFrame()
+        for i in 0..<30 {
+            let level = (i * 7) % 3
+            let t = transform(Scalar(i) * 0.01, 0, distances[level])
+            queue.enqueue(mesh: mesh, transform: t)
+            expected[level].append(t)
+        }
+        let encoder = CountingEncoder()
+        let stats = queue.encode(encoder: encoder, sceneState: sceneState())
+        XCTAssertEqual(stats.batches, 3)
+        XCTAssertEqual(stats.drawCalls, 3)
+        XCTAssertEqual(stats.instances, 30)
+        XCTAssertEqual(encoder.draws.count, 3)
+
+        let indexBuffers = [mesh.indexBuffer!, mesh.lods[0].indexBuffer, mesh.lods[1].indexBuffer]
+        for draw in encoder.draws {
+            let level = indexBuffers.firstIndex { $0 === draw.indexBuffer }!
+            XCTAssertEqual(draw.instanceCount, expected[level].count)
+            // all levels share one binding, indexed from baseInstance.
+            let binding = draw.binding!
+            XCTAssertEqual(binding.length, 30 * 64)
+            for (i, t) in expected[level].enumerated() {
+                assertEqual(matrix(at: binding, index: draw.baseInstance + i), t)
+            }
+        }
+    }
+
+    func testNonInstancedDrawsKeepTheirTransforms() {
+        let queue = SceneRenderQueue(device: HostDevice())
+        let meshes = (0..<2).map { _ in makeMesh(instanced: false) }
+        var expected: [Matrix4] = []
+        queue.beginFrame()
+        for i in 0..<10 {
+            let t = transform(Scalar(i), Scalar(i * 2), 10)
+            queue.enqueue(mesh: meshes[i / 5], transform: t)
+            expected.append(t)
+        }
+        let encoder = CountingEncoder()
+        let stats = queue.encode(encoder: encoder, sceneState: sceneState())
+        XCTAssertEqual(stats.batches, 2)
+        XCTAssertEqual(stats.drawCalls, 10)
+        XCTAssertEqual(stats.instances, 10)
+        XCTAssertEqual(encoder.draws.count, 10)
+
+        // every draw reads its own copy of the uniforms.
+        XCTAssertEqual(Set(encoder.draws.map { $0.binding!.offset }).count, 10)
+        for (draw, t) in zip(encoder.draws, expected) {
+            XCTAssertEqual(draw.instanceCount, 1)
+            assertEqual(matrix(at: draw.binding!, index: 0), t)
+        }
+    }
+}
@@ -0,0 +1,97 @@
+#if os(Linux) || os(Windows) || os(Android)
+import XCTest
+import Foundation
+@testable import VVD
+
+// Shader reflection and pipeline creation of a device at startup,
+// with empty caches (cold) and with the caches written by the previous run (warm).
+// Mesa drivers have their own shader cache, run with MESA_SHADER_CACHE_DISABLE=true
+// to measure the pipeline cache only.
+final class StartupCacheTests: XCTestCase {
+    var directory: URL!
+    var reflectionCache: DiskCache?
+
+    override func setUp() {
+        directory = FileManager.default.temporaryDirectory
+            .appendingPathComponent("StartupCacheTests-\(UUID().uuidString)", isDirectory: true)
+        reflectionCache = Shader.reflectionCache
+        Shader.reflectionCache = DiskCache(name: "ShaderReflection",
+                                           identity: reflectionCache?.identity ?? Data(),
+                                           directory: directory)
+        VulkanGraphicsDevice.pipelineCacheDirectory = directory
+    }
+
+    override func tearDown() {
+        Shader.reflectionCache = reflectionCache
+        VulkanGraphicsDevice.pipelineCacheDirectory = nil
+        try? FileManager.default.removeItem(at: directory)
+    }
+
+    struct Startup {
+        var reflection: Double = 0
+        var pipelines: Double = 0
+        var numShaders = 0
+        var numPipelines = 0
+    }
+
+    // reflects every SPIR-V of VUI, creates pipelines for
+    // combinations of color formats and blend states with a new device.
+    func startup() throws -> Startup {
+        guard let context = GraphicsDeviceContext.makeDefault() else {
+            throw XCTSkip("No graphics device available.")
+        }
+        let device = context.device
+        let urls = try FileManager.default.contentsOfDirectory(at: TestPipeline.shaderDirectory,
+                                                               includingPropertiesForKeys: nil)
+            .filter { $0.pathExtension == "spv" }
+            .sorted { $0.lastPathComponent < $1.lastPathComponent }
+        let spirv = try urls.map { try Data(contentsOf: $0) }
+
+        var result = Startup()
+        var start = DispatchTime.now().uptimeNanoseconds
+        let shaders = zip(urls, spirv).compactMap { url, data in
+            Shader(data: data, name: url.deletingPathExtension().lastPathComponent)
+        }
+        result.reflection = Double(DispatchTime.now().uptimeNanoseconds - start) * 0.000_001
+        result.numShaders = shaders.count
+        XCTAssertEqual(shaders.count, urls.count)
+
+        let vs = try XCTUnwrap(shaders.first { $0.name == "stencil.vert" })
+        let fs = try XCTUnwrap(shaders.first { $0.name == "stencil.frag" })
+        let vertexFunction = try XCTUnwrap(TestPipeline.makeFunction(vs, device: device))
+        let fragmentFunction = try XCTUnwrap(TestPipeline.makeFunction(fs, device: device))
+
+        let formats: [PixelFormat] = [.rgba8Unorm, .bgra8Unorm, .rgba16Float, .rgba8Unorm_srgb]
+        let blendStates: [BlendState] = [.opaque, .alphaBlend, .multiply, .screen, .darken, .lighten]
+        start = DispatchTime.now().uptimeNanoseconds
+        for format in formats {
+            for blendState in blendStates {
+                let descriptor = TestPipeline.makeDescriptor(vertexFunction: vertexFunction,
+                                                             fragmentFunction: fragmentFunction,
+                                                             colorFormat: format,
+                                                             blendState: blendState)
+                XCTAssertNotNil(device.makeRenderPipelineState(descriptor: descriptor))
+                result.numPipelines += 1
+            }
+        }
+        result.pipelines = Double(DispatchTime.now().uptimeNanoseconds - start) * 0.000_001
+        return result
+    }
+
+    func testColdWarmStartup() throws {
+        let cold = try startup()
+        let shaderCache = try XCTUnwrap(Shader.reflectionCache)
+        XCTAssertGreaterThan(shaderCache.totalSize, 0)
+        let pipelineCache = try XCTUnwrap(DiskCache(name: "Vulkan.PipelineCache", directory: directory))
+        XCTAssertGreaterThan(pipelineCache.totalSize, 0)
+
+        let warm = try startup()
+        XCTAssertEqual(warm.numShaders, cold.numShaders)
+
+        let format = { (value: Double) in String(format: "%.2f", value) }
+        print("Startup \(cold.numShaders) shaders, \(cold.numPipelines) pipelines:"
+              + " cold reflection \(format(cold.reflection)) ms, pipelines \(format(cold.pipelines)) ms,"
+              + " warm reflection \(format(warm.reflection)) ms, pipelines \(format(warm.pipelines)) ms")
+    }
+}
+#endif
@@ -0,0 +1,155 @@
+import XCTest
+import Foundation
+@testable import VVD
+
+final class TLSFAllocatorTests: XCTestCase {
+    // host memory standing in for a device memory chunk,
+    // every allocation is filled with its own tag.
+    struct FakeHeap {
+        var allocator: TLSFAllocator
+        var bytes: [UInt8]
+        var live: [(allocation: TLSFAllocator.Allocation, tag: UInt8)] = []
+
+        init(size: Int, granularity: UInt64 = 1) {
+            allocator = TLSFAllocator(size: UInt64(size), granularity: granularity)
+            bytes = .init(repeating: 0, count: size)
+        }
+
+        mutating func alloc(size: UInt64, alignment: UInt64, kind: TLSFAllocator.ResourceKind, tag: UInt8) -> Bool {
+            guard let allocation = allocator.alloc(size: size, alignment: alignment, kind: kind) else {
+                return false
+            }
+            let range = Int(allocation.offset)..<Int(allocation.offset + allocation.size)
+            XCTAssert(bytes[range].allSatisfy { $0 == 0 }, "overlapping allocation")
+            bytes.replaceSubrange(range, with: repeatElement(tag, count: range.count))
+            live.append((allocation, tag))
+            return true
+        }
+
+        mutating func free(at index: Int) {
+            let (allocation, tag) = live.remove(at: index)
+            let range = Int(allocation.offset)..<Int(allocation.offset + allocation.size)
+            XCTAssert(bytes[range].allSatisfy { $0 == tag }, "allocation overwritten")
+            bytes.replaceSubrange(range, with: repeatElement(0, count: range.count))
+            allocator.free(allocation)
+        }
+    }
+
+    func testRandomAllocFree() {
+        var heap = FakeHeap(size: 1 << 20)
+        var rng = SystemRandomNumberGenerator()
+        let alignments: [UInt64] = [1, 16, 256, 4096]
+        var failed = 0
+        for i in 0..<20000 {
+            if heap.live.isEmpty == false && Int.random(in: 0..<100, using: &rng) < 48 {
+                heap.free(at: Int.random(in: 0..<heap.live.count, using: &rng))
+            } else {
+                let size = UInt64.random(in: 1...[UInt64(300), 5000, 60000].randomElement(using: &rng)!, using: &rng)
+                let alignment = alignments.randomElement(using: &rng)!
+                if heap.alloc(size: size, alignment: alignment, kind: .linear, tag: UInt8(truncatingIfNeeded: i | 1)) {
+                    XCTAssertEqual(heap.live.last!.allocation.offset % max(alignment, TLSFAllocator.minAlignment), 0)
+                } else {
+                    failed += 1
+                }
+            }
+        }
+        XCTAssertEqual(heap.allocator.numAllocations, heap.live.count)
+        var offsets: [UInt64] = []
+        heap.allocator.forEachAllocation { allocation, _ in offsets.append(allocation.offset) }
+        XCTAssertEqual(offsets, heap.live.map(\.allocation.offset).sorted())
+
+        while heap.live.isEmpty == false {
+            heap.free(at: heap.live.count - 1)
+        }
+        // everything merged back into a single free block.
+        let stats = heap.allocator.statistics
+        XCTAssertEqual(stats.numAllocations, 0)
+        XCTAssertEqual(stats.numFreeBlocks, 1)
+        XCTAssertEqual(stats.largestFreeBlock, 1 << 20)
+        XCTAssertEqual(stats.externalFragmentation, 0)
+        print("TLSFAllocator random test: \(failed) failed allocations")
+    }
+
+    func testGranularity() {
+        var heap = FakeHeap(size: 1 << 16, granularity: 4096)
+        XCTAssert(heap.alloc(size: 100, alignment: 1, kind: .linear, tag: 1))
+        XCTAssert(heap.alloc(size: 100, alignment: 256, kind: .optimal, tag: 2))
+        XCTAssert(heap.alloc(size: 100, alignment: 1, kind: .linear, tag: 3))
+        XCTAssert(heap.alloc(size: 100, alignment: 256, kind: .optimal, tag: 4))
+
+        var pages: [(first: UInt64, last: UInt64, kind: TLSFAllocator.ResourceKind)] = []
+        heap.allocator.forEachAllocation { allocation, kind in
+            pages.append((allocation.offset / 4096, (allocation.offset + allocation.size - 1) / 4096, kind))
+        }
+        XCTAssertEqual(pages.count, 4)
+        for (a, b) in zip(pages, pages.dropFirst()) where a.kind != b.kind {
+            XCTAssertLessThan(a.last, b.first)
+        }
+        // same kind shares a page.
+        XCTAssertEqual(heap.live[0].allocation.offset / 4096, heap.live[2].allocation.offset / 4096)
+    }
+
+    func testExhaustion() {
+        var allocator = TLSFAllocator(size: 4096)
+        let a = allocator.alloc(size: 4096)
+        XCTAssertNotNil(a)
+        XCTAssertNil(allocator.alloc(size: 1))
+        allocator.free(a!)
+        XCTAssertNil(allocator.alloc(size: 4097))
+        XCTAssertNotNil(allocator.alloc(size: 2048, alignment: 2048))
+        XCTAssertNotNil(allocator.alloc(size: 2048, alignment: 2048))
+        XCTAssertNil(allocator.alloc(size: 8))
+    }
+
+    func testFragmentationStatistics() {
+        var allocator = TLSFAllocator(size: 1 << 16)
+        let a = allocator.alloc(size: 1025)!
+        var stats = allocator.statistics
+        XCTAssertEqual(stats.requestedSize, 1025)
+        XCTAssertEqual(stats.allocatedSize, 1032)
+        XCTAssertEqual(stats.internalFragmentation, 1.0 - 1025.0 / 1032.0, accuracy: 1e-9)
+        allocator.free(a)
+
+        var allocations: [TLSFAllocator.Allocation] = []
+        for _ in 0..<64 {
+            allocations.append(allocator.alloc(size: 1024)!)
+        }
+        XCTAssertEqual(allocator.statistics.freeSize, 0)
+        XCTAssertEqual(allocator.statistics.externalFragmentation, 0)
+        for i in stride(from: 0, to: 64, by: 2) {
+            allocator.free(allocations[i])
+        }
+        stats = allocator.statistics
+        XCTAssertEqual(stats.freeSize, 32 * 1024)
+        XCTAssertEqual(stats.largestFreeBlock, 1024)
+        XCTAssertEqual(stats.numFreeBlocks, 32)
+        XCTAssertEqual(stats.externalFragmentation, 1.0 - 1.0 / 32.0, accuracy: 1e-9)
+        XCTAssertNil(allocator.alloc(size: 2048))
+    }
+
+    func testAllocFreeThroughput() {
+        let count = 1_000_000
+        var allocator = TLSFAllocator(size: 256 << 20, granularity: 1024)
+        var live: [TLSFAllocator.Allocation] = []
+        live.reserveCapacity(4096)
+        var rng = SystemRandomNumberGenerator()
+
+        let start = DispatchTime.now().uptimeNanoseconds
+        for _ in 0..<count {
+            if live.count >= 4096 {
+                live.swapAt(Int.random(in: 0..<live.count, using: &rng), live.count - 1)
+                allocator.free(live.removeLast())
+            }
+            let size = UInt64.random(in: 256...65536, using: &rng)
+            if let allocation = allocator.alloc(size: size, alignment: 256,
+                                                kind: Bool.random(using: &rng) ? .linear : .optimal) {
+                live.append(allocation)
+            }
+        }
+        let elapsed = Double(DispatchTime.now().uptimeNanoseconds - start) * 0.000_000_001
+        let stats = allocator.statistics
+        print("TLSFAllocator \(count) alloc/free: \(elapsed)s (\(Double(count) / elapsed) ops/s), internal \(stats.internalFragmentation), external \(stats.externalFragmentation)")
+        for allocation in live { allocator.free(allocation) }
+        XCTAssertEqual(allocator.statistics.numFreeBlocks, 1)
+    }
+}
@@ -0,0 +1,82 @@
+import Foundation
+@testable import VVD
+
+// Render pipeline built from the SPIR-V of VUI (stencil.vert, stencil.frag),
+// one float2 position per vertex, for the tests with a graphics device.
+struct TestPipeline {
+    static let shaderDirectory = URL(fileURLWithPath: #filePath)
+        .deletingLastPathComponent()    // VVDTests
+        .deletingLastPathComponent()    // Tests
+        .deletingLastPathComponent()
+        .appendingPathComponent("Sources/VUI/Resources/Shaders/SPIRV")
+
+    static func loadShader(_ name: String) -> Shader? {
+        let url = shaderDirectory.appendingPathComponent("\(name).spv")
+        guard let data = try? Data(contentsOf: url) else { return nil }
+        return Shader(data: data, name: name)
+    }
+
+    static func makeFunction(_ shader: Shader, device: GraphicsDevice) -> ShaderFunction? {
+        guard let module = device.makeShaderModule(from: shader) else { return nil }
+        return module.makeFunction(name: module.functionNames.first ?? "")
+    }
+
+    static func makeDescriptor(device: GraphicsDevice, colorFormat: PixelFormat) -> RenderPipelineDescriptor? {
+        guard let vs = loadShader("stencil.vert"), let fs = loadShader("stencil.frag"),
+              let vertexFunction = makeFunction(vs, device: device),
+              let fragmentFunction = makeFunction(fs, device: device) else {
+            return nil
+        }
+        return makeDescriptor(vertexFunction: vertexFunction,
+                              fragmentFunction: fragmentFunction,
+                              colorFormat: colorFormat)
+    }
+
+    static func makeDescriptor(vertexFunction: ShaderFunction,
+                               fragmentFunction: ShaderFunction,
+                               colorFormat: PixelFormat,
+                               blendState: BlendState = .opaque) -> RenderPipelineDescriptor {
+        var descriptor = RenderPipelineDescriptor()
+        descriptor.vertexFunction = vertexFunction
+        descriptor.fragmentFunction = fragmentFunction
+        descriptor.colorAttachments = [
+            .init(index: 0, pixelFormat: colorFormat, blendState: blendState)
+        ]
+        descriptor.vertexDescriptor.attributes = [
+            .init(format: .float2, offset: 0, bufferIndex: 0, location: 0),
+        ]
+        descriptor.vertexDescriptor.layouts = [
+            .init(stepRate: .vertex, stride: MemoryLayout<Float2>.stride)
+        ]
+        descriptor.primitiveTopology = .triangle
+        return descriptor
+    }
+
+    let state: RenderPipelineState
+    let vertexBuffer: GPUBuffer
+    static let numTriangles = 64
+
+    // small triangles over the render target, vertexStart: triangle * 3
+    init?(device: GraphicsDevice, colorFormat: PixelFormat) {
+        guard let descriptor = Self.makeDescriptor(device: device, colorFormat: colorFormat),
+              let state = device.makeRenderPipelineState(descriptor: descriptor),
+              let buffer = device.makeBuffer(length: MemoryLayout<Float2>.stride * 3 * Self.numTriangles,
+                                             storageMode: .shared,
+                                             cpuCacheMode: .writeCombined),
+              let contents = buffer.contents() else {
+            return nil
+        }
+        let vertices = contents.bindMemory(to: Float.self, capacity: 6 * Self.numTriangles)
+        for t in 0..<Self.numTriangles {
+            let x = Float(t % 8) * 0.25 - 1.0
+            let y = Float(t / 8) * 0.25 - 1.0
+            let triangle: [Float] = [x, y, x + 0.2, y, x, y + 0.2]
+            for (i, v) in triangle.enumerated() {
+                vertices[t * 6 + i] = v
+            }
+        }
+        buffer.flush()
+        self.state = state
+        self.vertexBuffer = buffer
+    }
+}
@@ -0,0 +1,110 @@
+#if os(Linux) || os(Windows) || os(Android)
+import XCTest
+import Foundation
+@testable import VVD
+
+final class UploadManagerTests: XCTestCase {
+    func makeContext() throws -> (GraphicsDeviceContext, CommandQueue) {
+        guard let context = GraphicsDeviceContext.makeDefault(),
+              let queue = context.copyQueue() else {
+            throw XCTSkip("No graphics device available.")
+        }
+        return (context, queue)
+    }
+
+    func readBack(_ context: GraphicsDeviceContext, buffer: GPUBuffer) throws -> [UInt8] {
+        let cpuBuffer = try XCTUnwrap(context.makeCPUAccessible(buffer: buffer))
+        let contents = try XCTUnwrap(cpuBuffer.contents())
+        return Array(UnsafeRawBufferPointer(start: contents, count: buffer.length))
+    }
+
+    // uploads recorded before flush() are submitted at once.
+    func testBatchedSubmission() throws {
+        let (context, queue) = try makeContext()
+        let uploadManager = try XCTUnwrap(UploadManager(queue: queue))
+        let chunk = 256
+        let count = 100
+        let buffer = try XCTUnwrap(queue.device.makeBuffer(length: chunk * count,
+                                                           storageMode: .private,
+                                                           cpuCacheMode: .defaultCache))
+        var futures: [UploadManager.Future] = []
+        for i in 0..<count {
+            let data = [UInt8](repeating: UInt8(i), count: chunk)
+            let future = data.withUnsafeBytes { uploadManager.upload($0, to: buffer, offset: i * chunk) }
+            futures.append(try XCTUnwrap(future))
+        }
+        XCTAssertEqual(uploadManager.statistics.submissions, 0)
+        let future = try XCTUnwrap(uploadManager.flush())
+        XCTAssertTrue(futures.allSatisfy { $0 === future })
+        XCTAssertTrue(future.wait(timeout: 2.0))
+        XCTAssertEqual(uploadManager.statistics.submissions, 1)
+        XCTAssertEqual(uploadManager.statistics.uploads, UInt64(count))
+
+        let contents = try readBack(context, buffer: buffer)
+        for i in 0..<count {
+            XCTAssertTrue(contents[i * chunk ..< (i + 1) * chunk].allSatisfy { $0 == UInt8(i) })
+        }
+    }
+
+    // the ring is reused after the GPU has consumed the previous batches.
+    func testRingWrapAround() throws {
+        let (context, queue) = try makeContext()
+        let ringSize = 16 * 1024
+        let uploadManager = try XCTUnwrap(UploadManager(queue: queue, ringSize: ringSize))
+        let chunk = 3000
+        let count = 64
+        let buffer = try XCTUnwrap(queue.device.makeBuffer(length: chunk * count,
+                                                           storageMode: .private,
+                                                           cpuCacheMode: .defaultCache))
+        for i in 0..<count {
+            let data = [UInt8](repeating: UInt8(i), count: chunk)
+            XCTAssertNotNil(data.withUnsafeBytes { uploadManager.upload($0, to: buffer, offset: i * chunk) })
+        }
+        uploadManager.waitUntilCompleted()
+
+        let statistics = uploadManager.statistics
+        XCTAssertGreaterThan(statistics.stalls, 0)
+        XCTAssertEqual(statistics.dedicatedBuffers, 0)
+        print("\(count) uploads of \(chunk) bytes through \(ringSize) bytes ring: \(statistics.submissions) submissions")
+
+        let contents = try readBack(context, buffer: buffer)
+        for i in 0..<count {
+            XCTAssertTrue(contents[i * chunk ..< (i + 1) * chunk].allSatisfy { $0 == UInt8(i) })
+        }
+    }
+
+    // a future waited on before flush() submits its batch.
+    func testFutureWaitSubmitsBatch() throws {
+        let (_, queue) = try makeContext()
+        let uploadManager = try XCTUnwrap(UploadManager(queue: queue))
+        let buffer = try XCTUnwrap(queue.device.makeBuffer(length: 1024,
+                                                           storageMode: .private,
+                                                           cpuCacheMode: .defaultCache))
+        let data = [UInt8](repeating: 1, count: 1024)
+        let future = try XCTUnwrap(data.withUnsafeBytes { uploadManager.upload($0, to: buffer) })
+        let notified = DispatchSemaphore(value: 0)
+        future.notify { notified.signal() }
+        XCTAssertTrue(future.wait(timeout: 2.0))
+        XCTAssertEqual(notified.wait(timeout: .now() + 2.0), .success)
+        XCTAssertNil(uploadManager.flush())
+    }
+
+    // resources uploaded on the transfer queue are handed off to the render queue.
+    func testAsyncHandoff() async throws {
+        guard let context = GraphicsDeviceContext.makeDefault(),
+              let uploadManager = context.asyncUploadManager else {
+            throw XCTSkip("No graphics device available.")
+        }
+        XCTAssertNotNil(uploadManager.destinationQueue)
+
+        let data = (0..<4096).map { UInt8(truncatingIfNeeded: $0) }
+        let buffer = await uploadManager.makeBuffer(data)
+        let image = Image(width: 64, height: 64, pixelFormat: .rgba8, content: Color(1, 0, 1, 1).rgba8)
+        let texture = await uploadManager.makeTexture(image)
+        XCTAssertNotNil(texture)
+
+        let contents = try readBack(context, buffer: try XCTUnwrap(buffer))
+        XCTAssertEqual(contents, data)
+    }
+}
+#endif
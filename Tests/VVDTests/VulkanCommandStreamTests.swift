@@ -0,0 +1,102 @@
+#if os(Linux) || os(Windows) || os(Android)
+import XCTest
+import Foundation
+@testable import VVD
+
+final class VulkanCommandStreamTests: XCTestCase {
+    struct Draw {
+        var vertexCount: UInt32
+        var instanceCount: UInt32
+        var firstVertex: UInt32
+        var firstInstance: UInt32
+    }
+    struct Bind {
+        var index: Int
+    }
+
+    func testRecordAndReplay() throws {
+        let stream = VulkanCommandStream(capacity: 64)
+        for i in 0..<100 {
+            stream.append(0, Bind(index: i))
+            let bytes: [UInt8] = (0..<(i % 7)).map { UInt8($0) }
+            bytes.withUnsafeBytes {
+                _ = stream.append(1, Draw(vertexCount: UInt32(i), instanceCount: 1,
+                                          firstVertex: 0, firstInstance: 0),
+                                  payload: $0)
+            }
+        }
+        XCTAssertEqual(stream.count, 200)
+
+        var index = 0
+        stream.forEach { command, p in
+            XCTAssertEqual(Int(command), index % 2)
+            if command == 0 {
+                XCTAssertEqual(p.load(as: Bind.self).index, index / 2)
+            } else {
+                let draw = p.load(as: Draw.self)
+                XCTAssertEqual(Int(draw.vertexCount), index / 2)
+                let payload = p + VulkanCommandStream.payloadOffset(Draw.self)
+                for n in 0..<(Int(draw.vertexCount) % 7) {
+                    XCTAssertEqual(payload.load(fromByteOffset: n, as: UInt8.self), UInt8(n))
+                }
+            }
+            index += 1
+        }
+        XCTAssertEqual(index, 200)
+
+        let capacity = stream.capacity
+        stream.reset()
+        XCTAssertTrue(stream.isEmpty)
+        XCTAssertEqual(stream.capacity, capacity)
+    }
+
+    // 100k draws recorded with VulkanRenderCommandEncoder and replayed
+    // into the Vulkan command buffer on commit, runs on lavapipe.
+    func testRecordReplay100kDraws() throws {
+        guard let context = GraphicsDeviceContext.makeDefault(),
+              let queue = context.renderQueue() else {
+            throw XCTSkip("No graphics device available.")
+        }
+        let desc = TextureDescriptor(textureType: .type2D, pixelFormat: .rgba8Unorm,
+                                     width: 256, height: 256, usage: [.renderTarget])
+        guard let texture = context.device.makeTexture(descriptor: desc),
+              let pipeline = TestPipeline(device: context.device, colorFormat: .rgba8Unorm) else {
+            throw XCTSkip("Failed to create render target or pipeline.")
+        }
+        let renderPass = RenderPassDescriptor(colorAttachments: [
+            RenderPassColorAttachmentDescriptor(renderTarget: texture,
+                                                loadAction: .clear,
+                                                storeAction: .store)])
+
+        let numDraws = 100_000
+        let frames = 10
+        let triangleSize = MemoryLayout<Float2>.stride * 3
+        var recordTime = 0.0
+        var replayTime = 0.0
+        for _ in 0..<frames {
+            let commandBuffer = try XCTUnwrap(queue.makeCommandBuffer())
+            var start = DispatchTime.now().uptimeNanoseconds
+            let encoder = try XCTUnwrap(commandBuffer.makeRenderCommandEncoder(descriptor: renderPass))
+            XCTAssertTrue(encoder is VulkanRenderCommandEncoder)
+            encoder.setRenderPipelineState(pipeline.state)
+            for i in 0..<numDraws {
+                encoder.setVertexBuffer(pipeline.vertexBuffer,
+                                        offset: (i % TestPipeline.numTriangles) * triangleSize,
+                                        index: 0)
+                encoder.draw(vertexStart: 0, vertexCount: 3, instanceCount: 1, baseInstance: 0)
+            }
+            encoder.endEncoding()
+            recordTime += Double(DispatchTime.now().uptimeNanoseconds - start) * 0.000_001
+
+            // the recorded commands are encoded into VkCommandBuffer by commit().
+            let completed = DispatchSemaphore(value: 0)
+            commandBuffer.addCompletedHandler { _ in completed.signal() }
+            start = DispatchTime.now().uptimeNanoseconds
+            XCTAssertTrue(commandBuffer.commit())
+            replayTime += Double(DispatchTime.now().uptimeNanoseconds - start) * 0.000_001
+            XCTAssertEqual(completed.wait(timeout: .now() + 30.0), .success)
+        }
+        print("\(numDraws) draws: record \(recordTime / Double(frames)) ms/frame, replay \(replayTime / Double(frames)) ms/frame")
+    }
+}
+#endif
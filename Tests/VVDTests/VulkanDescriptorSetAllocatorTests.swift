@@ -0,0 +1,76 @@
+#if os(Linux) || os(Windows) || os(Android)
+import XCTest
+import Foundation
+import Vulkan
+@testable import VVD
+
+final class VulkanDescriptorSetAllocatorTests: XCTestCase {
+    typealias ContentKey = VulkanDescriptorSetAllocator.ContentKey
+
+    // fake handles, the key only compares them.
+    func handle(_ value: Int) -> OpaquePointer {
+        OpaquePointer(bitPattern: value)!
+    }
+
+    func textureBinding(binding: UInt32, imageView: Int, sampler: Int) -> VulkanDescriptorSet.Binding {
+        var layoutBinding = VkDescriptorSetLayoutBinding()
+        layoutBinding.binding = binding
+        layoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER
+        layoutBinding.descriptorCount = 1
+        var b = VulkanDescriptorSet.Binding(layoutBinding: layoutBinding)
+        var info = VkDescriptorImageInfo()
+        info.imageView = handle(imageView)
+        info.sampler = handle(sampler)
+        info.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL
+        b.imageInfos = [info]
+        b.valueSet = true
+        return b
+    }
+
+    func bufferBinding(binding: UInt32, buffer: Int, offset: UInt64) -> VulkanDescriptorSet.Binding {
+        var layoutBinding = VkDescriptorSetLayoutBinding()
+        layoutBinding.binding = binding
+        layoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER
+        layoutBinding.descriptorCount = 1
+        var b = VulkanDescriptorSet.Binding(layoutBinding: layoutBinding)
+        b.bufferInfos = [VkDescriptorBufferInfo(buffer: handle(buffer), offset: offset, range: 256)]
+        b.valueSet = true
+        return b
+    }
+
+    func testContentKey() {
+        let layout = handle(0x1000)
+        let a = ContentKey(layout: layout, bindings: [textureBinding(binding: 0, imageView: 0x10, sampler: 0x20),
+                                                      bufferBinding(binding: 1, buffer: 0x30, offset: 0)])
+        let b = ContentKey(layout: layout, bindings: [textureBinding(binding: 0, imageView: 0x10, sampler: 0x20),
+                                                      bufferBinding(binding: 1, buffer: 0x30, offset: 0)])
+        XCTAssertEqual(a, b)
+        XCTAssertEqual(a.hashValue, b.hashValue)
+
+        // any difference in the bound resources is a different set.
+        XCTAssertNotEqual(a, ContentKey(layout: layout, bindings: [textureBinding(binding: 0, imageView: 0x11, sampler: 0x20),
+                                                                   bufferBinding(binding: 1, buffer: 0x30, offset: 0)]))
+        XCTAssertNotEqual(a, ContentKey(layout: layout, bindings: [textureBinding(binding: 0, imageView: 0x10, sampler: 0x20),
+                                                                   bufferBinding(binding: 1, buffer: 0x30, offset: 256)]))
+        XCTAssertNotEqual(a, ContentKey(layout: handle(0x2000), bindings: [textureBinding(binding: 0, imageView: 0x10, sampler: 0x20),
+                                                                           bufferBinding(binding: 1, buffer: 0x30, offset: 0)]))
+        // unset bindings are ignored.
+        var unset = bufferBinding(binding: 2, buffer: 0x40, offset: 0)
+        unset.valueSet = false
+        XCTAssertEqual(a, ContentKey(layout: layout, bindings: [textureBinding(binding: 0, imageView: 0x10, sampler: 0x20),
+                                                                bufferBinding(binding: 1, buffer: 0x30, offset: 0),
+                                                                unset]))
+    }
+
+    func testContentMatches() {
+        let bindings = [textureBinding(binding: 0, imageView: 0x10, sampler: 0x20),
+                        bufferBinding(binding: 1, buffer: 0x30, offset: 0)]
+        XCTAssertTrue(ContentKey.matches(bindings, bindings))
+        XCTAssertFalse(ContentKey.matches(bindings, [textureBinding(binding: 0, imageView: 0x10, sampler: 0x21),
+                                                     bufferBinding(binding: 1, buffer: 0x30, offset: 0)]))
+        XCTAssertFalse(ContentKey.matches(bindings, [textureBinding(binding: 0, imageView: 0x10, sampler: 0x20),
+                                                     bufferBinding(binding: 1, buffer: 0x31, offset: 0)]))
+        XCTAssertFalse(ContentKey.matches(bindings, [textureBinding(binding: 0, imageView: 0x10, sampler: 0x20)]))
+    }
+}
+#endif
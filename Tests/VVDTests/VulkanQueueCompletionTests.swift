@@ -0,0 +1,59 @@
+#if os(Linux) || os(Windows) || os(Android)
+import XCTest
+import Foundation
+@testable import VVD
+
+final class VulkanQueueCompletionTests: XCTestCase {
+    func makeContext() throws -> (GraphicsDeviceContext, VulkanGraphicsDevice) {
+        guard let context = GraphicsDeviceContext.makeDefault(),
+              let device = context.device as? VulkanGraphicsDevice else {
+            throw XCTSkip("No Vulkan device available.")
+        }
+        return (context, device)
+    }
+
+    // time from commit to the completion handler of a small copy.
+    func testCompletionLatency() throws {
+        let (context, device) = try makeContext()
+        let queue = try XCTUnwrap(context.copyQueue())
+        let buffer = try XCTUnwrap(device.makeBuffer(length: 4096, storageMode: .private, cpuCacheMode: .defaultCache))
+
+        let iterations = 200
+        var latencies: [Double] = []
+        let completed = DispatchSemaphore(value: 0)
+        for _ in 0..<iterations {
+            let commandBuffer = try XCTUnwrap(queue.makeCommandBuffer())
+            let encoder = try XCTUnwrap(commandBuffer.makeCopyCommandEncoder())
+            encoder.fill(buffer: buffer, offset: 0, length: 4096, value: 0)
+            encoder.endEncoding()
+            commandBuffer.addCompletedHandler { _ in completed.signal() }
+
+            let start = DispatchTime.now().uptimeNanoseconds
+            XCTAssertTrue(commandBuffer.commit())
+            XCTAssertEqual(completed.wait(timeout: .now() + 2.0), .success)
+            latencies.append(Double(DispatchTime.now().uptimeNanoseconds - start) * 0.000_001)
+        }
+        latencies.sort()
+        let average = latencies.reduce(0, +) / Double(latencies.count)
+        let p99 = latencies[latencies.count * 99 / 100]
+        print("completion latency: avg \(String(format: "%.3f", average)) ms, p99 \(String(format: "%.3f", p99)) ms")
+
+        let statistics = device.completionMonitor.statistics
+        XCTAssertGreaterThanOrEqual(statistics.handlers, UInt64(iterations))
+    }
+
+    // the monitor thread must sleep while nothing is pending.
+    func testIdleWakeups() throws {
+        let (_, device) = try makeContext()
+        let monitor = device.completionMonitor
+
+        let wakeups = monitor.statistics.wakeups
+        let cpuStart = clock()
+        Thread.sleep(forTimeInterval: 0.5)
+        let cpuTime = Double(clock() - cpuStart) / Double(CLOCKS_PER_SEC)
+
+        XCTAssertEqual(monitor.statistics.wakeups, wakeups)
+        print("idle process CPU time in 0.5 s: \(String(format: "%.3f", cpuTime * 1000.0)) ms")
+    }
+}
+#endif
@@ -0,0 +1,37 @@
+#if os(Linux) || os(Windows) || os(Android)
+import XCTest
+@testable import VVD
+
+final class VulkanRetiredResourcesTests: XCTestCase {
+    final class Object {
+        let released: () -> Void
+        init(released: @escaping () -> Void) { self.released = released }
+        deinit { released() }
+    }
+
+    func testReleasedAfterEarlierCommandBuffers() {
+        let retired = VulkanRetiredResources()
+        var released: [Int] = []
+
+        let first = retired.beginCommandBuffer()
+        let second = retired.beginCommandBuffer()
+        retired.retire(Object { released.append(0) })
+        // created after the retirement, does not hold it.
+        let third = retired.beginCommandBuffer()
+        retired.retire(Object { released.append(1) })
+
+        retired.endCommandBuffer(epoch: first)
+        XCTAssertEqual(released, [])
+        retired.endCommandBuffer(epoch: second)
+        XCTAssertEqual(released, [0])
+        XCTAssertEqual(retired.count, 1)
+        retired.endCommandBuffer(epoch: third)
+        XCTAssertEqual(released, [0, 1])
+
+        // nothing in flight.
+        retired.retire(Object { released.append(2) })
+        XCTAssertEqual(released, [0, 1, 2])
+        XCTAssertEqual(retired.count, 0)
+    }
+}
+#endif